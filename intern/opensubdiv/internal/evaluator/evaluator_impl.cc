@@ -551,6 +551,44 @@ void convertPatchCoordsToArray(const OpenSubdiv_PatchCoord *patch_coords,
   }
 }
 
+size_t getStencilTableMemoryUsage(const StencilTable *stencil_table)
+{
+  if (stencil_table == NULL) {
+    return 0;
+  }
+  return stencil_table->GetSizes().size() * sizeof(int) +
+         stencil_table->GetOffsets().size() * sizeof(OpenSubdiv::Far::Index) +
+         stencil_table->GetControlIndices().size() * sizeof(OpenSubdiv::Far::Index) +
+         stencil_table->GetWeights().size() * sizeof(float);
+}
+
+// Data buffer which holds both coarse and refined vertices of the stencil table.
+size_t getStencilBufferMemoryUsage(const StencilTable *stencil_table, const int num_elements)
+{
+  if (stencil_table == NULL) {
+    return 0;
+  }
+  return size_t(stencil_table->GetNumControlVertices() + stencil_table->GetNumStencils()) *
+         num_elements * sizeof(float);
+}
+
+size_t getPatchTableMemoryUsage(const PatchTable *patch_table)
+{
+  return patch_table->GetPatchControlVerticesTable().size() * sizeof(OpenSubdiv::Far::Index) +
+         patch_table->GetPatchParamTable().size() * sizeof(OpenSubdiv::Far::PatchParam) +
+         patch_table->GetNumPatchesTotal() * sizeof(PatchTable::PatchHandle);
+}
+
+// Refined levels of the topology refiner. Every level stores the relations between its faces,
+// edges and vertices in both directions, along with offsets into those arrays and tags.
+size_t getRefinedTopologyMemoryUsage(const TopologyRefiner *refiner)
+{
+  return (size_t(refiner->GetNumFaceVerticesTotal()) * 4 +
+          size_t(refiner->GetNumFacesTotal()) * 4 + size_t(refiner->GetNumEdgesTotal()) * 10 +
+          size_t(refiner->GetNumVerticesTotal()) * 6) *
+         sizeof(int);
+}
+
 }  // namespace
 
 // Note: Define as a class instead of typedef to make it possible
@@ -751,7 +789,7 @@ void CpuEvalOutputAPI::evaluatePatchesLimit(const OpenSubdiv_PatchCoord *patch_c
 }  // namespace blender
 
 OpenSubdiv_EvaluatorImpl::OpenSubdiv_EvaluatorImpl()
-    : eval_output(NULL), patch_map(NULL), patch_table(NULL)
+    : eval_output(NULL), patch_map(NULL), patch_table(NULL), memory_usage(0)
 {
 }
 
@@ -877,6 +915,21 @@ OpenSubdiv_EvaluatorImpl *openSubdiv_createEvaluatorInternal(
   evaluator_descr->eval_output = new blender::opensubdiv::CpuEvalOutputAPI(eval_output, patch_map);
   evaluator_descr->patch_map = patch_map;
   evaluator_descr->patch_table = patch_table;
+  // The evaluator keeps copies of the stencil tables.
+  using blender::opensubdiv::getPatchTableMemoryUsage;
+  using blender::opensubdiv::getRefinedTopologyMemoryUsage;
+  using blender::opensubdiv::getStencilBufferMemoryUsage;
+  using blender::opensubdiv::getStencilTableMemoryUsage;
+  size_t memory_usage = getRefinedTopologyMemoryUsage(refiner) +
+                        getPatchTableMemoryUsage(patch_table);
+  memory_usage += getStencilTableMemoryUsage(vertex_stencils) +
+                  getStencilBufferMemoryUsage(vertex_stencils, 3);
+  memory_usage += getStencilTableMemoryUsage(varying_stencils) +
+                  getStencilBufferMemoryUsage(varying_stencils, 3);
+  for (const StencilTable *table : all_face_varying_stencils) {
+    memory_usage += getStencilTableMemoryUsage(table) + getStencilBufferMemoryUsage(table, 2);
+  }
+  evaluator_descr->memory_usage = memory_usage;
   // TOOD(sergey): Look into whether we've got duplicated stencils arrays.
   delete vertex_stencils;
   delete varying_stencils;
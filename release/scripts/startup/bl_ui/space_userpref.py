@@ -657,6 +657,16 @@ class USERPREF_PT_system_memory(SystemPanel, CenterAlignMixIn, Panel):
         col.prop(system, "vbo_collection_rate", text="Garbage Collection Rate")
 
 
+class USERPREF_PT_system_evaluation(SystemPanel, CenterAlignMixIn, Panel):
+    bl_label = "Evaluation"
+
+    def draw_centered(self, context, layout):
+        prefs = context.preferences
+        system = prefs.system
+
+        layout.prop(system, "use_depsgraph_priority_scheduling")
+
+
 class USERPREF_PT_system_video_sequencer(SystemPanel, CenterAlignMixIn, Panel):
     bl_label = "Video Sequencer"
 
@@ -2367,6 +2377,7 @@ classes = (
     USERPREF_PT_system_cycles_devices,
     USERPREF_PT_system_os_settings,
     USERPREF_PT_system_memory,
+    USERPREF_PT_system_evaluation,
     USERPREF_PT_system_video_sequencer,
     USERPREF_PT_system_sound,
 
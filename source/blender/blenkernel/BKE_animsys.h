@@ -241,6 +241,10 @@ bool BKE_animsys_rna_path_resolve(struct PointerRNA *ptr,
                                   struct PathResolvedRNA *r_result);
 bool BKE_animsys_read_from_rna_path(struct PathResolvedRNA *anim_rna, float *r_value);
 bool BKE_animsys_write_to_rna_path(struct PathResolvedRNA *anim_rna, const float value);
+void BKE_animsys_write_orig_anim_rna(struct PointerRNA *ptr,
+                                     const char *rna_path,
+                                     int array_index,
+                                     float value);
 
 /* Evaluation loop for evaluating animation data. */
 void BKE_animsys_evaluate_animdata(struct ID *id,
@@ -31,6 +31,8 @@ struct AnimationEvalContext;
 struct BMEditMesh;
 struct Bone;
 struct Depsgraph;
+struct DualQuat;
+struct GHash;
 struct IDProperty;
 struct ListBase;
 struct Main;
@@ -197,6 +199,11 @@ void BKE_pose_ensure(struct Main *bmain,
                      struct bArmature *arm,
                      const bool do_id_user);
 void BKE_pose_where_is(struct Depsgraph *depsgraph, struct Scene *scene, struct Object *ob);
+/* Independent groups of channels are solved in parallel, unless threading is disabled. */
+void BKE_pose_where_is_ex(struct Depsgraph *depsgraph,
+                          struct Scene *scene,
+                          struct Object *ob,
+                          const bool use_threading);
 void BKE_pose_where_is_bone(struct Depsgraph *depsgraph,
                             struct Scene *scene,
                             struct Object *ob,
@@ -483,6 +490,61 @@ void BKE_armature_deform_coords_with_editmesh(const struct Object *ob_arm,
                                               const char *defgrp_name,
                                               struct BMEditMesh *em_target);
 
+/** Flags of the channels in #PoseSkinningPalette. */
+enum {
+  /** The channel has a bone that deforms. */
+  POSE_SKINNING_DEFORM = (1 << 0),
+  /** The bone deforms with B-Bone segments. */
+  POSE_SKINNING_BBONE = (1 << 1),
+  /** The vertex group weights are multiplied by the bone envelope. */
+  POSE_SKINNING_MULT_VG_ENV = (1 << 2),
+};
+
+/**
+ * Deformation data of all channels of an evaluated pose, in flat arrays indexed like
+ * #bPose.chan_array. It is built once when the pose evaluation is done, and shared by all the
+ * objects deformed by the armature.
+ */
+typedef struct PoseSkinningPalette {
+  int channels_num;
+  struct bPoseChannel **channels;
+  /** Channel index for every channel name. */
+  struct GHash *channel_index_from_name;
+  uint8_t *flags;
+
+  /** Copies of #bPoseChannel.chan_mat and #bPoseChannel_Runtime.deform_dual_quat. */
+  float (*deform_mats)[4][4];
+  struct DualQuat *deform_dual_quats;
+
+  /**
+   * Copies of the B-Bone segment data of all channels, see #bPoseChannel_Runtime. The data of a
+   * channel starts at the same offset in both arrays, the dual quaternion arrays are padded.
+   */
+  int *bbone_offsets;
+  int bbone_len;
+  struct Mat4 *bbone_deform_mats;
+  struct DualQuat *bbone_dual_quats;
+
+  /**
+   * The pose was solved again outside of its evaluation, e.g. for sub-frame updates. Deforming
+   * objects then can't use the palette. It can't be freed, since other objects might be deformed
+   * at the same time.
+   */
+  bool is_outdated;
+} PoseSkinningPalette;
+
+struct PoseSkinningPalette *BKE_pose_skinning_palette_create(const struct bPose *pose);
+void BKE_pose_skinning_palette_free(struct PoseSkinningPalette *palette);
+/**
+ * Rebuild the palette of the pose, after its evaluation is done. The existing palette is updated
+ * in place when the channels didn't change.
+ */
+void BKE_pose_skinning_palette_update(struct bPose *pose);
+/** The pose was solved again after its evaluation, see #PoseSkinningPalette.is_outdated. */
+void BKE_pose_skinning_palette_tag_outdated(struct bPose *pose);
+/** Free the palette of the pose, when the pose channels changed. */
+void BKE_pose_skinning_palette_clear(struct bPose *pose);
+
 /** \} */
 
 #ifdef __cplusplus
@@ -0,0 +1,84 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup bke
+ *
+ * A compiled action stores the keyframes of all F-Curves of an action in flat arrays, with the
+ * Bezier segments already converted to polynomials. Evaluating it gives the same values as
+ * #evaluate_fcurve, but avoids the binary search over the keys when the time changes
+ * monotonically, and solves the Bezier segments of all channels together.
+ *
+ * Compiled actions are only created for evaluated copies of actions. Those are freed and copied
+ * again whenever the original action changes, so the compiled data never has to be invalidated
+ * explicitly.
+ */
+
+#include "BLI_sys_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct AnimData;
+struct AnimationEvalContext;
+struct CompiledAction;
+struct CompiledActionState;
+struct FCurve;
+struct PointerRNA;
+struct bAction;
+
+/**
+ * Get the compiled data of the action, creating it when it does not exist yet.
+ * This is thread safe, the action can be shared by IDs which are evaluated in parallel.
+ */
+const struct CompiledAction *BKE_compiled_action_ensure(struct bAction *act);
+void BKE_compiled_action_free(struct CompiledAction *compiled);
+
+/** Number of channels, which are all the F-Curves of the action that can be evaluated. */
+int BKE_compiled_action_channels_num(const struct CompiledAction *compiled);
+struct FCurve *BKE_compiled_action_channel_fcurve(const struct CompiledAction *compiled,
+                                                  int channel_index);
+
+/**
+ * Evaluate all channels at the given time.
+ *
+ * \param segment_hints: Index of the key segment that was used for every channel by the previous
+ * evaluation. Used as the starting point of the key search and updated for the next evaluation.
+ * Should be initialized to zero.
+ */
+void BKE_compiled_action_evaluate_channels(const struct CompiledAction *compiled,
+                                           float evaltime,
+                                           int *segment_hints,
+                                           float *r_values);
+
+/**
+ * Evaluate the active action of an evaluated ID and write the results to its properties.
+ * The resolved property paths and segment hints are kept in the animation data, so that they
+ * can be reused by the next evaluation.
+ */
+void BKE_compiled_action_evaluate_animdata(struct PointerRNA *ptr,
+                                           struct AnimData *adt,
+                                           struct bAction *act,
+                                           const struct AnimationEvalContext *anim_eval_context,
+                                           bool flush_to_original);
+void BKE_compiled_action_state_free(struct CompiledActionState *state);
+
+#ifdef __cplusplus
+}
+#endif
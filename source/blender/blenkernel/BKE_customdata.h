@@ -248,6 +248,14 @@ bool CustomData_is_referenced_layer(struct CustomData *data, int type);
 /* Duplicate all the layers with flag NOFREE, and remove the flag from duplicated layers. */
 void CustomData_duplicate_referenced_layers(CustomData *data, int totelem);
 
+/* Turn the layers owned by data into shared layers. They can then be copied with CD_REFERENCE
+ * without having to keep data alive, the layer data is freed together with its last user.
+ * Shared layers get the NOFREE flag, writing to them requires duplicating them first. */
+void CustomData_share_layers(struct CustomData *data, CustomDataMask mask, int totelem);
+/* Duplicate the layers with flag NOFREE that reference data owned elsewhere, keeping shared
+ * layers as they are. */
+void CustomData_duplicate_unshared_referenced_layers(struct CustomData *data, int totelem);
+
 /* set the CD_FLAG_NOCOPY flag in custom data layers where the mask is
  * zero for the layer type, so only layer types specified by the mask
  * will be copied
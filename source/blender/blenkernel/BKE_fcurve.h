@@ -322,6 +322,8 @@ float evaluate_fcurve_driver(struct PathResolvedRNA *anim_rna,
                              struct ChannelDriver *driver_orig,
                              const struct AnimationEvalContext *anim_eval_context);
 bool BKE_fcurve_is_empty(struct FCurve *fcu);
+bool BKE_fcurve_bezier_solve_parameter(
+    double c0, double c1, double c2, double c3, float *r_parameter);
 /* evaluate fcurve and store value */
 float calculate_fcurve(struct PathResolvedRNA *anim_rna,
                        struct FCurve *fcu,
@@ -94,6 +94,24 @@ void BKE_driver_invalidate_expression(struct ChannelDriver *driver,
                                       bool expr_changed,
                                       bool varname_changed);
 
+/**
+ * Counts of scripted expression evaluations since the last reset. Expressions that can not be
+ * handled by the simple expression evaluator need Python, which serializes driver evaluation.
+ * Only counted when depsgraph timing is enabled (`--debug-depsgraph-time`).
+ */
+typedef struct DriverExpressionStats {
+  uint64_t simple;
+  uint64_t python;
+  /* Reasons why the simple expression evaluator could not be used. */
+  uint64_t python_unknown_name;
+  uint64_t python_function_args;
+  uint64_t python_syntax;
+  uint64_t python_eval_error;
+} DriverExpressionStats;
+
+void BKE_driver_expression_stats_get(struct DriverExpressionStats *r_stats);
+void BKE_driver_expression_stats_reset(void);
+
 float evaluate_driver(struct PathResolvedRNA *anim_rna,
                       struct ChannelDriver *driver,
                       struct ChannelDriver *driver_orig,
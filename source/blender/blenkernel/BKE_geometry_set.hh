@@ -24,6 +24,7 @@
 #include <iostream>
 
 #include "BLI_float3.hh"
+#include "BLI_float4.hh"
 #include "BLI_float4x4.hh"
 #include "BLI_function_ref.hh"
 #include "BLI_hash.hh"
@@ -70,10 +71,16 @@ class GeometryComponent {
    * larger than one, the component becomes immutable. */
   mutable std::atomic<int> users_ = 1;
   GeometryComponentType type_;
+  /* Incremented whenever the component changes between being shared and being mutable. Results
+   * in the field cache are only reused while the version stays the same. */
+  mutable std::atomic<uint64_t> version_ = 0;
+  /* Results of field evaluations on this component while it is shared and therefore immutable.
+   * Only allocated when it is used, most components are never evaluated on when they are shared. */
+  mutable std::atomic<blender::fn::FieldCache *> field_cache_ = nullptr;
 
  public:
   GeometryComponent(GeometryComponentType type);
-  virtual ~GeometryComponent() = default;
+  virtual ~GeometryComponent();
   static GeometryComponent *create(GeometryComponentType component_type);
 
   /* The returned component should be of the same type as the type this is called on. */
@@ -89,6 +96,10 @@ class GeometryComponent {
   void user_remove() const;
   bool is_mutable() const;
 
+  uint64_t version() const;
+  /* Cache for field evaluations, only valid to use when the component is not mutable. */
+  blender::fn::FieldCache &field_cache() const;
+
   GeometryComponentType type() const;
 
   /* Return true when any attribute with this name exists, including built in attributes. */
@@ -620,8 +631,24 @@ class InstancesComponent : public GeometryComponent {
 
   /** Index into `references_`. Determines what data is instanced. */
   blender::Vector<int> instance_reference_handles_;
-  /** Transformation of the instances. */
+  /** Transformation of the instances. Only used when #use_compact_transforms_ is false. */
   blender::Vector<blender::float4x4> instance_transforms_;
+
+  /**
+   * When true, the transforms are stored as separate position, rotation and scale arrays instead
+   * of matrices. That needs less memory and the transform nodes can work on the components
+   * directly, but transforms with shear can't be represented. The rotations are quaternions in
+   * the (w, x, y, z) order used by `BLI_math_rotation.h`.
+   */
+  bool use_compact_transforms_ = false;
+  blender::Vector<blender::float3> instance_positions_;
+  blender::Vector<blender::float4> instance_rotations_;
+  blender::Vector<blender::float3> instance_scales_;
+
+  /* Matrices built from the compact transforms on demand, for read-only access to matrices. */
+  mutable std::mutex transforms_cache_mutex_;
+  mutable blender::Array<blender::float4x4> transforms_cache_;
+  mutable bool transforms_cache_dirty_ = true;
   /**
    * IDs of the instances. They are used for consistency over multiple frames for things like
    * motion blur. Proper stable ID data that actually helps when rendering can only be generated
@@ -649,6 +676,10 @@ class InstancesComponent : public GeometryComponent {
 
   int add_reference(const InstanceReference &reference);
   void add_instance(int instance_handle, const blender::float4x4 &transform);
+  void add_instance(int instance_handle,
+                    const blender::float3 &position,
+                    const blender::float4 &rotation,
+                    const blender::float3 &scale);
 
   blender::Span<InstanceReference> references() const;
   void remove_unused_references();
@@ -660,6 +691,17 @@ class InstancesComponent : public GeometryComponent {
   blender::MutableSpan<int> instance_reference_handles();
   blender::MutableSpan<blender::float4x4> instance_transforms();
   blender::Span<blender::float4x4> instance_transforms() const;
+  blender::float4x4 instance_transform(int index) const;
+
+  bool has_compact_transforms() const;
+  void use_compact_transforms();
+  void ensure_matrix_transforms();
+  blender::MutableSpan<blender::float3> instance_positions();
+  blender::Span<blender::float3> instance_positions() const;
+  blender::MutableSpan<blender::float4> instance_rotations();
+  blender::Span<blender::float4> instance_rotations() const;
+  blender::MutableSpan<blender::float3> instance_scales();
+  blender::Span<blender::float3> instance_scales() const;
   blender::MutableSpan<int> instance_ids();
   blender::Span<int> instance_ids() const;
 
@@ -734,6 +776,9 @@ class GeometryComponentFieldContext : public fn::FieldContext {
   {
     return domain_;
   }
+
+  fn::FieldCache *field_cache() const override;
+  uint64_t field_cache_key() const override;
 };
 
 class AttributeFieldInput : public fn::FieldInput {
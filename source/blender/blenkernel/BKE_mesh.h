@@ -125,6 +125,15 @@ void BKE_mesh_eval_delete(struct Mesh *mesh_eval);
  * optional referencing original arrays to reduce memory. */
 struct Mesh *BKE_mesh_copy_for_eval(const struct Mesh *source, bool reference);
 
+/* Performs copy for use during evaluation, sharing the custom data layers of the source instead
+ * of duplicating them. Both meshes have to duplicate a layer before writing to it and
+ * the source can be freed independently of the copy. Since not all code that writes to layers
+ * of evaluated meshes does that, only use this when the source is freed right after.
+ * It is not used for copy-on-write copies and #BKE_mesh_copy_for_eval, which copy meshes that
+ * are written to in place. #BKE_mesh_new_nomain_from_template allocates new layers, so there is
+ * no data to share. */
+struct Mesh *BKE_mesh_copy_for_eval_shared(struct Mesh *source);
+
 /* These functions construct a new Mesh,
  * contrary to BKE_mesh_to_curve_nurblist which modifies ob itself. */
 struct Mesh *BKE_mesh_new_nomain_from_curve(const struct Object *ob);
@@ -339,6 +339,7 @@ class BezierSpline final : public Spline {
   blender::Span<int> control_point_offsets() const;
   blender::Span<float> evaluated_mappings() const;
   blender::Span<blender::float3> evaluated_positions() const final;
+  void evaluate_positions(blender::MutableSpan<blender::float3> r_positions) const;
   struct InterpolationData {
     int control_point_index;
     int next_control_point_index;
@@ -486,6 +487,7 @@ class NURBSpline final : public Spline {
   int evaluated_points_size() const final;
 
   blender::Span<blender::float3> evaluated_positions() const final;
+  void evaluate_positions(blender::MutableSpan<blender::float3> r_positions) const;
 
   blender::fn::GVArrayPtr interpolate_to_evaluated(const blender::fn::GVArray &src) const final;
 
@@ -582,6 +584,11 @@ struct CurveEval {
   blender::Array<int> evaluated_point_offsets() const;
   blender::Array<float> accumulated_spline_lengths() const;
 
+  void ensure_evaluated_positions() const;
+  void ensure_evaluated_normals() const;
+  void evaluate_positions(blender::Span<int> offsets,
+                          blender::MutableSpan<blender::float3> r_positions) const;
+
   void mark_cache_invalid();
 
   void assert_valid_point_attributes() const;
@@ -36,6 +36,7 @@ struct OpenSubdiv_Converter;
 struct OpenSubdiv_Evaluator;
 struct OpenSubdiv_TopologyRefiner;
 struct Subdiv;
+struct SubdivCacheEntry;
 
 typedef enum eSubdivVtxBoundaryInterpolation {
   /* Do not interpolate boundaries. */
@@ -190,9 +191,31 @@ typedef struct Subdiv {
     /* Indexed by base face index, element indicates total number of ptex
      * faces created for preceding base faces. */
     int *face_ptex_offset;
+    /* Hash of the coarse topology, used to find descriptors in the descriptors cache. */
+    uint32_t topology_hash;
+    bool has_topology_hash;
+    /* Entry of the descriptors cache, NULL when the descriptor is not managed by the cache. */
+    struct SubdivCacheEntry *entry;
   } cache_;
 } Subdiv;
 
+/* Statistics of the descriptors cache. */
+typedef struct SubdivCacheStats {
+  /* Number of times a descriptor was requested from the cache and was found or not. */
+  int num_hits;
+  int num_misses;
+  /* Number of descriptors freed to keep the memory usage within the limit. */
+  int num_evictions;
+  /* Descriptors which are in use and their total number of users. There are more users than
+   * descriptors when descriptors are shared. */
+  int num_used;
+  int num_users;
+  /* Descriptors which are not used by anyone and their estimated memory usage. */
+  int num_entries;
+  size_t memory_used;
+  size_t memory_limit;
+} SubdivCacheStats;
+
 /* =================----====--===== MODULE ==========================------== */
 
 /* (De)initialize the entire subdivision surface module. */
@@ -247,6 +270,39 @@ Subdiv *BKE_subdiv_update_from_mesh(Subdiv *subdiv,
 
 void BKE_subdiv_free(Subdiv *subdiv);
 
+/* ============================ DESCRIPTORS CACHE =========================== */
+
+/* Descriptors are shared by everyone who requests a descriptor for the same settings and
+ * topology, for example by objects which use the same base mesh. Descriptors which are no longer
+ * used are kept in the cache, from where they are picked up again. This avoids rebuilding the
+ * topology refiner and evaluator when the runtime data of a modifier is freed, for example on undo
+ * or when the same base mesh is subdivided again later on.
+ *
+ * The evaluator of a shared descriptor holds the coarse positions of one user at a time, so users
+ * evaluate it between BKE_subdiv_cache_eval_lock() and BKE_subdiv_cache_eval_unlock(). */
+
+/* Same as BKE_subdiv_update_from_mesh(), but the descriptor comes from the cache when possible.
+ * An existing descriptor which does not match the settings or topology is released to the cache
+ * instead of being freed. Descriptors from the cache have their evaluator created already. */
+Subdiv *BKE_subdiv_update_from_mesh_cached(Subdiv *subdiv,
+                                           const SubdivSettings *settings,
+                                           const struct Mesh *mesh);
+
+/* Give up the descriptor. When it has no other users it is kept in the cache for re-use for as
+ * long as the memory limit of the cache allows, and freed otherwise. */
+void BKE_subdiv_cache_release(Subdiv *subdiv);
+
+/* Serialize evaluation of a descriptor which might be shared with other users. */
+void BKE_subdiv_cache_eval_lock(Subdiv *subdiv);
+void BKE_subdiv_cache_eval_unlock(Subdiv *subdiv);
+
+/* Free all descriptors stored in the cache. */
+void BKE_subdiv_cache_clear(void);
+
+void BKE_subdiv_cache_memory_limit_set(size_t memory_limit);
+void BKE_subdiv_cache_stats_get(SubdivCacheStats *r_stats);
+void BKE_subdiv_cache_stats_print(void);
+
 /* ============================ DISPLACEMENT API ============================ */
 
 void BKE_subdiv_displacement_attach_from_multires(Subdiv *subdiv,
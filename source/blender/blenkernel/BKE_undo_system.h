@@ -132,7 +132,11 @@ typedef struct UndoType {
   void (*step_encode_init)(struct bContext *C, UndoStep *us);
 
   bool (*step_encode)(struct bContext *C, struct Main *bmain, UndoStep *us);
-  void (*step_decode)(
+  /**
+   * Return false when the step could not be loaded, the undo or redo stops at the previous step
+   * then.
+   */
+  bool (*step_decode)(
       struct bContext *C, struct Main *bmain, UndoStep *us, const eUndoStepDir dir, bool is_final);
 
   /**
@@ -1536,6 +1536,23 @@ static void editbmesh_calc_modifier_final_normals(Mesh *mesh_final,
   }
 }
 
+/**
+ * Replace the final mesh with a copy that deformed coordinates can be applied to.
+ *
+ * When the final mesh is not the cage it is freed right away, so the copy can share its layers
+ * and only the vertices are copied when they are written. The cage is kept as is and must not
+ * share layers with the final mesh, since modifiers write to layers of their input in place.
+ */
+static Mesh *editbmesh_copy_final_for_deform(Mesh *mesh_final, const Mesh *mesh_cage)
+{
+  if (mesh_final == mesh_cage) {
+    return BKE_mesh_copy_for_eval(mesh_final, false);
+  }
+  Mesh *mesh_copy = BKE_mesh_copy_for_eval_shared(mesh_final);
+  BKE_id_free(nullptr, mesh_final);
+  return mesh_copy;
+}
+
 static void editbmesh_calc_modifiers(struct Depsgraph *depsgraph,
                                      Scene *scene,
                                      Object *ob,
@@ -1656,11 +1673,7 @@ static void editbmesh_calc_modifiers(struct Depsgraph *depsgraph,
       /* apply vertex coordinates or build a DerivedMesh as necessary */
       if (mesh_final) {
         if (deformed_verts) {
-          Mesh *mesh_tmp = BKE_mesh_copy_for_eval(mesh_final, false);
-          if (mesh_final != mesh_cage) {
-            BKE_id_free(nullptr, mesh_final);
-          }
-          mesh_final = mesh_tmp;
+          mesh_final = editbmesh_copy_final_for_deform(mesh_final, mesh_cage);
           BKE_mesh_vert_coords_apply(mesh_final, deformed_verts);
         }
         else if (mesh_final == mesh_cage) {
@@ -1770,11 +1783,7 @@ static void editbmesh_calc_modifiers(struct Depsgraph *depsgraph,
    * then we need to build one. */
   if (mesh_final) {
     if (deformed_verts) {
-      Mesh *mesh_tmp = BKE_mesh_copy_for_eval(mesh_final, false);
-      if (mesh_final != mesh_cage) {
-        BKE_id_free(nullptr, mesh_final);
-      }
-      mesh_final = mesh_tmp;
+      mesh_final = editbmesh_copy_final_for_deform(mesh_final, mesh_cage);
       BKE_mesh_vert_coords_apply(mesh_final, deformed_verts);
     }
   }
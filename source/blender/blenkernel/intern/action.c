@@ -52,6 +52,7 @@
 #include "BKE_animsys.h"
 #include "BKE_armature.h"
 #include "BKE_asset.h"
+#include "BKE_compiled_action.h"
 #include "BKE_constraint.h"
 #include "BKE_deform.h"
 #include "BKE_fcurve.h"
@@ -151,6 +152,8 @@ static void action_copy_data(Main *UNUSED(bmain), ID *id_dst, const ID *id_src,
   else {
     BKE_previewimg_id_copy(&action_dst->id, &action_src->id);
   }
+
+  action_dst->compiled = NULL;
 }
 
 /** Free (or release) any data used by this action (does not free the action itself). */
@@ -169,6 +172,12 @@ static void action_free_data(struct ID *id)
   BLI_freelistN(&action->markers);
 
   BKE_previewimg_free(&action->preview);
+
+  /* Free runtime data. */
+  if (action->compiled) {
+    BKE_compiled_action_free(action->compiled);
+    action->compiled = NULL;
+  }
 }
 
 static void action_foreach_id(ID *id, LibraryForeachIDData *data)
@@ -230,6 +239,8 @@ static void action_blend_read_data(BlendDataReader *reader, ID *id)
 
   BLO_read_data_address(reader, &act->preview);
   BKE_previewimg_blend_read(reader, act->preview);
+
+  act->compiled = NULL;
 }
 
 static void blend_read_lib_constraint_channels(BlendLibReader *reader, ID *id, ListBase *chanbase)
@@ -1172,6 +1183,7 @@ void BKE_pose_channels_free_ex(bPose *pose, bool do_id_user)
   BKE_pose_channels_hash_free(pose);
 
   MEM_SAFE_FREE(pose->chan_array);
+  BKE_pose_skinning_palette_clear(pose);
 }
 
 void BKE_pose_channels_free(bPose *pose)
@@ -1979,6 +1991,7 @@ void BKE_pose_blend_read_data(BlendDataReader *reader, bPose *pose)
 
   pose->chanhash = NULL;
   pose->chan_array = NULL;
+  pose->skinning_palette = NULL;
 
   LISTBASE_FOREACH (bPoseChannel *, pchan, &pose->chanbase) {
     BKE_pose_channel_runtime_reset(&pchan->runtime);
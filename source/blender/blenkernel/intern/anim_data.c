@@ -27,6 +27,7 @@
 #include "BKE_action.h"
 #include "BKE_anim_data.h"
 #include "BKE_animsys.h"
+#include "BKE_compiled_action.h"
 #include "BKE_context.h"
 #include "BKE_fcurve.h"
 #include "BKE_fcurve_driver.h"
@@ -258,6 +259,11 @@ void BKE_animdata_free(ID *id, const bool do_id_user)
       /* free driver array cache */
       MEM_SAFE_FREE(adt->driver_array);
 
+      /* free cached evaluation state of the active action */
+      if (adt->compiled_action_state) {
+        BKE_compiled_action_state_free(adt->compiled_action_state);
+      }
+
       /* free overrides */
       /* TODO... */
 
@@ -359,6 +365,7 @@ AnimData *BKE_animdata_copy(Main *bmain, AnimData *adt, const int flag)
   /* duplicate drivers (F-Curves) */
   BKE_fcurves_copy(&dadt->drivers, &adt->drivers);
   dadt->driver_array = NULL;
+  dadt->compiled_action_state = NULL;
 
   /* don't copy overrides */
   BLI_listbase_clear(&dadt->overrides);
@@ -1580,6 +1587,7 @@ void BKE_animdata_blend_read_data(BlendDataReader *reader, AnimData *adt)
   BLO_read_list(reader, &adt->drivers);
   BKE_fcurve_blend_read_data(reader, &adt->drivers);
   adt->driver_array = NULL;
+  adt->compiled_action_state = NULL;
 
   /* link overrides */
   /* TODO... */
@@ -53,6 +53,7 @@
 #include "BKE_action.h"
 #include "BKE_anim_data.h"
 #include "BKE_animsys.h"
+#include "BKE_compiled_action.h"
 #include "BKE_context.h"
 #include "BKE_fcurve.h"
 #include "BKE_global.h"
@@ -580,10 +581,11 @@ static bool animsys_construct_orig_pointer_rna(const PointerRNA *ptr, PointerRNA
   return true;
 }
 
-static void animsys_write_orig_anim_rna(PointerRNA *ptr,
-                                        const char *rna_path,
-                                        int array_index,
-                                        float value)
+/* Write the value to the original data-block, for evaluated copies of the active depsgraph. */
+void BKE_animsys_write_orig_anim_rna(PointerRNA *ptr,
+                                     const char *rna_path,
+                                     int array_index,
+                                     float value)
 {
   PointerRNA ptr_orig;
   if (!animsys_construct_orig_pointer_rna(ptr, &ptr_orig)) {
@@ -618,7 +620,7 @@ static void animsys_evaluate_fcurves(PointerRNA *ptr,
       const float curval = calculate_fcurve(&anim_rna, fcu, anim_eval_context);
       BKE_animsys_write_to_rna_path(&anim_rna, curval);
       if (flush_to_original) {
-        animsys_write_orig_anim_rna(ptr, fcu->rna_path, fcu->array_index, curval);
+        BKE_animsys_write_orig_anim_rna(ptr, fcu->rna_path, fcu->array_index, curval);
       }
     }
   }
@@ -2481,7 +2483,7 @@ void nladata_flush_channels(PointerRNA *ptr,
         }
         BKE_animsys_write_to_rna_path(&rna, value);
         if (flush_to_original) {
-          animsys_write_orig_anim_rna(ptr, nec->rna_path, rna.prop_index, value);
+          BKE_animsys_write_orig_anim_rna(ptr, nec->rna_path, rna.prop_index, value);
         }
       }
     }
@@ -3307,7 +3309,16 @@ void BKE_animsys_evaluate_animdata(ID *id,
     }
     /* evaluate Active Action only */
     else if (adt->action) {
-      animsys_evaluate_action(&id_ptr, adt->action, anim_eval_context, flush_to_original);
+      if (DEG_is_evaluated_id(id) && DEG_is_evaluated_id(&adt->action->id)) {
+        /* Evaluated copies are copied again when the ID or the action changes, which makes it
+         * possible to keep the compiled action and resolved paths between evaluations. */
+        action_idcode_patch_check(id, adt->action);
+        BKE_compiled_action_evaluate_animdata(
+            &id_ptr, adt, adt->action, anim_eval_context, flush_to_original);
+      }
+      else {
+        animsys_evaluate_action(&id_ptr, adt->action, anim_eval_context, flush_to_original);
+      }
     }
   }
 
@@ -3567,7 +3578,7 @@ void BKE_animsys_eval_driver(Depsgraph *depsgraph, ID *id, int driver_index, FCu
 
         /* Flush results & status codes to original data for UI (T59984) */
         if (ok && DEG_is_active(depsgraph)) {
-          animsys_write_orig_anim_rna(&id_ptr, fcu->rna_path, fcu->array_index, curval);
+          BKE_animsys_write_orig_anim_rna(&id_ptr, fcu->rna_path, fcu->array_index, curval);
 
           /* curval is displayed in the UI, and flag contains error-status codes */
           fcu_orig->curval = fcu->curval;
@@ -35,6 +35,7 @@
 #include "BLI_listbase.h"
 #include "BLI_math.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "BLT_translation.h"
 
@@ -2824,9 +2825,187 @@ void BKE_pose_where_is_bone(struct Depsgraph *depsgraph,
   BKE_pose_where_is_bone_tail(pchan);
 }
 
+/* Solve the pose channel, or the IK tree it is the root of. */
+static void pose_channel_solve(
+    struct Depsgraph *depsgraph, Scene *scene, Object *ob, bPoseChannel *pchan, float ctime)
+{
+  /* 4a. if we find an IK root, we handle it separated */
+  if (pchan->flag & POSE_IKTREE) {
+    BIK_execute_tree(depsgraph, scene, ob, pchan, ctime);
+  }
+  /* 4b. if we find a Spline IK root, we handle it separated too */
+  else if (pchan->flag & POSE_IKSPLINE) {
+    BKE_splineik_execute_tree(depsgraph, scene, ob, pchan, ctime);
+  }
+  /* 5. otherwise just call the normal solver */
+  else if (!(pchan->flag & POSE_DONE)) {
+    BKE_pose_where_is_bone(depsgraph, scene, ob, pchan, ctime, 1);
+  }
+}
+
+/* Poses with fewer channels are always solved on a single thread. */
+#define POSE_PARALLEL_MIN_CHANNELS 64
+
+/**
+ * Channels of a pose split into groups that don't depend on each other: a root bone with all of
+ * its children, joined with the groups of the bones that are used as constraint targets. IK and
+ * Spline IK trees only contain channels of the hierarchy below their root, so every tree is
+ * solved as part of a single group.
+ */
+typedef struct PoseSolveGroups {
+  int groups_num;
+  /* The channels of group i are channels[group_offsets[i]] to channels[group_offsets[i + 1]],
+   * in the hierarchical order of the pose. */
+  int *group_offsets;
+  bPoseChannel **channels;
+  /* Single allocation holding all arrays. */
+  void *buffer;
+} PoseSolveGroups;
+
+/* Union-find over the indices of the channels, stored in their runtime data. */
+static int pose_solve_group_find(bPoseChannel **channels, int index)
+{
+  while (channels[index]->runtime.solve_group != index) {
+    bPoseChannel_Runtime *runtime = &channels[index]->runtime;
+    runtime->solve_group = channels[runtime->solve_group]->runtime.solve_group;
+    index = runtime->solve_group;
+  }
+  return index;
+}
+
+static void pose_solve_group_join(bPoseChannel **channels, int a, int b)
+{
+  a = pose_solve_group_find(channels, a);
+  b = pose_solve_group_find(channels, b);
+  /* The channel with the lowest index represents the group, to keep the order of the pose. */
+  if (a < b) {
+    channels[b]->runtime.solve_group = a;
+  }
+  else if (b < a) {
+    channels[a]->runtime.solve_group = b;
+  }
+}
+
+/**
+ * \return False when the pose should be solved on a single thread, because it is small, has no
+ * independent groups, or has Python constraints which need the interpreter lock.
+ */
+static bool pose_solve_groups_build(Object *ob, PoseSolveGroups *r_groups)
+{
+  bPose *pose = ob->pose;
+  const int channels_num = BLI_listbase_count(&pose->chanbase);
+  if (channels_num < POSE_PARALLEL_MIN_CHANNELS) {
+    return false;
+  }
+
+  /* Channels in the order of the pose and sorted by group, then the offsets and the fill position
+   * of every group. There are at most as many groups as channels. */
+  void *buffer = MEM_mallocN(sizeof(bPoseChannel *) * (size_t)channels_num * 2 +
+                                 sizeof(int) * (size_t)(channels_num * 2 + 1),
+                             __func__);
+  bPoseChannel **channels = buffer;
+  bPoseChannel **channels_sorted = channels + channels_num;
+  int *group_offsets = (int *)(channels_sorted + channels_num);
+  int *group_fill = group_offsets + channels_num + 1;
+
+  int i;
+  LISTBASE_FOREACH_INDEX (bPoseChannel *, pchan, &pose->chanbase, i) {
+    channels[i] = pchan;
+    pchan->runtime.solve_index = i;
+    pchan->runtime.solve_group = i;
+  }
+
+  bool use_threading = true;
+  for (i = 0; i < channels_num && use_threading; i++) {
+    bPoseChannel *pchan = channels[i];
+    if (pchan->parent) {
+      pose_solve_group_join(channels, i, pchan->parent->runtime.solve_index);
+    }
+
+    LISTBASE_FOREACH (bConstraint *, con, &pchan->constraints) {
+      if (con->type == CONSTRAINT_TYPE_PYTHON) {
+        use_threading = false;
+        break;
+      }
+      const bConstraintTypeInfo *cti = BKE_constraint_typeinfo_get(con);
+      if (cti == NULL || cti->get_constraint_targets == NULL) {
+        continue;
+      }
+      ListBase targets = {NULL, NULL};
+      cti->get_constraint_targets(con, &targets);
+      LISTBASE_FOREACH (bConstraintTarget *, ct, &targets) {
+        if (ct->tar == ob && ct->subtarget[0] != '\0') {
+          bPoseChannel *pchan_target = BKE_pose_channel_find_name(pose, ct->subtarget);
+          if (pchan_target != NULL) {
+            pose_solve_group_join(channels, i, pchan_target->runtime.solve_index);
+          }
+        }
+      }
+      if (cti->flush_constraint_targets) {
+        cti->flush_constraint_targets(con, &targets, true);
+      }
+    }
+  }
+
+  /* Number the groups in the order of their first channel. The index of a channel is not needed
+   * anymore, so it is replaced by the index of its group. Roots come before the other channels of
+   * their group. */
+  int groups_num = 0;
+  for (i = 0; i < channels_num && use_threading; i++) {
+    const int root = pose_solve_group_find(channels, i);
+    channels[i]->runtime.solve_index = (root == i) ? groups_num++ :
+                                                     channels[root]->runtime.solve_index;
+  }
+
+  if (!use_threading || groups_num < 2) {
+    MEM_freeN(buffer);
+    return false;
+  }
+
+  /* Sort the channels by group, keeping their order within the groups. */
+  memset(group_offsets, 0, sizeof(int) * (size_t)(groups_num + 1));
+  for (i = 0; i < channels_num; i++) {
+    group_offsets[channels[i]->runtime.solve_index + 1]++;
+  }
+  for (i = 0; i < groups_num; i++) {
+    group_offsets[i + 1] += group_offsets[i];
+  }
+  memcpy(group_fill, group_offsets, sizeof(int) * (size_t)groups_num);
+  for (i = 0; i < channels_num; i++) {
+    channels_sorted[group_fill[channels[i]->runtime.solve_index]++] = channels[i];
+  }
+  r_groups->groups_num = groups_num;
+  r_groups->group_offsets = group_offsets;
+  r_groups->channels = channels_sorted;
+  r_groups->buffer = buffer;
+  return true;
+}
+
+typedef struct PoseSolveGroupsData {
+  struct Depsgraph *depsgraph;
+  Scene *scene;
+  Object *ob;
+  float ctime;
+  const PoseSolveGroups *groups;
+} PoseSolveGroupsData;
+
+static void pose_solve_group_task(void *__restrict userdata,
+                                  const int group,
+                                  const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const PoseSolveGroupsData *data = userdata;
+  const PoseSolveGroups *groups = data->groups;
+  for (int i = groups->group_offsets[group]; i < groups->group_offsets[group + 1]; i++) {
+    pose_channel_solve(data->depsgraph, data->scene, data->ob, groups->channels[i], data->ctime);
+  }
+}
+
 /* This only reads anim data from channels, and writes to channels */
 /* This is the only function adding poses */
-void BKE_pose_where_is(struct Depsgraph *depsgraph, Scene *scene, Object *ob)
+void BKE_pose_where_is_ex(struct Depsgraph *depsgraph,
+                          Scene *scene,
+                          Object *ob,
+                          const bool use_threading)
 {
   bArmature *arm;
   Bone *bone;
@@ -2876,19 +3055,26 @@ void BKE_pose_where_is(struct Depsgraph *depsgraph, Scene *scene, Object *ob)
      */
     BKE_pose_splineik_init_tree(scene, ob, ctime);
 
-    /* 3. the main loop, channels are already hierarchical sorted from root to children */
-    for (pchan = ob->pose->chanbase.first; pchan; pchan = pchan->next) {
-      /* 4a. if we find an IK root, we handle it separated */
-      if (pchan->flag & POSE_IKTREE) {
-        BIK_execute_tree(depsgraph, scene, ob, pchan, ctime);
-      }
-      /* 4b. if we find a Spline IK root, we handle it separated too */
-      else if (pchan->flag & POSE_IKSPLINE) {
-        BKE_splineik_execute_tree(depsgraph, scene, ob, pchan, ctime);
-      }
-      /* 5. otherwise just call the normal solver */
-      else if (!(pchan->flag & POSE_DONE)) {
-        BKE_pose_where_is_bone(depsgraph, scene, ob, pchan, ctime, 1);
+    /* 3. the main loop, channels are already hierarchical sorted from root to children.
+     * Independent groups of channels are solved in parallel. */
+    PoseSolveGroups groups;
+    if (use_threading && pose_solve_groups_build(ob, &groups)) {
+      PoseSolveGroupsData data = {
+          .depsgraph = depsgraph,
+          .scene = scene,
+          .ob = ob,
+          .ctime = ctime,
+          .groups = &groups,
+      };
+      TaskParallelSettings settings;
+      BLI_parallel_range_settings_defaults(&settings);
+      settings.min_iter_per_thread = 1;
+      BLI_task_parallel_range(0, groups.groups_num, &data, pose_solve_group_task, &settings);
+      MEM_freeN(groups.buffer);
+    }
+    else {
+      for (pchan = ob->pose->chanbase.first; pchan; pchan = pchan->next) {
+        pose_channel_solve(depsgraph, scene, ob, pchan, ctime);
       }
     }
     /* 6. release the IK tree */
@@ -2902,6 +3088,15 @@ void BKE_pose_where_is(struct Depsgraph *depsgraph, Scene *scene, Object *ob)
       mul_m4_m4m4(pchan->chan_mat, pchan->pose_mat, imat);
     }
   }
+
+  /* The deformation of the pose changed. This can run during the depsgraph evaluation while other
+   * objects are deformed by the palette, so it is only tagged. */
+  BKE_pose_skinning_palette_tag_outdated(ob->pose);
+}
+
+void BKE_pose_where_is(struct Depsgraph *depsgraph, Scene *scene, Object *ob)
+{
+  BKE_pose_where_is_ex(depsgraph, scene, ob, true);
 }
 
 /** \} */
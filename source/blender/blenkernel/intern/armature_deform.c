@@ -32,8 +32,10 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "BLI_ghash.h"
 #include "BLI_listbase.h"
 #include "BLI_math.h"
+#include "BLI_simd.h"
 #include "BLI_task.h"
 #include "BLI_utildefines.h"
 
@@ -96,15 +98,17 @@ static void pchan_deform_accumulate(const DualQuat *deform_dq,
   }
 }
 
-static void b_bone_deform(const bPoseChannel *pchan,
+static void b_bone_deform(const PoseSkinningPalette *palette,
+                          const int channel,
                           const float co[3],
                           float weight,
                           float vec[3],
                           DualQuat *dq,
                           float defmat[3][3])
 {
-  const DualQuat *quats = pchan->runtime.bbone_dual_quats;
-  const Mat4 *mats = pchan->runtime.bbone_deform_mats;
+  const bPoseChannel *pchan = palette->channels[channel];
+  const DualQuat *quats = &palette->bbone_dual_quats[palette->bbone_offsets[channel]];
+  const Mat4 *mats = &palette->bbone_deform_mats[palette->bbone_offsets[channel]];
   const float(*mat)[4] = mats[0].mat;
   float blend, y;
   int index;
@@ -175,10 +179,14 @@ float distfactor_to_bone(
   return 1.0f - (a * a) / (rdist * rdist);
 }
 
-static float dist_bone_deform(
-    bPoseChannel *pchan, float vec[3], DualQuat *dq, float mat[3][3], const float co[3])
+static float dist_bone_deform(const PoseSkinningPalette *palette,
+                              const int channel,
+                              float vec[3],
+                              DualQuat *dq,
+                              float mat[3][3],
+                              const float co[3])
 {
-  Bone *bone = pchan->bone;
+  const Bone *bone = palette->channels[channel]->bone;
   float fac, contrib = 0.0;
 
   if (bone == NULL) {
@@ -192,12 +200,17 @@ static float dist_bone_deform(
     fac *= bone->weight;
     contrib = fac;
     if (contrib > 0.0f) {
-      if (bone->segments > 1 && pchan->runtime.bbone_segments == bone->segments) {
-        b_bone_deform(pchan, co, fac, vec, dq, mat);
+      if (palette->flags[channel] & POSE_SKINNING_BBONE) {
+        b_bone_deform(palette, channel, co, fac, vec, dq, mat);
       }
       else {
-        pchan_deform_accumulate(
-            &pchan->runtime.deform_dual_quat, pchan->chan_mat, co, fac, vec, dq, mat);
+        pchan_deform_accumulate(&palette->deform_dual_quats[channel],
+                                palette->deform_mats[channel],
+                                co,
+                                fac,
+                                vec,
+                                dq,
+                                mat);
       }
     }
   }
@@ -205,7 +218,8 @@ static float dist_bone_deform(
   return contrib;
 }
 
-static void pchan_bone_deform(bPoseChannel *pchan,
+static void pchan_bone_deform(const PoseSkinningPalette *palette,
+                              const int channel,
                               float weight,
                               float vec[3],
                               DualQuat *dq,
@@ -213,18 +227,21 @@ static void pchan_bone_deform(bPoseChannel *pchan,
                               const float co[3],
                               float *contrib)
 {
-  Bone *bone = pchan->bone;
-
   if (!weight) {
     return;
   }
 
-  if (bone->segments > 1 && pchan->runtime.bbone_segments == bone->segments) {
-    b_bone_deform(pchan, co, weight, vec, dq, mat);
+  if (palette->flags[channel] & POSE_SKINNING_BBONE) {
+    b_bone_deform(palette, channel, co, weight, vec, dq, mat);
   }
   else {
-    pchan_deform_accumulate(
-        &pchan->runtime.deform_dual_quat, pchan->chan_mat, co, weight, vec, dq, mat);
+    pchan_deform_accumulate(&palette->deform_dual_quats[channel],
+                            palette->deform_mats[channel],
+                            co,
+                            weight,
+                            vec,
+                            dq,
+                            mat);
   }
 
   (*contrib) += weight;
@@ -256,18 +273,79 @@ typedef struct ArmatureUserdata {
   const MDeformVert *dverts;
   int dverts_len;
 
-  bPoseChannel **pchan_from_defbase;
+  const PoseSkinningPalette *palette;
+  /** Index of the palette channel of every vertex group, or -1 for non-deforming groups. */
+  const int *channel_from_defbase;
   int defbase_len;
 
   float premat[4][4];
   float postmat[4][4];
 
+  int vert_coords_len;
+
   /** Specific data types. */
   struct {
     int cd_dvert_offset;
   } bmesh;
 } ArmatureUserdata;
 
+/**
+ * Apply the accumulated bone influences to the vertex coordinate, which is in armature space,
+ * and transform it back to the space of the target object.
+ */
+static void armature_vert_apply_deform(const ArmatureUserdata *data,
+                                       const int i,
+                                       float co[3],
+                                       const float contrib,
+                                       const float armature_weight,
+                                       float vec[3],
+                                       DualQuat *dq,
+                                       float summat[3][3])
+{
+  float(*const vert_deform_mats)[3][3] = data->vert_deform_mats;
+  const bool use_quaternion = data->use_quaternion;
+  float dco[3];
+
+  /* actually should be EPSILON? weight values and contrib can be like 10e-39 small */
+  if (contrib > 0.0001f) {
+    if (use_quaternion) {
+      normalize_dq(dq, contrib);
+
+      if (armature_weight != 1.0f) {
+        copy_v3_v3(dco, co);
+        mul_v3m3_dq(dco, (vert_deform_mats) ? summat : NULL, dq);
+        sub_v3_v3(dco, co);
+        mul_v3_fl(dco, armature_weight);
+        add_v3_v3(co, dco);
+      }
+      else {
+        mul_v3m3_dq(co, (vert_deform_mats) ? summat : NULL, dq);
+      }
+    }
+    else {
+      mul_v3_fl(vec, armature_weight / contrib);
+      add_v3_v3v3(co, vec, co);
+    }
+
+    if (vert_deform_mats) {
+      float pre[3][3], post[3][3], tmpmat[3][3];
+
+      copy_m3_m4(pre, data->premat);
+      copy_m3_m4(post, data->postmat);
+      copy_m3_m3(tmpmat, vert_deform_mats[i]);
+
+      if (!use_quaternion) { /* quaternion already is scale corrected */
+        mul_m3_fl(summat, armature_weight / contrib);
+      }
+
+      mul_m3_series(vert_deform_mats[i], post, summat, pre, tmpmat);
+    }
+  }
+
+  /* always, check above code */
+  mul_m4_v3(data->postmat, co);
+}
+
 static void armature_vert_task_with_dvert(const ArmatureUserdata *data,
                                           const int i,
                                           const MDeformVert *dvert)
@@ -280,9 +358,9 @@ static void armature_vert_task_with_dvert(const ArmatureUserdata *data,
   const bool use_dverts = data->use_dverts;
   const int armature_def_nr = data->armature_def_nr;
 
+  const PoseSkinningPalette *palette = data->palette;
   DualQuat sumdq, *dq = NULL;
-  bPoseChannel *pchan;
-  float *co, dco[3];
+  float *co;
   float sumvec[3], summat[3][3];
   float *vec = NULL, (*smat)[3] = NULL;
   float contrib = 0.0f;
@@ -334,77 +412,39 @@ static void armature_vert_task_with_dvert(const ArmatureUserdata *data,
     unsigned int j;
     for (j = dvert->totweight; j != 0; j--, dw++) {
       const uint index = dw->def_nr;
-      if (index < data->defbase_len && (pchan = data->pchan_from_defbase[index])) {
+      int channel;
+      if (index < data->defbase_len && (channel = data->channel_from_defbase[index]) != -1) {
         float weight = dw->weight;
-        Bone *bone = pchan->bone;
 
         deformed = 1;
 
-        if (bone && bone->flag & BONE_MULT_VG_ENV) {
+        if (palette->flags[channel] & POSE_SKINNING_MULT_VG_ENV) {
+          const Bone *bone = palette->channels[channel]->bone;
           weight *= distfactor_to_bone(
               co, bone->arm_head, bone->arm_tail, bone->rad_head, bone->rad_tail, bone->dist);
         }
 
-        pchan_bone_deform(pchan, weight, vec, dq, smat, co, &contrib);
+        pchan_bone_deform(palette, channel, weight, vec, dq, smat, co, &contrib);
       }
     }
     /* If there are vertex-groups but not groups with bones (like for soft-body groups). */
     if (deformed == 0 && use_envelope) {
-      for (pchan = data->ob_arm->pose->chanbase.first; pchan; pchan = pchan->next) {
-        if (!(pchan->bone->flag & BONE_NO_DEFORM)) {
-          contrib += dist_bone_deform(pchan, vec, dq, smat, co);
+      for (int channel = 0; channel < palette->channels_num; channel++) {
+        if (palette->flags[channel] & POSE_SKINNING_DEFORM) {
+          contrib += dist_bone_deform(palette, channel, vec, dq, smat, co);
         }
       }
     }
   }
   else if (use_envelope) {
-    for (pchan = data->ob_arm->pose->chanbase.first; pchan; pchan = pchan->next) {
-      if (!(pchan->bone->flag & BONE_NO_DEFORM)) {
-        contrib += dist_bone_deform(pchan, vec, dq, smat, co);
-      }
-    }
-  }
-
-  /* actually should be EPSILON? weight values and contrib can be like 10e-39 small */
-  if (contrib > 0.0001f) {
-    if (use_quaternion) {
-      normalize_dq(dq, contrib);
-
-      if (armature_weight != 1.0f) {
-        copy_v3_v3(dco, co);
-        mul_v3m3_dq(dco, (vert_deform_mats) ? summat : NULL, dq);
-        sub_v3_v3(dco, co);
-        mul_v3_fl(dco, armature_weight);
-        add_v3_v3(co, dco);
-      }
-      else {
-        mul_v3m3_dq(co, (vert_deform_mats) ? summat : NULL, dq);
-      }
-
-      smat = summat;
-    }
-    else {
-      mul_v3_fl(vec, armature_weight / contrib);
-      add_v3_v3v3(co, vec, co);
-    }
-
-    if (vert_deform_mats) {
-      float pre[3][3], post[3][3], tmpmat[3][3];
-
-      copy_m3_m4(pre, data->premat);
-      copy_m3_m4(post, data->postmat);
-      copy_m3_m3(tmpmat, vert_deform_mats[i]);
-
-      if (!use_quaternion) { /* quaternion already is scale corrected */
-        mul_m3_fl(smat, armature_weight / contrib);
+    for (int channel = 0; channel < palette->channels_num; channel++) {
+      if (palette->flags[channel] & POSE_SKINNING_DEFORM) {
+        contrib += dist_bone_deform(palette, channel, vec, dq, smat, co);
       }
-
-      mul_m3_series(vert_deform_mats[i], post, smat, pre, tmpmat);
     }
   }
 
-  /* always, check above code */
-  mul_m4_v3(data->postmat, co);
+  armature_vert_apply_deform(data, i, co, contrib, armature_weight, vec, dq, summat);
 
   /* interpolate with previous modifier position using weight group */
   if (vert_coords_prev) {
@@ -415,34 +455,28 @@ static void armature_vert_task_with_dvert(const ArmatureUserdata *data,
   }
 }
 
-static void armature_vert_task(void *__restrict userdata,
-                               const int i,
-                               const TaskParallelTLS *__restrict UNUSED(tls))
+static const MDeformVert *armature_vert_dvert_get(const ArmatureUserdata *data, const int i)
 {
-  const ArmatureUserdata *data = userdata;
-  const MDeformVert *dvert;
   if (data->use_dverts || data->armature_def_nr != -1) {
     if (data->me_target) {
       BLI_assert(i < data->me_target->totvert);
       if (data->me_target->dvert != NULL) {
-        dvert = data->me_target->dvert + i;
-      }
-      else {
-        dvert = NULL;
+        return data->me_target->dvert + i;
       }
     }
     else if (data->dverts && i < data->dverts_len) {
-      dvert = data->dverts + i;
-    }
-    else {
-      dvert = NULL;
+      return data->dverts + i;
     }
   }
-  else {
-    dvert = NULL;
-  }
+  return NULL;
+}
 
-  armature_vert_task_with_dvert(data, i, dvert);
+static void armature_vert_task(void *__restrict userdata,
+                               const int i,
+                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ArmatureUserdata *data = userdata;
+  armature_vert_task_with_dvert(data, i, armature_vert_dvert_get(data, i));
 }
 
 static void armature_vert_task_editmesh(void *__restrict userdata,
@@ -464,6 +498,476 @@ static void armature_vert_task_editmesh_no_dvert(void *__restrict userdata,
   armature_vert_task_with_dvert(data, BM_elem_index_get(v), NULL);
 }
 
+/* Deforming vertices one at a time is dominated by looking up the bone of every vertex group
+ * weight and checking how that bone deforms. Vertices that are only deformed by the vertex groups
+ * of regular bones (no B-Bones, no envelope multiplication) are instead packed per chunk of
+ * consecutive vertices. Within a chunk they are sorted by their number of influences and grouped,
+ * so that the vertices of a group have similar influence counts. The bone influences of all
+ * vertices in a group are then accumulated at once, one vertex per SIMD lane, from the flat arrays
+ * of the #PoseSkinningPalette. Every lane does the same operations in the same order as
+ * #pchan_deform_accumulate, so the result is exactly the same as deforming one vertex at a time.
+ * Shorter lanes are padded with zero weights, which don't change the sums. */
+
+/* Number of vertices deformed together, one per SIMD lane. */
+#define SKINNING_LANES 4
+/* Number of consecutive vertices that are sorted by their number of influences. */
+#define SKINNING_CHUNK_SIZE 64
+/* Vertices with more weights are deformed one at a time. */
+#define SKINNING_MAX_INFLUENCES 16
+/* Packing the weights is not worth it for a few vertices, e.g. for grease pencil strokes. */
+#define SKINNING_MIN_VERTS 1024
+
+typedef struct ArmatureSkinningGroup {
+  int verts[SKINNING_LANES];
+  int lanes;
+  /* Number of influences of every lane, and the largest of them. */
+  int influences_num[SKINNING_LANES];
+  int max_influences_num;
+  float armature_weights[SKINNING_LANES];
+  /* Palette channel and weight of every influence, in the same order as in the vertex. */
+  int channels[SKINNING_MAX_INFLUENCES][SKINNING_LANES];
+  float weights[SKINNING_MAX_INFLUENCES][SKINNING_LANES];
+} ArmatureSkinningGroup;
+
+/* The packed vertices of a chunk, before they are sorted into groups. */
+typedef struct ArmatureSkinningChunk {
+  int verts_len;
+  int verts[SKINNING_CHUNK_SIZE];
+  int influences_num[SKINNING_CHUNK_SIZE];
+  float armature_weights[SKINNING_CHUNK_SIZE];
+  int channels[SKINNING_CHUNK_SIZE][SKINNING_MAX_INFLUENCES];
+  float weights[SKINNING_CHUNK_SIZE][SKINNING_MAX_INFLUENCES];
+} ArmatureSkinningChunk;
+
+/**
+ * Add the weights of the vertex to the chunk.
+ * \return False when the vertex has to be deformed by #armature_vert_task_with_dvert.
+ */
+static bool armature_skinning_chunk_add_vert(const ArmatureUserdata *data,
+                                             ArmatureSkinningChunk *chunk,
+                                             const int i,
+                                             const MDeformVert *dvert)
+{
+  const PoseSkinningPalette *palette = data->palette;
+  if (dvert == NULL) {
+    return false;
+  }
+
+  float armature_weight = 1.0f;
+  if (data->armature_def_nr != -1) {
+    armature_weight = BKE_defvert_find_weight(dvert, data->armature_def_nr);
+    if (data->invert_vgroup) {
+      armature_weight = 1.0f - armature_weight;
+    }
+    /* Vertices which are not deformed at all are skipped by the other code path. */
+    if (armature_weight == 0.0f) {
+      return false;
+    }
+  }
+
+  const int index = chunk->verts_len;
+  int influences_num = 0;
+  bool deformed = false;
+  for (int j = 0; j < dvert->totweight; j++) {
+    const uint def_nr = dvert->dw[j].def_nr;
+    int channel;
+    if (def_nr < data->defbase_len && (channel = data->channel_from_defbase[def_nr]) != -1) {
+      if (palette->flags[channel] & (POSE_SKINNING_BBONE | POSE_SKINNING_MULT_VG_ENV)) {
+        return false;
+      }
+      deformed = true;
+      if (dvert->dw[j].weight != 0.0f) {
+        if (influences_num == SKINNING_MAX_INFLUENCES) {
+          return false;
+        }
+        chunk->channels[index][influences_num] = channel;
+        chunk->weights[index][influences_num] = dvert->dw[j].weight;
+        influences_num++;
+      }
+    }
+  }
+
+  /* Envelopes are used when none of the vertex groups belongs to a bone. */
+  if (!deformed && data->use_envelope) {
+    return false;
+  }
+
+  chunk->verts[index] = i;
+  chunk->influences_num[index] = influences_num;
+  chunk->armature_weights[index] = armature_weight;
+  chunk->verts_len++;
+  return true;
+}
+
+/**
+ * Sort the packed vertices of the chunk by their number of influences, and interleave them into
+ * groups of #SKINNING_LANES vertices.
+ * \return The number of groups.
+ */
+static int armature_skinning_chunk_to_groups(const ArmatureSkinningChunk *chunk,
+                                             ArmatureSkinningGroup *groups)
+{
+  /* Counting sort, which keeps vertices with the same number of influences in order. */
+  int offsets[SKINNING_MAX_INFLUENCES + 2] = {0};
+  for (int i = 0; i < chunk->verts_len; i++) {
+    offsets[chunk->influences_num[i] + 1]++;
+  }
+  for (int n = 1; n <= SKINNING_MAX_INFLUENCES + 1; n++) {
+    offsets[n] += offsets[n - 1];
+  }
+  int sorted[SKINNING_CHUNK_SIZE];
+  for (int i = 0; i < chunk->verts_len; i++) {
+    sorted[offsets[chunk->influences_num[i]]++] = i;
+  }
+
+  const int groups_num = (chunk->verts_len + SKINNING_LANES - 1) / SKINNING_LANES;
+  for (int g = 0; g < groups_num; g++) {
+    ArmatureSkinningGroup *group = &groups[g];
+    group->lanes = MIN2(SKINNING_LANES, chunk->verts_len - g * SKINNING_LANES);
+    group->max_influences_num = 0;
+    for (int lane = 0; lane < SKINNING_LANES; lane++) {
+      if (lane >= group->lanes) {
+        group->verts[lane] = -1;
+        group->influences_num[lane] = 0;
+        group->armature_weights[lane] = 0.0f;
+        continue;
+      }
+      const int index = sorted[g * SKINNING_LANES + lane];
+      group->verts[lane] = chunk->verts[index];
+      group->influences_num[lane] = chunk->influences_num[index];
+      group->armature_weights[lane] = chunk->armature_weights[index];
+      group->max_influences_num = MAX2(group->max_influences_num, chunk->influences_num[index]);
+    }
+    for (int j = 0; j < group->max_influences_num; j++) {
+      for (int lane = 0; lane < SKINNING_LANES; lane++) {
+        if (j < group->influences_num[lane]) {
+          const int index = sorted[g * SKINNING_LANES + lane];
+          group->channels[j][lane] = chunk->channels[index][j];
+          group->weights[j][lane] = chunk->weights[index][j];
+        }
+        else {
+          group->channels[j][lane] = 0;
+          group->weights[j][lane] = 0.0f;
+        }
+      }
+    }
+  }
+  return groups_num;
+}
+
+#ifdef BLI_HAVE_SSE2
+/**
+ * Load the same row of four 4x4 matrices, and transpose it, so that `r_columns[i]` contains the
+ * i-th element of the row of every matrix.
+ */
+BLI_INLINE void skinning_load_row_transposed(const float *rows[SKINNING_LANES],
+                                             __m128 r_columns[4])
+{
+  const __m128 r0 = _mm_loadu_ps(rows[0]);
+  const __m128 r1 = _mm_loadu_ps(rows[1]);
+  const __m128 r2 = _mm_loadu_ps(rows[2]);
+  const __m128 r3 = _mm_loadu_ps(rows[3]);
+  const __m128 t0 = _mm_unpacklo_ps(r0, r1);
+  const __m128 t1 = _mm_unpacklo_ps(r2, r3);
+  const __m128 t2 = _mm_unpackhi_ps(r0, r1);
+  const __m128 t3 = _mm_unpackhi_ps(r2, r3);
+  r_columns[0] = _mm_movelh_ps(t0, t1);
+  r_columns[1] = _mm_movehl_ps(t1, t0);
+  r_columns[2] = _mm_movelh_ps(t2, t3);
+  r_columns[3] = _mm_movehl_ps(t3, t2);
+}
+#endif
+
+/* Linear blend skinning, with the same operations as #pchan_deform_accumulate. */
+static void armature_skinning_group_deform_linear(const ArmatureUserdata *data,
+                                                  const ArmatureSkinningGroup *group)
+{
+  const PoseSkinningPalette *palette = data->palette;
+  const bool use_deform_mats = data->vert_deform_mats != NULL;
+  float(*const vert_coords)[3] = data->vert_coords;
+  const float(*premat)[4] = data->premat;
+
+  /* Coordinates in armature space, vertex influences and weight sums of every lane. */
+  float co[3][SKINNING_LANES] = {{0.0f}};
+  float vec[3][SKINNING_LANES];
+  float summat[3][3][SKINNING_LANES];
+  float contrib[SKINNING_LANES];
+
+  for (int lane = 0; lane < group->lanes; lane++) {
+    const float *co_in = vert_coords[group->verts[lane]];
+    co[0][lane] = premat[0][0] * co_in[0] + premat[1][0] * co_in[1] + premat[2][0] * co_in[2] +
+                  premat[3][0];
+    co[1][lane] = premat[0][1] * co_in[0] + premat[1][1] * co_in[1] + premat[2][1] * co_in[2] +
+                  premat[3][1];
+    co[2][lane] = premat[0][2] * co_in[0] + premat[1][2] * co_in[1] + premat[2][2] * co_in[2] +
+                  premat[3][2];
+  }
+
+#ifdef BLI_HAVE_SSE2
+  const __m128 x = _mm_loadu_ps(co[0]);
+  const __m128 y = _mm_loadu_ps(co[1]);
+  const __m128 z = _mm_loadu_ps(co[2]);
+  __m128 vec_sum[3] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+  __m128 mat_sum[3][3];
+  for (int a = 0; a < 3; a++) {
+    for (int b = 0; b < 3; b++) {
+      mat_sum[a][b] = _mm_setzero_ps();
+    }
+  }
+  __m128 contrib_sum = _mm_setzero_ps();
+
+  for (int j = 0; j < group->max_influences_num; j++) {
+    const float(*mats[SKINNING_LANES])[4];
+    for (int lane = 0; lane < SKINNING_LANES; lane++) {
+      mats[lane] = palette->deform_mats[group->channels[j][lane]];
+    }
+    /* Element `[a][b]` of the deform matrix of every lane. */
+    __m128 mat[4][4];
+    for (int a = 0; a < 4; a++) {
+      const float *rows[SKINNING_LANES] = {mats[0][a], mats[1][a], mats[2][a], mats[3][a]};
+      skinning_load_row_transposed(rows, mat[a]);
+    }
+    const __m128 weight = _mm_loadu_ps(group->weights[j]);
+
+    const __m128 co_lanes[3] = {x, y, z};
+    for (int b = 0; b < 3; b++) {
+      __m128 tmp = _mm_add_ps(_mm_mul_ps(x, mat[0][b]), _mm_mul_ps(y, mat[1][b]));
+      tmp = _mm_add_ps(tmp, _mm_mul_ps(mat[2][b], z));
+      tmp = _mm_add_ps(tmp, mat[3][b]);
+      tmp = _mm_sub_ps(tmp, co_lanes[b]);
+      vec_sum[b] = _mm_add_ps(vec_sum[b], _mm_mul_ps(tmp, weight));
+    }
+    contrib_sum = _mm_add_ps(contrib_sum, weight);
+
+    if (use_deform_mats) {
+      for (int a = 0; a < 3; a++) {
+        for (int b = 0; b < 3; b++) {
+          mat_sum[a][b] = _mm_add_ps(mat_sum[a][b], _mm_mul_ps(mat[a][b], weight));
+        }
+      }
+    }
+  }
+
+  for (int b = 0; b < 3; b++) {
+    _mm_storeu_ps(vec[b], vec_sum[b]);
+  }
+  for (int a = 0; a < 3; a++) {
+    for (int b = 0; b < 3; b++) {
+      _mm_storeu_ps(summat[a][b], mat_sum[a][b]);
+    }
+  }
+  _mm_storeu_ps(contrib, contrib_sum);
+#else
+  for (int lane = 0; lane < group->lanes; lane++) {
+    const float x = co[0][lane];
+    const float y = co[1][lane];
+    const float z = co[2][lane];
+    vec[0][lane] = vec[1][lane] = vec[2][lane] = 0.0f;
+    for (int a = 0; a < 3; a++) {
+      for (int b = 0; b < 3; b++) {
+        summat[a][b][lane] = 0.0f;
+      }
+    }
+    contrib[lane] = 0.0f;
+
+    for (int j = 0; j < group->influences_num[lane]; j++) {
+      const float(*mat)[4] = palette->deform_mats[group->channels[j][lane]];
+      const float weight = group->weights[j][lane];
+      const float co_lane[3] = {x, y, z};
+      for (int b = 0; b < 3; b++) {
+        float tmp = x * mat[0][b] + y * mat[1][b] + mat[2][b] * z + mat[3][b];
+        tmp -= co_lane[b];
+        vec[b][lane] += tmp * weight;
+      }
+      contrib[lane] += weight;
+
+      if (use_deform_mats) {
+        for (int a = 0; a < 3; a++) {
+          for (int b = 0; b < 3; b++) {
+            summat[a][b][lane] += mat[a][b] * weight;
+          }
+        }
+      }
+    }
+  }
+#endif
+
+  for (int lane = 0; lane < group->lanes; lane++) {
+    float *co_out = vert_coords[group->verts[lane]];
+    float vec_lane[3], summat_lane[3][3];
+    for (int a = 0; a < 3; a++) {
+      co_out[a] = co[a][lane];
+      vec_lane[a] = vec[a][lane];
+      for (int b = 0; b < 3; b++) {
+        summat_lane[a][b] = summat[a][b][lane];
+      }
+    }
+    armature_vert_apply_deform(data,
+                               group->verts[lane],
+                               co_out,
+                               contrib[lane],
+                               group->armature_weights[lane],
+                               vec_lane,
+                               NULL,
+                               summat_lane);
+  }
+}
+
+/* Dual quaternion skinning, with the same operations as #add_weighted_dq_dq. */
+static void armature_skinning_group_deform_dual_quat(const ArmatureUserdata *data,
+                                                     const ArmatureSkinningGroup *group)
+{
+  const PoseSkinningPalette *palette = data->palette;
+  float(*const vert_coords)[3] = data->vert_coords;
+
+  for (int lane = 0; lane < group->lanes; lane++) {
+    mul_m4_v3(data->premat, vert_coords[group->verts[lane]]);
+  }
+
+  DualQuat sumdq[SKINNING_LANES];
+  float contrib[SKINNING_LANES];
+  memset(sumdq, 0, sizeof(sumdq));
+
+#ifdef BLI_HAVE_SSE2
+  __m128 quat_sum[4], trans_sum[4], scale_sum[4][4];
+  for (int a = 0; a < 4; a++) {
+    quat_sum[a] = trans_sum[a] = _mm_setzero_ps();
+    for (int b = 0; b < 4; b++) {
+      scale_sum[a][b] = _mm_setzero_ps();
+    }
+  }
+  __m128 scale_weight_sum = _mm_setzero_ps();
+  __m128 contrib_sum = _mm_setzero_ps();
+  const __m128 sign_mask = _mm_set1_ps(-0.0f);
+
+  for (int j = 0; j < group->max_influences_num; j++) {
+    const DualQuat *dqs[SKINNING_LANES];
+    for (int lane = 0; lane < SKINNING_LANES; lane++) {
+      dqs[lane] = &palette->deform_dual_quats[group->channels[j][lane]];
+    }
+    const __m128 weight = _mm_loadu_ps(group->weights[j]);
+
+    __m128 quat[4], trans[4];
+    {
+      const float *rows[SKINNING_LANES] = {
+          dqs[0]->quat, dqs[1]->quat, dqs[2]->quat, dqs[3]->quat};
+      skinning_load_row_transposed(rows, quat);
+    }
+    {
+      const float *rows[SKINNING_LANES] = {
+          dqs[0]->trans, dqs[1]->trans, dqs[2]->trans, dqs[3]->trans};
+      skinning_load_row_transposed(rows, trans);
+    }
+
+    /* Interpolate the rotations in the right direction. */
+    __m128 dot = _mm_mul_ps(quat[0], quat_sum[0]);
+    for (int a = 1; a < 4; a++) {
+      dot = _mm_add_ps(dot, _mm_mul_ps(quat[a], quat_sum[a]));
+    }
+    const __m128 flipped = _mm_cmplt_ps(dot, _mm_setzero_ps());
+    const __m128 weight_signed = _mm_xor_ps(weight, _mm_and_ps(flipped, sign_mask));
+    for (int a = 0; a < 4; a++) {
+      quat_sum[a] = _mm_add_ps(quat_sum[a], _mm_mul_ps(weight_signed, quat[a]));
+      trans_sum[a] = _mm_add_ps(trans_sum[a], _mm_mul_ps(weight_signed, trans[a]));
+    }
+
+    /* Interpolate the scale of the lanes which have scale, with a positive weight. */
+    const __m128 scale_weight = _mm_setr_ps(
+        dqs[0]->scale_weight, dqs[1]->scale_weight, dqs[2]->scale_weight, dqs[3]->scale_weight);
+    const __m128 has_scale = _mm_cmpneq_ps(scale_weight, _mm_setzero_ps());
+    if (_mm_movemask_ps(has_scale) != 0) {
+      const __m128 weight_scale = _mm_and_ps(has_scale, weight);
+      for (int a = 0; a < 4; a++) {
+        const float *rows[SKINNING_LANES] = {
+            dqs[0]->scale[a], dqs[1]->scale[a], dqs[2]->scale[a], dqs[3]->scale[a]};
+        __m128 scale[4];
+        skinning_load_row_transposed(rows, scale);
+        for (int b = 0; b < 4; b++) {
+          scale_sum[a][b] = _mm_add_ps(scale_sum[a][b], _mm_mul_ps(scale[b], weight_scale));
+        }
+      }
+      scale_weight_sum = _mm_add_ps(scale_weight_sum, weight_scale);
+    }
+    contrib_sum = _mm_add_ps(contrib_sum, weight);
+  }
+
+  float values[SKINNING_LANES];
+  for (int a = 0; a < 4; a++) {
+    _mm_storeu_ps(values, quat_sum[a]);
+    for (int lane = 0; lane < SKINNING_LANES; lane++) {
+      sumdq[lane].quat[a] = values[lane];
+    }
+    _mm_storeu_ps(values, trans_sum[a]);
+    for (int lane = 0; lane < SKINNING_LANES; lane++) {
+      sumdq[lane].trans[a] = values[lane];
+    }
+    for (int b = 0; b < 4; b++) {
+      _mm_storeu_ps(values, scale_sum[a][b]);
+      for (int lane = 0; lane < SKINNING_LANES; lane++) {
+        sumdq[lane].scale[a][b] = values[lane];
+      }
+    }
+  }
+  _mm_storeu_ps(values, scale_weight_sum);
+  for (int lane = 0; lane < SKINNING_LANES; lane++) {
+    sumdq[lane].scale_weight = values[lane];
+  }
+  _mm_storeu_ps(contrib, contrib_sum);
+#else
+  for (int lane = 0; lane < group->lanes; lane++) {
+    contrib[lane] = 0.0f;
+    for (int j = 0; j < group->influences_num[lane]; j++) {
+      const float weight = group->weights[j][lane];
+      add_weighted_dq_dq(
+          &sumdq[lane], &palette->deform_dual_quats[group->channels[j][lane]], weight);
+      contrib[lane] += weight;
+    }
+  }
+#endif
+
+  for (int lane = 0; lane < group->lanes; lane++) {
+    float summat[3][3];
+    armature_vert_apply_deform(data,
+                               group->verts[lane],
+                               vert_coords[group->verts[lane]],
+                               contrib[lane],
+                               group->armature_weights[lane],
+                               NULL,
+                               &sumdq[lane],
+                               summat);
+  }
+}
+
+static void armature_vert_chunk_task(void *__restrict userdata,
+                                     const int chunk_index,
+                                     const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const ArmatureUserdata *data = userdata;
+  const int start = chunk_index * SKINNING_CHUNK_SIZE;
+  const int end = MIN2(start + SKINNING_CHUNK_SIZE, data->vert_coords_len);
+
+  ArmatureSkinningChunk chunk;
+  chunk.verts_len = 0;
+
+  for (int i = start; i < end; i++) {
+    const MDeformVert *dvert = armature_vert_dvert_get(data, i);
+    if (!armature_skinning_chunk_add_vert(data, &chunk, i, dvert)) {
+      armature_vert_task_with_dvert(data, i, dvert);
+    }
+  }
+
+  ArmatureSkinningGroup groups[SKINNING_CHUNK_SIZE / SKINNING_LANES];
+  const int groups_num = armature_skinning_chunk_to_groups(&chunk, groups);
+  for (int g = 0; g < groups_num; g++) {
+    if (data->use_quaternion) {
+      armature_skinning_group_deform_dual_quat(data, &groups[g]);
+    }
+    else {
+      armature_skinning_group_deform_linear(data, &groups[g]);
+    }
+  }
+}
+
 static void armature_deform_coords_impl(const Object *ob_arm,
                                         const Object *ob_target,
                                         float (*vert_coords)[3],
@@ -477,7 +981,7 @@ static void armature_deform_coords_impl(const Object *ob_arm,
                                         bGPDstroke *gps_target)
 {
   bArmature *arm = ob_arm->data;
-  bPoseChannel **pchan_from_defbase = NULL;
+  int *channel_from_defbase = NULL;
   const MDeformVert *dverts = NULL;
   bDeformGroup *dg;
   const bool use_envelope = (deformflag & ARM_DEF_ENVELOPE) != 0;
@@ -501,6 +1005,15 @@ static void armature_deform_coords_impl(const Object *ob_arm,
     BLI_assert(0);
   }
 
+  /* The palette is built when the pose evaluation is done, it only has to be created here when
+   * deforming with a pose that was not evaluated by the depsgraph, or that was solved again after
+   * its evaluation. */
+  const PoseSkinningPalette *palette = ob_arm->pose->skinning_palette;
+  PoseSkinningPalette *palette_temp = NULL;
+  if (palette == NULL || palette->is_outdated) {
+    palette = palette_temp = BKE_pose_skinning_palette_create(ob_arm->pose);
+  }
+
   if (BKE_object_supports_vertex_groups(ob_target)) {
     /* get the def_nr for the overall armature vertex group if present */
     armature_def_nr = BKE_object_defgroup_name_index(ob_target, defgrp_name);
@@ -545,18 +1058,20 @@ static void armature_deform_coords_impl(const Object *ob_arm,
       }
 
       if (use_dverts) {
-        pchan_from_defbase = MEM_callocN(sizeof(*pchan_from_defbase) * defbase_len, "defnrToBone");
+        channel_from_defbase = MEM_malloc_arrayN(
+            defbase_len, sizeof(*channel_from_defbase), "defnrToBone");
         /* TODO(sergey): Some considerations here:
          *
          * - Check whether keeping this consistent across frames gives speedup.
          */
         const ListBase *defbase = BKE_object_defgroup_list(ob_target);
         for (i = 0, dg = defbase->first; dg; i++, dg = dg->next) {
-          pchan_from_defbase[i] = BKE_pose_channel_find_name(ob_arm->pose, dg->name);
+          channel_from_defbase[i] = POINTER_AS_INT(BLI_ghash_lookup_default(
+              palette->channel_index_from_name, dg->name, POINTER_FROM_INT(-1)));
           /* exclude non-deforming bones */
-          if (pchan_from_defbase[i]) {
-            if (pchan_from_defbase[i]->bone->flag & BONE_NO_DEFORM) {
-              pchan_from_defbase[i] = NULL;
+          if (channel_from_defbase[i] != -1) {
+            if (!(palette->flags[channel_from_defbase[i]] & POSE_SKINNING_DEFORM)) {
+              channel_from_defbase[i] = -1;
             }
           }
         }
@@ -578,8 +1093,10 @@ static void armature_deform_coords_impl(const Object *ob_arm,
       .armature_def_nr = armature_def_nr,
       .dverts = dverts,
       .dverts_len = dverts_len,
-      .pchan_from_defbase = pchan_from_defbase,
+      .palette = palette,
+      .channel_from_defbase = channel_from_defbase,
       .defbase_len = defbase_len,
+      .vert_coords_len = vert_coords_len,
       .bmesh =
           {
               .cd_dvert_offset = cd_dvert_offset,
@@ -609,6 +1126,12 @@ static void armature_deform_coords_impl(const Object *ob_arm,
           em_target->bm->vpool, &data, armature_vert_task_editmesh_no_dvert, &settings);
     }
   }
+  else if (use_dverts && vert_coords_prev == NULL && vert_coords_len >= SKINNING_MIN_VERTS) {
+    TaskParallelSettings settings;
+    BLI_parallel_range_settings_defaults(&settings);
+    const int chunks_len = (vert_coords_len + SKINNING_CHUNK_SIZE - 1) / SKINNING_CHUNK_SIZE;
+    BLI_task_parallel_range(0, chunks_len, &data, armature_vert_chunk_task, &settings);
+  }
   else {
     TaskParallelSettings settings;
     BLI_parallel_range_settings_defaults(&settings);
@@ -616,8 +1139,11 @@ static void armature_deform_coords_impl(const Object *ob_arm,
     BLI_task_parallel_range(0, vert_coords_len, &data, armature_vert_task, &settings);
   }
 
-  if (pchan_from_defbase) {
-    MEM_freeN(pchan_from_defbase);
+  if (channel_from_defbase) {
+    MEM_freeN(channel_from_defbase);
+  }
+  if (palette_temp) {
+    BKE_pose_skinning_palette_free(palette_temp);
   }
 }
 
@@ -691,3 +1217,147 @@ void BKE_armature_deform_coords_with_editmesh(const Object *ob_arm,
 }
 
 /** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Pose Skinning Palette
+ *
+ * Many objects can be deformed by the same pose, e.g. in crowds. The deformation of every channel
+ * is gathered once per pose evaluation, so that all the deformed objects read it from compact
+ * arrays instead of the scattered pose channels.
+ * \{ */
+
+static uint8_t pose_skinning_channel_flags(const bPoseChannel *pchan)
+{
+  const Bone *bone = pchan->bone;
+  if (bone == NULL || (bone->flag & BONE_NO_DEFORM)) {
+    return 0;
+  }
+  uint8_t flags = POSE_SKINNING_DEFORM;
+  if (bone->flag & BONE_MULT_VG_ENV) {
+    flags |= POSE_SKINNING_MULT_VG_ENV;
+  }
+  if (bone->segments > 1 && pchan->runtime.bbone_segments == bone->segments) {
+    flags |= POSE_SKINNING_BBONE;
+  }
+  return flags;
+}
+
+/* Copy the deformation of all channels into the palette, which has to match their layout. */
+static void pose_skinning_palette_fill(PoseSkinningPalette *palette)
+{
+  for (int i = 0; i < palette->channels_num; i++) {
+    const bPoseChannel *pchan = palette->channels[i];
+    copy_m4_m4(palette->deform_mats[i], pchan->chan_mat);
+    copy_dq_dq(&palette->deform_dual_quats[i], &pchan->runtime.deform_dual_quat);
+    if (palette->flags[i] & POSE_SKINNING_BBONE) {
+      const int segments = pchan->runtime.bbone_segments;
+      const int offset = palette->bbone_offsets[i];
+      memcpy(&palette->bbone_deform_mats[offset],
+             pchan->runtime.bbone_deform_mats,
+             sizeof(Mat4) * (2 + segments));
+      memcpy(&palette->bbone_dual_quats[offset],
+             pchan->runtime.bbone_dual_quats,
+             sizeof(DualQuat) * (1 + segments));
+    }
+  }
+}
+
+static bool pose_skinning_palette_matches_pose(const PoseSkinningPalette *palette,
+                                               const bPose *pose)
+{
+  int bbone_len = 0;
+  int i = 0;
+  LISTBASE_FOREACH (const bPoseChannel *, pchan, &pose->chanbase) {
+    if (i == palette->channels_num || palette->channels[i] != pchan ||
+        palette->flags[i] != pose_skinning_channel_flags(pchan)) {
+      return false;
+    }
+    if (palette->flags[i] & POSE_SKINNING_BBONE) {
+      if (palette->bbone_offsets[i] != bbone_len) {
+        return false;
+      }
+      bbone_len += 2 + pchan->bone->segments;
+    }
+    i++;
+  }
+  return i == palette->channels_num && bbone_len == palette->bbone_len;
+}
+
+PoseSkinningPalette *BKE_pose_skinning_palette_create(const bPose *pose)
+{
+  PoseSkinningPalette *palette = MEM_callocN(sizeof(*palette), __func__);
+  const int channels_num = BLI_listbase_count(&pose->chanbase);
+
+  palette->channels_num = channels_num;
+  palette->channels = MEM_malloc_arrayN(channels_num, sizeof(*palette->channels), __func__);
+  palette->channel_index_from_name = BLI_ghash_str_new_ex(__func__, (uint)channels_num);
+  palette->flags = MEM_calloc_arrayN(channels_num, sizeof(*palette->flags), __func__);
+  palette->deform_mats = MEM_malloc_arrayN(channels_num, sizeof(*palette->deform_mats), __func__);
+  palette->deform_dual_quats = MEM_malloc_arrayN(channels_num, sizeof(DualQuat), __func__);
+  palette->bbone_offsets = MEM_calloc_arrayN(channels_num, sizeof(int), __func__);
+
+  int bbone_len = 0;
+  int i;
+  LISTBASE_FOREACH_INDEX (bPoseChannel *, pchan, &pose->chanbase, i) {
+    palette->channels[i] = pchan;
+    BLI_ghash_insert(palette->channel_index_from_name, pchan->name, POINTER_FROM_INT(i));
+    palette->flags[i] = pose_skinning_channel_flags(pchan);
+    if (palette->flags[i] & POSE_SKINNING_BBONE) {
+      palette->bbone_offsets[i] = bbone_len;
+      /* Same sizes as the B-Bone matrices in #bPoseChannel_Runtime. */
+      bbone_len += 2 + pchan->bone->segments;
+    }
+  }
+
+  palette->bbone_len = bbone_len;
+  if (bbone_len > 0) {
+    palette->bbone_deform_mats = MEM_malloc_arrayN(bbone_len, sizeof(Mat4), __func__);
+    palette->bbone_dual_quats = MEM_malloc_arrayN(bbone_len, sizeof(DualQuat), __func__);
+  }
+
+  pose_skinning_palette_fill(palette);
+  return palette;
+}
+
+void BKE_pose_skinning_palette_free(PoseSkinningPalette *palette)
+{
+  MEM_freeN(palette->channels);
+  /* The names are owned by the pose channels. */
+  BLI_ghash_free(palette->channel_index_from_name, NULL, NULL);
+  MEM_freeN(palette->flags);
+  MEM_freeN(palette->deform_mats);
+  MEM_freeN(palette->deform_dual_quats);
+  MEM_freeN(palette->bbone_offsets);
+  MEM_SAFE_FREE(palette->bbone_deform_mats);
+  MEM_SAFE_FREE(palette->bbone_dual_quats);
+  MEM_freeN(palette);
+}
+
+void BKE_pose_skinning_palette_update(bPose *pose)
+{
+  PoseSkinningPalette *palette = pose->skinning_palette;
+  if (palette != NULL && pose_skinning_palette_matches_pose(palette, pose)) {
+    pose_skinning_palette_fill(palette);
+    palette->is_outdated = false;
+    return;
+  }
+  BKE_pose_skinning_palette_clear(pose);
+  pose->skinning_palette = BKE_pose_skinning_palette_create(pose);
+}
+
+void BKE_pose_skinning_palette_tag_outdated(bPose *pose)
+{
+  if (pose->skinning_palette != NULL) {
+    pose->skinning_palette->is_outdated = true;
+  }
+}
+
+void BKE_pose_skinning_palette_clear(bPose *pose)
+{
+  if (pose->skinning_palette != NULL) {
+    BKE_pose_skinning_palette_free(pose->skinning_palette);
+    pose->skinning_palette = NULL;
+  }
+}
+
+/** \} */
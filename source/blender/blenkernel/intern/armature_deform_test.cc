@@ -0,0 +1,390 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_array.hh"
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_rand.hh"
+#include "BLI_string.h"
+
+#include "BKE_armature.h"
+#include "BKE_deform.h"
+
+#include "DNA_action_types.h"
+#include "DNA_armature_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+
+namespace blender::bke::tests {
+
+/**
+ * A posed armature and a mesh with random vertex group weights.
+ *
+ * Vertices that are only deformed by the vertex groups of regular bones are deformed in SIMD
+ * lanes, while bones which multiply the weights with their envelope are deformed one vertex at a
+ * time.
+ * An envelope that is large enough multiplies the weights by exactly one, so the per-vertex code
+ * is used as reference by enabling that option on all bones.
+ */
+struct ArmatureDeformTestContext {
+  bArmature armature = {{nullptr}};
+  bPose pose = {{nullptr}};
+  Object ob_armature = {{nullptr}};
+  Mesh mesh = {{nullptr}};
+  Object ob_mesh = {{nullptr}};
+  /* All bones have a large envelope, see #set_envelope_multiply. */
+  Bone *bones = nullptr;
+  int bones_num = 0;
+
+  Array<float3> coords;
+  Array<float3> coords_reference;
+  /* Flat 3x3 matrices. */
+  Array<float> deform_mats;
+  Array<float> deform_mats_reference;
+
+  ~ArmatureDeformTestContext()
+  {
+    BKE_pose_skinning_palette_clear(&pose);
+    BLI_freelistN(&pose.chanbase);
+    MEM_SAFE_FREE(bones);
+    BLI_freelistN(&mesh.vertex_group_names);
+    BKE_defvert_array_free(mesh.dvert, mesh.totvert);
+  }
+
+  /**
+   * \param local_weights: Weight vertices to bones with similar indices, like neighboring
+   * vertices of a real mesh, instead of to random bones.
+   */
+  void create(const int bones_num,
+              const int verts_num,
+              const int seed,
+              const bool local_weights = false)
+  {
+    RandomNumberGenerator rng(seed);
+
+    ob_armature.type = OB_ARMATURE;
+    ob_armature.data = &armature;
+    ob_armature.pose = &pose;
+    unit_m4(ob_armature.obmat);
+    STRNCPY(armature.id.name, "ARArmature");
+
+    ob_mesh.type = OB_MESH;
+    ob_mesh.data = &mesh;
+    unit_m4(ob_mesh.obmat);
+    STRNCPY(mesh.id.name, "MEMesh");
+
+    this->bones_num = bones_num;
+    bones = static_cast<Bone *>(MEM_calloc_arrayN(bones_num, sizeof(Bone), __func__));
+    for (const int i : IndexRange(bones_num)) {
+      Bone *bone = &bones[i];
+      bone->segments = 1;
+      bone->weight = 1.0f;
+      bone->rad_head = bone->rad_tail = 1e6f;
+      unit_m4(bone->arm_mat);
+      copy_v3_v3(bone->arm_mat[3], random_vector(rng, 2.0f));
+
+      bPoseChannel *pchan = static_cast<bPoseChannel *>(
+          MEM_callocN(sizeof(bPoseChannel), __func__));
+      SNPRINTF(pchan->name, "Bone%d", i);
+      pchan->bone = bone;
+      const float3 loc = random_vector(rng, 0.5f);
+      const float3 eul = random_vector(rng, 1.0f);
+      const float3 size = float3(1.0f) + random_vector(rng, 0.2f);
+      loc_eul_size_to_mat4(pchan->chan_mat, loc, eul, size);
+      mat4_to_dquat(&pchan->runtime.deform_dual_quat, bone->arm_mat, pchan->chan_mat);
+      BLI_addtail(&pose.chanbase, pchan);
+
+      bDeformGroup *group = static_cast<bDeformGroup *>(
+          MEM_callocN(sizeof(bDeformGroup), __func__));
+      STRNCPY(group->name, pchan->name);
+      BLI_addtail(&mesh.vertex_group_names, group);
+    }
+
+    /* A vertex group without a bone, and the armature vertex group. */
+    for (const char *name : {"NoBone", "Armature"}) {
+      bDeformGroup *group = static_cast<bDeformGroup *>(
+          MEM_callocN(sizeof(bDeformGroup), __func__));
+      STRNCPY(group->name, name);
+      BLI_addtail(&mesh.vertex_group_names, group);
+    }
+    const int groups_num = bones_num + 2;
+
+    mesh.totvert = verts_num;
+    mesh.dvert = static_cast<MDeformVert *>(
+        MEM_calloc_arrayN(verts_num, sizeof(MDeformVert), __func__));
+    for (const int i : IndexRange(verts_num)) {
+      MDeformVert *dvert = &mesh.dvert[i];
+      const int weights_num = rng.get_int32(6);
+      if (weights_num == 0) {
+        continue;
+      }
+      dvert->totweight = weights_num;
+      dvert->dw = static_cast<MDeformWeight *>(
+          MEM_calloc_arrayN(weights_num, sizeof(MDeformWeight), __func__));
+      for (const int j : IndexRange(weights_num)) {
+        if (local_weights) {
+          const int bone = int(int64_t(i) * bones_num / verts_num) + rng.get_int32(4);
+          dvert->dw[j].def_nr = std::min(bone, bones_num - 1);
+        }
+        else {
+          dvert->dw[j].def_nr = rng.get_int32(groups_num);
+        }
+        /* Some zero weights, which are skipped. */
+        dvert->dw[j].weight = (rng.get_int32(8) == 0) ? 0.0f : rng.get_float();
+      }
+    }
+
+    coords.reinitialize(verts_num);
+    for (const int i : IndexRange(verts_num)) {
+      coords[i] = random_vector(rng, 3.0f);
+    }
+    coords_reference = coords;
+    deform_mats.reinitialize(verts_num * 9);
+    for (const int i : IndexRange(verts_num)) {
+      unit_m3(as_matrices(deform_mats)[i]);
+    }
+    deform_mats_reference = deform_mats;
+  }
+
+  static float (*as_matrices(Array<float> &values))[3][3]
+  {
+    return reinterpret_cast<float(*)[3][3]>(values.data());
+  }
+
+  static float3 random_vector(RandomNumberGenerator &rng, const float scale)
+  {
+    return float3(rng.get_float() - 0.5f, rng.get_float() - 0.5f, rng.get_float() - 0.5f) *
+           (2.0f * scale);
+  }
+
+  void set_envelope_multiply(const int bone_index, const bool use_multiply)
+  {
+    Bone *bone = &bones[bone_index];
+    SET_FLAG_FROM_TEST(bone->flag, use_multiply, BONE_MULT_VG_ENV);
+  }
+
+  void deform(float3 *coords,
+              float (*vert_deform_mats)[3][3],
+              const int deformflag,
+              const char *defgrp_name)
+  {
+    BKE_armature_deform_coords_with_mesh(&ob_armature,
+                                         &ob_mesh,
+                                         reinterpret_cast<float(*)[3]>(coords),
+                                         vert_deform_mats,
+                                         mesh.totvert,
+                                         deformflag,
+                                         nullptr,
+                                         defgrp_name,
+                                         &mesh);
+  }
+
+  /** Deform with the current bones, and with the per-vertex code path as reference. */
+  void deform_with_reference(const int deformflag,
+                             const bool use_deform_mats,
+                             const char *defgrp_name = "")
+  {
+    deform(coords.data(),
+           use_deform_mats ? as_matrices(deform_mats) : nullptr,
+           deformflag,
+           defgrp_name);
+
+    Array<int> flags(bones_num);
+    for (const int i : IndexRange(bones_num)) {
+      flags[i] = bones[i].flag;
+      set_envelope_multiply(i, true);
+    }
+    deform(coords_reference.data(),
+           use_deform_mats ? as_matrices(deform_mats_reference) : nullptr,
+           deformflag,
+           defgrp_name);
+    for (const int i : IndexRange(bones_num)) {
+      bones[i].flag = flags[i];
+    }
+  }
+
+  /**
+   * The SIMD lanes do the same operations in the same order as the per-vertex code, so the
+   * results have to be exactly the same.
+   */
+  void expect_same_as_reference(const bool use_deform_mats)
+  {
+    for (const int i : coords.index_range()) {
+      for (const int j : IndexRange(3)) {
+        EXPECT_EQ(coords[i][j], coords_reference[i][j]);
+      }
+    }
+    if (use_deform_mats) {
+      for (const int i : deform_mats.index_range()) {
+        EXPECT_EQ(deform_mats[i], deform_mats_reference[i]);
+      }
+    }
+  }
+};
+
+TEST(armature_deform, LinearBlend)
+{
+  ArmatureDeformTestContext ctx;
+  ctx.create(20, 5000, 0);
+  ctx.deform_with_reference(ARM_DEF_VGROUP, false);
+  ctx.expect_same_as_reference(false);
+}
+
+TEST(armature_deform, LinearBlendDeformMatrices)
+{
+  ArmatureDeformTestContext ctx;
+  ctx.create(20, 5000, 1);
+  ctx.deform_with_reference(ARM_DEF_VGROUP | ARM_DEF_ENVELOPE, true);
+  ctx.expect_same_as_reference(true);
+}
+
+TEST(armature_deform, DualQuaternion)
+{
+  ArmatureDeformTestContext ctx;
+  ctx.create(20, 5000, 2);
+  ctx.deform_with_reference(ARM_DEF_VGROUP | ARM_DEF_QUATERNION, false);
+  ctx.expect_same_as_reference(false);
+}
+
+TEST(armature_deform, DualQuaternionDeformMatrices)
+{
+  ArmatureDeformTestContext ctx;
+  ctx.create(20, 5000, 3);
+  ctx.deform_with_reference(ARM_DEF_VGROUP | ARM_DEF_QUATERNION | ARM_DEF_ENVELOPE, true);
+  ctx.expect_same_as_reference(true);
+}
+
+TEST(armature_deform, ArmatureVertexGroup)
+{
+  ArmatureDeformTestContext ctx;
+  ctx.create(20, 5000, 4);
+  ctx.deform_with_reference(ARM_DEF_VGROUP | ARM_DEF_INVERT_VGROUP, true, "Armature");
+  ctx.expect_same_as_reference(true);
+  ctx.deform_with_reference(ARM_DEF_VGROUP | ARM_DEF_QUATERNION, false, "Armature");
+  ctx.expect_same_as_reference(false);
+}
+
+TEST(armature_deform, MixedBones)
+{
+  /* Vertices weighted to these bones are deformed one at a time in both cases. */
+  ArmatureDeformTestContext ctx;
+  ctx.create(20, 5000, 5);
+  for (int i = 0; i < 20; i += 3) {
+    ctx.set_envelope_multiply(i, true);
+  }
+  ctx.deform_with_reference(ARM_DEF_VGROUP, true);
+  ctx.expect_same_as_reference(true);
+}
+
+TEST(armature_deform, EvaluatedPalette)
+{
+  /* The palette built after pose evaluation gives the same result as a temporary palette. */
+  ArmatureDeformTestContext ctx;
+  ctx.create(20, 5000, 6);
+  ctx.set_envelope_multiply(3, true);
+  BKE_pose_skinning_palette_update(&ctx.pose);
+  ctx.deform(ctx.coords.data(), ctx.as_matrices(ctx.deform_mats), ARM_DEF_VGROUP, "");
+  BKE_pose_skinning_palette_clear(&ctx.pose);
+  ctx.deform(
+      ctx.coords_reference.data(), ctx.as_matrices(ctx.deform_mats_reference), ARM_DEF_VGROUP, "");
+  ctx.expect_same_as_reference(true);
+}
+
+TEST(armature_deform, OutdatedPalette)
+{
+  /* A pose that is solved again after its evaluation is not deformed with the old palette. */
+  ArmatureDeformTestContext ctx;
+  ctx.create(20, 5000, 7);
+  BKE_pose_skinning_palette_update(&ctx.pose);
+  const PoseSkinningPalette *palette = ctx.pose.skinning_palette;
+  bPoseChannel *pchan = static_cast<bPoseChannel *>(ctx.pose.chanbase.first);
+  translate_m4(pchan->chan_mat, 0.5f, 0.0f, 0.0f);
+  BKE_pose_skinning_palette_tag_outdated(&ctx.pose);
+  ctx.deform(ctx.coords.data(), nullptr, ARM_DEF_VGROUP, "");
+  EXPECT_EQ(ctx.pose.skinning_palette, palette);
+
+  /* Updating after the evaluation reuses the palette. */
+  BKE_pose_skinning_palette_update(&ctx.pose);
+  EXPECT_EQ(ctx.pose.skinning_palette, palette);
+  EXPECT_FALSE(palette->is_outdated);
+  ctx.deform(ctx.coords_reference.data(), nullptr, ARM_DEF_VGROUP, "");
+  ctx.expect_same_as_reference(false);
+}
+
+/** Deform copies of the coordinates a few times, and print the fastest time. */
+static void armature_deform_benchmark(const char *name,
+                                      ArmatureDeformTestContext &ctx,
+                                      const int deformflag)
+{
+  using Clock = std::chrono::steady_clock;
+  Clock::duration best_time = Clock::duration::max();
+  for (int iteration = 0; iteration < 10; iteration++) {
+    Array<float3> coords = ctx.coords;
+    const Clock::time_point start = Clock::now();
+    ctx.deform(coords.data(), nullptr, deformflag, "");
+    best_time = std::min(best_time, Clock::now() - start);
+  }
+  const double seconds = std::chrono::duration<double>(best_time).count();
+  std::cout << name << ": " << seconds * 1000.0 << " ms, "
+            << ctx.mesh.totvert / seconds / 1000000.0 << " million vertices per second\n";
+}
+
+/**
+ * Compare the SIMD lanes with the per-vertex code. The per-vertex code also multiplies the
+ * weights with the envelopes, which is part of the difference.
+ */
+static void test_armature_deform_performance(const int bones_num,
+                                             const int verts_num,
+                                             const int deformflag,
+                                             const bool local_weights)
+{
+  ArmatureDeformTestContext ctx;
+  ctx.create(bones_num, verts_num, 0, local_weights);
+  armature_deform_benchmark("lanes", ctx, deformflag);
+  for (const int i : IndexRange(bones_num)) {
+    ctx.set_envelope_multiply(i, true);
+  }
+  armature_deform_benchmark("per vertex", ctx, deformflag);
+}
+
+TEST(armature_deform_performance, linear_blend_300_bones_500000_verts)
+{
+  test_armature_deform_performance(300, 500000, ARM_DEF_VGROUP, false);
+}
+
+TEST(armature_deform_performance, linear_blend_300_bones_500000_verts_local)
+{
+  test_armature_deform_performance(300, 500000, ARM_DEF_VGROUP, true);
+}
+
+TEST(armature_deform_performance, dual_quaternion_300_bones_500000_verts)
+{
+  test_armature_deform_performance(300, 500000, ARM_DEF_VGROUP | ARM_DEF_QUATERNION, false);
+}
+
+TEST(armature_deform_performance, dual_quaternion_300_bones_500000_verts_local)
+{
+  test_armature_deform_performance(300, 500000, ARM_DEF_VGROUP | ARM_DEF_QUATERNION, true);
+}
+
+}  // namespace blender::bke::tests
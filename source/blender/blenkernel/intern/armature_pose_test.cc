@@ -0,0 +1,294 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_float4x4.hh"
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_rand.hh"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+#include "BLI_vector.hh"
+
+#include "BKE_action.h"
+#include "BKE_appdir.h"
+#include "BKE_armature.h"
+#include "BKE_blender.h"
+#include "BKE_collection.h"
+#include "BKE_constraint.h"
+#include "BKE_global.h"
+#include "BKE_idtype.h"
+#include "BKE_image.h"
+#include "BKE_main.h"
+#include "BKE_modifier.h"
+#include "BKE_node.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+
+#include "DNA_action_types.h"
+#include "DNA_armature_types.h"
+#include "DNA_constraint_types.h"
+#include "DNA_curve_types.h"
+#include "DNA_genfile.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "IMB_imbuf.h"
+
+#include "RNA_define.h"
+
+#include "CLG_log.h"
+
+namespace blender::bke::tests {
+
+/* Number of bones of every chain, and number of chains. Every four chains are connected by
+ * constraints, which gives independent groups of channels that are solved in parallel. */
+static constexpr int pose_test_chain_length = 4;
+static constexpr int pose_test_chains_num = 24;
+
+class PoseWhereIsTest : public testing::Test {
+ protected:
+  Main *bmain_ = nullptr;
+  Scene *scene_ = nullptr;
+  Object *ob_armature_ = nullptr;
+  Object *ob_curve_ = nullptr;
+  ::Depsgraph *depsgraph_ = nullptr;
+
+  static void SetUpTestCase()
+  {
+    testing::Test::SetUpTestCase();
+
+    /* Same initialization as for loading a blend-file and evaluating its depsgraph. */
+    CLG_init();
+    BLI_threadapi_init();
+    DNA_sdna_current_init();
+    BKE_blender_globals_init();
+    BKE_idtype_init();
+    BKE_appdir_init();
+    IMB_init();
+    BKE_images_init();
+    BKE_modifier_init();
+    DEG_register_node_types();
+    RNA_init();
+    BKE_node_system_init();
+
+    G.background = true;
+  }
+
+  static void TearDownTestCase()
+  {
+    BKE_blender_free();
+    RNA_exit();
+    DEG_free_node_types();
+    DNA_sdna_current_free();
+    BLI_threadapi_exit();
+    BKE_blender_atexit();
+    BKE_appdir_exit();
+    CLG_exit();
+
+    testing::Test::TearDownTestCase();
+  }
+
+  void SetUp() override
+  {
+    bmain_ = BKE_main_new();
+    scene_ = BKE_scene_add(bmain_, "Scene");
+  }
+
+  void TearDown() override
+  {
+    if (depsgraph_ != nullptr) {
+      DEG_graph_free(depsgraph_);
+    }
+    BKE_main_free(bmain_);
+  }
+
+  Object *add_object(const int type, const char *name)
+  {
+    Object *ob = BKE_object_add_only_object(bmain_, type, name);
+    ob->data = BKE_object_obdata_add_from_type(bmain_, type, name);
+    BKE_collection_object_add(bmain_, scene_->master_collection, ob);
+    return ob;
+  }
+
+  /* A poly curve along which the Spline IK chains are laid out. */
+  void add_curve()
+  {
+    ob_curve_ = add_object(OB_CURVE, "Path");
+    Curve *cu = static_cast<Curve *>(ob_curve_->data);
+    cu->flag |= CU_PATH | CU_3D;
+
+    Nurb *nu = static_cast<Nurb *>(MEM_callocN(sizeof(Nurb), __func__));
+    nu->type = CU_POLY;
+    nu->pntsu = 4;
+    nu->pntsv = 1;
+    nu->orderu = nu->orderv = 4;
+    nu->resolu = cu->resolu;
+    nu->bp = static_cast<BPoint *>(MEM_calloc_arrayN(nu->pntsu, sizeof(BPoint), __func__));
+    for (const int i : IndexRange(nu->pntsu)) {
+      BPoint *bp = &nu->bp[i];
+      const float co[4] = {0.5f * i, 0.25f * (i % 2), 1.5f * i, 1.0f};
+      copy_v4_v4(bp->vec, co);
+      bp->radius = 1.0f;
+    }
+    BLI_addtail(&cu->nurb, nu);
+  }
+
+  /* Chains of connected bones next to each other, with random rotations in the pose. */
+  void add_armature(RandomNumberGenerator &rng)
+  {
+    ob_armature_ = add_object(OB_ARMATURE, "Rig");
+    bArmature *arm = static_cast<bArmature *>(ob_armature_->data);
+    for (const int chain : IndexRange(pose_test_chains_num)) {
+      Bone *parent = nullptr;
+      for (const int i : IndexRange(pose_test_chain_length)) {
+        Bone *bone = static_cast<Bone *>(MEM_callocN(sizeof(Bone), __func__));
+        BLI_snprintf(bone->name, sizeof(bone->name), "Chain%d.%d", chain, i);
+        if (parent == nullptr) {
+          const float head[3] = {float(chain), 0.0f, 0.0f};
+          const float tail[3] = {float(chain), 0.0f, 1.0f};
+          copy_v3_v3(bone->head, head);
+          copy_v3_v3(bone->tail, tail);
+          BLI_addtail(&arm->bonebase, bone);
+        }
+        else {
+          const float tail[3] = {0.0f, 1.0f, 0.0f};
+          copy_v3_v3(bone->tail, tail);
+          bone->parent = parent;
+          bone->flag |= BONE_CONNECTED;
+          BLI_addtail(&parent->childbase, bone);
+        }
+        parent = bone;
+      }
+    }
+    BKE_armature_where_is(arm);
+    BKE_pose_ensure(bmain_, ob_armature_, arm, false);
+
+    LISTBASE_FOREACH (bPoseChannel *, pchan, &ob_armature_->pose->chanbase) {
+      const float axis[3] = {rng.get_float() - 0.5f, rng.get_float() - 0.5f, 1.0f};
+      axis_angle_to_quat(pchan->quat, axis, rng.get_float() - 0.5f);
+    }
+  }
+
+  bPoseChannel *pose_channel(const int chain, const int i)
+  {
+    char name[MAXBONENAME];
+    BLI_snprintf(name, sizeof(name), "Chain%d.%d", chain, i);
+    return BKE_pose_channel_find_name(ob_armature_->pose, name);
+  }
+
+  /* Constraints connect chains to chains which come before them in the pose. */
+  void add_constraints()
+  {
+    const int tip = pose_test_chain_length - 1;
+    for (int chain = 0; chain < pose_test_chains_num; chain += 4) {
+      bConstraint *con = BKE_constraint_add_for_pose(
+          ob_armature_, pose_channel(chain + 1, tip), "Spline IK", CONSTRAINT_TYPE_SPLINEIK);
+      bSplineIKConstraint *spline_ik = static_cast<bSplineIKConstraint *>(con->data);
+      spline_ik->tar = ob_curve_;
+      spline_ik->chainlen = pose_test_chain_length;
+
+      con = BKE_constraint_add_for_pose(
+          ob_armature_, pose_channel(chain + 2, 2), "Copy Location", CONSTRAINT_TYPE_LOCLIKE);
+      bLocateLikeConstraint *loclike = static_cast<bLocateLikeConstraint *>(con->data);
+      loclike->tar = ob_armature_;
+      STRNCPY(loclike->subtarget, pose_channel(chain + 1, 1)->name);
+
+      /* IK with its target and pole in other chains. */
+      con = BKE_constraint_add_for_pose(
+          ob_armature_, pose_channel(chain + 3, tip), "IK", CONSTRAINT_TYPE_KINEMATIC);
+      bKinematicConstraint *ik = static_cast<bKinematicConstraint *>(con->data);
+      ik->tar = ob_armature_;
+      STRNCPY(ik->subtarget, pose_channel(chain, tip)->name);
+      ik->poletar = ob_armature_;
+      STRNCPY(ik->polesubtarget, pose_channel(chain + 2, 1)->name);
+      ik->rootbone = pose_test_chain_length - 1;
+    }
+    BKE_pose_update_constraint_flags(ob_armature_->pose);
+  }
+
+  void evaluate()
+  {
+    ViewLayer *view_layer = static_cast<ViewLayer *>(scene_->view_layers.first);
+    depsgraph_ = DEG_graph_new(bmain_, scene_, view_layer, DAG_EVAL_VIEWPORT);
+    DEG_graph_build_from_view_layer(depsgraph_);
+    DEG_evaluate_on_framechange(depsgraph_, 1.0f);
+  }
+
+  struct PoseMatrices {
+    Vector<float4x4> pose_mats;
+    Vector<float4x4> chan_mats;
+  };
+
+  PoseMatrices where_is(const bool use_threading)
+  {
+    Scene *scene_eval = DEG_get_evaluated_scene(depsgraph_);
+    Object *ob_eval = DEG_get_evaluated_object(depsgraph_, ob_armature_);
+    BKE_pose_where_is_ex(depsgraph_, scene_eval, ob_eval, use_threading);
+    PoseMatrices result;
+    LISTBASE_FOREACH (const bPoseChannel *, pchan, &ob_eval->pose->chanbase) {
+      result.pose_mats.append(float4x4(pchan->pose_mat));
+      result.chan_mats.append(float4x4(pchan->chan_mat));
+    }
+    return result;
+  }
+};
+
+/* Solving groups in parallel must not change the result, not even in the last bit. */
+static void expect_same_matrices(const Span<float4x4> mats, const Span<float4x4> mats_reference)
+{
+  ASSERT_EQ(mats.size(), mats_reference.size());
+  for (const int64_t i : mats.index_range()) {
+    for (const int row : IndexRange(4)) {
+      for (const int col : IndexRange(4)) {
+        EXPECT_EQ(mats[i].values[row][col], mats_reference[i].values[row][col])
+            << "channel " << i << " [" << row << "][" << col << "]";
+      }
+    }
+  }
+}
+
+TEST_F(PoseWhereIsTest, ParallelMatchesSerial)
+{
+  RandomNumberGenerator rng(0);
+  add_curve();
+  add_armature(rng);
+  add_constraints();
+  evaluate();
+
+  /* Solve serially first, so both solves start from the same pose. */
+  where_is(false);
+  const PoseMatrices reference = where_is(false);
+  const PoseMatrices result = where_is(true);
+  expect_same_matrices(result.pose_mats, reference.pose_mats);
+  expect_same_matrices(result.chan_mats, reference.chan_mats);
+
+  /* The constraints between chains are evaluated: Copy Location moves a bone to its target. */
+  const int loclike_owner = 2 * pose_test_chain_length + 2;
+  const int loclike_target = pose_test_chain_length + 1;
+  EXPECT_V3_NEAR(result.pose_mats[loclike_owner].values[3],
+                 result.pose_mats[loclike_target].values[3],
+                 1e-5f);
+}
+
+}  // namespace blender::bke::tests
@@ -779,6 +779,7 @@ void BKE_pose_pchan_index_rebuild(bPose *pose)
   for (bPoseChannel *pchan = pose->chanbase.first; pchan != NULL; pchan = pchan->next) {
     pose->chan_array[pchan_index++] = pchan;
   }
+  BKE_pose_skinning_palette_clear(pose);
 }
 
 BLI_INLINE bPoseChannel *pose_pchan_get_indexed(Object *ob, int pchan_index)
@@ -819,6 +820,8 @@ void BKE_pose_eval_init(struct Depsgraph *depsgraph, Scene *UNUSED(scene), Objec
 
   BLI_assert(pose->chan_array != NULL || BLI_listbase_is_empty(&pose->chanbase));
 
+  BKE_pose_skinning_palette_clear(pose);
+
   if (object->proxy != NULL) {
     object->proxy->proxy_from = object;
   }
@@ -1021,9 +1024,10 @@ void BKE_pose_eval_done(struct Depsgraph *depsgraph, Object *object)
 {
   bPose *pose = object->pose;
   BLI_assert(pose != NULL);
-  UNUSED_VARS_NDEBUG(pose);
   DEG_debug_print_eval(depsgraph, __func__, object->id.name, object);
   BLI_assert(object->type == OB_ARMATURE);
+  /* All bones are evaluated, gather their deformation for the objects using the armature. */
+  BKE_pose_skinning_palette_update(pose);
 }
 
 void BKE_pose_eval_cleanup(struct Depsgraph *depsgraph, Scene *scene, Object *object)
@@ -1045,12 +1049,15 @@ void BKE_pose_eval_proxy_init(struct Depsgraph *depsgraph, Object *object)
   DEG_debug_print_eval(depsgraph, __func__, object->id.name, object);
 
   BLI_assert(object->pose->chan_array != NULL || BLI_listbase_is_empty(&object->pose->chanbase));
+
+  BKE_pose_skinning_palette_clear(object->pose);
 }
 
 void BKE_pose_eval_proxy_done(struct Depsgraph *depsgraph, Object *object)
 {
   BLI_assert(ID_IS_LINKED(object) && object->proxy_from != NULL);
   DEG_debug_print_eval(depsgraph, __func__, object->id.name, object);
+  BKE_pose_skinning_palette_update(object->pose);
 }
 
 void BKE_pose_eval_proxy_cleanup(struct Depsgraph *depsgraph, Object *object)
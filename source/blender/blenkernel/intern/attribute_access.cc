@@ -1410,6 +1410,27 @@ OutputAttribute GeometryComponent::attribute_try_get_for_output_only(
 
 namespace blender::bke {
 
+/* Evaluating fields on fewer elements is cheaper than looking up and storing the results. */
+static constexpr int field_cache_min_domain_size = 1024;
+
+fn::FieldCache *GeometryComponentFieldContext::field_cache() const
+{
+  /* Mutable components can be changed at any time without notice, so only results computed on
+   * shared components are cached. */
+  if (component_.is_mutable()) {
+    return nullptr;
+  }
+  if (component_.attribute_domain_size(domain_) < field_cache_min_domain_size) {
+    return nullptr;
+  }
+  return &component_.field_cache();
+}
+
+uint64_t GeometryComponentFieldContext::field_cache_key() const
+{
+  return component_.version() * ATTR_DOMAIN_NUM + domain_;
+}
+
 const GVArray *AttributeFieldInput::get_varray_for_context(const fn::FieldContext &context,
                                                            IndexMask UNUSED(mask),
                                                            ResourceScope &scope) const
@@ -0,0 +1,543 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bke
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_array.hh"
+#include "BLI_easing.h"
+#include "BLI_listbase.h"
+#include "BLI_math_vector.h"
+#include "BLI_vector.hh"
+
+#include "DNA_action_types.h"
+#include "DNA_anim_types.h"
+
+#include "BKE_animsys.h"
+#include "BKE_compiled_action.h"
+#include "BKE_fcurve.h"
+
+#include "RNA_access.h"
+
+#include "atomic_ops.h"
+
+using blender::Array;
+using blender::IndexRange;
+using blender::Span;
+using blender::Vector;
+
+/* Same threshold as used by the binary search in #fcurve_eval_keyframes_interpolate. A time this
+ * close to a key evaluates to the value of the key. */
+static constexpr float key_time_threshold = 0.0001f;
+/* When keys are closer than this, the binary search may find a different key within its threshold
+ * than the segment search, so such F-Curves are evaluated with #evaluate_fcurve instead. */
+static constexpr float min_key_distance = 0.001f;
+
+enum class SegmentType : uint8_t {
+  /** The value of the first key is used for the whole segment. */
+  Constant,
+  Linear,
+  Bezier,
+  /** Easing interpolation, evaluated with #evaluate_fcurve. */
+  Generic,
+};
+
+struct CompiledChannel {
+  FCurve *fcurve;
+  /** False when the F-Curve has to be evaluated with #evaluate_fcurve, e.g. for modifiers. */
+  bool use_keys;
+  bool int_values;
+  /** Keys of the F-Curve in the arrays of the compiled action. */
+  IndexRange keys;
+  /** Slopes of the extrapolation before the first and after the last key. */
+  float slope_before;
+  float slope_after;
+};
+
+struct CompiledAction {
+  /** Unique for every compiled action, so that freed and compiled again data is detected. */
+  uint64_t generation;
+  Vector<CompiledChannel> channels;
+
+  /* Keys of all channels. Every key starts a segment, except for the last key of a channel. */
+  Vector<float> key_times;
+  Vector<float> key_values;
+  Vector<SegmentType> segment_types;
+  /* Coefficients of the polynomials of Bezier segments. The constant terms are the key itself. */
+  Vector<float> bezier_x1;
+  Vector<float> bezier_x2;
+  Vector<float> bezier_x3;
+  Vector<float> bezier_y1;
+  Vector<float> bezier_y2;
+  Vector<float> bezier_y3;
+
+#ifdef WITH_CXX_GUARDEDALLOC
+  MEM_CXX_CLASS_ALLOC_FUNCS("CompiledAction")
+#endif
+};
+
+enum class TargetType : uint8_t {
+  /** The path could not be resolved, the channel is skipped. */
+  Invalid,
+  /** The resolved path is stored in the state. */
+  Resolved,
+  /** The path leads into data of another ID, which may be reallocated while the evaluated copy of
+   * this ID stays the same. The path is resolved for every evaluation. */
+  ResolveAlways,
+};
+
+struct CompiledActionState {
+  /** The compiled action that the state was created for. */
+  const CompiledAction *compiled;
+  uint64_t generation;
+
+  Array<int> segment_hints;
+  Array<float> values;
+  Array<PathResolvedRNA> targets;
+  Array<TargetType> target_types;
+
+#ifdef WITH_CXX_GUARDEDALLOC
+  MEM_CXX_CLASS_ALLOC_FUNCS("CompiledActionState")
+#endif
+};
+
+static std::atomic<uint64_t> next_generation = 1;
+
+/* -------------------------------------------------------------------- */
+/** \name Compiling
+ * \{ */
+
+static bool fcurve_keys_can_be_compiled(const FCurve *fcu)
+{
+  if (fcu->bezt == nullptr || fcu->totvert == 0 || fcu->driver != nullptr ||
+      !BLI_listbase_is_empty(&fcu->modifiers)) {
+    return false;
+  }
+  for (const int i : IndexRange(fcu->totvert - 1)) {
+    if (!(fcu->bezt[i + 1].vec[1][0] - fcu->bezt[i].vec[1][0] > min_key_distance)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Same as #fcurve_eval_keyframes_extrapolate, with the time dependent part taken out. */
+static float fcurve_extrapolation_slope(const FCurve *fcu,
+                                        const int endpoint_offset,
+                                        const int direction_to_neighbor)
+{
+  const BezTriple *endpoint_bezt = fcu->bezt + endpoint_offset;
+
+  if (endpoint_bezt->ipo == BEZT_IPO_CONST || fcu->extend == FCURVE_EXTRAPOLATE_CONSTANT ||
+      (fcu->flag & FCURVE_DISCRETE_VALUES) != 0) {
+    return 0.0f;
+  }
+
+  if (endpoint_bezt->ipo == BEZT_IPO_LIN) {
+    if (fcu->totvert == 1) {
+      return 0.0f;
+    }
+    const BezTriple *neighbor_bezt = endpoint_bezt + direction_to_neighbor;
+    const float fac = neighbor_bezt->vec[1][0] - endpoint_bezt->vec[1][0];
+    if (fac == 0.0f) {
+      return 0.0f;
+    }
+    return (neighbor_bezt->vec[1][1] - endpoint_bezt->vec[1][1]) / fac;
+  }
+
+  const int handle = direction_to_neighbor > 0 ? 0 : 2;
+  const float fac = endpoint_bezt->vec[1][0] - endpoint_bezt->vec[handle][0];
+  if (fac == 0.0f) {
+    return 0.0f;
+  }
+  return (endpoint_bezt->vec[1][1] - endpoint_bezt->vec[handle][1]) / fac;
+}
+
+static void append_segment(CompiledAction &compiled,
+                           const SegmentType type,
+                           const float bezier[6])
+{
+  compiled.segment_types.append(type);
+  compiled.bezier_x1.append(bezier[0]);
+  compiled.bezier_x2.append(bezier[1]);
+  compiled.bezier_x3.append(bezier[2]);
+  compiled.bezier_y1.append(bezier[3]);
+  compiled.bezier_y2.append(bezier[4]);
+  compiled.bezier_y3.append(bezier[5]);
+}
+
+/* Same as #fcurve_eval_keyframes_interpolate, with the time dependent part taken out. */
+static void compile_segment(CompiledAction &compiled,
+                            const FCurve *fcu,
+                            const BezTriple *prevbezt,
+                            const BezTriple *bezt)
+{
+  float bezier[6] = {0.0f};
+  SegmentType type = SegmentType::Generic;
+
+  if (prevbezt->ipo == BEZT_IPO_CONST || (fcu->flag & FCURVE_DISCRETE_VALUES)) {
+    type = SegmentType::Constant;
+  }
+  else if (prevbezt->ipo == BEZT_IPO_LIN) {
+    type = SegmentType::Linear;
+  }
+  else if (prevbezt->ipo == BEZT_IPO_BEZ) {
+    float v1[2], v2[2], v3[2], v4[2];
+    copy_v2_v2(v1, prevbezt->vec[1]);
+    copy_v2_v2(v2, prevbezt->vec[2]);
+    copy_v2_v2(v3, bezt->vec[0]);
+    copy_v2_v2(v4, bezt->vec[1]);
+
+    if (fabsf(v1[1] - v4[1]) < FLT_EPSILON && fabsf(v2[1] - v3[1]) < FLT_EPSILON &&
+        fabsf(v3[1] - v4[1]) < FLT_EPSILON) {
+      type = SegmentType::Constant;
+    }
+    else {
+      BKE_fcurve_correct_bezpart(v1, v2, v3, v4);
+      type = SegmentType::Bezier;
+      /* Same as the coefficients computed by #findzero and #berekeny. */
+      bezier[0] = 3.0f * (v2[0] - v1[0]);
+      bezier[1] = 3.0f * (v1[0] - 2.0f * v2[0] + v3[0]);
+      bezier[2] = v4[0] - v1[0] + 3.0f * (v2[0] - v3[0]);
+      bezier[3] = 3.0f * (v2[1] - v1[1]);
+      bezier[4] = 3.0f * (v1[1] - 2.0f * v2[1] + v3[1]);
+      bezier[5] = v4[1] - v1[1] + 3.0f * (v2[1] - v3[1]);
+    }
+  }
+
+  append_segment(compiled, type, bezier);
+}
+
+static void compile_fcurve(CompiledAction &compiled, FCurve *fcu)
+{
+  CompiledChannel channel;
+  channel.fcurve = fcu;
+  channel.use_keys = fcurve_keys_can_be_compiled(fcu);
+  channel.int_values = (fcu->flag & FCURVE_INT_VALUES) != 0;
+  channel.keys = IndexRange(compiled.key_times.size(), channel.use_keys ? fcu->totvert : 0);
+  channel.slope_before = 0.0f;
+  channel.slope_after = 0.0f;
+
+  if (channel.use_keys) {
+    const int keys_num = fcu->totvert;
+    channel.slope_before = fcurve_extrapolation_slope(fcu, 0, +1);
+    channel.slope_after = fcurve_extrapolation_slope(fcu, keys_num - 1, -1);
+    for (const int i : IndexRange(keys_num)) {
+      const BezTriple *bezt = fcu->bezt + i;
+      compiled.key_times.append(bezt->vec[1][0]);
+      compiled.key_values.append(bezt->vec[1][1]);
+      if (i + 1 < keys_num) {
+        compile_segment(compiled, fcu, bezt, bezt + 1);
+      }
+      else {
+        /* Keep the segment arrays aligned with the keys. */
+        const float unused[6] = {0.0f};
+        append_segment(compiled, SegmentType::Constant, unused);
+      }
+    }
+  }
+
+  compiled.channels.append(channel);
+}
+
+static CompiledAction *compiled_action_create(bAction *act)
+{
+  CompiledAction *compiled = new CompiledAction();
+  compiled->generation = next_generation++;
+  LISTBASE_FOREACH (FCurve *, fcu, &act->curves) {
+    if (BKE_fcurve_is_empty(fcu)) {
+      continue;
+    }
+    compile_fcurve(*compiled, fcu);
+  }
+  return compiled;
+}
+
+const CompiledAction *BKE_compiled_action_ensure(bAction *act)
+{
+  CompiledAction *compiled = act->compiled;
+  if (compiled != nullptr) {
+    return compiled;
+  }
+  /* Compiling is cheap compared to evaluating, so when multiple threads get here at the same time,
+   * all but one of the compiled actions are just freed again. */
+  compiled = compiled_action_create(act);
+  CompiledAction *existing = (CompiledAction *)atomic_cas_ptr(
+      (void **)&act->compiled, nullptr, compiled);
+  if (existing != nullptr) {
+    delete compiled;
+    return existing;
+  }
+  return compiled;
+}
+
+void BKE_compiled_action_free(CompiledAction *compiled)
+{
+  delete compiled;
+}
+
+int BKE_compiled_action_channels_num(const CompiledAction *compiled)
+{
+  return compiled->channels.size();
+}
+
+FCurve *BKE_compiled_action_channel_fcurve(const CompiledAction *compiled, int channel_index)
+{
+  return compiled->channels[channel_index].fcurve;
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Evaluation
+ * \{ */
+
+/**
+ * Find the segment which contains the time, starting at the segment that was used before.
+ * The time has to be between the first and the last key.
+ */
+static int find_segment(Span<float> times, const float evaltime, const int hint)
+{
+  const int segments_num = times.size() - 1;
+  if (hint >= 0 && hint < segments_num) {
+    if (times[hint] <= evaltime) {
+      if (evaltime < times[hint + 1]) {
+        return hint;
+      }
+      /* Playback usually moves to the next segment. */
+      if (hint + 1 < segments_num && evaltime < times[hint + 2]) {
+        return hint + 1;
+      }
+    }
+  }
+  const float *next = std::upper_bound(times.begin(), times.end(), evaltime);
+  return std::clamp<int>(next - times.begin() - 1, 0, segments_num - 1);
+}
+
+void BKE_compiled_action_evaluate_channels(const CompiledAction *compiled,
+                                           const float evaltime,
+                                           int *segment_hints,
+                                           float *r_values)
+{
+  const Span<CompiledChannel> channels = compiled->channels;
+  const Span<float> times = compiled->key_times;
+  const Span<float> values = compiled->key_values;
+
+  /* Bezier segments are solved afterwards for all channels together, which keeps the branches
+   * on the interpolation type out of the loops over the polynomials. */
+  Vector<int> bezier_channels;
+  Vector<int> bezier_segments;
+
+  for (const int channel_index : channels.index_range()) {
+    const CompiledChannel &channel = channels[channel_index];
+    float &r_value = r_values[channel_index];
+    if (!channel.use_keys) {
+      r_value = evaluate_fcurve(channel.fcurve, evaltime);
+      continue;
+    }
+
+    const Span<float> channel_times = times.slice(channel.keys);
+    const int first = channel.keys.first();
+    const int last = channel.keys.last();
+    if (evaltime <= times[first]) {
+      r_value = values[first] - channel.slope_before * (times[first] - evaltime);
+    }
+    else if (times[last] <= evaltime) {
+      r_value = values[last] - channel.slope_after * (times[last] - evaltime);
+    }
+    else {
+      const int segment = find_segment(channel_times, evaltime, segment_hints[channel_index]);
+      segment_hints[channel_index] = segment;
+      const int key = first + segment;
+      const float time = evaltime - times[key];
+      if (fabsf(time) <= key_time_threshold) {
+        r_value = values[key];
+      }
+      else if (fabsf(times[key + 1] - evaltime) <= key_time_threshold) {
+        r_value = values[key + 1];
+      }
+      else {
+        switch (compiled->segment_types[key]) {
+          case SegmentType::Constant:
+            r_value = values[key];
+            break;
+          case SegmentType::Linear:
+            r_value = BLI_easing_linear_ease(
+                time, values[key], values[key + 1] - values[key], times[key + 1] - times[key]);
+            break;
+          case SegmentType::Bezier:
+            bezier_channels.append(channel_index);
+            bezier_segments.append(key);
+            continue;
+          case SegmentType::Generic:
+            r_value = evaluate_fcurve(channel.fcurve, evaltime);
+            continue;
+        }
+      }
+    }
+    if (channel.int_values) {
+      r_value = floorf(r_value + 0.5f);
+    }
+  }
+
+  if (bezier_channels.is_empty()) {
+    return;
+  }
+
+  /* Find the parameters of the evaluation time on the segments, like #findzero. */
+  Array<float> parameters(bezier_channels.size());
+  for (const int i : bezier_channels.index_range()) {
+    const int key = bezier_segments[i];
+    if (!BKE_fcurve_bezier_solve_parameter(times[key] - evaltime,
+                                           compiled->bezier_x1[key],
+                                           compiled->bezier_x2[key],
+                                           compiled->bezier_x3[key],
+                                           &parameters[i])) {
+      /* Let the regular evaluation handle and report the failure. */
+      parameters[i] = NAN;
+    }
+  }
+
+  /* Evaluate the Y polynomials at the parameters, like #berekeny. */
+  for (const int i : bezier_channels.index_range()) {
+    const int key = bezier_segments[i];
+    const float t = parameters[i];
+    r_values[bezier_channels[i]] = values[key] + t * compiled->bezier_y1[key] +
+                                   t * t * compiled->bezier_y2[key] +
+                                   t * t * t * compiled->bezier_y3[key];
+  }
+
+  for (const int i : bezier_channels.index_range()) {
+    const CompiledChannel &channel = channels[bezier_channels[i]];
+    float &r_value = r_values[bezier_channels[i]];
+    if (std::isnan(parameters[i])) {
+      r_value = evaluate_fcurve(channel.fcurve, evaltime);
+    }
+    else if (channel.int_values) {
+      r_value = floorf(r_value + 0.5f);
+    }
+  }
+}
+
+/** \} */
+
+/* -------------------------------------------------------------------- */
+/** \name Animation Data Evaluation
+ * \{ */
+
+static bool fcurve_is_evaluatable(const FCurve *fcu)
+{
+  if (fcu->flag & (FCURVE_MUTED | FCURVE_DISABLED)) {
+    return false;
+  }
+  if (fcu->grp != nullptr && (fcu->grp->flag & AGRP_MUTED)) {
+    return false;
+  }
+  return true;
+}
+
+static CompiledActionState *compiled_action_state_create(PointerRNA *ptr,
+                                                         const CompiledAction *compiled)
+{
+  const int channels_num = compiled->channels.size();
+  CompiledActionState *state = new CompiledActionState();
+  state->compiled = compiled;
+  state->generation = compiled->generation;
+  state->segment_hints = Array<int>(channels_num, 0);
+  state->values = Array<float>(channels_num);
+  state->targets = Array<PathResolvedRNA>(channels_num);
+  state->target_types = Array<TargetType>(channels_num);
+
+  for (const int i : IndexRange(channels_num)) {
+    const FCurve *fcu = compiled->channels[i].fcurve;
+    PathResolvedRNA &target = state->targets[i];
+    if (!BKE_animsys_rna_path_resolve(ptr, fcu->rna_path, fcu->array_index, &target)) {
+      state->target_types[i] = TargetType::Invalid;
+    }
+    else if (target.ptr.owner_id == ptr->owner_id || target.ptr.data == target.ptr.owner_id) {
+      /* Data of evaluated IDs is only reallocated when the whole ID is copied again. */
+      state->target_types[i] = TargetType::Resolved;
+    }
+    else {
+      state->target_types[i] = TargetType::ResolveAlways;
+    }
+  }
+  return state;
+}
+
+void BKE_compiled_action_evaluate_animdata(PointerRNA *ptr,
+                                           AnimData *adt,
+                                           bAction *act,
+                                           const AnimationEvalContext *anim_eval_context,
+                                           const bool flush_to_original)
+{
+  const CompiledAction *compiled = BKE_compiled_action_ensure(act);
+
+  CompiledActionState *state = adt->compiled_action_state;
+  if (state == nullptr || state->compiled != compiled ||
+      state->generation != compiled->generation) {
+    BKE_compiled_action_state_free(state);
+    state = compiled_action_state_create(ptr, compiled);
+    adt->compiled_action_state = state;
+  }
+
+  BKE_compiled_action_evaluate_channels(compiled,
+                                        anim_eval_context->eval_time,
+                                        state->segment_hints.data(),
+                                        state->values.data());
+
+  for (const int i : compiled->channels.index_range()) {
+    FCurve *fcu = compiled->channels[i].fcurve;
+    if (!fcurve_is_evaluatable(fcu)) {
+      continue;
+    }
+    const float value = state->values[i];
+    switch (state->target_types[i]) {
+      case TargetType::Invalid:
+        continue;
+      case TargetType::Resolved:
+        BKE_animsys_write_to_rna_path(&state->targets[i], value);
+        break;
+      case TargetType::ResolveAlways: {
+        PathResolvedRNA anim_rna;
+        if (!BKE_animsys_rna_path_resolve(ptr, fcu->rna_path, fcu->array_index, &anim_rna)) {
+          continue;
+        }
+        BKE_animsys_write_to_rna_path(&anim_rna, value);
+        break;
+      }
+    }
+    fcu->curval = value; /* Debug display only, not thread safe! */
+    if (flush_to_original) {
+      BKE_animsys_write_orig_anim_rna(ptr, fcu->rna_path, fcu->array_index, value);
+    }
+  }
+}
+
+void BKE_compiled_action_state_free(CompiledActionState *state)
+{
+  delete state;
+}
+
+/** \} */
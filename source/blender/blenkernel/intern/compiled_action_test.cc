@@ -0,0 +1,144 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_array.hh"
+#include "BLI_listbase.h"
+#include "BLI_rand.hh"
+#include "BLI_vector.hh"
+
+#include "BKE_compiled_action.h"
+#include "BKE_fcurve.h"
+
+#include "ED_keyframing.h"
+
+#include "DNA_action_types.h"
+#include "DNA_anim_types.h"
+
+namespace blender::bke::tests {
+
+class CompiledActionTest : public testing::Test {
+ protected:
+  bAction action_ = {{nullptr}};
+
+  void TearDown() override
+  {
+    BKE_compiled_action_free(action_.compiled);
+    BKE_fcurves_free(&action_.curves);
+  }
+
+  FCurve *add_fcurve(const int keys_num, const int seed)
+  {
+    RandomNumberGenerator rng(seed);
+    FCurve *fcu = BKE_fcurve_create();
+    float frame = 1.0f;
+    for (int i = 0; i < keys_num; i++) {
+      insert_vert_fcurve(
+          fcu, frame, rng.get_float() * 10.0f, BEZT_KEYTYPE_KEYFRAME, INSERTKEY_NO_USERPREF);
+      frame += 1.0f + rng.get_float() * 5.0f;
+    }
+    BLI_addtail(&action_.curves, fcu);
+    return fcu;
+  }
+
+  /* Evaluate the compiled action at all times and compare with regular F-Curve evaluation. */
+  void expect_same_values(Span<float> times)
+  {
+    const CompiledAction *compiled = BKE_compiled_action_ensure(&action_);
+    const int channels_num = BKE_compiled_action_channels_num(compiled);
+    ASSERT_EQ(channels_num, BLI_listbase_count(&action_.curves));
+
+    Array<int> segment_hints(channels_num, 0);
+    Array<float> values(channels_num);
+    for (const float time : times) {
+      BKE_compiled_action_evaluate_channels(
+          compiled, time, segment_hints.data(), values.data());
+      for (const int i : IndexRange(channels_num)) {
+        FCurve *fcu = BKE_compiled_action_channel_fcurve(compiled, i);
+        EXPECT_NEAR(values[i], evaluate_fcurve(fcu, time), 1e-5f) << "at time " << time;
+      }
+    }
+  }
+};
+
+static Vector<float> playback_times(const float start, const float end, const float step)
+{
+  Vector<float> times;
+  for (float time = start; time <= end; time += step) {
+    times.append(time);
+  }
+  return times;
+}
+
+TEST_F(CompiledActionTest, Bezier)
+{
+  add_fcurve(1, 0);
+  add_fcurve(2, 1);
+  add_fcurve(20, 2);
+  expect_same_values(playback_times(-5.0f, 120.0f, 0.25f));
+}
+
+TEST_F(CompiledActionTest, InterpolationAndExtrapolation)
+{
+  const int types[] = {BEZT_IPO_CONST, BEZT_IPO_LIN, BEZT_IPO_BEZ, BEZT_IPO_ELASTIC};
+  for (const int i : IndexRange(8)) {
+    FCurve *fcu = add_fcurve(10, i);
+    for (const int key : IndexRange(fcu->totvert)) {
+      fcu->bezt[key].ipo = types[(key + i) % 4];
+    }
+    fcu->extend = (i % 2) ? FCURVE_EXTRAPOLATE_LINEAR : FCURVE_EXTRAPOLATE_CONSTANT;
+  }
+  expect_same_values(playback_times(-5.0f, 80.0f, 0.5f));
+}
+
+TEST_F(CompiledActionTest, ExactKeys)
+{
+  FCurve *fcu = add_fcurve(5, 3);
+  Vector<float> times;
+  for (const int key : IndexRange(fcu->totvert)) {
+    const float frame = fcu->bezt[key].vec[1][0];
+    times.extend({frame - 0.00008f, frame, frame + 0.00008f});
+  }
+  expect_same_values(times);
+}
+
+TEST_F(CompiledActionTest, RandomTimes)
+{
+  add_fcurve(50, 4);
+  add_fcurve(3, 5);
+  RandomNumberGenerator rng(6);
+  Vector<float> times;
+  for (int i = 0; i < 500; i++) {
+    times.append(rng.get_float() * 300.0f - 10.0f);
+  }
+  expect_same_values(times);
+}
+
+TEST_F(CompiledActionTest, Fallback)
+{
+  /* Keys that are too close and modifiers are evaluated like regular F-Curves. */
+  FCurve *fcu_close = add_fcurve(4, 7);
+  fcu_close->bezt[1].vec[1][0] = fcu_close->bezt[0].vec[1][0] + 0.0002f;
+  FCurve *fcu_modifier = add_fcurve(4, 8);
+  add_fmodifier(&fcu_modifier->modifiers, FMODIFIER_TYPE_NOISE, fcu_modifier);
+  FCurve *fcu_int = add_fcurve(6, 9);
+  fcu_int->flag |= FCURVE_INT_VALUES;
+  expect_same_values(playback_times(0.0f, 40.0f, 0.3f));
+}
+
+}  // namespace blender::bke::tests
@@ -160,6 +160,109 @@ blender::Array<float> CurveEval::accumulated_spline_lengths() const
   return spline_lengths;
 }
 
+/** Indices of the splines of every type, to process them without virtual calls. */
+struct SplineTypeIndices {
+  Vector<int> bezier;
+  Vector<int> nurbs;
+  Vector<int> poly;
+};
+
+static SplineTypeIndices spline_indices_by_type(Span<SplinePtr> splines)
+{
+  SplineTypeIndices indices;
+  for (const int i : splines.index_range()) {
+    switch (splines[i]->type()) {
+      case Spline::Type::Bezier:
+        indices.bezier.append(i);
+        break;
+      case Spline::Type::NURBS:
+        indices.nurbs.append(i);
+        break;
+      case Spline::Type::Poly:
+        indices.poly.append(i);
+        break;
+    }
+  }
+  return indices;
+}
+
+template<typename SplineType>
+static void evaluate_positions_of_type(Span<SplinePtr> splines, Span<int> indices)
+{
+  blender::threading::parallel_for(indices.index_range(), 64, [&](IndexRange range) {
+    for (const int i : range) {
+      /* The cast avoids the virtual call, since the methods are final in the derived types. */
+      static_cast<const SplineType &>(*splines[indices[i]]).evaluated_positions();
+    }
+  });
+}
+
+template<typename SplineType>
+static void evaluate_positions_of_type(Span<SplinePtr> splines,
+                                       Span<int> indices,
+                                       Span<int> offsets,
+                                       MutableSpan<float3> r_positions)
+{
+  blender::threading::parallel_for(indices.index_range(), 64, [&](IndexRange range) {
+    for (const int i : range) {
+      const int spline_index = indices[i];
+      MutableSpan<float3> positions = r_positions.slice(
+          offsets[spline_index], offsets[spline_index + 1] - offsets[spline_index]);
+      static_cast<const SplineType &>(*splines[spline_index]).evaluate_positions(positions);
+    }
+  });
+}
+
+/**
+ * Calculate the evaluated positions of all splines at once. This is much faster than evaluating
+ * the splines lazily one after another when there are many small splines (like hair), because
+ * every spline is evaluated on a single thread and the splines of the same type are processed
+ * together.
+ */
+void CurveEval::ensure_evaluated_positions() const
+{
+  /* The evaluated positions of poly splines are the control point positions. */
+  const SplineTypeIndices indices = spline_indices_by_type(splines_);
+  evaluate_positions_of_type<BezierSpline>(splines_, indices.bezier);
+  evaluate_positions_of_type<NURBSpline>(splines_, indices.nurbs);
+}
+
+/**
+ * Write the evaluated positions of all splines to one contiguous array, where the positions of
+ * every spline start at its offset from #evaluated_point_offsets. Unlike
+ * #ensure_evaluated_positions, the position caches of the splines are not filled, which avoids
+ * an allocation for every spline when the positions are only needed in a combined array.
+ */
+void CurveEval::evaluate_positions(Span<int> offsets, MutableSpan<float3> r_positions) const
+{
+  BLI_assert(offsets.size() == splines_.size() + 1);
+  BLI_assert(r_positions.size() == offsets.last());
+
+  const SplineTypeIndices indices = spline_indices_by_type(splines_);
+  evaluate_positions_of_type<BezierSpline>(splines_, indices.bezier, offsets, r_positions);
+  evaluate_positions_of_type<NURBSpline>(splines_, indices.nurbs, offsets, r_positions);
+  blender::threading::parallel_for(indices.poly.index_range(), 256, [&](IndexRange range) {
+    for (const int i : range) {
+      const int spline_index = indices.poly[i];
+      r_positions.slice(offsets[spline_index], offsets[spline_index + 1] - offsets[spline_index])
+          .copy_from(splines_[spline_index]->positions());
+    }
+  });
+}
+
+/**
+ * Like #ensure_evaluated_positions, but also calculate the evaluated tangents and normals.
+ */
+void CurveEval::ensure_evaluated_normals() const
+{
+  this->ensure_evaluated_positions();
+  blender::threading::parallel_for(splines_.index_range(), 64, [&](IndexRange range) {
+    for (const int i : range) {
+      splines_[i]->evaluated_normals();
+    }
+  });
+}
+
 void CurveEval::mark_cache_invalid()
 {
   for (SplinePtr &spline : splines_) {
@@ -49,9 +49,12 @@ struct ResultInfo {
   int spline_edge_len;
   int profile_vert_len;
   int profile_edge_len;
+  /** The radii of the curve spline's evaluated points, shared by all profiles. */
+  Span<float> spline_radii;
 };
 
 static void vert_extrude_to_mesh_data(const Spline &spline,
+                                      const Span<float> radii,
                                       const float3 profile_vert,
                                       MutableSpan<MVert> r_verts,
                                       MutableSpan<MEdge> r_edges,
@@ -76,7 +79,6 @@ static void vert_extrude_to_mesh_data(const Spline &spline,
   Span<float3> positions = spline.evaluated_positions();
   Span<float3> tangents = spline.evaluated_tangents();
   Span<float3> normals = spline.evaluated_normals();
-  GVArray_Typed<float> radii = spline.interpolate_to_evaluated(spline.radii());
   for (const int i : IndexRange(eval_size)) {
     float4x4 point_matrix = float4x4::from_normalized_axis_data(
         positions[i], normals[i], tangents[i]);
@@ -105,6 +107,7 @@ static void spline_extrude_to_mesh_data(const ResultInfo &info,
   const Spline &profile = info.profile;
   if (info.profile_vert_len == 1) {
     vert_extrude_to_mesh_data(spline,
+                              info.spline_radii,
                               profile.evaluated_positions()[0],
                               r_verts,
                               r_edges,
@@ -226,8 +229,8 @@ static void spline_extrude_to_mesh_data(const ResultInfo &info,
   Span<float3> tangents = spline.evaluated_tangents();
   Span<float3> normals = spline.evaluated_normals();
   Span<float3> profile_positions = profile.evaluated_positions();
+  Span<float> radii = info.spline_radii;
 
-  GVArray_Typed<float> radii = spline.interpolate_to_evaluated(spline.radii());
   for (const int i_ring : IndexRange(info.spline_vert_len)) {
     float4x4 point_matrix = float4x4::from_normalized_axis_data(
         positions[i_ring], normals[i_ring], tangents[i_ring]);
@@ -254,34 +257,52 @@ static void spline_extrude_to_mesh_data(const ResultInfo &info,
   }
 }
 
-static inline int spline_extrude_vert_size(const Spline &curve, const Spline &profile)
+/** Sizes of the evaluated data of a spline, to avoid virtual calls for every combination. */
+struct SplineSizes {
+  int vert_len;
+  int edge_len;
+  bool is_cyclic;
+};
+
+static Array<SplineSizes> calculate_spline_sizes(Span<SplinePtr> splines)
 {
-  return curve.evaluated_points_size() * profile.evaluated_points_size();
+  Array<SplineSizes> sizes(splines.size());
+  threading::parallel_for(splines.index_range(), 1024, [&](IndexRange range) {
+    for (const int i : range) {
+      const Spline &spline = *splines[i];
+      sizes[i] = {spline.evaluated_points_size(), spline.evaluated_edges_size(), spline.is_cyclic()};
+    }
+  });
+  return sizes;
 }
 
-static inline int spline_extrude_edge_size(const Spline &curve, const Spline &profile)
+static inline int spline_extrude_vert_size(const SplineSizes &curve, const SplineSizes &profile)
+{
+  return curve.vert_len * profile.vert_len;
+}
+
+static inline int spline_extrude_edge_size(const SplineSizes &curve, const SplineSizes &profile)
 {
   /* Add the ring edges, with one ring for every curve vertex, and the edge loops
    * that run along the length of the curve, starting on the first profile. */
-  return curve.evaluated_points_size() * profile.evaluated_edges_size() +
-         curve.evaluated_edges_size() * profile.evaluated_points_size();
+  return curve.vert_len * profile.edge_len + curve.edge_len * profile.vert_len;
 }
 
-static inline int spline_extrude_loop_size(const Spline &curve,
-                                           const Spline &profile,
+static inline int spline_extrude_loop_size(const SplineSizes &curve,
+                                           const SplineSizes &profile,
                                            const bool fill_caps)
 {
-  const int tube = curve.evaluated_edges_size() * profile.evaluated_edges_size() * 4;
-  const int caps = (fill_caps && profile.is_cyclic()) ? profile.evaluated_edges_size() * 2 : 0;
+  const int tube = curve.edge_len * profile.edge_len * 4;
+  const int caps = (fill_caps && profile.is_cyclic) ? profile.edge_len * 2 : 0;
   return tube + caps;
 }
 
-static inline int spline_extrude_poly_size(const Spline &curve,
-                                           const Spline &profile,
+static inline int spline_extrude_poly_size(const SplineSizes &curve,
+                                           const SplineSizes &profile,
                                            const bool fill_caps)
 {
-  const int tube = curve.evaluated_edges_size() * profile.evaluated_edges_size();
-  const int caps = (fill_caps && profile.is_cyclic()) ? 2 : 0;
+  const int tube = curve.edge_len * profile.edge_len;
+  const int caps = (fill_caps && profile.is_cyclic) ? 2 : 0;
   return tube + caps;
 }
 
@@ -291,8 +312,13 @@ struct ResultOffsets {
   Array<int> loop;
   Array<int> poly;
 };
-static ResultOffsets calculate_result_offsets(Span<SplinePtr> profiles,
-                                              Span<SplinePtr> curves,
+
+/**
+ * Compute the offsets of every curve and profile spline combination in the result mesh in a
+ * single prefix sum pass, so that all combinations can be filled in parallel afterwards.
+ */
+static ResultOffsets calculate_result_offsets(Span<SplineSizes> profiles,
+                                              Span<SplineSizes> curves,
                                               const bool fill_caps)
 {
   const int total = profiles.size() * curves.size();
@@ -306,16 +332,16 @@ static ResultOffsets calculate_result_offsets(Span<SplinePtr> profiles,
   int edge_offset = 0;
   int loop_offset = 0;
   int poly_offset = 0;
-  for (const int i_spline : curves.index_range()) {
-    for (const int i_profile : profiles.index_range()) {
+  for (const SplineSizes &curve : curves) {
+    for (const SplineSizes &profile : profiles) {
       vert[mesh_index] = vert_offset;
       edge[mesh_index] = edge_offset;
       loop[mesh_index] = loop_offset;
       poly[mesh_index] = poly_offset;
-      vert_offset += spline_extrude_vert_size(*curves[i_spline], *profiles[i_profile]);
-      edge_offset += spline_extrude_edge_size(*curves[i_spline], *profiles[i_profile]);
-      loop_offset += spline_extrude_loop_size(*curves[i_spline], *profiles[i_profile], fill_caps);
-      poly_offset += spline_extrude_poly_size(*curves[i_spline], *profiles[i_profile], fill_caps);
+      vert_offset += spline_extrude_vert_size(curve, profile);
+      edge_offset += spline_extrude_edge_size(curve, profile);
+      loop_offset += spline_extrude_loop_size(curve, profile, fill_caps);
+      poly_offset += spline_extrude_poly_size(curve, profile, fill_caps);
       mesh_index++;
     }
   }
@@ -491,14 +517,11 @@ static void copy_curve_point_data_to_mesh_faces(const Span<T> src,
   }
 }
 
-static void copy_curve_point_attribute_to_mesh(const GSpan src,
+static void copy_curve_point_attribute_to_mesh(const GSpan interpolated,
                                                const ResultInfo &info,
                                                ResultAttributeData &dst)
 {
-  GVArrayPtr interpolated_gvarray = info.spline.interpolate_to_evaluated(src);
-  GSpan interpolated = interpolated_gvarray->get_internal_span();
-
-  attribute_math::convert_to_static_type(src.type(), [&](auto dummy) {
+  attribute_math::convert_to_static_type(interpolated.type(), [&](auto dummy) {
     using T = decltype(dummy);
     switch (dst.domain) {
       case ATTR_DOMAIN_POINT:
@@ -557,14 +580,11 @@ static void copy_profile_point_data_to_mesh_faces(const Span<T> src,
   }
 }
 
-static void copy_profile_point_attribute_to_mesh(const GSpan src,
+static void copy_profile_point_attribute_to_mesh(const GSpan interpolated,
                                                  const ResultInfo &info,
                                                  ResultAttributeData &dst)
 {
-  GVArrayPtr interpolated_gvarray = info.profile.interpolate_to_evaluated(src);
-  GSpan interpolated = interpolated_gvarray->get_internal_span();
-
-  attribute_math::convert_to_static_type(src.type(), [&](auto dummy) {
+  attribute_math::convert_to_static_type(interpolated.type(), [&](auto dummy) {
     using T = decltype(dummy);
     switch (dst.domain) {
       case ATTR_DOMAIN_POINT:
@@ -586,110 +606,129 @@ static void copy_profile_point_attribute_to_mesh(const GSpan src,
   });
 }
 
-static void copy_point_domain_attributes_to_mesh(const ResultInfo &info,
-                                                 ResultAttributes &attributes)
+/**
+ * Point attributes of a spline interpolated to its evaluated points, in the order of the
+ * corresponding result attributes. Attributes without a result attribute are null.
+ */
+using InterpolatedPointAttributes = Vector<GVArrayPtr>;
+
+static InterpolatedPointAttributes interpolate_point_attributes(
+    const Spline &spline, Span<std::optional<ResultAttributeData>> result_attributes)
 {
-  if (!attributes.curve_point_attributes.is_empty()) {
-    int i = 0;
-    info.spline.attributes.foreach_attribute(
-        [&](const AttributeIDRef &id, const AttributeMetaData &UNUSED(meta_data)) {
-          if (attributes.curve_point_attributes[i]) {
-            copy_curve_point_attribute_to_mesh(*info.spline.attributes.get_for_read(id),
-                                               info,
-                                               *attributes.curve_point_attributes[i]);
-          }
-          i++;
-          return true;
-        },
-        ATTR_DOMAIN_POINT);
-  }
-  if (!attributes.profile_point_attributes.is_empty()) {
-    int i = 0;
-    info.profile.attributes.foreach_attribute(
-        [&](const AttributeIDRef &id, const AttributeMetaData &UNUSED(meta_data)) {
-          if (attributes.profile_point_attributes[i]) {
-            copy_profile_point_attribute_to_mesh(*info.profile.attributes.get_for_read(id),
-                                                 info,
-                                                 *attributes.profile_point_attributes[i]);
-          }
-          i++;
-          return true;
-        },
-        ATTR_DOMAIN_POINT);
+  InterpolatedPointAttributes interpolated;
+  if (result_attributes.is_empty()) {
+    return interpolated;
   }
+  spline.attributes.foreach_attribute(
+      [&](const AttributeIDRef &id, const AttributeMetaData &UNUSED(meta_data)) {
+        if (result_attributes[interpolated.size()]) {
+          interpolated.append(
+              spline.interpolate_to_evaluated(*spline.attributes.get_for_read(id)));
+        }
+        else {
+          interpolated.append({});
+        }
+        return true;
+      },
+      ATTR_DOMAIN_POINT);
+  return interpolated;
 }
 
-template<typename T>
-static void copy_spline_data_to_mesh(Span<T> src, Span<int> offsets, MutableSpan<T> dst)
+static void copy_point_domain_attributes_to_mesh(const ResultInfo &info,
+                                                 const InterpolatedPointAttributes &spline_data,
+                                                 const InterpolatedPointAttributes &profile_data,
+                                                 ResultAttributes &attributes)
 {
-  for (const int i : IndexRange(src.size())) {
-    dst.slice(offsets[i], offsets[i + 1] - offsets[i]).fill(src[i]);
+  for (const int i : spline_data.index_range()) {
+    if (spline_data[i]) {
+      copy_curve_point_attribute_to_mesh(
+          spline_data[i]->get_internal_span(), info, *attributes.curve_point_attributes[i]);
+    }
+  }
+  for (const int i : profile_data.index_range()) {
+    if (profile_data[i]) {
+      copy_profile_point_attribute_to_mesh(
+          profile_data[i]->get_internal_span(), info, *attributes.profile_point_attributes[i]);
+    }
   }
 }
 
 /**
- * Since the offsets for each combination of curve and profile spline are stored for every mesh
- * domain, and this just needs to fill the chunks corresponding to each combination, we can use
- * the same function for all mesh domains.
+ * Spline domain attributes of the inputs, in the order of the corresponding result attributes.
+ * Attributes without a result attribute are not gathered.
  */
-static void copy_spline_attribute_to_mesh(const GSpan src,
-                                          const ResultOffsets &offsets,
-                                          ResultAttributeData &dst_attribute)
+static Vector<std::optional<GSpan>> gather_spline_domain_attributes(
+    const CurveEval &curve, Span<std::optional<ResultAttributeData>> result_attributes)
 {
-  attribute_math::convert_to_static_type(src.type(), [&](auto dummy) {
-    using T = decltype(dummy);
-    switch (dst_attribute.domain) {
-      case ATTR_DOMAIN_POINT:
-        copy_spline_data_to_mesh(src.typed<T>(), offsets.vert, dst_attribute.data.typed<T>());
-        break;
-      case ATTR_DOMAIN_EDGE:
-        copy_spline_data_to_mesh(src.typed<T>(), offsets.edge, dst_attribute.data.typed<T>());
-        break;
-      case ATTR_DOMAIN_FACE:
-        copy_spline_data_to_mesh(src.typed<T>(), offsets.poly, dst_attribute.data.typed<T>());
-        break;
-      case ATTR_DOMAIN_CORNER:
-        copy_spline_data_to_mesh(src.typed<T>(), offsets.loop, dst_attribute.data.typed<T>());
-        break;
-      default:
-        BLI_assert_unreachable();
-        break;
-    }
-  });
+  Vector<std::optional<GSpan>> spans;
+  curve.attributes.foreach_attribute(
+      [&](const AttributeIDRef &id, const AttributeMetaData &UNUSED(meta_data)) {
+        if (result_attributes[spans.size()]) {
+          spans.append(*curve.attributes.get_for_read(id));
+        }
+        else {
+          spans.append(std::nullopt);
+        }
+        return true;
+      },
+      ATTR_DOMAIN_CURVE);
+  return spans;
+}
+
+static IndexRange result_domain_range(const ResultOffsets &offsets,
+                                      const AttributeDomain domain,
+                                      const int i_mesh)
+{
+  Span<int> domain_offsets;
+  switch (domain) {
+    case ATTR_DOMAIN_POINT:
+      domain_offsets = offsets.vert;
+      break;
+    case ATTR_DOMAIN_EDGE:
+      domain_offsets = offsets.edge;
+      break;
+    case ATTR_DOMAIN_FACE:
+      domain_offsets = offsets.poly;
+      break;
+    case ATTR_DOMAIN_CORNER:
+      domain_offsets = offsets.loop;
+      break;
+    default:
+      BLI_assert_unreachable();
+      return {};
+  }
+  return {domain_offsets[i_mesh], domain_offsets[i_mesh + 1] - domain_offsets[i_mesh]};
 }
 
-static void copy_spline_domain_attributes_to_mesh(const CurveEval &curve,
-                                                  const CurveEval &profile,
-                                                  const ResultOffsets &offsets,
+/**
+ * Fill the part of the result attributes that corresponds to one combination of curve and
+ * profile spline with the value of the spline domain attributes of both splines.
+ */
+static void copy_spline_domain_attributes_to_mesh(const ResultOffsets &offsets,
+                                                  const int i_mesh,
+                                                  const int i_spline,
+                                                  const int i_profile,
+                                                  Span<std::optional<GSpan>> curve_data,
+                                                  Span<std::optional<GSpan>> profile_data,
                                                   ResultAttributes &attributes)
 {
-  if (!attributes.curve_spline_attributes.is_empty()) {
-    int i = 0;
-    curve.attributes.foreach_attribute(
-        [&](const AttributeIDRef &id, const AttributeMetaData &UNUSED(meta_data)) {
-          if (attributes.curve_spline_attributes[i]) {
-            copy_spline_attribute_to_mesh(*curve.attributes.get_for_read(id),
-                                          offsets,
-                                          *attributes.curve_spline_attributes[i]);
-          }
-          i++;
-          return true;
-        },
-        ATTR_DOMAIN_CURVE);
+  auto fill_attribute = [&](const GSpan src, const int index, ResultAttributeData &dst) {
+    const IndexRange range = result_domain_range(offsets, dst.domain, i_mesh);
+    if (range.size() == 0) {
+      return;
+    }
+    const CPPType &type = src.type();
+    type.fill_assign_n(src[index], dst.data[range.start()], range.size());
+  };
+  for (const int i : curve_data.index_range()) {
+    if (curve_data[i]) {
+      fill_attribute(*curve_data[i], i_spline, *attributes.curve_spline_attributes[i]);
+    }
   }
-  if (!attributes.profile_spline_attributes.is_empty()) {
-    int i = 0;
-    profile.attributes.foreach_attribute(
-        [&](const AttributeIDRef &id, const AttributeMetaData &UNUSED(meta_data)) {
-          if (attributes.profile_spline_attributes[i]) {
-            copy_spline_attribute_to_mesh(*profile.attributes.get_for_read(id),
-                                          offsets,
-                                          *attributes.profile_spline_attributes[i]);
-          }
-          i++;
-          return true;
-        },
-        ATTR_DOMAIN_CURVE);
+  for (const int i : profile_data.index_range()) {
+    if (profile_data[i]) {
+      fill_attribute(*profile_data[i], i_profile, *attributes.profile_spline_attributes[i]);
+    }
   }
 }
 
@@ -708,7 +747,13 @@ Mesh *curve_to_mesh_sweep(const CurveEval &curve, const CurveEval &profile, cons
   Span<SplinePtr> profiles = profile.splines();
   Span<SplinePtr> curves = curve.splines();
 
-  const ResultOffsets offsets = calculate_result_offsets(profiles, curves, fill_caps);
+  /* Evaluate all splines up front, instead of lazily in the nested loops below. */
+  curve.ensure_evaluated_normals();
+  profile.ensure_evaluated_positions();
+
+  const Array<SplineSizes> curve_sizes = calculate_spline_sizes(curves);
+  const Array<SplineSizes> profile_sizes = calculate_spline_sizes(profiles);
+  const ResultOffsets offsets = calculate_result_offsets(profile_sizes, curve_sizes, fill_caps);
   if (offsets.vert.last() == 0) {
     return nullptr;
   }
@@ -721,13 +766,31 @@ Mesh *curve_to_mesh_sweep(const CurveEval &curve, const CurveEval &profile, cons
   BKE_mesh_normals_tag_dirty(mesh);
 
   ResultAttributes attributes = create_result_attributes(curve, profile, *mesh);
+  const Vector<std::optional<GSpan>> curve_spline_data = gather_spline_domain_attributes(
+      curve, attributes.curve_spline_attributes);
+  const Vector<std::optional<GSpan>> profile_spline_data = gather_spline_domain_attributes(
+      profile, attributes.profile_spline_attributes);
+
+  /* The profile data is the same for every curve spline, so only interpolate it once. */
+  Array<InterpolatedPointAttributes> profile_point_data(profiles.size());
+  threading::parallel_for(profiles.index_range(), 128, [&](IndexRange range) {
+    for (const int i_profile : range) {
+      profile_point_data[i_profile] = interpolate_point_attributes(
+          *profiles[i_profile], attributes.profile_point_attributes);
+    }
+  });
 
   threading::parallel_for(curves.index_range(), 128, [&](IndexRange curves_range) {
     for (const int i_spline : curves_range) {
       const Spline &spline = *curves[i_spline];
-      if (spline.evaluated_points_size() == 0) {
+      if (curve_sizes[i_spline].vert_len == 0) {
         continue;
       }
+      /* Interpolate the curve spline data once for all profiles. */
+      GVArray_Typed<float> radii = spline.interpolate_to_evaluated(spline.radii());
+      const InterpolatedPointAttributes spline_point_data = interpolate_point_attributes(
+          spline, attributes.curve_point_attributes);
+
       const int spline_start_index = i_spline * profiles.size();
       threading::parallel_for(profiles.index_range(), 128, [&](IndexRange profiles_range) {
         for (const int i_profile : profiles_range) {
@@ -740,10 +803,11 @@ Mesh *curve_to_mesh_sweep(const CurveEval &curve, const CurveEval &profile, cons
               offsets.edge[i_mesh],
               offsets.loop[i_mesh],
               offsets.poly[i_mesh],
-              spline.evaluated_points_size(),
-              spline.evaluated_edges_size(),
-              profile.evaluated_points_size(),
-              profile.evaluated_edges_size(),
+              curve_sizes[i_spline].vert_len,
+              curve_sizes[i_spline].edge_len,
+              profile_sizes[i_profile].vert_len,
+              profile_sizes[i_profile].edge_len,
+              radii->get_internal_span(),
           };
 
           spline_extrude_to_mesh_data(info,
@@ -753,14 +817,20 @@ Mesh *curve_to_mesh_sweep(const CurveEval &curve, const CurveEval &profile, cons
                                       {mesh->mloop, mesh->totloop},
                                       {mesh->mpoly, mesh->totpoly});
 
-          copy_point_domain_attributes_to_mesh(info, attributes);
+          copy_point_domain_attributes_to_mesh(
+              info, spline_point_data, profile_point_data[i_profile], attributes);
+          copy_spline_domain_attributes_to_mesh(offsets,
+                                                i_mesh,
+                                                i_spline,
+                                                i_profile,
+                                                curve_spline_data,
+                                                profile_spline_data,
+                                                attributes);
         }
       });
     }
   });
 
-  copy_spline_domain_attributes_to_mesh(curve, profile, offsets, attributes);
-
   for (OutputAttribute &output_attribute : attributes.attributes) {
     output_attribute.save();
   }
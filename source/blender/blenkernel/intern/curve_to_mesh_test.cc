@@ -0,0 +1,183 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "testing/testing.h"
+
+#include "BLI_math_base.h"
+#include "BLI_timeit.hh"
+
+#include "DNA_mesh_types.h"
+
+#include "BKE_curve_to_mesh.hh"
+#include "BKE_idtype.h"
+#include "BKE_lib_id.h"
+#include "BKE_spline.hh"
+
+namespace blender::bke::tests {
+
+/** A curve with #splines_num straight poly splines with #points_num points each. */
+static std::unique_ptr<CurveEval> create_line_curve(const int splines_num, const int points_num)
+{
+  std::unique_ptr<CurveEval> curve = std::make_unique<CurveEval>();
+  for (const int i_spline : IndexRange(splines_num)) {
+    std::unique_ptr<PolySpline> spline = std::make_unique<PolySpline>();
+    spline->resize(points_num);
+    MutableSpan<float3> positions = spline->positions();
+    for (const int i : IndexRange(points_num)) {
+      positions[i] = float3(float(i_spline), 0.0f, float(i));
+    }
+    spline->radii().fill(1.0f);
+    spline->tilts().fill(0.0f);
+    curve->add_spline(std::move(spline));
+  }
+  curve->attributes.reallocate(curve->splines().size());
+  return curve;
+}
+
+/** A single cyclic poly spline with #resolution points on a circle. */
+static std::unique_ptr<CurveEval> create_circle_profile(const int resolution)
+{
+  std::unique_ptr<CurveEval> curve = std::make_unique<CurveEval>();
+  std::unique_ptr<PolySpline> spline = std::make_unique<PolySpline>();
+  spline->resize(resolution);
+  MutableSpan<float3> positions = spline->positions();
+  for (const int i : IndexRange(resolution)) {
+    const float angle = 2.0f * float(M_PI) * float(i) / float(resolution);
+    positions[i] = float3(std::cos(angle), std::sin(angle), 0.0f);
+  }
+  spline->radii().fill(1.0f);
+  spline->tilts().fill(0.0f);
+  spline->set_cyclic(true);
+  curve->add_spline(std::move(spline));
+  curve->attributes.reallocate(curve->splines().size());
+  return curve;
+}
+
+static void test_curve_to_mesh_sweep(const int splines_num,
+                                     const int points_num,
+                                     const int profile_resolution)
+{
+  BKE_idtype_init();
+  std::unique_ptr<CurveEval> curve = create_line_curve(splines_num, points_num);
+  std::unique_ptr<CurveEval> profile = create_circle_profile(profile_resolution);
+
+  Mesh *mesh;
+  {
+    SCOPED_TIMER(__func__);
+    mesh = curve_to_mesh_sweep(*curve, *profile, true);
+  }
+
+  ASSERT_NE(mesh, nullptr);
+  EXPECT_EQ(mesh->totvert, splines_num * points_num * profile_resolution);
+  EXPECT_EQ(mesh->totpoly, splines_num * ((points_num - 1) * profile_resolution + 2));
+  BKE_id_free(nullptr, mesh);
+}
+
+TEST(curve_to_mesh_performance, splines_10_resolution_8)
+{
+  test_curve_to_mesh_sweep(10, 100, 8);
+}
+TEST(curve_to_mesh_performance, splines_1000_resolution_8)
+{
+  test_curve_to_mesh_sweep(1000, 100, 8);
+}
+TEST(curve_to_mesh_performance, splines_100000_resolution_8)
+{
+  test_curve_to_mesh_sweep(100000, 10, 8);
+}
+TEST(curve_to_mesh_performance, splines_500000_resolution_4)
+{
+  test_curve_to_mesh_sweep(500000, 4, 4);
+}
+TEST(curve_to_mesh_performance, splines_10_resolution_1000)
+{
+  test_curve_to_mesh_sweep(10, 100, 1000);
+}
+TEST(curve_to_mesh_performance, splines_1000_resolution_64)
+{
+  test_curve_to_mesh_sweep(1000, 100, 64);
+}
+
+/** Splines of every type, where the positions of half of them are evaluated before. */
+static std::unique_ptr<CurveEval> create_mixed_curve(const int splines_num)
+{
+  std::unique_ptr<CurveEval> curve = std::make_unique<CurveEval>();
+  for (const int i_spline : IndexRange(splines_num)) {
+    const float x = float(i_spline);
+    switch (i_spline % 3) {
+      case 0: {
+        std::unique_ptr<BezierSpline> spline = std::make_unique<BezierSpline>();
+        spline->set_resolution(4 + i_spline % 5);
+        for (const int i : IndexRange(2 + i_spline % 4)) {
+          const float3 position(x, float(i % 2), float(i));
+          spline->add_point(position,
+                            BezierSpline::HandleType::Auto,
+                            position,
+                            BezierSpline::HandleType::Auto,
+                            position,
+                            1.0f,
+                            0.0f);
+        }
+        spline->set_cyclic(i_spline % 2);
+        curve->add_spline(std::move(spline));
+        break;
+      }
+      case 1: {
+        std::unique_ptr<NURBSpline> spline = std::make_unique<NURBSpline>();
+        spline->set_resolution(6);
+        spline->set_order(3);
+        for (const int i : IndexRange(4 + i_spline % 3)) {
+          spline->add_point(float3(x, float(i * i % 3), float(i)), 1.0f, 0.0f, 1.0f);
+        }
+        curve->add_spline(std::move(spline));
+        break;
+      }
+      case 2: {
+        std::unique_ptr<PolySpline> spline = std::make_unique<PolySpline>();
+        for (const int i : IndexRange(1 + i_spline % 3)) {
+          spline->add_point(float3(x, 0.0f, float(i)), 1.0f, 0.0f);
+        }
+        curve->add_spline(std::move(spline));
+        break;
+      }
+    }
+    if (i_spline % 2) {
+      curve->splines().last()->evaluated_positions();
+    }
+  }
+  curve->attributes.reallocate(curve->splines().size());
+  return curve;
+}
+
+/* Evaluating into one array must give the same positions as the caches of the splines. */
+TEST(curve_eval, EvaluatePositionsContiguous)
+{
+  std::unique_ptr<CurveEval> curve = create_mixed_curve(60);
+  const Array<int> offsets = curve->evaluated_point_offsets();
+  Array<float3> positions(offsets.last());
+  curve->evaluate_positions(offsets, positions);
+
+  const std::unique_ptr<CurveEval> curve_cached = std::make_unique<CurveEval>(*curve);
+  Span<SplinePtr> splines = curve_cached->splines();
+  for (const int i_spline : splines.index_range()) {
+    Span<float3> expected = splines[i_spline]->evaluated_positions();
+    ASSERT_EQ(expected.size(), offsets[i_spline + 1] - offsets[i_spline]);
+    for (const int i : expected.index_range()) {
+      EXPECT_EQ(positions[offsets[i_spline] + i], expected[i]);
+    }
+  }
+}
+
+}  // namespace blender::bke::tests
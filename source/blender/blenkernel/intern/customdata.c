@@ -26,6 +26,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 /* Since we have versioning code here (CustomData_verify_versions()). */
 #define DNA_DEPRECATED_ALLOW
 
@@ -2096,6 +2098,110 @@ static bool customdata_typemap_is_valid(const CustomData *data)
 }
 #endif
 
+/* -------------------------------------------------------------------- */
+/** \name Layer Sharing
+ *
+ * Layers that are shared between several #CustomData point to the same
+ * #CustomDataSharingInfo, which owns the layer data and counts its users.
+ *
+ * Only meshes created by the edit-mode modifier stack share layers for now, see
+ * #BKE_mesh_copy_for_eval_shared. Sharing is only safe where every writer duplicates referenced
+ * layers first, which is not the case for original meshes edited by tools, nor for the
+ * copy-on-write meshes whose normals are recalculated in place. Reference copies of shared
+ * layers, like those made by #BKE_mesh_copy_for_eval, become users of the shared data.
+ * \{ */
+
+typedef struct CustomDataSharingInfo {
+  /** Number of layers using #data, only changed atomically. */
+  int users;
+  /** Number of elements in #data, needed to free it with the last user. */
+  int totelem;
+  void *data;
+} CustomDataSharingInfo;
+
+static void customData_layer_sharing_add_user(CustomDataLayer *layer, CustomDataSharingInfo *info)
+{
+  atomic_add_and_fetch_int32(&info->users, 1);
+  layer->sharing_info = info;
+}
+
+/* Remove the layer as a user of its shared data and free the data if it was the last user. */
+static void customData_layer_sharing_release(CustomDataLayer *layer)
+{
+  CustomDataSharingInfo *info = layer->sharing_info;
+  layer->sharing_info = NULL;
+
+  if (atomic_sub_and_fetch_int32(&info->users, 1) > 0) {
+    return;
+  }
+
+  const LayerTypeInfo *typeInfo = layerType_getInfo(layer->type);
+  if (info->data) {
+    if (typeInfo->free) {
+      typeInfo->free(info->data, info->totelem, typeInfo->size);
+    }
+    MEM_freeN(info->data);
+  }
+  MEM_freeN(info);
+}
+
+/* When the layer is the only user left of its shared data it can take ownership of it
+ * again without a copy. Nobody else can add users since that requires another user. */
+static bool customData_layer_sharing_take_ownership(CustomDataLayer *layer)
+{
+  CustomDataSharingInfo *info = layer->sharing_info;
+  if (layer->data != info->data || atomic_add_and_fetch_int32(&info->users, 0) != 1) {
+    return false;
+  }
+
+  MEM_freeN(info);
+  layer->sharing_info = NULL;
+  layer->flag &= ~CD_FLAG_NOFREE;
+  return true;
+}
+
+void CustomData_share_layers(CustomData *data, CustomDataMask mask, int totelem)
+{
+  for (int i = 0; i < data->totlayer; i++) {
+    CustomDataLayer *layer = &data->layers[i];
+
+    if (!(mask & CD_TYPE_AS_MASK(layer->type))) {
+      continue;
+    }
+    /* Already shared, or referencing data that is owned elsewhere. */
+    if (layer->flag & CD_FLAG_NOFREE) {
+      continue;
+    }
+    if (layer->data == NULL) {
+      continue;
+    }
+
+    CustomDataSharingInfo *info = MEM_callocN(sizeof(*info), __func__);
+    info->users = 1;
+    info->totelem = totelem;
+    info->data = layer->data;
+
+    layer->sharing_info = info;
+    layer->flag |= CD_FLAG_NOFREE;
+  }
+}
+
+static void *customData_duplicate_referenced_layer_index(CustomData *data,
+                                                         const int layer_index,
+                                                         const int totelem);
+
+void CustomData_duplicate_unshared_referenced_layers(CustomData *data, int totelem)
+{
+  for (int i = 0; i < data->totlayer; i++) {
+    const CustomDataLayer *layer = &data->layers[i];
+    if ((layer->flag & CD_FLAG_NOFREE) && layer->sharing_info == NULL) {
+      customData_duplicate_referenced_layer_index(data, i, totelem);
+    }
+  }
+}
+
+/** \} */
+
 bool CustomData_merge(const struct CustomData *source,
                       struct CustomData *dest,
                       CustomDataMask mask,
@@ -2175,6 +2281,20 @@ bool CustomData_merge(const struct CustomData *source,
         BKE_anonymous_attribute_id_increment_weak(layer->anonymous_id);
         newlayer->anonymous_id = layer->anonymous_id;
       }
+
+      /* Referencing shared data adds a user, so the data outlives the source layer. */
+      if (layer->sharing_info != NULL && (newlayer->flag & CD_FLAG_NOFREE) &&
+          newlayer->data == layer->data && newlayer->sharing_info == NULL) {
+        if (alloctype == CD_ASSIGN) {
+          /* The source layer gives up its data, so its user moves to the new layer. Otherwise
+           * the data is never freed, since the source layer is not freed after assigning. */
+          newlayer->sharing_info = layer->sharing_info;
+          layer->sharing_info = NULL;
+        }
+        else {
+          customData_layer_sharing_add_user(newlayer, layer->sharing_info);
+        }
+      }
     }
   }
 
@@ -2219,7 +2339,10 @@ static void customData_free_layer__internal(CustomDataLayer *layer, int totelem)
     BKE_anonymous_attribute_id_decrement_weak(layer->anonymous_id);
     layer->anonymous_id = NULL;
   }
-  if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
+  if (layer->sharing_info != NULL) {
+    customData_layer_sharing_release(layer);
+  }
+  else if (!(layer->flag & CD_FLAG_NOFREE) && layer->data) {
     typeInfo = layerType_getInfo(layer->type);
 
     if (typeInfo->free) {
@@ -2799,6 +2922,10 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
   CustomDataLayer *layer = &data->layers[layer_index];
 
   if (layer->flag & CD_FLAG_NOFREE) {
+    if (layer->sharing_info != NULL && customData_layer_sharing_take_ownership(layer)) {
+      return layer->data;
+    }
+
     /* MEM_dupallocN won't work in case of complex layers, like e.g.
      * CD_MDEFORMVERT, which has pointers to allocated data...
      * So in case a custom copy function is defined, use it!
@@ -2815,6 +2942,9 @@ static void *customData_duplicate_referenced_layer_index(CustomData *data,
       layer->data = MEM_dupallocN(layer->data);
     }
 
+    if (layer->sharing_info != NULL) {
+      customData_layer_sharing_release(layer);
+    }
     layer->flag &= ~CD_FLAG_NOFREE;
   }
 
@@ -5250,6 +5380,7 @@ void CustomData_blend_read(BlendDataReader *reader, CustomData *data, int count)
     }
 
     layer->flag &= ~CD_FLAG_NOFREE;
+    layer->sharing_info = NULL;
 
     if (CustomData_verify_versions(data, i)) {
       BLO_read_data_address(reader, &layer->data);
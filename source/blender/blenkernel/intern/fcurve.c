@@ -1689,6 +1689,22 @@ static int findzero(float x, float q0, float q1, float q2, float q3, float *o)
   return solve_cubic(c0, c1, c2, c3, o);
 }
 
+/**
+ * Find the parameter of a point on a Bezier segment, given the coefficients of the polynomial
+ * `c0 + c1 t + c2 t^2 + c3 t^3` of its X coordinates, with the X value of the point already
+ * subtracted from `c0`. Like keyframe interpolation, this uses the first root that was found.
+ */
+bool BKE_fcurve_bezier_solve_parameter(
+    double c0, double c1, double c2, double c3, float *r_parameter)
+{
+  float opl[3];
+  if (solve_cubic(c0, c1, c2, c3, opl) == 0) {
+    return false;
+  }
+  *r_parameter = opl[0];
+  return true;
+}
+
 static void berekeny(float f1, float f2, float f3, float f4, float *o, int b)
 {
   float t, c0, c1, c2, c3;
@@ -60,6 +60,9 @@ static ThreadMutex python_driver_lock = BLI_MUTEX_INITIALIZER;
 
 static CLG_LogRef LOG = {"bke.fcurve"};
 
+/* Updated atomically, drivers are evaluated from multiple threads. */
+static DriverExpressionStats expression_stats = {0};
+
 /* -------------------------------------------------------------------- */
 /** \name Driver Variables
  * \{ */
@@ -978,6 +981,21 @@ enum {
   VAR_INDEX_CUSTOM
 };
 
+static const char *driver_simple_expr_parse_error_name(eExprPyLike_ParseError error)
+{
+  switch (error) {
+    case EXPR_PYLIKE_PARSE_OK:
+      return "ok";
+    case EXPR_PYLIKE_PARSE_UNKNOWN_NAME:
+      return "unknown name";
+    case EXPR_PYLIKE_PARSE_FUNCTION_ARGS:
+      return "wrong function arguments";
+    case EXPR_PYLIKE_PARSE_SYNTAX:
+      return "unsupported syntax";
+  }
+  return "unknown";
+}
+
 static ExprPyLike_Parsed *driver_compile_simple_expr_impl(ChannelDriver *driver)
 {
   /* Prepare parameter names. */
@@ -991,7 +1009,18 @@ static ExprPyLike_Parsed *driver_compile_simple_expr_impl(ChannelDriver *driver)
     names[i++] = dvar->name;
   }
 
-  return BLI_expr_pylike_parse(driver->expression, names, names_len + VAR_INDEX_CUSTOM);
+  ExprPyLike_Parsed *expr = BLI_expr_pylike_parse(
+      driver->expression, names, names_len + VAR_INDEX_CUSTOM);
+
+  if (!BLI_expr_pylike_is_valid(expr) && driver->expression[0] != '\0') {
+    CLOG_INFO(&LOG,
+              1,
+              "driver expression needs Python (%s): '%s'",
+              driver_simple_expr_parse_error_name(BLI_expr_pylike_parse_error(expr)),
+              driver->expression);
+  }
+
+  return expr;
 }
 
 static bool driver_check_simple_expr_depends_on_time(ExprPyLike_Parsed *expr)
@@ -1068,6 +1097,15 @@ static bool driver_compile_simple_expr(ChannelDriver *driver)
   return true;
 }
 
+/* Count an evaluation in the expression statistics. Counting uses atomics on shared counters,
+ * so it is only done when the statistics are printed. */
+static void driver_expression_stats_count(uint64_t *counter)
+{
+  if (G.debug & G_DEBUG_DEPSGRAPH_TIME) {
+    atomic_add_and_fetch_uint64(counter, 1);
+  }
+}
+
 /* Try using the simple expression evaluator to compute the result of the driver.
  * On success, stores the result and returns true; on failure result is set to 0. */
 static bool driver_try_evaluate_simple_expr(ChannelDriver *driver,
@@ -1077,9 +1115,33 @@ static bool driver_try_evaluate_simple_expr(ChannelDriver *driver,
 {
   *result = 0.0f;
 
-  return driver_compile_simple_expr(driver_orig) &&
-         BLI_expr_pylike_is_valid(driver_orig->expr_simple) &&
-         driver_evaluate_simple_expr(driver, driver_orig->expr_simple, result, time);
+  if (!driver_compile_simple_expr(driver_orig)) {
+    return false;
+  }
+
+  uint64_t *counter;
+  switch (BLI_expr_pylike_parse_error(driver_orig->expr_simple)) {
+    case EXPR_PYLIKE_PARSE_OK:
+      if (driver_evaluate_simple_expr(driver, driver_orig->expr_simple, result, time)) {
+        driver_expression_stats_count(&expression_stats.simple);
+        return true;
+      }
+      counter = &expression_stats.python_eval_error;
+      break;
+    case EXPR_PYLIKE_PARSE_UNKNOWN_NAME:
+      counter = &expression_stats.python_unknown_name;
+      break;
+    case EXPR_PYLIKE_PARSE_FUNCTION_ARGS:
+      counter = &expression_stats.python_function_args;
+      break;
+    default:
+      counter = &expression_stats.python_syntax;
+      break;
+  }
+
+  driver_expression_stats_count(counter);
+  driver_expression_stats_count(&expression_stats.python);
+  return false;
 }
 
 /* Check if the expression in the driver conforms to the simple subset. */
@@ -1088,6 +1150,17 @@ bool BKE_driver_has_simple_expression(ChannelDriver *driver)
   return driver_compile_simple_expr(driver) && BLI_expr_pylike_is_valid(driver->expr_simple);
 }
 
+void BKE_driver_expression_stats_get(DriverExpressionStats *r_stats)
+{
+  *r_stats = expression_stats;
+}
+
+void BKE_driver_expression_stats_reset(void)
+{
+  const DriverExpressionStats empty_stats = {0};
+  expression_stats = empty_stats;
+}
+
 /* TODO(sergey): This is somewhat weak, but we don't want neither false-positive
  * time dependencies nor special exceptions in the depsgraph evaluation. */
 static bool python_driver_exression_depends_on_time(const char *expression)
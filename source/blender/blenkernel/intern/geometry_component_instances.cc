@@ -18,6 +18,8 @@
 
 #include "BLI_float4x4.hh"
 #include "BLI_map.hh"
+#include "BLI_math_matrix.h"
+#include "BLI_math_rotation.h"
 #include "BLI_rand.hh"
 #include "BLI_set.hh"
 #include "BLI_span.hh"
@@ -31,7 +33,10 @@
 
 #include "attribute_access_intern.hh"
 
+using blender::float3;
+using blender::float4;
 using blender::float4x4;
+using blender::IndexRange;
 using blender::Map;
 using blender::MutableSpan;
 using blender::Set;
@@ -51,6 +56,10 @@ GeometryComponent *InstancesComponent::copy() const
   InstancesComponent *new_component = new InstancesComponent();
   new_component->instance_reference_handles_ = instance_reference_handles_;
   new_component->instance_transforms_ = instance_transforms_;
+  new_component->use_compact_transforms_ = use_compact_transforms_;
+  new_component->instance_positions_ = instance_positions_;
+  new_component->instance_rotations_ = instance_rotations_;
+  new_component->instance_scales_ = instance_scales_;
   new_component->instance_ids_ = instance_ids_;
   new_component->references_ = references_;
   return new_component;
@@ -59,7 +68,14 @@ GeometryComponent *InstancesComponent::copy() const
 void InstancesComponent::reserve(int min_capacity)
 {
   instance_reference_handles_.reserve(min_capacity);
-  instance_transforms_.reserve(min_capacity);
+  if (use_compact_transforms_) {
+    instance_positions_.reserve(min_capacity);
+    instance_rotations_.reserve(min_capacity);
+    instance_scales_.reserve(min_capacity);
+  }
+  else {
+    instance_transforms_.reserve(min_capacity);
+  }
   if (!instance_ids_.is_empty()) {
     this->instance_ids_ensure();
   }
@@ -74,7 +90,15 @@ void InstancesComponent::reserve(int min_capacity)
 void InstancesComponent::resize(int capacity)
 {
   instance_reference_handles_.resize(capacity);
-  instance_transforms_.resize(capacity);
+  if (use_compact_transforms_) {
+    instance_positions_.resize(capacity);
+    instance_rotations_.resize(capacity);
+    instance_scales_.resize(capacity);
+    transforms_cache_dirty_ = true;
+  }
+  else {
+    instance_transforms_.resize(capacity);
+  }
   if (!instance_ids_.is_empty()) {
     this->instance_ids_ensure();
   }
@@ -84,6 +108,12 @@ void InstancesComponent::clear()
 {
   instance_reference_handles_.clear();
   instance_transforms_.clear();
+  use_compact_transforms_ = false;
+  instance_positions_.clear();
+  instance_rotations_.clear();
+  instance_scales_.clear();
+  transforms_cache_.reinitialize(0);
+  transforms_cache_dirty_ = true;
   instance_ids_.clear();
 
   references_.clear();
@@ -93,6 +123,8 @@ void InstancesComponent::add_instance(const int instance_handle, const float4x4
 {
   BLI_assert(instance_handle >= 0);
   BLI_assert(instance_handle < references_.size());
+  /* A matrix can't always be represented in the compact form. */
+  this->ensure_matrix_transforms();
   instance_reference_handles_.append(instance_handle);
   instance_transforms_.append(transform);
   if (!instance_ids_.is_empty()) {
@@ -100,6 +132,33 @@ void InstancesComponent::add_instance(const int instance_handle, const float4x4
   }
 }
 
+/**
+ * \param rotation: A quaternion, see #use_compact_transforms_.
+ */
+void InstancesComponent::add_instance(const int instance_handle,
+                                      const float3 &position,
+                                      const float4 &rotation,
+                                      const float3 &scale)
+{
+  BLI_assert(instance_handle >= 0);
+  BLI_assert(instance_handle < references_.size());
+  instance_reference_handles_.append(instance_handle);
+  if (use_compact_transforms_) {
+    instance_positions_.append(position);
+    instance_rotations_.append(rotation);
+    instance_scales_.append(scale);
+    transforms_cache_dirty_ = true;
+  }
+  else {
+    float4x4 transform;
+    loc_quat_size_to_mat4(transform.values, position, rotation, scale);
+    instance_transforms_.append(transform);
+  }
+  if (!instance_ids_.is_empty()) {
+    this->instance_ids_ensure();
+  }
+}
+
 blender::Span<int> InstancesComponent::instance_reference_handles() const
 {
   return instance_reference_handles_;
@@ -110,13 +169,149 @@ blender::MutableSpan<int> InstancesComponent::instance_reference_handles()
   return instance_reference_handles_;
 }
 
+/**
+ * Write access to the transforms as matrices. This switches the component to matrix storage
+ * when it uses compact transforms, so code that can work on the compact transforms directly
+ * should check #has_compact_transforms first.
+ */
 blender::MutableSpan<blender::float4x4> InstancesComponent::instance_transforms()
 {
+  this->ensure_matrix_transforms();
   return instance_transforms_;
 }
+
+/**
+ * When the component uses compact transforms, the matrices are built on the first access and
+ * cached until the transforms are changed. Use #instance_transform to avoid allocating the
+ * matrices for all instances at once.
+ */
 blender::Span<blender::float4x4> InstancesComponent::instance_transforms() const
 {
-  return instance_transforms_;
+  if (!use_compact_transforms_) {
+    return instance_transforms_;
+  }
+  std::lock_guard lock{transforms_cache_mutex_};
+  if (transforms_cache_dirty_) {
+    transforms_cache_.reinitialize(instance_positions_.size());
+    blender::threading::parallel_for(
+        transforms_cache_.index_range(), 2048, [&](const IndexRange range) {
+          for (const int i : range) {
+            loc_quat_size_to_mat4(transforms_cache_[i].values,
+                                  instance_positions_[i],
+                                  instance_rotations_[i],
+                                  instance_scales_[i]);
+          }
+        });
+    transforms_cache_dirty_ = false;
+  }
+  return transforms_cache_;
+}
+
+float4x4 InstancesComponent::instance_transform(const int index) const
+{
+  if (!use_compact_transforms_) {
+    return instance_transforms_[index];
+  }
+  float4x4 transform;
+  loc_quat_size_to_mat4(transform.values,
+                        instance_positions_[index],
+                        instance_rotations_[index],
+                        instance_scales_[index]);
+  return transform;
+}
+
+bool InstancesComponent::has_compact_transforms() const
+{
+  return use_compact_transforms_;
+}
+
+/**
+ * Switch to storing the transforms as positions, rotations and scales. Existing transforms are
+ * decomposed, which loses shear, so this should generally be called before instances are added.
+ */
+void InstancesComponent::use_compact_transforms()
+{
+  if (use_compact_transforms_) {
+    return;
+  }
+  const int size = instance_transforms_.size();
+  instance_positions_.resize(size);
+  instance_rotations_.resize(size);
+  instance_scales_.resize(size);
+  blender::threading::parallel_for(IndexRange(size), 2048, [&](const IndexRange range) {
+    for (const int i : range) {
+      mat4_decompose(instance_positions_[i],
+                     instance_rotations_[i],
+                     instance_scales_[i],
+                     instance_transforms_[i].values);
+    }
+  });
+  instance_transforms_.clear_and_make_inline();
+  use_compact_transforms_ = true;
+  transforms_cache_dirty_ = true;
+}
+
+/**
+ * Switch to storing the transforms as matrices, so that arbitrary transforms can be applied.
+ */
+void InstancesComponent::ensure_matrix_transforms()
+{
+  if (!use_compact_transforms_) {
+    return;
+  }
+  const int size = instance_positions_.size();
+  instance_transforms_.resize(size);
+  blender::threading::parallel_for(IndexRange(size), 2048, [&](const IndexRange range) {
+    for (const int i : range) {
+      loc_quat_size_to_mat4(instance_transforms_[i].values,
+                            instance_positions_[i],
+                            instance_rotations_[i],
+                            instance_scales_[i]);
+    }
+  });
+  instance_positions_.clear_and_make_inline();
+  instance_rotations_.clear_and_make_inline();
+  instance_scales_.clear_and_make_inline();
+  transforms_cache_.reinitialize(0);
+  use_compact_transforms_ = false;
+}
+
+/* The compact transform arrays are only valid when #has_compact_transforms is true. */
+
+blender::MutableSpan<float3> InstancesComponent::instance_positions()
+{
+  BLI_assert(use_compact_transforms_);
+  transforms_cache_dirty_ = true;
+  return instance_positions_;
+}
+blender::Span<float3> InstancesComponent::instance_positions() const
+{
+  BLI_assert(use_compact_transforms_);
+  return instance_positions_;
+}
+
+blender::MutableSpan<float4> InstancesComponent::instance_rotations()
+{
+  BLI_assert(use_compact_transforms_);
+  transforms_cache_dirty_ = true;
+  return instance_rotations_;
+}
+blender::Span<float4> InstancesComponent::instance_rotations() const
+{
+  BLI_assert(use_compact_transforms_);
+  return instance_rotations_;
+}
+
+blender::MutableSpan<float3> InstancesComponent::instance_scales()
+{
+  BLI_assert(use_compact_transforms_);
+  transforms_cache_dirty_ = true;
+  return instance_scales_;
+}
+blender::Span<float3> InstancesComponent::instance_scales() const
+{
+  BLI_assert(use_compact_transforms_);
+  return instance_scales_;
 }
 
 blender::MutableSpan<int> InstancesComponent::instance_ids()
@@ -257,7 +452,7 @@ void InstancesComponent::remove_unused_references()
 
 int InstancesComponent::instances_amount() const
 {
-  return instance_transforms_.size();
+  return instance_reference_handles_.size();
 }
 
 int InstancesComponent::references_amount() const
@@ -393,6 +588,10 @@ class InstancePositionAttributeProvider final : public BuiltinAttributeProvider
   {
     const InstancesComponent &instances_component = static_cast<const InstancesComponent &>(
         component);
+    if (instances_component.has_compact_transforms()) {
+      return std::make_unique<fn::GVArray_For_Span<float3>>(
+          instances_component.instance_positions());
+    }
     Span<float4x4> transforms = instances_component.instance_transforms();
     return std::make_unique<fn::GVArray_For_DerivedSpan<float4x4, float3, get_transform_position>>(
         transforms);
@@ -401,6 +600,11 @@ class InstancePositionAttributeProvider final : public BuiltinAttributeProvider
   WriteAttributeLookup try_get_for_write(GeometryComponent &component) const final
   {
     InstancesComponent &instances_component = static_cast<InstancesComponent &>(component);
+    if (instances_component.has_compact_transforms()) {
+      return {std::make_unique<fn::GVMutableArray_For_MutableSpan<float3>>(
+                  instances_component.instance_positions()),
+              domain_};
+    }
     MutableSpan<float4x4> transforms = instances_component.instance_transforms();
     return {
         std::make_unique<fn::GVMutableArray_For_DerivedSpan<float4x4,
@@ -31,6 +31,8 @@
 #include "DNA_collection_types.h"
 #include "DNA_object_types.h"
 
+#include "FN_field_cache.hh"
+
 #include "BLI_rand.hh"
 
 #include "MEM_guardedalloc.h"
@@ -51,6 +53,11 @@ GeometryComponent::GeometryComponent(GeometryComponentType type) : type_(type)
 {
 }
 
+GeometryComponent::~GeometryComponent()
+{
+  delete field_cache_.load();
+}
+
 GeometryComponent *GeometryComponent::create(GeometryComponentType component_type)
 {
   switch (component_type) {
@@ -71,7 +78,11 @@ GeometryComponent *GeometryComponent::create(GeometryComponentType component_typ
 
 void GeometryComponent::user_add() const
 {
-  users_.fetch_add(1);
+  const int old_users = users_.fetch_add(1);
+  if (old_users == 1) {
+    /* Results that have been cached while the component was mutable may be outdated. */
+    version_.fetch_add(1);
+  }
 }
 
 void GeometryComponent::user_remove() const
@@ -80,6 +91,13 @@ void GeometryComponent::user_remove() const
   if (new_users == 0) {
     delete this;
   }
+  else if (new_users == 1) {
+    /* The remaining user may modify the component now, so cached results become invalid. */
+    version_.fetch_add(1);
+    if (blender::fn::FieldCache *field_cache = field_cache_.load()) {
+      field_cache->clear();
+    }
+  }
 }
 
 bool GeometryComponent::is_mutable() const
@@ -89,6 +107,26 @@ bool GeometryComponent::is_mutable() const
   return users_ <= 1;
 }
 
+uint64_t GeometryComponent::version() const
+{
+  return version_;
+}
+
+blender::fn::FieldCache &GeometryComponent::field_cache() const
+{
+  blender::fn::FieldCache *field_cache = field_cache_.load();
+  if (field_cache != nullptr) {
+    return *field_cache;
+  }
+  /* Another thread may create the cache at the same time, only one of them is kept. */
+  blender::fn::FieldCache *new_field_cache = new blender::fn::FieldCache();
+  if (field_cache_.compare_exchange_strong(field_cache, new_field_cache)) {
+    return *new_field_cache;
+  }
+  delete new_field_cache;
+  return *field_cache;
+}
+
 GeometryComponentType GeometryComponent::type() const
 {
   return type_;
@@ -23,6 +23,8 @@
 #include "BKE_pointcloud.h"
 #include "BKE_spline.hh"
 
+#include "BLI_task.hh"
+
 #include "DNA_collection_types.h"
 #include "DNA_layer_types.h"
 #include "DNA_mesh_types.h"
@@ -138,12 +140,11 @@ static void geometry_set_collect_recursive(const GeometrySet &geometry_set,
     const InstancesComponent &instances_component =
         *geometry_set.get_component_for_read<InstancesComponent>();
 
-    Span<float4x4> transforms = instances_component.instance_transforms();
     Span<int> handles = instances_component.instance_reference_handles();
     Span<InstanceReference> references = instances_component.references();
-    for (const int i : transforms.index_range()) {
+    for (const int i : handles.index_range()) {
       const InstanceReference &reference = references[handles[i]];
-      const float4x4 instance_transform = transform * transforms[i];
+      const float4x4 instance_transform = transform * instances_component.instance_transform(i);
 
       switch (reference.type()) {
         case InstanceReference::Type::Object: {
@@ -224,6 +225,61 @@ void geometry_set_gather_instances_attribute_info(Span<GeometryInstanceGroup> se
   }
 }
 
+static void copy_mesh_instance(const Mesh &mesh,
+                               const float4x4 &transform,
+                               Span<int> material_index_map,
+                               const int vert_offset,
+                               const int edge_offset,
+                               const int loop_offset,
+                               const int poly_offset,
+                               Mesh &new_mesh)
+{
+  threading::parallel_for(IndexRange(mesh.totvert), 2048, [&](IndexRange range) {
+    for (const int i : range) {
+      const MVert &old_vert = mesh.mvert[i];
+      MVert &new_vert = new_mesh.mvert[vert_offset + i];
+
+      new_vert = old_vert;
+
+      const float3 new_position = transform * float3(old_vert.co);
+      copy_v3_v3(new_vert.co, new_position);
+    }
+  });
+  threading::parallel_for(IndexRange(mesh.totedge), 4096, [&](IndexRange range) {
+    for (const int i : range) {
+      const MEdge &old_edge = mesh.medge[i];
+      MEdge &new_edge = new_mesh.medge[edge_offset + i];
+      new_edge = old_edge;
+      new_edge.v1 += vert_offset;
+      new_edge.v2 += vert_offset;
+    }
+  });
+  threading::parallel_for(IndexRange(mesh.totloop), 4096, [&](IndexRange range) {
+    for (const int i : range) {
+      const MLoop &old_loop = mesh.mloop[i];
+      MLoop &new_loop = new_mesh.mloop[loop_offset + i];
+      new_loop = old_loop;
+      new_loop.v += vert_offset;
+      new_loop.e += edge_offset;
+    }
+  });
+  threading::parallel_for(IndexRange(mesh.totpoly), 4096, [&](IndexRange range) {
+    for (const int i : range) {
+      const MPoly &old_poly = mesh.mpoly[i];
+      MPoly &new_poly = new_mesh.mpoly[poly_offset + i];
+      new_poly = old_poly;
+      new_poly.loopstart += loop_offset;
+      if (old_poly.mat_nr >= 0 && old_poly.mat_nr < mesh.totcol) {
+        new_poly.mat_nr = material_index_map[new_poly.mat_nr];
+      }
+      else {
+        /* The material index was invalid before. */
+        new_poly.mat_nr = 0;
+      }
+    }
+  });
+}
+
 static Mesh *join_mesh_topology_and_builtin_attributes(Span<GeometryInstanceGroup> set_groups)
 {
   int totverts = 0;
@@ -236,8 +292,19 @@ static Mesh *join_mesh_topology_and_builtin_attributes(Span<GeometryInstanceGrou
   int64_t cd_dirty_loop = 0;
   VectorSet<Material *> materials;
 
-  for (const GeometryInstanceGroup &set_group : set_groups) {
+  /* Where the elements of every group start in the new mesh. */
+  Array<int> vert_offsets(set_groups.size());
+  Array<int> edge_offsets(set_groups.size());
+  Array<int> loop_offsets(set_groups.size());
+  Array<int> poly_offsets(set_groups.size());
+
+  for (const int group_index : set_groups.index_range()) {
+    const GeometryInstanceGroup &set_group = set_groups[group_index];
     const GeometrySet &set = set_group.geometry_set;
+    vert_offsets[group_index] = totverts;
+    edge_offsets[group_index] = totedges;
+    loop_offsets[group_index] = totloops;
+    poly_offsets[group_index] = totpolys;
     const int tot_transforms = set_group.transforms.size();
     if (set.has_mesh()) {
       const Mesh &mesh = *set.get_mesh_for_read();
@@ -280,67 +347,43 @@ static Mesh *join_mesh_topology_and_builtin_attributes(Span<GeometryInstanceGrou
   new_mesh->runtime.cd_dirty_edge = cd_dirty_edge;
   new_mesh->runtime.cd_dirty_loop = cd_dirty_loop;
 
-  int vert_offset = 0;
-  int loop_offset = 0;
-  int edge_offset = 0;
-  int poly_offset = 0;
-  for (const GeometryInstanceGroup &set_group : set_groups) {
-    const GeometrySet &set = set_group.geometry_set;
-    if (set.has_mesh()) {
+  /* All offsets are known, so the instances can be copied into the new mesh independently. */
+  threading::parallel_for(set_groups.index_range(), 32, [&](IndexRange range) {
+    for (const int group_index : range) {
+      const GeometryInstanceGroup &set_group = set_groups[group_index];
+      const GeometrySet &set = set_group.geometry_set;
+      if (!set.has_mesh()) {
+        continue;
+      }
       const Mesh &mesh = *set.get_mesh_for_read();
 
-      Array<int> material_index_map(mesh.totcol);
+      Array<int, 16> material_index_map(mesh.totcol);
       for (const int i : IndexRange(mesh.totcol)) {
         Material *material = mesh.mat[i];
         const int new_material_index = materials.index_of(material);
         material_index_map[i] = new_material_index;
       }
 
+      int vert_offset = vert_offsets[group_index];
+      int edge_offset = edge_offsets[group_index];
+      int loop_offset = loop_offsets[group_index];
+      int poly_offset = poly_offsets[group_index];
       for (const float4x4 &transform : set_group.transforms) {
-        for (const int i : IndexRange(mesh.totvert)) {
-          const MVert &old_vert = mesh.mvert[i];
-          MVert &new_vert = new_mesh->mvert[vert_offset + i];
-
-          new_vert = old_vert;
-
-          const float3 new_position = transform * float3(old_vert.co);
-          copy_v3_v3(new_vert.co, new_position);
-        }
-        for (const int i : IndexRange(mesh.totedge)) {
-          const MEdge &old_edge = mesh.medge[i];
-          MEdge &new_edge = new_mesh->medge[edge_offset + i];
-          new_edge = old_edge;
-          new_edge.v1 += vert_offset;
-          new_edge.v2 += vert_offset;
-        }
-        for (const int i : IndexRange(mesh.totloop)) {
-          const MLoop &old_loop = mesh.mloop[i];
-          MLoop &new_loop = new_mesh->mloop[loop_offset + i];
-          new_loop = old_loop;
-          new_loop.v += vert_offset;
-          new_loop.e += edge_offset;
-        }
-        for (const int i : IndexRange(mesh.totpoly)) {
-          const MPoly &old_poly = mesh.mpoly[i];
-          MPoly &new_poly = new_mesh->mpoly[poly_offset + i];
-          new_poly = old_poly;
-          new_poly.loopstart += loop_offset;
-          if (old_poly.mat_nr >= 0 && old_poly.mat_nr < mesh.totcol) {
-            new_poly.mat_nr = material_index_map[new_poly.mat_nr];
-          }
-          else {
-            /* The material index was invalid before. */
-            new_poly.mat_nr = 0;
-          }
-        }
-
+        copy_mesh_instance(mesh,
+                           transform,
+                           material_index_map,
+                           vert_offset,
+                           edge_offset,
+                           loop_offset,
+                           poly_offset,
+                           *new_mesh);
         vert_offset += mesh.totvert;
         loop_offset += mesh.totloop;
         edge_offset += mesh.totedge;
         poly_offset += mesh.totpoly;
       }
     }
-  }
+  });
 
   /* A possible optimization is to only tag the normals dirty when there are transforms that change
    * normals. */
@@ -349,6 +392,16 @@ static Mesh *join_mesh_topology_and_builtin_attributes(Span<GeometryInstanceGrou
   return new_mesh;
 }
 
+/** A component in one of the instance groups and where its attribute values are copied to. */
+struct ComponentToJoin {
+  const GeometryComponent *component;
+  /** Index in the deduplicated components, which are often shared by many instances. */
+  int source_index;
+  int offset;
+  int domain_size;
+  int tot_transforms;
+};
+
 static void join_attributes(Span<GeometryInstanceGroup> set_groups,
                             Span<GeometryComponentType> component_types,
                             const Map<AttributeIDRef, AttributeKind> &attribute_info,
@@ -369,8 +422,9 @@ static void join_attributes(Span<GeometryInstanceGroup> set_groups,
       continue;
     }
 
-    fn::GVMutableArray_GSpan dst_span{*write_attribute.varray};
-
+    /* Find where the values of every component go. */
+    Vector<ComponentToJoin> components_to_join;
+    VectorSet<const GeometryComponent *> source_components;
     int offset = 0;
     for (const GeometryInstanceGroup &set_group : set_groups) {
       const GeometrySet &set = set_group.geometry_set;
@@ -381,25 +435,47 @@ static void join_attributes(Span<GeometryInstanceGroup> set_groups,
           if (domain_size == 0) {
             continue; /* Domain size is 0, so no need to increment the offset. */
           }
-          GVArrayPtr source_attribute = component.attribute_try_get_for_read(
-              attribute_id, domain_output, data_type_output);
-
-          if (source_attribute) {
-            fn::GVArray_GSpan src_span{*source_attribute};
-            const void *src_buffer = src_span.data();
-            for (const int UNUSED(i) : set_group.transforms.index_range()) {
-              void *dst_buffer = dst_span[offset];
-              cpp_type->copy_assign_n(src_buffer, dst_buffer, domain_size);
-              offset += domain_size;
-            }
-          }
-          else {
-            offset += domain_size * set_group.transforms.size();
-          }
+          const int tot_transforms = set_group.transforms.size();
+          const int source_index = source_components.index_of_or_add(&component);
+          components_to_join.append(
+              {&component, source_index, offset, domain_size, tot_transforms});
+          offset += domain_size * tot_transforms;
         }
       }
     }
 
+    /* Read the attribute from every component only once. */
+    Array<GVArrayPtr> source_attributes(source_components.size());
+    Array<std::unique_ptr<fn::GVArray_GSpan>> source_spans(source_components.size());
+    threading::parallel_for(IndexRange(source_components.size()), 64, [&](IndexRange range) {
+      for (const int i : range) {
+        source_attributes[i] = source_components[i]->attribute_try_get_for_read(
+            attribute_id, domain_output, data_type_output);
+        if (source_attributes[i]) {
+          source_spans[i] = std::make_unique<fn::GVArray_GSpan>(*source_attributes[i]);
+        }
+      }
+    });
+
+    fn::GVMutableArray_GSpan dst_span{*write_attribute.varray};
+
+    threading::parallel_for(components_to_join.index_range(), 256, [&](IndexRange range) {
+      for (const ComponentToJoin &component_to_join : components_to_join.as_span().slice(range)) {
+        const fn::GVArray_GSpan *src_span = source_spans[component_to_join.source_index].get();
+        if (src_span == nullptr) {
+          /* The values stay default initialized. */
+          continue;
+        }
+        const void *src_buffer = src_span->data();
+        int dst_offset = component_to_join.offset;
+        for (const int UNUSED(i) : IndexRange(component_to_join.tot_transforms)) {
+          void *dst_buffer = dst_span[dst_offset];
+          cpp_type->copy_assign_n(src_buffer, dst_buffer, component_to_join.domain_size);
+          dst_offset += component_to_join.domain_size;
+        }
+      }
+    });
+
     dst_span.save();
   }
 }
@@ -422,47 +498,79 @@ static PointCloud *join_pointcloud_position_attribute(Span<GeometryInstanceGroup
   PointCloud *new_pointcloud = BKE_pointcloud_new_nomain(totpoint);
   MutableSpan new_positions{(float3 *)new_pointcloud->co, new_pointcloud->totpoint};
 
-  /* Transform each instance's point locations into the new point cloud. */
+  Array<int> offsets(set_groups.size());
   int offset = 0;
-  for (const GeometryInstanceGroup &set_group : set_groups) {
-    const GeometrySet &set = set_group.geometry_set;
-    const PointCloud *pointcloud = set.get_pointcloud_for_read();
-    if (pointcloud == nullptr) {
-      continue;
+  for (const int group_index : set_groups.index_range()) {
+    const GeometryInstanceGroup &set_group = set_groups[group_index];
+    offsets[group_index] = offset;
+    const PointCloud *pointcloud = set_group.geometry_set.get_pointcloud_for_read();
+    if (pointcloud != nullptr) {
+      offset += pointcloud->totpoint * set_group.transforms.size();
     }
-    for (const float4x4 &transform : set_group.transforms) {
-      for (const int i : IndexRange(pointcloud->totpoint)) {
-        new_positions[offset + i] = transform * float3(pointcloud->co[i]);
+  }
+
+  /* Transform each instance's point locations into the new point cloud. */
+  threading::parallel_for(set_groups.index_range(), 32, [&](IndexRange range) {
+    for (const int group_index : range) {
+      const GeometryInstanceGroup &set_group = set_groups[group_index];
+      const PointCloud *pointcloud = set_group.geometry_set.get_pointcloud_for_read();
+      if (pointcloud == nullptr) {
+        continue;
+      }
+      int point_offset = offsets[group_index];
+      for (const float4x4 &transform : set_group.transforms) {
+        threading::parallel_for(
+            IndexRange(pointcloud->totpoint), 4096, [&](IndexRange point_range) {
+              for (const int i : point_range) {
+                new_positions[point_offset + i] = transform * float3(pointcloud->co[i]);
+              }
+            });
+        point_offset += pointcloud->totpoint;
       }
-      offset += pointcloud->totpoint;
     }
-  }
+  });
 
   return new_pointcloud;
 }
 
 static CurveEval *join_curve_splines_and_builtin_attributes(Span<GeometryInstanceGroup> set_groups)
 {
-  Vector<SplinePtr> new_splines;
-  for (const GeometryInstanceGroup &set_group : set_groups) {
+  Array<int> offsets(set_groups.size());
+  int tot_splines = 0;
+  for (const int group_index : set_groups.index_range()) {
+    const GeometryInstanceGroup &set_group = set_groups[group_index];
+    offsets[group_index] = tot_splines;
     const GeometrySet &set = set_group.geometry_set;
-    if (!set.has_curve()) {
-      continue;
-    }
-
-    const CurveEval &source_curve = *set.get_curve_for_read();
-    for (const SplinePtr &source_spline : source_curve.splines()) {
-      for (const float4x4 &transform : set_group.transforms) {
-        SplinePtr new_spline = source_spline->copy_without_attributes();
-        new_spline->transform(transform);
-        new_splines.append(std::move(new_spline));
-      }
+    if (set.has_curve()) {
+      tot_splines += set.get_curve_for_read()->splines().size() * set_group.transforms.size();
     }
   }
-  if (new_splines.is_empty()) {
+  if (tot_splines == 0) {
     return nullptr;
   }
 
+  Array<SplinePtr> new_splines(tot_splines);
+  threading::parallel_for(set_groups.index_range(), 32, [&](IndexRange range) {
+    for (const int group_index : range) {
+      const GeometryInstanceGroup &set_group = set_groups[group_index];
+      const GeometrySet &set = set_group.geometry_set;
+      if (!set.has_curve()) {
+        continue;
+      }
+
+      const CurveEval &source_curve = *set.get_curve_for_read();
+      int offset = offsets[group_index];
+      for (const SplinePtr &source_spline : source_curve.splines()) {
+        for (const float4x4 &transform : set_group.transforms) {
+          SplinePtr new_spline = source_spline->copy_without_attributes();
+          new_spline->transform(transform);
+          new_splines[offset] = std::move(new_spline);
+          offset++;
+        }
+      }
+    }
+  });
+
   CurveEval *new_curve = new CurveEval();
   for (SplinePtr &new_spline : new_splines) {
     new_curve->add_spline(std::move(new_spline));
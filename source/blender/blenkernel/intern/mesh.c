@@ -1125,6 +1125,28 @@ Mesh *BKE_mesh_copy_for_eval(const Mesh *source, bool reference)
   return result;
 }
 
+Mesh *BKE_mesh_copy_for_eval_shared(Mesh *source)
+{
+  CustomData_share_layers(&source->vdata, CD_MASK_ALL, source->totvert);
+  CustomData_share_layers(&source->edata, CD_MASK_ALL, source->totedge);
+  CustomData_share_layers(&source->fdata, CD_MASK_ALL, source->totface);
+  CustomData_share_layers(&source->ldata, CD_MASK_ALL, source->totloop);
+  CustomData_share_layers(&source->pdata, CD_MASK_ALL, source->totpoly);
+
+  Mesh *result = BKE_mesh_copy_for_eval(source, true);
+
+  /* Layers the source only references may be owned by a mesh that is kept, don't let writes to
+   * the copy change them. */
+  CustomData_duplicate_unshared_referenced_layers(&result->vdata, result->totvert);
+  CustomData_duplicate_unshared_referenced_layers(&result->edata, result->totedge);
+  CustomData_duplicate_unshared_referenced_layers(&result->fdata, result->totface);
+  CustomData_duplicate_unshared_referenced_layers(&result->ldata, result->totloop);
+  CustomData_duplicate_unshared_referenced_layers(&result->pdata, result->totpoly);
+  BKE_mesh_update_customdata_pointers(result, false);
+
+  return result;
+}
+
 BMesh *BKE_mesh_to_bmesh_ex(const Mesh *me,
                             const struct BMeshCreateParams *create_params,
                             const struct BMeshFromMeshParams *convert_params)
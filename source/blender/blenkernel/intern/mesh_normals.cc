@@ -347,6 +347,11 @@ void BKE_mesh_ensure_normals_for_display(Mesh *mesh)
       poly_nors = (float(*)[3])MEM_malloc_arrayN(
           (size_t)mesh->totpoly, sizeof(*poly_nors), __func__);
     }
+    else {
+      /* The layer may be shared with other evaluated meshes. */
+      poly_nors = (float(*)[3])CustomData_duplicate_referenced_layer(
+          &mesh->pdata, CD_NORMAL, mesh->totpoly);
+    }
 
     /* Calculate poly/vert normals. */
     if (do_vert_normals) {
@@ -897,24 +897,26 @@ static void make_duplis_geometry_set_impl(const DupliContext *ctx,
     instances_ctx = &new_instances_ctx;
   }
 
-  Span<float4x4> instance_offset_matrices = component->instance_transforms();
   Span<int> instance_reference_handles = component->instance_reference_handles();
   Span<int> almost_unique_ids = component->almost_unique_ids();
   Span<InstanceReference> references = component->references();
 
-  for (int64_t i : instance_offset_matrices.index_range()) {
+  for (int64_t i : instance_reference_handles.index_range()) {
     const InstanceReference &reference = references[instance_reference_handles[i]];
     const int id = almost_unique_ids[i];
+    /* Built for every instance separately, to avoid creating all matrices at once for instances
+     * with compact transforms. */
+    const float4x4 instance_offset_matrix = component->instance_transform(int(i));
 
     switch (reference.type()) {
       case InstanceReference::Type::Object: {
         Object &object = reference.object();
         float matrix[4][4];
-        mul_m4_m4m4(matrix, parent_transform, instance_offset_matrices[i].values);
+        mul_m4_m4m4(matrix, parent_transform, instance_offset_matrix.values);
         make_dupli(instances_ctx, &object, matrix, id);
 
         float space_matrix[4][4];
-        mul_m4_m4m4(space_matrix, instance_offset_matrices[i].values, object.imat);
+        mul_m4_m4m4(space_matrix, instance_offset_matrix.values, object.imat);
         mul_m4_m4_pre(space_matrix, parent_transform);
         make_recursive_duplis(instances_ctx, &object, space_matrix, id);
         break;
@@ -924,7 +926,7 @@ static void make_duplis_geometry_set_impl(const DupliContext *ctx,
         float collection_matrix[4][4];
         unit_m4(collection_matrix);
         sub_v3_v3(collection_matrix[3], collection.instance_offset);
-        mul_m4_m4_pre(collection_matrix, instance_offset_matrices[i].values);
+        mul_m4_m4_pre(collection_matrix, instance_offset_matrix.values);
         mul_m4_m4_pre(collection_matrix, parent_transform);
 
         DupliContext sub_ctx;
@@ -948,7 +950,7 @@ static void make_duplis_geometry_set_impl(const DupliContext *ctx,
       }
       case InstanceReference::Type::GeometrySet: {
         float new_transform[4][4];
-        mul_m4_m4m4(new_transform, parent_transform, instance_offset_matrices[i].values);
+        mul_m4_m4m4(new_transform, parent_transform, instance_offset_matrix.values);
 
         DupliContext sub_ctx;
         copy_dupli_context(&sub_ctx, instances_ctx, instances_ctx->object, nullptr, id);
@@ -51,8 +51,17 @@
 
 #define LEAF_LIMIT 10000
 
+/* Number of bins used to evaluate split candidates when building the tree. */
+#define PBVH_BUILD_SPLIT_BINS 16
+
+/* Depth from which subtrees are built in parallel. */
+#define PBVH_BUILD_TASK_DEPTH 6
+
 //#define PERFCNTRS
 
+/* Print time spent in each stage of the tree build. */
+//#define DEBUG_BUILD_TIME
+
 #define STACK_FIXED_DEPTH 100
 
 typedef struct PBVHStack {
@@ -249,43 +258,57 @@ void pbvh_grow_nodes(PBVH *pbvh, int totnode)
   pbvh->totnode = totnode;
 }
 
-/* Add a vertex to the map, with a positive value for unique vertices and
- * a negative value for additional vertices */
-static int map_insert_vert(
-    PBVH *pbvh, GHash *map, unsigned int *face_verts, unsigned int *uniq_verts, int vertex)
+static int vert_index_cmp(const void *a_, const void *b_)
 {
-  void *key, **value_p;
+  const int a = *(const int *)a_;
+  const int b = *(const int *)b_;
+  return (a > b) - (a < b);
+}
 
-  key = POINTER_FROM_INT(vertex);
-  if (!BLI_ghash_ensure_p(map, key, &value_p)) {
-    int value_i;
-    if (BLI_BITMAP_TEST(pbvh->vert_bitmap, vertex) == 0) {
-      BLI_BITMAP_ENABLE(pbvh->vert_bitmap, vertex);
-      value_i = *uniq_verts;
-      (*uniq_verts)++;
+/* Index of a vertex in the sorted array of vertices used by a node. */
+static int sorted_vert_index_find(const int *verts, int verts_num, int vertex)
+{
+  int lo = 0, hi = verts_num - 1;
+  while (lo < hi) {
+    const int mid = (lo + hi) / 2;
+    if (verts[mid] < vertex) {
+      lo = mid + 1;
     }
     else {
-      value_i = ~(*face_verts);
-      (*face_verts)++;
+      hi = mid;
     }
-    *value_p = POINTER_FROM_INT(value_i);
-    return value_i;
   }
+  BLI_assert(verts[lo] == vertex);
+  return lo;
+}
 
-  return POINTER_AS_INT(*value_p);
+/* Claim ownership of a vertex for a leaf node. The node with the lowest index using a vertex
+ * owns it, which keeps the result independent of the order leaves are built in. */
+static void vert_owner_claim(int *vert_owner, const int node_index)
+{
+  int owner = *vert_owner;
+  while (node_index < owner) {
+    const int prev_owner = atomic_cas_int32(vert_owner, owner, node_index);
+    if (prev_owner == owner) {
+      break;
+    }
+    owner = prev_owner;
+  }
 }
 
-/* Find vertices used by the faces in this node and update the draw buffers */
-static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node)
+/* Find vertices used by the faces in this node and update the draw buffers.
+ * Vertices owned by the node (see #vert_owner_claim) are unique vertices and are stored first,
+ * others are additional vertices shared with other nodes. */
+static void build_mesh_leaf_node(PBVH *pbvh,
+                                 PBVHNode *node,
+                                 const int node_index,
+                                 const int *vert_owner)
 {
   bool has_visible = false;
 
   node->uniq_verts = node->face_verts = 0;
   const int totface = node->totprim;
 
-  /* reserve size is rough guess */
-  GHash *map = BLI_ghash_int_new_ex("build_mesh_leaf_node gh", 2 * totface);
-
   int(*face_vert_indices)[3] = MEM_mallocN(sizeof(int[3]) * totface, "bvh node face vert indices");
 
   node->face_vert_indices = (const int(*)[3])face_vert_indices;
@@ -294,11 +317,11 @@ static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node)
     has_visible = true;
   }
 
+  /* Store mesh vertex indices first, they are remapped to node vertices below. */
   for (int i = 0; i < totface; i++) {
     const MLoopTri *lt = &pbvh->looptri[node->prim_indices[i]];
     for (int j = 0; j < 3; j++) {
-      face_vert_indices[i][j] = map_insert_vert(
-          pbvh, map, &node->face_verts, &node->uniq_verts, pbvh->mloop[lt->tri[j]].v);
+      face_vert_indices[i][j] = pbvh->mloop[lt->tri[j]].v;
     }
 
     if (has_visible == false) {
@@ -308,30 +331,40 @@ static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node)
     }
   }
 
-  int *vert_indices = MEM_callocN(sizeof(int) * (node->uniq_verts + node->face_verts),
-                                  "bvh node vert indices");
-  node->vert_indices = vert_indices;
-
-  /* Build the vertex list, unique verts first */
-  GHashIterator gh_iter;
-  GHASH_ITER (gh_iter, map) {
-    void *value = BLI_ghashIterator_getValue(&gh_iter);
-    int ndx = POINTER_AS_INT(value);
+  /* Sorted array of the vertices used by the node, without duplicates. */
+  int *verts = MEM_mallocN(sizeof(int[3]) * totface, __func__);
+  memcpy(verts, face_vert_indices, sizeof(int[3]) * totface);
+  qsort(verts, (size_t)totface * 3, sizeof(int), vert_index_cmp);
+  int verts_num = 0;
+  for (int i = 0; i < totface * 3; i++) {
+    if (verts_num == 0 || verts[verts_num - 1] != verts[i]) {
+      verts[verts_num++] = verts[i];
+    }
+  }
 
-    if (ndx < 0) {
-      ndx = -ndx + node->uniq_verts - 1;
+  for (int i = 0; i < verts_num; i++) {
+    if (vert_owner[verts[i]] == node_index) {
+      node->uniq_verts++;
     }
+  }
+  node->face_verts = verts_num - node->uniq_verts;
+
+  int *vert_indices = MEM_mallocN(sizeof(int) * verts_num, "bvh node vert indices");
+  node->vert_indices = vert_indices;
 
-    vert_indices[ndx] = POINTER_AS_INT(BLI_ghashIterator_getKey(&gh_iter));
+  /* Build the vertex list, unique verts first. The map stores the index in the node of each
+   * vertex of the sorted array. */
+  int *vert_map = MEM_mallocN(sizeof(int) * verts_num, __func__);
+  int uniq_index = 0, face_index = node->uniq_verts;
+  for (int i = 0; i < verts_num; i++) {
+    vert_map[i] = (vert_owner[verts[i]] == node_index) ? uniq_index++ : face_index++;
+    vert_indices[vert_map[i]] = verts[i];
   }
 
   for (int i = 0; i < totface; i++) {
-    const int sides = 3;
-
-    for (int j = 0; j < sides; j++) {
-      if (face_vert_indices[i][j] < 0) {
-        face_vert_indices[i][j] = -face_vert_indices[i][j] + node->uniq_verts - 1;
-      }
+    for (int j = 0; j < 3; j++) {
+      face_vert_indices[i][j] = vert_map[sorted_vert_index_find(
+          verts, verts_num, face_vert_indices[i][j])];
     }
   }
 
@@ -339,7 +372,8 @@ static void build_mesh_leaf_node(PBVH *pbvh, PBVHNode *node)
 
   BKE_pbvh_node_fully_hidden_set(node, !has_visible);
 
-  BLI_ghash_free(map, NULL, NULL);
+  MEM_freeN(verts);
+  MEM_freeN(vert_map);
 }
 
 static void update_vb(PBVH *pbvh, PBVHNode *node, BBC *prim_bbc, int offset, int count)
@@ -412,22 +446,14 @@ static void build_grid_leaf_node(PBVH *pbvh, PBVHNode *node)
   BKE_pbvh_node_mark_rebuild_draw(node);
 }
 
-static void build_leaf(PBVH *pbvh, int node_index, BBC *prim_bbc, int offset, int count)
+/* Only tags the node as leaf, vertex data and bounds of leaves are built once the whole tree is
+ * known, see #pbvh_build_leaves. */
+static void build_leaf(PBVH *pbvh, PBVHNode *node, int offset, int count)
 {
-  pbvh->nodes[node_index].flag |= PBVH_Leaf;
+  node->flag |= PBVH_Leaf;
 
-  pbvh->nodes[node_index].prim_indices = pbvh->prim_indices + offset;
-  pbvh->nodes[node_index].totprim = count;
-
-  /* Still need vb for searches */
-  update_vb(pbvh, &pbvh->nodes[node_index], prim_bbc, offset, count);
-
-  if (pbvh->looptri) {
-    build_mesh_leaf_node(pbvh, pbvh->nodes + node_index);
-  }
-  else {
-    build_grid_leaf_node(pbvh, pbvh->nodes + node_index);
-  }
+  node->prim_indices = pbvh->prim_indices + offset;
+  node->totprim = count;
 }
 
 /* Return zero if all primitives in the node can be drawn with the
@@ -464,37 +490,229 @@ static bool leaf_needs_material_split(PBVH *pbvh, int offset, int count)
   return false;
 }
 
-/* Recursively build a node in the tree
+/* Nodes of a tree which is being built. Children of a node are stored after it. */
+typedef struct PBVHBuildNodes {
+  PBVHNode *nodes;
+  int totnode;
+  int mem_count;
+} PBVHBuildNodes;
+
+/* Subtree which is built by a parallel task, once the top of the tree has been built. */
+typedef struct PBVHBuildTask {
+  /* Index of the subtree root in the tree. */
+  int node_index;
+  int offset, count;
+  BB cb;
+  bool has_cb;
+  PBVHBuildNodes subtree;
+} PBVHBuildTask;
+
+typedef struct PBVHBuildTaskList {
+  PBVHBuildTask tasks[1 << PBVH_BUILD_TASK_DEPTH];
+  int tasks_num;
+} PBVHBuildTaskList;
+
+typedef struct PBVHBuildData {
+  PBVH *pbvh;
+  BBC *prim_bbc;
+  PBVHBuildTaskList *task_list;
+} PBVHBuildData;
+
+static void build_nodes_grow(PBVHBuildNodes *build_nodes, int totnode)
+{
+  if (UNLIKELY(totnode > build_nodes->mem_count)) {
+    build_nodes->mem_count = build_nodes->mem_count + (build_nodes->mem_count / 3);
+    if (build_nodes->mem_count < totnode) {
+      build_nodes->mem_count = totnode;
+    }
+    build_nodes->nodes = MEM_recallocN(build_nodes->nodes,
+                                       sizeof(PBVHNode) * build_nodes->mem_count);
+  }
+
+  build_nodes->totnode = totnode;
+}
+
+BLI_INLINE int build_split_bin_index(const float co, const float bin_min, const float bin_scale)
+{
+  const int bin = (int)((co - bin_min) * bin_scale);
+  return CLAMPIS(bin, 0, PBVH_BUILD_SPLIT_BINS - 1);
+}
+
+static float BB_half_surface_area(const BB *bb)
+{
+  const float dx = bb->bmax[0] - bb->bmin[0];
+  const float dy = bb->bmax[1] - bb->bmin[1];
+  const float dz = bb->bmax[2] - bb->bmin[2];
+  return dx * dy + dy * dz + dz * dx;
+}
+
+/* Returns the index of the first element on the right of the partition */
+static int partition_indices_bin(int *prim_indices,
+                                 int lo,
+                                 int hi,
+                                 int axis,
+                                 float bin_min,
+                                 float bin_scale,
+                                 int split_bin,
+                                 const BBC *prim_bbc)
+{
+  int i = lo, j = hi;
+  for (;;) {
+    for (; build_split_bin_index(prim_bbc[prim_indices[i]].bcentroid[axis], bin_min, bin_scale) <
+           split_bin;
+         i++) {
+      /* pass */
+    }
+    for (; build_split_bin_index(prim_bbc[prim_indices[j]].bcentroid[axis], bin_min, bin_scale) >=
+           split_bin;
+         j--) {
+      /* pass */
+    }
+
+    if (!(i < j)) {
+      return i;
+    }
+
+    SWAP(int, prim_indices[i], prim_indices[j]);
+    i++;
+  }
+}
+
+/* Partition primitives along the given axis at the bin boundary with the lowest surface area
+ * heuristic cost. Splits leaving less than a quarter of the primitives on one side are not
+ * considered, so leaves stay close to the leaf limit.
  *
- * vb is the voxel box around all of the primitives contained in
- * this node.
+ * Returns the index of the first element on the right of the partition, or -1 if there is no
+ * valid split. On success the centroid bounds of both sides are returned in r_cb. */
+static int partition_indices_sah(
+    PBVH *pbvh, BBC *prim_bbc, int offset, int count, const BB *cb, int axis, BB r_cb[2])
+{
+  const float extent = cb->bmax[axis] - cb->bmin[axis];
+  if (!(extent > 0.0f)) {
+    return -1;
+  }
+  const float bin_min = cb->bmin[axis];
+  const float bin_scale = PBVH_BUILD_SPLIT_BINS / extent;
+
+  int bin_count[PBVH_BUILD_SPLIT_BINS] = {0};
+  BB bin_bb[PBVH_BUILD_SPLIT_BINS];
+  BB bin_cb[PBVH_BUILD_SPLIT_BINS];
+  for (int b = 0; b < PBVH_BUILD_SPLIT_BINS; b++) {
+    BB_reset(&bin_bb[b]);
+    BB_reset(&bin_cb[b]);
+  }
+
+  for (int i = offset + count - 1; i >= offset; i--) {
+    BBC *bbc = &prim_bbc[pbvh->prim_indices[i]];
+    const int b = build_split_bin_index(bbc->bcentroid[axis], bin_min, bin_scale);
+    bin_count[b]++;
+    BB_expand_with_bb(&bin_bb[b], (BB *)bbc);
+    BB_expand(&bin_cb[b], bbc->bcentroid);
+  }
+
+  /* Cost of the right side when splitting before each bin. */
+  float right_cost[PBVH_BUILD_SPLIT_BINS];
+  int right_count[PBVH_BUILD_SPLIT_BINS];
+  BB bb;
+  BB_reset(&bb);
+  int bb_count = 0;
+  for (int b = PBVH_BUILD_SPLIT_BINS - 1; b > 0; b--) {
+    BB_expand_with_bb(&bb, &bin_bb[b]);
+    bb_count += bin_count[b];
+    right_count[b] = bb_count;
+    right_cost[b] = bb_count ? BB_half_surface_area(&bb) * bb_count : 0.0f;
+  }
+
+  const int min_count = max_ii(count / 4, 1);
+  float best_cost = FLT_MAX;
+  int best_split = -1;
+  BB_reset(&bb);
+  bb_count = 0;
+  for (int b = 1; b < PBVH_BUILD_SPLIT_BINS; b++) {
+    BB_expand_with_bb(&bb, &bin_bb[b - 1]);
+    bb_count += bin_count[b - 1];
+    if (bb_count < min_count || right_count[b] < min_count) {
+      continue;
+    }
+    const float cost = BB_half_surface_area(&bb) * bb_count + right_cost[b];
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_split = b;
+    }
+  }
+
+  if (best_split == -1) {
+    return -1;
+  }
+
+  BB_reset(&r_cb[0]);
+  BB_reset(&r_cb[1]);
+  for (int b = 0; b < PBVH_BUILD_SPLIT_BINS; b++) {
+    BB_expand_with_bb(&r_cb[b < best_split ? 0 : 1], &bin_cb[b]);
+  }
+
+  return partition_indices_bin(pbvh->prim_indices,
+                               offset,
+                               offset + count - 1,
+                               axis,
+                               bin_min,
+                               bin_scale,
+                               best_split,
+                               prim_bbc);
+}
+
+/* Recursively build a node in the tree
  *
  * cb is the bounding box around all the centroids of the primitives
  * contained in this node
  *
  * offset and start indicate a range in the array of primitive indices
+ *
+ * When a task list is given, nodes at #PBVH_BUILD_TASK_DEPTH are not built but added to the list,
+ * to be built as independent subtrees in parallel.
  */
 
-static void build_sub(PBVH *pbvh, int node_index, BB *cb, BBC *prim_bbc, int offset, int count)
+static void build_sub(PBVHBuildData *data,
+                      PBVHBuildNodes *build_nodes,
+                      int node_index,
+                      BB *cb,
+                      int offset,
+                      int count,
+                      PBVHBuildTaskList *task_list,
+                      int depth)
 {
+  PBVH *pbvh = data->pbvh;
+  BBC *prim_bbc = data->prim_bbc;
   int end;
   BB cb_backing;
+  BB cb_children[2];
+  BB *cb_left = NULL, *cb_right = NULL;
 
   /* Decide whether this is a leaf or not */
   const bool below_leaf_limit = count <= pbvh->leaf_limit;
   if (below_leaf_limit) {
     if (!leaf_needs_material_split(pbvh, offset, count)) {
-      build_leaf(pbvh, node_index, prim_bbc, offset, count);
+      build_leaf(pbvh, &build_nodes->nodes[node_index], offset, count);
       return;
     }
   }
 
-  /* Add two child nodes */
-  pbvh->nodes[node_index].children_offset = pbvh->totnode;
-  pbvh_grow_nodes(pbvh, pbvh->totnode + 2);
+  if (task_list && depth == PBVH_BUILD_TASK_DEPTH) {
+    PBVHBuildTask *task = &task_list->tasks[task_list->tasks_num++];
+    task->node_index = node_index;
+    task->offset = offset;
+    task->count = count;
+    task->has_cb = cb != NULL;
+    if (cb) {
+      task->cb = *cb;
+    }
+    return;
+  }
 
-  /* Update parent node bounding box */
-  update_vb(pbvh, &pbvh->nodes[node_index], prim_bbc, offset, count);
+  /* Add two child nodes */
+  const int children_offset = build_nodes->totnode;
+  build_nodes_grow(build_nodes, build_nodes->totnode + 2);
+  build_nodes->nodes[node_index].children_offset = children_offset;
 
   if (!below_leaf_limit) {
     /* Find axis with widest range of primitive centroids */
@@ -508,12 +726,19 @@ static void build_sub(PBVH *pbvh, int node_index, BB *cb, BBC *prim_bbc, int off
     const int axis = BB_widest_axis(cb);
 
     /* Partition primitives along that axis */
-    end = partition_indices(pbvh->prim_indices,
-                            offset,
-                            offset + count - 1,
-                            axis,
-                            (cb->bmax[axis] + cb->bmin[axis]) * 0.5f,
-                            prim_bbc);
+    end = partition_indices_sah(pbvh, prim_bbc, offset, count, cb, axis, cb_children);
+    if (end != -1) {
+      cb_left = &cb_children[0];
+      cb_right = &cb_children[1];
+    }
+    else {
+      end = partition_indices(pbvh->prim_indices,
+                              offset,
+                              offset + count - 1,
+                              axis,
+                              (cb->bmax[axis] + cb->bmin[axis]) * 0.5f,
+                              prim_bbc);
+    }
   }
   else {
     /* Partition primitives by material */
@@ -521,16 +746,222 @@ static void build_sub(PBVH *pbvh, int node_index, BB *cb, BBC *prim_bbc, int off
   }
 
   /* Build children */
-  build_sub(pbvh, pbvh->nodes[node_index].children_offset, NULL, prim_bbc, offset, end - offset);
-  build_sub(pbvh,
-            pbvh->nodes[node_index].children_offset + 1,
-            NULL,
-            prim_bbc,
+  build_sub(data,
+            build_nodes,
+            children_offset,
+            cb_left,
+            offset,
+            end - offset,
+            task_list,
+            depth + 1);
+  build_sub(data,
+            build_nodes,
+            children_offset + 1,
+            cb_right,
             end,
-            offset + count - end);
+            offset + count - end,
+            task_list,
+            depth + 1);
 }
 
-static void pbvh_build(PBVH *pbvh, BB *cb, BBC *prim_bbc, int totprim)
+static void pbvh_build_subtree_task_cb(void *__restrict userdata,
+                                       const int n,
+                                       const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PBVHBuildData *data = userdata;
+  PBVHBuildTask *task = &data->task_list->tasks[n];
+  PBVHBuildNodes *subtree = &task->subtree;
+
+  /* Rough guess, leaves are usually about half full. */
+  subtree->mem_count = max_ii(4 * task->count / data->pbvh->leaf_limit, 16);
+  subtree->nodes = MEM_callocN(sizeof(PBVHNode) * subtree->mem_count, "bvh subtree nodes");
+  subtree->totnode = 1;
+
+  build_sub(data,
+            subtree,
+            0,
+            task->has_cb ? &task->cb : NULL,
+            task->offset,
+            task->count,
+            NULL,
+            PBVH_BUILD_TASK_DEPTH);
+}
+
+/* Move nodes of a subtree built by a task into the tree, the subtree root replaces the node the
+ * task was created for and other nodes are appended. */
+static void build_nodes_merge_subtree(PBVHBuildNodes *build_nodes,
+                                      int node_index,
+                                      PBVHBuildNodes *subtree)
+{
+  const int base = build_nodes->totnode - 1;
+  build_nodes_grow(build_nodes, build_nodes->totnode + subtree->totnode - 1);
+
+  for (int i = 0; i < subtree->totnode; i++) {
+    PBVHNode *node = &subtree->nodes[i];
+    if (!(node->flag & PBVH_Leaf)) {
+      node->children_offset += base;
+    }
+  }
+
+  build_nodes->nodes[node_index] = subtree->nodes[0];
+  memcpy(&build_nodes->nodes[base + 1],
+         &subtree->nodes[1],
+         sizeof(PBVHNode) * (subtree->totnode - 1));
+
+  MEM_freeN(subtree->nodes);
+}
+
+/* Build the nodes hierarchy. The top of the tree is built on a single thread, deeper subtrees are
+ * built in parallel and merged in a fixed order, so the result doesn't depend on scheduling. */
+static void pbvh_build_tree(PBVH *pbvh, BB *cb, BBC *prim_bbc, int totprim)
+{
+  PBVHBuildTaskList *task_list = MEM_mallocN(sizeof(PBVHBuildTaskList), __func__);
+  task_list->tasks_num = 0;
+
+  PBVHBuildData data = {
+      .pbvh = pbvh,
+      .prim_bbc = prim_bbc,
+      .task_list = task_list,
+  };
+
+  PBVHBuildNodes build_nodes = {
+      .nodes = pbvh->nodes,
+      .totnode = pbvh->totnode,
+      .mem_count = pbvh->node_mem_count,
+  };
+
+  build_sub(&data, &build_nodes, 0, cb, 0, totprim, task_list, 0);
+
+  if (task_list->tasks_num) {
+    TaskParallelSettings settings;
+    BKE_pbvh_parallel_range_settings(&settings, true, task_list->tasks_num);
+    BLI_task_parallel_range(
+        0, task_list->tasks_num, &data, pbvh_build_subtree_task_cb, &settings);
+
+    for (int i = 0; i < task_list->tasks_num; i++) {
+      PBVHBuildTask *task = &task_list->tasks[i];
+      build_nodes_merge_subtree(&build_nodes, task->node_index, &task->subtree);
+    }
+  }
+
+  pbvh->nodes = build_nodes.nodes;
+  pbvh->totnode = build_nodes.totnode;
+  pbvh->node_mem_count = build_nodes.mem_count;
+
+  MEM_freeN(task_list);
+}
+
+typedef struct PBVHBuildLeavesData {
+  PBVH *pbvh;
+  BBC *prim_bbc;
+  const int *leaf_indices;
+  int *vert_owner;
+} PBVHBuildLeavesData;
+
+static void pbvh_build_leaf_vert_owner_task_cb(void *__restrict userdata,
+                                               const int n,
+                                               const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PBVHBuildLeavesData *data = userdata;
+  PBVH *pbvh = data->pbvh;
+  const int node_index = data->leaf_indices[n];
+  const PBVHNode *node = &pbvh->nodes[node_index];
+
+  for (int i = 0; i < node->totprim; i++) {
+    const MLoopTri *lt = &pbvh->looptri[node->prim_indices[i]];
+    for (int j = 0; j < 3; j++) {
+      vert_owner_claim(&data->vert_owner[pbvh->mloop[lt->tri[j]].v], node_index);
+    }
+  }
+}
+
+static void pbvh_build_leaf_task_cb(void *__restrict userdata,
+                                    const int n,
+                                    const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  PBVHBuildLeavesData *data = userdata;
+  PBVH *pbvh = data->pbvh;
+  const int node_index = data->leaf_indices[n];
+  PBVHNode *node = &pbvh->nodes[node_index];
+
+  /* Still need vb for searches */
+  update_vb(pbvh,
+            node,
+            data->prim_bbc,
+            (int)(node->prim_indices - pbvh->prim_indices),
+            node->totprim);
+
+  if (pbvh->looptri) {
+    build_mesh_leaf_node(pbvh, node, node_index, data->vert_owner);
+  }
+  else {
+    build_grid_leaf_node(pbvh, node);
+  }
+}
+
+/* Build vertex data and bounds of all leaves in parallel, then bounds of the other nodes. */
+static void pbvh_build_leaves(PBVH *pbvh, BBC *prim_bbc)
+{
+  int *leaf_indices = MEM_mallocN(sizeof(int) * pbvh->totnode, __func__);
+  int totleaf = 0;
+  for (int i = 0; i < pbvh->totnode; i++) {
+    if (pbvh->nodes[i].flag & PBVH_Leaf) {
+      leaf_indices[totleaf++] = i;
+    }
+  }
+
+  PBVHBuildLeavesData data = {
+      .pbvh = pbvh,
+      .prim_bbc = prim_bbc,
+      .leaf_indices = leaf_indices,
+      .vert_owner = NULL,
+  };
+
+  TaskParallelSettings settings;
+  BKE_pbvh_parallel_range_settings(&settings, true, totleaf);
+
+  if (pbvh->looptri) {
+    data.vert_owner = MEM_malloc_arrayN(pbvh->totvert, sizeof(int), "bvh vert owner");
+    for (int i = 0; i < pbvh->totvert; i++) {
+      data.vert_owner[i] = INT_MAX;
+    }
+    BLI_task_parallel_range(0, totleaf, &data, pbvh_build_leaf_vert_owner_task_cb, &settings);
+  }
+
+  BLI_task_parallel_range(0, totleaf, &data, pbvh_build_leaf_task_cb, &settings);
+
+  /* Children are stored after their parent, so they are always updated first. */
+  for (int i = pbvh->totnode - 1; i >= 0; i--) {
+    PBVHNode *node = &pbvh->nodes[i];
+    if (!(node->flag & PBVH_Leaf)) {
+      update_node_vb(pbvh, node);
+      node->orig_vb = node->vb;
+    }
+  }
+
+  MEM_SAFE_FREE(data.vert_owner);
+  MEM_freeN(leaf_indices);
+}
+
+typedef struct PBVHBuildTimings {
+  double start;
+  double prim_bounds;
+  double tree;
+  double leaves;
+} PBVHBuildTimings;
+
+#ifdef DEBUG_BUILD_TIME
+static void pbvh_build_timings_print(const PBVH *pbvh, const PBVHBuildTimings *timings)
+{
+  printf("PBVH build: %d primitives, %d nodes\n", pbvh->totprim, pbvh->totnode);
+  printf("  Primitive bounds: %.6f\n", timings->prim_bounds - timings->start);
+  printf("  Tree: %.6f\n", timings->tree - timings->prim_bounds);
+  printf("  Leaves: %.6f\n", timings->leaves - timings->tree);
+  printf("  Total: %.6f\n", timings->leaves - timings->start);
+}
+#endif
+
+static void pbvh_build(PBVH *pbvh, BB *cb, BBC *prim_bbc, int totprim, PBVHBuildTimings *timings)
 {
   if (totprim != pbvh->totprim) {
     pbvh->totprim = totprim;
@@ -552,7 +983,99 @@ static void pbvh_build(PBVH *pbvh, BB *cb, BBC *prim_bbc, int totprim)
   }
 
   pbvh->totnode = 1;
-  build_sub(pbvh, 0, cb, prim_bbc, 0, totprim);
+  pbvh_build_tree(pbvh, cb, prim_bbc, totprim);
+  timings->tree = PIL_check_seconds_timer();
+
+  pbvh_build_leaves(pbvh, prim_bbc);
+  timings->leaves = PIL_check_seconds_timer();
+
+#ifdef DEBUG_BUILD_TIME
+  pbvh_build_timings_print(pbvh, timings);
+#endif
+}
+
+typedef struct PBVHBuildPrimBoundsData {
+  PBVH *pbvh;
+  BBC *prim_bbc;
+} PBVHBuildPrimBoundsData;
+
+static void pbvh_build_mesh_prim_bounds_task_cb(void *__restrict userdata,
+                                                const int i,
+                                                const TaskParallelTLS *__restrict tls)
+{
+  PBVHBuildPrimBoundsData *data = userdata;
+  PBVH *pbvh = data->pbvh;
+  const MLoopTri *lt = &pbvh->looptri[i];
+  const int sides = 3;
+  BBC *bbc = data->prim_bbc + i;
+
+  BB_reset((BB *)bbc);
+
+  for (int j = 0; j < sides; j++) {
+    BB_expand((BB *)bbc, pbvh->verts[pbvh->mloop[lt->tri[j]].v].co);
+  }
+
+  BBC_update_centroid(bbc);
+
+  BB_expand((BB *)tls->userdata_chunk, bbc->bcentroid);
+}
+
+static void pbvh_build_grids_prim_bounds_task_cb(void *__restrict userdata,
+                                                 const int i,
+                                                 const TaskParallelTLS *__restrict tls)
+{
+  PBVHBuildPrimBoundsData *data = userdata;
+  PBVH *pbvh = data->pbvh;
+  const CCGKey *key = &pbvh->gridkey;
+  CCGElem *grid = pbvh->grids[i];
+  BBC *bbc = data->prim_bbc + i;
+
+  BB_reset((BB *)bbc);
+
+  for (int j = 0; j < key->grid_area; j++) {
+    BB_expand((BB *)bbc, CCG_elem_offset_co(key, grid, j));
+  }
+
+  BBC_update_centroid(bbc);
+
+  BB_expand((BB *)tls->userdata_chunk, bbc->bcentroid);
+}
+
+static void pbvh_build_prim_bounds_reduce(const void *__restrict UNUSED(userdata),
+                                          void *__restrict chunk_join,
+                                          void *__restrict chunk)
+{
+  BB_expand_with_bb(chunk_join, chunk);
+}
+
+/* For each primitive, store the AABB and the AABB centroid, and compute the bounding box of all
+ * centroids in r_cb. */
+static BBC *pbvh_build_prim_bounds(PBVH *pbvh, int totprim, BB *r_cb)
+{
+  BBC *prim_bbc = MEM_mallocN(sizeof(BBC) * totprim, "prim_bbc");
+
+  BB_reset(r_cb);
+
+  PBVHBuildPrimBoundsData data = {
+      .pbvh = pbvh,
+      .prim_bbc = prim_bbc,
+  };
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 1024;
+  settings.userdata_chunk = r_cb;
+  settings.userdata_chunk_size = sizeof(*r_cb);
+  settings.func_reduce = pbvh_build_prim_bounds_reduce;
+
+  BLI_task_parallel_range(0,
+                          totprim,
+                          &data,
+                          pbvh->looptri ? pbvh_build_mesh_prim_bounds_task_cb :
+                                          pbvh_build_grids_prim_bounds_task_cb,
+                          &settings);
+
+  return prim_bbc;
 }
 
 /**
@@ -573,8 +1096,8 @@ void BKE_pbvh_build_mesh(PBVH *pbvh,
                          const MLoopTri *looptri,
                          int looptri_num)
 {
-  BBC *prim_bbc = NULL;
-  BB cb;
+  PBVHBuildTimings timings;
+  timings.start = PIL_check_seconds_timer();
 
   pbvh->mesh = mesh;
   pbvh->type = PBVH_FACES;
@@ -582,7 +1105,6 @@ void BKE_pbvh_build_mesh(PBVH *pbvh,
   pbvh->mloop = mloop;
   pbvh->looptri = looptri;
   pbvh->verts = verts;
-  pbvh->vert_bitmap = BLI_BITMAP_NEW(totvert, "bvh->vert_bitmap");
   pbvh->totvert = totvert;
   pbvh->leaf_limit = LEAF_LIMIT;
   pbvh->vdata = vdata;
@@ -592,33 +1114,15 @@ void BKE_pbvh_build_mesh(PBVH *pbvh,
   pbvh->face_sets_color_seed = mesh->face_sets_color_seed;
   pbvh->face_sets_color_default = mesh->face_sets_color_default;
 
-  BB_reset(&cb);
-
-  /* For each face, store the AABB and the AABB centroid */
-  prim_bbc = MEM_mallocN(sizeof(BBC) * looptri_num, "prim_bbc");
-
-  for (int i = 0; i < looptri_num; i++) {
-    const MLoopTri *lt = &looptri[i];
-    const int sides = 3;
-    BBC *bbc = prim_bbc + i;
-
-    BB_reset((BB *)bbc);
-
-    for (int j = 0; j < sides; j++) {
-      BB_expand((BB *)bbc, verts[pbvh->mloop[lt->tri[j]].v].co);
-    }
-
-    BBC_update_centroid(bbc);
-
-    BB_expand(&cb, bbc->bcentroid);
-  }
+  BB cb;
+  BBC *prim_bbc = pbvh_build_prim_bounds(pbvh, looptri_num, &cb);
+  timings.prim_bounds = PIL_check_seconds_timer();
 
   if (looptri_num) {
-    pbvh_build(pbvh, &cb, prim_bbc, looptri_num);
+    pbvh_build(pbvh, &cb, prim_bbc, looptri_num, &timings);
   }
 
   MEM_freeN(prim_bbc);
-  MEM_freeN(pbvh->vert_bitmap);
 }
 
 /* Do a full rebuild with on Grids data structure */
@@ -632,6 +1136,9 @@ void BKE_pbvh_build_grids(PBVH *pbvh,
 {
   const int gridsize = key->grid_size;
 
+  PBVHBuildTimings timings;
+  timings.start = PIL_check_seconds_timer();
+
   pbvh->type = PBVH_GRIDS;
   pbvh->grids = grids;
   pbvh->gridfaces = gridfaces;
@@ -642,28 +1149,11 @@ void BKE_pbvh_build_grids(PBVH *pbvh,
   pbvh->leaf_limit = max_ii(LEAF_LIMIT / (gridsize * gridsize), 1);
 
   BB cb;
-  BB_reset(&cb);
-
-  /* For each grid, store the AABB and the AABB centroid */
-  BBC *prim_bbc = MEM_mallocN(sizeof(BBC) * totgrid, "prim_bbc");
-
-  for (int i = 0; i < totgrid; i++) {
-    CCGElem *grid = grids[i];
-    BBC *bbc = prim_bbc + i;
-
-    BB_reset((BB *)bbc);
-
-    for (int j = 0; j < gridsize * gridsize; j++) {
-      BB_expand((BB *)bbc, CCG_elem_offset_co(key, grid, j));
-    }
-
-    BBC_update_centroid(bbc);
-
-    BB_expand(&cb, bbc->bcentroid);
-  }
+  BBC *prim_bbc = pbvh_build_prim_bounds(pbvh, totgrid, &cb);
+  timings.prim_bounds = PIL_check_seconds_timer();
 
   if (totgrid) {
-    pbvh_build(pbvh, &cb, prim_bbc, totgrid);
+    pbvh_build(pbvh, &cb, prim_bbc, totgrid, &timings);
   }
 
   MEM_freeN(prim_bbc);
@@ -599,10 +599,17 @@ Span<float> BezierSpline::evaluated_mappings() const
 
   Span<int> offsets = this->control_point_offsets();
 
-  blender::threading::isolate_task([&]() {
-    /* Isolate the task, since this is function is multi-threaded and holds a lock. */
+  if (eval_size < 2048) {
+    /* Avoid the overhead of task isolation for small splines, which are computed on one thread.
+     */
     calculate_mappings_linear_resolution(offsets, size, resolution_, is_cyclic_, mappings);
-  });
+  }
+  else {
+    blender::threading::isolate_task([&]() {
+      /* Isolate the task, since this is function is multi-threaded and holds a lock. */
+      calculate_mappings_linear_resolution(offsets, size, resolution_, is_cyclic_, mappings);
+    });
+  }
 
   mapping_cache_dirty_ = false;
   return mappings;
@@ -619,45 +626,68 @@ Span<float3> BezierSpline::evaluated_positions() const
     return evaluated_position_cache_;
   }
 
+  evaluated_position_cache_.resize(this->evaluated_points_size());
+  this->evaluate_positions(evaluated_position_cache_);
+
+  position_cache_dirty_ = false;
+  return evaluated_position_cache_;
+}
+
+/**
+ * Write the evaluated positions to \a r_positions, which must have the size of
+ * #evaluated_points_size. The position cache is used when it is valid, but it is not filled,
+ * so that the positions of many splines can be evaluated into one array without an allocation
+ * for every spline.
+ */
+void BezierSpline::evaluate_positions(MutableSpan<float3> r_positions) const
+{
   const int size = this->size();
-  const int eval_size = this->evaluated_points_size();
-  evaluated_position_cache_.resize(eval_size);
+  BLI_assert(r_positions.size() == this->evaluated_points_size());
 
-  MutableSpan<float3> positions = evaluated_position_cache_;
+  if (!position_cache_dirty_) {
+    r_positions.copy_from(evaluated_position_cache_);
+    return;
+  }
 
   if (size == 1) {
     /* Use a special case for single point splines to avoid checking in #evaluate_segment. */
-    BLI_assert(eval_size == 1);
-    positions.first() = positions_.first();
-    position_cache_dirty_ = false;
-    return positions;
+    BLI_assert(r_positions.size() == 1);
+    r_positions.first() = positions_.first();
+    return;
   }
 
   this->ensure_auto_handles();
 
   Span<int> offsets = this->control_point_offsets();
 
+  auto evaluate_segments = [&](const IndexRange range) {
+    for (const int i : range) {
+      this->evaluate_segment(
+          i, i + 1, r_positions.slice(offsets[i], offsets[i + 1] - offsets[i]));
+    }
+  };
   const int grain_size = std::max(512 / resolution_, 1);
-  blender::threading::isolate_task([&]() {
-    /* Isolate the task, since this is function is multi-threaded and holds a lock. */
-    blender::threading::parallel_for(IndexRange(size - 1), grain_size, [&](IndexRange range) {
-      for (const int i : range) {
-        this->evaluate_segment(i, i + 1, positions.slice(offsets[i], offsets[i + 1] - offsets[i]));
-      }
+  if (size - 1 <= grain_size) {
+    /* Most splines are evaluated on a single thread, in which case task isolation is not
+     * necessary. That is important for curves with many small splines. */
+    evaluate_segments(IndexRange(size - 1));
+  }
+  else {
+    blender::threading::isolate_task([&]() {
+      /* Isolate the task, since this is function is multi-threaded and can be called while
+       * holding a lock. */
+      blender::threading::parallel_for(IndexRange(size - 1), grain_size, evaluate_segments);
     });
-  });
+  }
   if (is_cyclic_) {
     this->evaluate_segment(
-        size - 1, 0, positions.slice(offsets[size - 1], offsets[size] - offsets[size - 1]));
+        size - 1, 0, r_positions.slice(offsets[size - 1], offsets[size] - offsets[size - 1]));
   }
   else {
     /* Since evaluating the bezier segment doesn't add the final point,
      * it must be added manually in the non-cyclic case. */
-    positions.last() = positions_.last();
+    r_positions.last() = positions_.last();
   }
-
-  position_cache_dirty_ = false;
-  return positions;
 }
 
 /**
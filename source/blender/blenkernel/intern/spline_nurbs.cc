@@ -28,7 +28,6 @@ using blender::MutableSpan;
 using blender::Span;
 using blender::fn::GVArray;
 using blender::fn::GVArray_For_ArrayContainer;
-using blender::fn::GVArray_Typed;
 using blender::fn::GVArrayPtr;
 
 void NURBSpline::copy_settings(Spline &dst) const
@@ -444,13 +443,40 @@ Span<float3> NURBSpline::evaluated_positions() const
     return evaluated_position_cache_;
   }
 
-  const int eval_size = this->evaluated_points_size();
-  evaluated_position_cache_.resize(eval_size);
-
-  /* TODO: Avoid copying the evaluated data from the temporary array. */
-  GVArray_Typed<float3> evaluated = Spline::interpolate_to_evaluated(positions_.as_span());
-  evaluated->materialize(evaluated_position_cache_);
+  evaluated_position_cache_.resize(this->evaluated_points_size());
+  this->evaluate_positions(evaluated_position_cache_);
 
   position_cache_dirty_ = false;
   return evaluated_position_cache_;
 }
+
+/**
+ * Write the evaluated positions to \a r_positions, which must have the size of
+ * #evaluated_points_size. The position cache is used when it is valid, but it is not filled.
+ */
+void NURBSpline::evaluate_positions(MutableSpan<float3> r_positions) const
+{
+  BLI_assert(r_positions.size() == this->evaluated_points_size());
+
+  if (!position_cache_dirty_) {
+    r_positions.copy_from(evaluated_position_cache_);
+    return;
+  }
+
+  /* Evaluate the positions directly, which gives the same result as #interpolate_to_evaluated
+   * without the temporary array and the virtual array access. */
+  Span<BasisCache> basis_cache = this->calculate_basis_cache();
+  const int size = this->size();
+  for (const int i : r_positions.index_range()) {
+    Span<float> point_weights = basis_cache[i].weights;
+    const int start_index = basis_cache[i].start_index;
+    float3 position{0.0f};
+    float total_weight = 0.0f;
+    for (const int j : point_weights.index_range()) {
+      const int point_index = (start_index + j) % size;
+      position += positions_[point_index] * point_weights[j];
+      total_weight += point_weights[j];
+    }
+    r_positions[i] = total_weight > 0.0f ? position * (1.0f / total_weight) : float3(0.0f);
+  }
+}
@@ -29,6 +29,8 @@
 
 #include "BLI_utildefines.h"
 
+#include "BKE_global.h"
+
 #include "MEM_guardedalloc.h"
 
 #include "subdiv_converter.h"
@@ -47,6 +49,10 @@ void BKE_subdiv_init()
 
 void BKE_subdiv_exit()
 {
+  if (G.debug & G_DEBUG) {
+    BKE_subdiv_cache_stats_print();
+  }
+  BKE_subdiv_cache_clear();
   openSubdiv_cleanup();
 }
 
@@ -0,0 +1,334 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bke
+ */
+
+#include "BKE_subdiv.h"
+#include "BKE_subdiv_eval.h"
+
+#include <stdio.h>
+
+#include "DNA_mesh_types.h"
+
+#include "BLI_hash_mm2a.h"
+#include "BLI_listbase.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "subdiv_converter.h"
+
+#include "opensubdiv_converter_capi.h"
+#include "opensubdiv_evaluator_capi.h"
+#include "opensubdiv_topology_refiner_capi.h"
+
+/* Default limit of the estimated memory used by descriptors stored in the cache. */
+#define SUBDIV_CACHE_DEFAULT_MEMORY_LIMIT ((size_t)256 * 1024 * 1024)
+
+/* Rough estimate of memory used by topology refiner, stencils and patches per refined vertex.
+ * Only used for descriptors which have no evaluator to query. */
+#define SUBDIV_CACHE_BYTES_PER_REFINED_VERTEX 128
+
+typedef struct SubdivCacheEntry {
+  struct SubdivCacheEntry *next, *prev;
+  Subdiv *subdiv;
+  /* Number of users of the descriptor. Entries without users are stored in the released list. */
+  int num_users;
+  /* Estimated memory usage, only known for released entries. */
+  size_t memory_size;
+  /* Held by the user which evaluates the descriptor. */
+  ThreadMutex eval_mutex;
+} SubdivCacheEntry;
+
+typedef struct SubdivCache {
+  /* Entries which are in use. */
+  ListBase used_entries;
+  /* Entries which are not used by anyone, least recently released entries come first. */
+  ListBase released_entries;
+  size_t memory_used;
+  size_t memory_limit;
+  int num_hits;
+  int num_misses;
+  int num_evictions;
+} SubdivCache;
+
+static SubdivCache subdiv_cache = {
+    .used_entries = {NULL, NULL},
+    .released_entries = {NULL, NULL},
+    .memory_used = 0,
+    .memory_limit = SUBDIV_CACHE_DEFAULT_MEMORY_LIMIT,
+};
+static ThreadMutex subdiv_cache_mutex = BLI_MUTEX_INITIALIZER;
+
+/* ================================ HELPERS ================================= */
+
+static uint32_t subdiv_cache_topology_hash(const OpenSubdiv_Converter *converter)
+{
+  const int num_faces = converter->getNumFaces(converter);
+  BLI_HashMurmur2A mm2;
+  BLI_hash_mm2a_init(&mm2, 0);
+  BLI_hash_mm2a_add_int(&mm2, converter->getNumVertices(converter));
+  BLI_hash_mm2a_add_int(&mm2, num_faces);
+  int *face_vertices = NULL;
+  int face_vertices_size = 0;
+  for (int face_index = 0; face_index < num_faces; face_index++) {
+    const int num_face_vertices = converter->getNumFaceVertices(converter, face_index);
+    if (num_face_vertices > face_vertices_size) {
+      MEM_SAFE_FREE(face_vertices);
+      face_vertices = MEM_malloc_arrayN(num_face_vertices, sizeof(int), __func__);
+      face_vertices_size = num_face_vertices;
+    }
+    converter->getFaceVertices(converter, face_index, face_vertices);
+    BLI_hash_mm2a_add_int(&mm2, num_face_vertices);
+    BLI_hash_mm2a_add(
+        &mm2, (const unsigned char *)face_vertices, sizeof(int) * (size_t)num_face_vertices);
+  }
+  MEM_SAFE_FREE(face_vertices);
+  return BLI_hash_mm2a_end(&mm2);
+}
+
+static size_t subdiv_cache_memory_estimate(const Subdiv *subdiv)
+{
+  const OpenSubdiv_TopologyRefiner *topology_refiner = subdiv->topology_refiner;
+  if (topology_refiner == NULL) {
+    return 0;
+  }
+  const size_t num_ptex_faces = (size_t)topology_refiner->getNumPtexFaces(topology_refiner);
+  const size_t face_ptex_offset_size = (subdiv->cache_.face_ptex_offset != NULL) ?
+                                           topology_refiner->getNumFaces(topology_refiner) *
+                                               sizeof(int) :
+                                           0;
+  if (subdiv->evaluator != NULL) {
+    return subdiv->evaluator->getMemoryUsage(subdiv->evaluator) + face_ptex_offset_size;
+  }
+  const size_t num_refined_vertices = num_ptex_faces << (2 * subdiv->settings.level);
+  return num_refined_vertices * SUBDIV_CACHE_BYTES_PER_REFINED_VERTEX + face_ptex_offset_size;
+}
+
+static bool subdiv_cache_can_reuse(const Subdiv *subdiv,
+                                   const SubdivSettings *settings,
+                                   const OpenSubdiv_Converter *converter)
+{
+  return subdiv->topology_refiner != NULL &&
+         BKE_subdiv_settings_equal(&subdiv->settings, settings) &&
+         openSubdiv_topologyRefinerCompareWithConverter(subdiv->topology_refiner, converter);
+}
+
+static void subdiv_cache_entry_free(SubdivCacheEntry *entry)
+{
+  BLI_mutex_end(&entry->eval_mutex);
+  entry->subdiv->cache_.entry = NULL;
+  BKE_subdiv_free(entry->subdiv);
+  MEM_freeN(entry);
+}
+
+/* Free least recently released descriptors until the memory limit is respected.
+ * Expected to be called with the cache mutex locked. */
+static void subdiv_cache_evict(void)
+{
+  while (subdiv_cache.memory_used > subdiv_cache.memory_limit) {
+    SubdivCacheEntry *entry = subdiv_cache.released_entries.first;
+    BLI_remlink(&subdiv_cache.released_entries, entry);
+    subdiv_cache.memory_used -= entry->memory_size;
+    subdiv_cache.num_evictions++;
+    subdiv_cache_entry_free(entry);
+  }
+}
+
+/* Find most recently added entry for the given settings and topology.
+ * Expected to be called with the cache mutex locked. */
+static SubdivCacheEntry *subdiv_cache_find(ListBase *entries,
+                                           const SubdivSettings *settings,
+                                           const OpenSubdiv_Converter *converter,
+                                           const uint32_t topology_hash)
+{
+  LISTBASE_FOREACH_BACKWARD (SubdivCacheEntry *, entry, entries) {
+    /* Hash collisions are possible, the full comparison is done after the hash matched. */
+    if (entry->subdiv->cache_.topology_hash == topology_hash &&
+        subdiv_cache_can_reuse(entry->subdiv, settings, converter)) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/* Add a user to a descriptor for the given settings and topology, either one which is in use
+ * already or one which was released. */
+static Subdiv *subdiv_cache_acquire(const SubdivSettings *settings,
+                                    const OpenSubdiv_Converter *converter,
+                                    const uint32_t topology_hash)
+{
+  BLI_mutex_lock(&subdiv_cache_mutex);
+  SubdivCacheEntry *entry = subdiv_cache_find(
+      &subdiv_cache.used_entries, settings, converter, topology_hash);
+  if (entry == NULL) {
+    entry = subdiv_cache_find(&subdiv_cache.released_entries, settings, converter, topology_hash);
+    if (entry != NULL) {
+      BLI_remlink(&subdiv_cache.released_entries, entry);
+      subdiv_cache.memory_used -= entry->memory_size;
+      entry->memory_size = 0;
+      BLI_addtail(&subdiv_cache.used_entries, entry);
+    }
+  }
+  if (entry != NULL) {
+    entry->num_users++;
+    subdiv_cache.num_hits++;
+  }
+  else {
+    subdiv_cache.num_misses++;
+  }
+  BLI_mutex_unlock(&subdiv_cache_mutex);
+  return (entry != NULL) ? entry->subdiv : NULL;
+}
+
+/* Make a new descriptor available to others. Other users only compare its topology and evaluate
+ * it, so everything which modifies the descriptor is done before it is added. */
+static void subdiv_cache_add(Subdiv *subdiv, const uint32_t topology_hash)
+{
+  subdiv->cache_.topology_hash = topology_hash;
+  subdiv->cache_.has_topology_hash = true;
+  SubdivCacheEntry *entry = MEM_callocN(sizeof(SubdivCacheEntry), __func__);
+  entry->subdiv = subdiv;
+  entry->num_users = 1;
+  BLI_mutex_init(&entry->eval_mutex);
+  subdiv->cache_.entry = entry;
+  BLI_mutex_lock(&subdiv_cache_mutex);
+  BLI_addtail(&subdiv_cache.used_entries, entry);
+  BLI_mutex_unlock(&subdiv_cache_mutex);
+}
+
+/* =============================== PUBLIC API =============================== */
+
+Subdiv *BKE_subdiv_update_from_mesh_cached(Subdiv *subdiv,
+                                           const SubdivSettings *settings,
+                                           const Mesh *mesh)
+{
+  OpenSubdiv_Converter converter;
+  BKE_subdiv_converter_init_for_mesh(&converter, settings, mesh);
+  if (subdiv != NULL) {
+    if (subdiv_cache_can_reuse(subdiv, settings, &converter)) {
+      BKE_subdiv_converter_free(&converter);
+      return subdiv;
+    }
+    /* Others might still use it, or use it later on. */
+    BKE_subdiv_cache_release(subdiv);
+  }
+  const uint32_t topology_hash = subdiv_cache_topology_hash(&converter);
+  Subdiv *result = subdiv_cache_acquire(settings, &converter, topology_hash);
+  if (result == NULL) {
+    result = BKE_subdiv_new_from_converter(settings, &converter);
+    /* The evaluator refines the topology refiner when it is created, and the ptex offsets are
+     * computed on first access, which can't happen while others use the descriptor. */
+    if (result->topology_refiner != NULL && BKE_subdiv_eval_begin(result)) {
+      BKE_subdiv_face_ptex_offset_get(result);
+      subdiv_cache_add(result, topology_hash);
+    }
+  }
+  BKE_subdiv_converter_free(&converter);
+  return result;
+}
+
+void BKE_subdiv_cache_release(Subdiv *subdiv)
+{
+  SubdivCacheEntry *entry = subdiv->cache_.entry;
+  if (entry == NULL) {
+    BKE_subdiv_free(subdiv);
+    return;
+  }
+  BLI_mutex_lock(&subdiv_cache_mutex);
+  BLI_assert(entry->num_users > 0);
+  entry->num_users--;
+  if (entry->num_users == 0) {
+    /* Displacement is specific to the object which used the descriptor. */
+    BKE_subdiv_displacement_detach(subdiv);
+    BLI_remlink(&subdiv_cache.used_entries, entry);
+    entry->memory_size = subdiv_cache_memory_estimate(subdiv);
+    BLI_addtail(&subdiv_cache.released_entries, entry);
+    subdiv_cache.memory_used += entry->memory_size;
+    subdiv_cache_evict();
+  }
+  BLI_mutex_unlock(&subdiv_cache_mutex);
+}
+
+void BKE_subdiv_cache_eval_lock(Subdiv *subdiv)
+{
+  if (subdiv->cache_.entry != NULL) {
+    BLI_mutex_lock(&subdiv->cache_.entry->eval_mutex);
+  }
+}
+
+void BKE_subdiv_cache_eval_unlock(Subdiv *subdiv)
+{
+  if (subdiv->cache_.entry != NULL) {
+    BLI_mutex_unlock(&subdiv->cache_.entry->eval_mutex);
+  }
+}
+
+void BKE_subdiv_cache_clear(void)
+{
+  BLI_mutex_lock(&subdiv_cache_mutex);
+  LISTBASE_FOREACH_MUTABLE (SubdivCacheEntry *, entry, &subdiv_cache.released_entries) {
+    subdiv_cache_entry_free(entry);
+  }
+  BLI_listbase_clear(&subdiv_cache.released_entries);
+  subdiv_cache.memory_used = 0;
+  BLI_mutex_unlock(&subdiv_cache_mutex);
+}
+
+void BKE_subdiv_cache_memory_limit_set(size_t memory_limit)
+{
+  BLI_mutex_lock(&subdiv_cache_mutex);
+  subdiv_cache.memory_limit = memory_limit;
+  subdiv_cache_evict();
+  BLI_mutex_unlock(&subdiv_cache_mutex);
+}
+
+void BKE_subdiv_cache_stats_get(SubdivCacheStats *r_stats)
+{
+  BLI_mutex_lock(&subdiv_cache_mutex);
+  r_stats->num_hits = subdiv_cache.num_hits;
+  r_stats->num_misses = subdiv_cache.num_misses;
+  r_stats->num_evictions = subdiv_cache.num_evictions;
+  r_stats->num_used = 0;
+  r_stats->num_users = 0;
+  LISTBASE_FOREACH (const SubdivCacheEntry *, entry, &subdiv_cache.used_entries) {
+    r_stats->num_used++;
+    r_stats->num_users += entry->num_users;
+  }
+  r_stats->num_entries = BLI_listbase_count(&subdiv_cache.released_entries);
+  r_stats->memory_used = subdiv_cache.memory_used;
+  r_stats->memory_limit = subdiv_cache.memory_limit;
+  BLI_mutex_unlock(&subdiv_cache_mutex);
+}
+
+void BKE_subdiv_cache_stats_print(void)
+{
+  SubdivCacheStats stats;
+  BKE_subdiv_cache_stats_get(&stats);
+  printf("Subdivision surface descriptors cache statistics:\n");
+  printf("  Hits: %d, misses: %d, evictions: %d\n",
+         stats.num_hits,
+         stats.num_misses,
+         stats.num_evictions);
+  printf("  Used: %d, users: %d\n", stats.num_used, stats.num_users);
+  printf("  Released: %d, memory: %zu of %zu (bytes)\n",
+         stats.num_entries,
+         stats.memory_used,
+         stats.memory_limit);
+}
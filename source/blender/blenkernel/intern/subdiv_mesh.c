@@ -41,6 +41,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "opensubdiv_capi_type.h"
+
 /* -------------------------------------------------------------------- */
 /** \name Subdivision Context
  * \{ */
@@ -425,7 +427,23 @@ static void loop_interpolation_end(LoopsForInterpolation *loop_interpolation)
 /** \name TLS
  * \{ */
 
+/* Inner vertices are evaluated in batches, so that the evaluator is not called for every single
+ * vertex. Their positions and normals are written once a batch is full or the TLS is freed. */
+#define SUBDIV_MESH_EVAL_BATCH_SIZE 256
+
+typedef struct SubdivMeshEvalBatch {
+  SubdivMeshContext *ctx;
+  int num_vertices;
+  OpenSubdiv_PatchCoord *patch_coords;
+  int *subdiv_vertex_indices;
+  float (*P)[3];
+  float (*dPdu)[3];
+  float (*dPdv)[3];
+} SubdivMeshEvalBatch;
+
 typedef struct SubdivMeshTLS {
+  SubdivMeshEvalBatch eval_batch;
+
   bool vertex_interpolation_initialized;
   VerticesForInterpolation vertex_interpolation;
   const MPoly *vertex_interpolation_coarse_poly;
@@ -437,9 +455,22 @@ typedef struct SubdivMeshTLS {
   int loop_interpolation_coarse_corner;
 } SubdivMeshTLS;
 
+static void subdiv_mesh_eval_batch_flush(SubdivMeshEvalBatch *batch);
+
+static void subdiv_mesh_eval_batch_free(SubdivMeshEvalBatch *batch)
+{
+  subdiv_mesh_eval_batch_flush(batch);
+  MEM_SAFE_FREE(batch->patch_coords);
+  MEM_SAFE_FREE(batch->subdiv_vertex_indices);
+  MEM_SAFE_FREE(batch->P);
+  MEM_SAFE_FREE(batch->dPdu);
+  MEM_SAFE_FREE(batch->dPdv);
+}
+
 static void subdiv_mesh_tls_free(void *tls_v)
 {
   SubdivMeshTLS *tls = tls_v;
+  subdiv_mesh_eval_batch_free(&tls->eval_batch);
   if (tls->vertex_interpolation_initialized) {
     vertex_interpolation_end(&tls->vertex_interpolation);
   }
@@ -454,21 +485,72 @@ static void subdiv_mesh_tls_free(void *tls_v)
 /** \name Evaluation helper functions
  * \{ */
 
-static void eval_final_point_and_vertex_normal(Subdiv *subdiv,
-                                               const int ptex_face_index,
-                                               const float u,
-                                               const float v,
-                                               float r_P[3],
-                                               short r_N[3])
+static void subdiv_mesh_eval_batch_add(SubdivMeshContext *ctx,
+                                       SubdivMeshEvalBatch *batch,
+                                       const int ptex_face_index,
+                                       const float u,
+                                       const float v,
+                                       const int subdiv_vertex_index)
 {
-  if (subdiv->displacement_evaluator == NULL) {
-    BKE_subdiv_eval_limit_point_and_short_normal(subdiv, ptex_face_index, u, v, r_P, r_N);
+  if (batch->patch_coords == NULL) {
+    batch->ctx = ctx;
+    batch->patch_coords = MEM_malloc_arrayN(
+        SUBDIV_MESH_EVAL_BATCH_SIZE, sizeof(OpenSubdiv_PatchCoord), "subdiv batch patch coords");
+    batch->subdiv_vertex_indices = MEM_malloc_arrayN(
+        SUBDIV_MESH_EVAL_BATCH_SIZE, sizeof(int), "subdiv batch vertex indices");
+    batch->P = MEM_malloc_arrayN(SUBDIV_MESH_EVAL_BATCH_SIZE, sizeof(float[3]), "subdiv batch P");
+    batch->dPdu = MEM_malloc_arrayN(
+        SUBDIV_MESH_EVAL_BATCH_SIZE, sizeof(float[3]), "subdiv batch dPdu");
+    batch->dPdv = MEM_malloc_arrayN(
+        SUBDIV_MESH_EVAL_BATCH_SIZE, sizeof(float[3]), "subdiv batch dPdv");
   }
-  else {
-    BKE_subdiv_eval_final_point(subdiv, ptex_face_index, u, v, r_P);
+  OpenSubdiv_PatchCoord *patch_coord = &batch->patch_coords[batch->num_vertices];
+  patch_coord->ptex_face = ptex_face_index;
+  patch_coord->u = u;
+  patch_coord->v = v;
+  batch->subdiv_vertex_indices[batch->num_vertices] = subdiv_vertex_index;
+  batch->num_vertices++;
+  if (batch->num_vertices == SUBDIV_MESH_EVAL_BATCH_SIZE) {
+    subdiv_mesh_eval_batch_flush(batch);
   }
 }
 
+/* Final position of the vertices of the batch. Their normal is the limit surface normal, unless
+ * there is displacement, then normals are calculated from the final mesh. */
+static void subdiv_mesh_eval_batch_flush(SubdivMeshEvalBatch *batch)
+{
+  if (batch->num_vertices == 0) {
+    return;
+  }
+  Subdiv *subdiv = batch->ctx->subdiv;
+  MVert *subdiv_mvert = batch->ctx->subdiv_mesh->mvert;
+  BKE_subdiv_eval_limit_points_and_derivatives(
+      subdiv, batch->patch_coords, batch->num_vertices, batch->P, batch->dPdu, batch->dPdv);
+  for (int i = 0; i < batch->num_vertices; i++) {
+    MVert *subdiv_vert = &subdiv_mvert[batch->subdiv_vertex_indices[i]];
+    if (subdiv->displacement_evaluator == NULL) {
+      float N[3];
+      copy_v3_v3(subdiv_vert->co, batch->P[i]);
+      cross_v3_v3v3(N, batch->dPdu[i], batch->dPdv[i]);
+      normalize_v3(N);
+      normal_float_to_short_v3(subdiv_vert->no, N);
+    }
+    else {
+      const OpenSubdiv_PatchCoord *patch_coord = &batch->patch_coords[i];
+      float D[3];
+      BKE_subdiv_eval_displacement(subdiv,
+                                   patch_coord->ptex_face,
+                                   patch_coord->u,
+                                   patch_coord->v,
+                                   batch->dPdu[i],
+                                   batch->dPdv[i],
+                                   D);
+      add_v3_v3v3(subdiv_vert->co, batch->P[i], D);
+    }
+  }
+  batch->num_vertices = 0;
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -783,7 +865,6 @@ static void subdiv_mesh_vertex_inner(const SubdivForeachContext *foreach_context
 {
   SubdivMeshContext *ctx = foreach_context->user_data;
   SubdivMeshTLS *tls = tls_v;
-  Subdiv *subdiv = ctx->subdiv;
   const Mesh *coarse_mesh = ctx->coarse_mesh;
   const MPoly *coarse_mpoly = coarse_mesh->mpoly;
   const MPoly *coarse_poly = &coarse_mpoly[coarse_poly_index];
@@ -792,8 +873,7 @@ static void subdiv_mesh_vertex_inner(const SubdivForeachContext *foreach_context
   MVert *subdiv_vert = &subdiv_mvert[subdiv_vertex_index];
   subdiv_mesh_ensure_vertex_interpolation(ctx, tls, coarse_poly, coarse_corner);
   subdiv_vertex_data_interpolate(ctx, subdiv_vert, &tls->vertex_interpolation, u, v);
-  eval_final_point_and_vertex_normal(
-      subdiv, ptex_face_index, u, v, subdiv_vert->co, subdiv_vert->no);
+  subdiv_mesh_eval_batch_add(ctx, &tls->eval_batch, ptex_face_index, u, v, subdiv_vertex_index);
   subdiv_mesh_tag_center_vertex(coarse_poly, subdiv_vert, u, v);
 }
 
@@ -177,7 +177,7 @@ static bool undosys_step_encode(bContext *C, Main *bmain, UndoStack *ustack, Und
   return ok;
 }
 
-static void undosys_step_decode(bContext *C,
+static bool undosys_step_decode(bContext *C,
                                 Main *bmain,
                                 UndoStack *ustack,
                                 UndoStep *us,
@@ -197,7 +197,9 @@ static void undosys_step_decode(bContext *C,
           else {
             /* Load the previous memfile state so any ID's referenced in this
              * undo step will be correctly resolved, see: T56163. */
-            undosys_step_decode(C, bmain, ustack, us_iter, dir, false);
+            if (!undosys_step_decode(C, bmain, ustack, us_iter, dir, false)) {
+              return false;
+            }
             /* May have been freed on memfile read. */
             bmain = G_MAIN;
           }
@@ -212,14 +214,18 @@ static void undosys_step_decode(bContext *C,
   }
 
   UNDO_NESTED_CHECK_BEGIN;
-  us->type->step_decode(C, bmain, us, dir, is_final);
+  const bool success = us->type->step_decode(C, bmain, us, dir, is_final);
   UNDO_NESTED_CHECK_END;
+  if (!success) {
+    return false;
+  }
 
 #ifdef WITH_GLOBAL_UNDO_CORRECT_ORDER
   if (us->type == BKE_UNDOSYS_TYPE_MEMFILE) {
     ustack->step_active_memfile = us;
   }
 #endif
+  return true;
 }
 
 static void undosys_step_free_and_unlink(UndoStack *ustack, UndoStep *us)
@@ -824,7 +830,15 @@ bool BKE_undosys_step_load_data_ex(UndoStack *ustack,
                 us_iter->type->name);
     }
 
-    undosys_step_decode(C, G_MAIN, ustack, us_iter, undo_dir, is_final);
+    if (!undosys_step_decode(C, G_MAIN, ustack, us_iter, undo_dir, is_final)) {
+      /* The active step stays the last one which was loaded. */
+      CLOG_ERROR(&LOG,
+                 "failed to load step addr=%p, name='%s', type='%s'",
+                 us_iter,
+                 us_iter->name,
+                 us_iter->type->name);
+      return false;
+    }
     ustack->step_active = us_iter;
 
     if (us_iter == us_target) {
@@ -41,10 +41,22 @@ typedef enum eExprPyLike_EvalStatus {
   EXPR_PYLIKE_FATAL_ERROR,
 } eExprPyLike_EvalStatus;
 
+/** Reason why an expression could not be parsed. */
+typedef enum eExprPyLike_ParseError {
+  EXPR_PYLIKE_PARSE_OK = 0,
+  /* A name that is neither a parameter nor a supported constant or function. */
+  EXPR_PYLIKE_PARSE_UNKNOWN_NAME,
+  /* A supported function called with a wrong number of arguments. */
+  EXPR_PYLIKE_PARSE_FUNCTION_ARGS,
+  /* Invalid syntax, or syntax outside of the supported subset. */
+  EXPR_PYLIKE_PARSE_SYNTAX,
+} eExprPyLike_ParseError;
+
 void BLI_expr_pylike_free(struct ExprPyLike_Parsed *expr);
 bool BLI_expr_pylike_is_valid(struct ExprPyLike_Parsed *expr);
 bool BLI_expr_pylike_is_constant(struct ExprPyLike_Parsed *expr);
 bool BLI_expr_pylike_is_using_param(struct ExprPyLike_Parsed *expr, int index);
+eExprPyLike_ParseError BLI_expr_pylike_parse_error(struct ExprPyLike_Parsed *expr);
 ExprPyLike_Parsed *BLI_expr_pylike_parse(const char *expression,
                                          const char **param_names,
                                          int param_names_len);
@@ -0,0 +1,81 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ * \brief Temporary file to move data out of memory.
+ *
+ * Every page holds one compressed buffer. The space of released pages is reused by the pages
+ * written after them.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "BLI_compiler_attrs.h"
+#include "BLI_utildefines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct PageFile PageFile;
+
+typedef struct PageFilePage {
+  int64_t offset;
+  /** Size of the compressed data in the file. */
+  size_t size_compressed;
+  /** Size of the data in memory. */
+  size_t size;
+} PageFilePage;
+
+/**
+ * Create the file, an existing file is overwritten.
+ * \return NULL when the file can't be created.
+ */
+PageFile *BLI_page_file_create(const char *filepath,
+                               int compression_level) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
+/**
+ * Close and delete the file.
+ */
+void BLI_page_file_free(PageFile *page_file) ATTR_NONNULL();
+
+/**
+ * \return false when the data could not be written, nothing is stored then.
+ */
+bool BLI_page_file_write(PageFile *page_file, const void *data, size_t size, PageFilePage *r_page)
+    ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
+/**
+ * Read the data of the page into \a r_data, which holds `page->size` bytes.
+ * \return false when the page could not be read back, e.g. because the file was modified.
+ */
+bool BLI_page_file_read(PageFile *page_file, const PageFilePage *page, void *r_data)
+    ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
+/**
+ * Make the space of the page available for later pages.
+ */
+void BLI_page_file_release(PageFile *page_file, const PageFilePage *page) ATTR_NONNULL();
+
+/**
+ * Size of the file up to the end of the last page which was not released.
+ */
+int64_t BLI_page_file_size(const PageFile *page_file) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
+
+#ifdef __cplusplus
+}
+#endif
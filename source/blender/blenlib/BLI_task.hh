@@ -67,6 +67,11 @@ void parallel_for(IndexRange range, int64_t grain_size, const Function &function
     return;
   }
 #ifdef WITH_TBB
+  /* Invoking tbb for small workloads has a large overhead. */
+  if (range.size() <= grain_size) {
+    function(range);
+    return;
+  }
   tbb::parallel_for(tbb::blocked_range<int64_t>(range.first(), range.one_after_last(), grain_size),
                     [&](const tbb::blocked_range<int64_t> &subrange) {
                       function(IndexRange(subrange.begin(), subrange.size()));
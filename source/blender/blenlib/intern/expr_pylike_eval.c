@@ -29,14 +29,16 @@
  *  - Literals:
  *      floating point and decimal integer.
  *  - Constants:
- *      pi, True, False
+ *      pi, e, tau, inf, True, False
  *  - Operators:
- *      +, -, *, /, ==, !=, <, <=, >, >=, and, or, not, ternary if
+ *      +, -, *, /, //, %, **, ==, !=, <, <=, >, >=, and, or, not, ternary if
  *  - Functions:
  *      min, max, radians, degrees,
- *      abs, fabs, floor, ceil, trunc, int,
- *      sin, cos, tan, asin, acos, atan, atan2,
- *      exp, log, sqrt, pow, fmod
+ *      abs, fabs, floor, ceil, trunc, round, int, float, bool,
+ *      sin, cos, tan, asin, acos, atan, atan2, hypot,
+ *      sinh, cosh, tanh, asinh, acosh, atanh,
+ *      exp, log, log10, log2, sqrt, pow, fmod, copysign,
+ *      lerp, clamp, smoothstep
  *
  * The implementation has no global state and can be used multi-threaded.
  */
@@ -114,6 +116,7 @@ typedef struct ExprOp {
 struct ExprPyLike_Parsed {
   int ops_count;
   int max_stack;
+  eExprPyLike_ParseError parse_error;
 
   ExprOp ops[];
 };
@@ -162,6 +165,15 @@ bool BLI_expr_pylike_is_using_param(ExprPyLike_Parsed *expr, int index)
   return false;
 }
 
+/** Get the reason why parsing failed, for valid expressions this is #EXPR_PYLIKE_PARSE_OK. */
+eExprPyLike_ParseError BLI_expr_pylike_parse_error(ExprPyLike_Parsed *expr)
+{
+  if (expr == NULL) {
+    return EXPR_PYLIKE_PARSE_SYNTAX;
+  }
+  return expr->parse_error;
+}
+
 /** \} */
 
 /* -------------------------------------------------------------------- */
@@ -325,6 +337,43 @@ static double op_sub(double a, double b)
   return a - b;
 }
 
+/* Python floor division: derive the quotient from the modulo like CPython does, so that
+ * `a == (a // b) * b + a % b` holds even when `a / b` is rounded up to an integer,
+ * e.g. `1 // 0.1` is 9 and not 10. */
+static double op_floordiv(double a, double b)
+{
+  if (b == 0.0) {
+    /* Raise the same floating point exceptions as a regular division. */
+    return a / b;
+  }
+
+  double mod = fmod(a, b);
+  double div = (a - mod) / b;
+  if (mod != 0.0 && ((mod < 0.0) != (b < 0.0))) {
+    div -= 1.0;
+  }
+
+  if (div == 0.0) {
+    return copysign(0.0, a / b);
+  }
+
+  double floordiv = floor(div);
+  if (div - floordiv > 0.5) {
+    floordiv += 1.0;
+  }
+  return floordiv;
+}
+
+/* Python modulo: the result has the sign of the divisor. */
+static double op_mod(double a, double b)
+{
+  double r = fmod(a, b);
+  if (r != 0.0 && ((r < 0.0) != (b < 0.0))) {
+    r += b;
+  }
+  return r;
+}
+
 static double op_radians(double arg)
 {
   return arg * M_PI / 180.0;
@@ -340,6 +389,16 @@ static double op_log2(double a, double b)
   return log(a) / log(b);
 }
 
+static double op_float(double arg)
+{
+  return arg;
+}
+
+static double op_bool(double arg)
+{
+  return arg != 0.0 ? 1.0 : 0.0;
+}
+
 static double op_lerp(double a, double b, double x)
 {
   return a * (1.0 - x) + b * x;
@@ -405,7 +464,14 @@ typedef struct BuiltinConstDef {
 } BuiltinConstDef;
 
 static BuiltinConstDef builtin_consts[] = {
-    {"pi", M_PI}, {"True", 1.0}, {"False", 0.0}, {NULL, 0.0}};
+    {"pi", M_PI},
+    {"e", M_E},
+    {"tau", 2.0 * M_PI},
+    {"inf", INFINITY},
+    {"True", 1.0},
+    {"False", 0.0},
+    {NULL, 0.0},
+};
 
 typedef struct BuiltinOpDef {
   const char *name;
@@ -430,6 +496,8 @@ static BuiltinOpDef builtin_ops[] = {
     {"trunc", OPCODE_FUNC1, trunc},
     {"round", OPCODE_FUNC1, round},
     {"int", OPCODE_FUNC1, trunc},
+    {"float", OPCODE_FUNC1, op_float},
+    {"bool", OPCODE_FUNC1, op_bool},
     {"sin", OPCODE_FUNC1, sin},
     {"cos", OPCODE_FUNC1, cos},
     {"tan", OPCODE_FUNC1, tan},
@@ -437,12 +505,22 @@ static BuiltinOpDef builtin_ops[] = {
     {"acos", OPCODE_FUNC1, acos},
     {"atan", OPCODE_FUNC1, atan},
     {"atan2", OPCODE_FUNC2, atan2},
+    {"hypot", OPCODE_FUNC2, hypot},
+    {"sinh", OPCODE_FUNC1, sinh},
+    {"cosh", OPCODE_FUNC1, cosh},
+    {"tanh", OPCODE_FUNC1, tanh},
+    {"asinh", OPCODE_FUNC1, asinh},
+    {"acosh", OPCODE_FUNC1, acosh},
+    {"atanh", OPCODE_FUNC1, atanh},
     {"exp", OPCODE_FUNC1, exp},
     {"log", OPCODE_FUNC1, log},
     {"log", OPCODE_FUNC2, op_log2},
+    {"log10", OPCODE_FUNC1, log10},
+    {"log2", OPCODE_FUNC1, log2},
     {"sqrt", OPCODE_FUNC1, sqrt},
     {"pow", OPCODE_FUNC2, pow},
     {"fmod", OPCODE_FUNC2, fmod},
+    {"copysign", OPCODE_FUNC2, copysign},
     {"lerp", OPCODE_FUNC3, op_lerp},
     {"clamp", OPCODE_FUNC1, op_clamp},
     {"clamp", OPCODE_FUNC3, op_clamp3},
@@ -472,6 +550,8 @@ static BuiltinOpDef builtin_ops[] = {
 #define TOKEN_LE MAKE_CHAR2('<', '=')
 #define TOKEN_NE MAKE_CHAR2('!', '=')
 #define TOKEN_EQ MAKE_CHAR2('=', '=')
+#define TOKEN_POW MAKE_CHAR2('*', '*')
+#define TOKEN_FLOORDIV MAKE_CHAR2('/', '/')
 #define TOKEN_AND MAKE_CHAR2('A', 'N')
 #define TOKEN_OR MAKE_CHAR2('O', 'R')
 #define TOKEN_NOT MAKE_CHAR2('N', 'O')
@@ -479,6 +559,7 @@ static BuiltinOpDef builtin_ops[] = {
 #define TOKEN_ELSE MAKE_CHAR2('E', 'L')
 
 static const char *token_eq_characters = "!=><";
+static const char *token_double_characters = "*/";
 static const char *token_characters = "~`!@#$%^&*+-=/\\?:;<>(){}[]|.,\"'";
 
 typedef struct KeywordTokenDef {
@@ -514,8 +595,20 @@ typedef struct ExprParseState {
 
   /* Stack space requirement tracking */
   int stack_ptr, max_stack;
+
+  /* First error found while parsing. */
+  eExprPyLike_ParseError error;
 } ExprParseState;
 
+/* Remember the reason of a parse failure, keeping the innermost error. */
+static bool parse_set_error(ExprParseState *state, eExprPyLike_ParseError error)
+{
+  if (state->error == EXPR_PYLIKE_PARSE_OK) {
+    state->error = error;
+  }
+  return false;
+}
+
 /* Reserve space for the specified number of operations in the buffer. */
 static ExprOp *parse_alloc_ops(ExprParseState *state, int count)
 {
@@ -580,6 +673,10 @@ static bool parse_add_func(ExprParseState *state, eOpCode code, int args, void *
   ExprOp *prev_ops = &state->ops[state->ops_count];
   int jmp_gap = state->ops_count - state->last_jmp;
 
+  if (args != opcode_arg_count(code)) {
+    return parse_set_error(state, EXPR_PYLIKE_PARSE_FUNCTION_ARGS);
+  }
+
   feclearexcept(FE_ALL_EXCEPT);
 
   switch (code) {
@@ -720,6 +817,13 @@ static bool parse_next_token(ExprParseState *state)
     return true;
   }
 
+  /* Doubled operator tokens: ** and // */
+  if (state->cur[1] == state->cur[0] && strchr(token_double_characters, state->cur[0])) {
+    state->token = MAKE_CHAR2(state->cur[0], state->cur[1]);
+    state->cur += 2;
+    return true;
+  }
+
   /* Special characters (single character tokens) */
   if (strchr(token_characters, *state->cur)) {
     state->token = *state->cur++;
@@ -792,19 +896,11 @@ static int parse_function_args(ExprParseState *state)
   }
 }
 
-static bool parse_unary(ExprParseState *state)
+static bool parse_primary(ExprParseState *state)
 {
   int i;
 
   switch (state->token) {
-    case '+':
-      return parse_next_token(state) && parse_unary(state);
-
-    case '-':
-      CHECK_ERROR(parse_next_token(state) && parse_unary(state));
-      parse_add_func(state, OPCODE_FUNC1, 1, op_negate);
-      return true;
-
     case '(':
       return parse_next_token(state) && parse_expr(state) && state->token == ')' &&
              parse_next_token(state);
@@ -835,6 +931,7 @@ static bool parse_unary(ExprParseState *state)
       for (i = 0; builtin_ops[i].name; i++) {
         if (STREQ(state->tokenbuf, builtin_ops[i].name)) {
           int args = parse_function_args(state);
+          CHECK_ERROR(args >= 0);
 
           /* Search for other arg count versions if necessary. */
           if (args != opcode_arg_count(builtin_ops[i].op)) {
@@ -868,13 +965,44 @@ static bool parse_unary(ExprParseState *state)
         return true;
       }
 
-      return false;
+      return parse_set_error(state, EXPR_PYLIKE_PARSE_UNKNOWN_NAME);
 
     default:
       return false;
   }
 }
 
+static bool parse_unary(ExprParseState *state);
+
+static bool parse_power(ExprParseState *state)
+{
+  CHECK_ERROR(parse_primary(state));
+
+  /* Right associative, and binds tighter than a unary operator on the left: -2**2 == -4. */
+  if (state->token == TOKEN_POW) {
+    CHECK_ERROR(parse_next_token(state) && parse_unary(state));
+    parse_add_func(state, OPCODE_FUNC2, 2, pow);
+  }
+
+  return true;
+}
+
+static bool parse_unary(ExprParseState *state)
+{
+  switch (state->token) {
+    case '+':
+      return parse_next_token(state) && parse_unary(state);
+
+    case '-':
+      CHECK_ERROR(parse_next_token(state) && parse_unary(state));
+      parse_add_func(state, OPCODE_FUNC1, 1, op_negate);
+      return true;
+
+    default:
+      return parse_power(state);
+  }
+}
+
 static bool parse_mul(ExprParseState *state)
 {
   CHECK_ERROR(parse_unary(state));
@@ -891,6 +1019,16 @@ static bool parse_mul(ExprParseState *state)
         parse_add_func(state, OPCODE_FUNC2, 2, op_div);
         break;
 
+      case TOKEN_FLOORDIV:
+        CHECK_ERROR(parse_next_token(state) && parse_unary(state));
+        parse_add_func(state, OPCODE_FUNC2, 2, op_floordiv);
+        break;
+
+      case '%':
+        CHECK_ERROR(parse_next_token(state) && parse_unary(state));
+        parse_add_func(state, OPCODE_FUNC2, 2, op_mod);
+        break;
+
       default:
         return true;
     }
@@ -1109,11 +1247,15 @@ ExprPyLike_Parsed *BLI_expr_pylike_parse(const char *expression,
     expr->ops_count = state.ops_count;
     expr->max_stack = state.max_stack;
 
+    expr->parse_error = EXPR_PYLIKE_PARSE_OK;
+
     memcpy(expr->ops, state.ops, state.ops_count * sizeof(ExprOp));
   }
   else {
     /* Always return a non-NULL object so that parse failure can be cached. */
     expr = MEM_callocN(sizeof(ExprPyLike_Parsed), "ExprPyLike_Parsed(empty)");
+    expr->parse_error = (state.error != EXPR_PYLIKE_PARSE_OK) ? state.error :
+                                                                EXPR_PYLIKE_PARSE_SYNTAX;
   }
 
   MEM_freeN(state.tokenbuf);
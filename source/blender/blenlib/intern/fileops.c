@@ -65,7 +65,9 @@
 size_t BLI_file_zstd_from_mem_at_pos(
     void *buf, size_t len, FILE *file, size_t file_offset, int compression_level)
 {
-  fseek(file, file_offset, SEEK_SET);
+  if (BLI_fseek(file, (int64_t)file_offset, SEEK_SET) != 0) {
+    return 0;
+  }
 
   ZSTD_CCtx *ctx = ZSTD_createCCtx();
   ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, compression_level);
@@ -111,7 +113,9 @@ size_t BLI_file_zstd_from_mem_at_pos(
 
 size_t BLI_file_unzstd_to_mem_at_pos(void *buf, size_t len, FILE *file, size_t file_offset)
 {
-  fseek(file, file_offset, SEEK_SET);
+  if (BLI_fseek(file, (int64_t)file_offset, SEEK_SET) != 0) {
+    return 0;
+  }
 
   ZSTD_DCtx *ctx = ZSTD_createDCtx();
 
@@ -0,0 +1,174 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup bli
+ */
+
+#include <stdio.h>
+
+#include <zstd.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_fileops.h"
+#include "BLI_listbase.h"
+#include "BLI_page_file.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+
+typedef struct PageFileRange {
+  struct PageFileRange *next, *prev;
+  int64_t offset;
+  size_t size;
+} PageFileRange;
+
+struct PageFile {
+  FILE *file;
+  char filepath[FILE_MAX];
+  int compression_level;
+  /** End of the last page which was not released. */
+  int64_t size;
+  /** Released space before #size, sorted by offset, adjacent ranges are merged. */
+  ListBase free_ranges;
+};
+
+PageFile *BLI_page_file_create(const char *filepath, const int compression_level)
+{
+  FILE *file = BLI_fopen(filepath, "w+b");
+  if (file == NULL) {
+    return NULL;
+  }
+  PageFile *page_file = MEM_callocN(sizeof(PageFile), __func__);
+  page_file->file = file;
+  BLI_strncpy(page_file->filepath, filepath, sizeof(page_file->filepath));
+  page_file->compression_level = compression_level;
+  return page_file;
+}
+
+void BLI_page_file_free(PageFile *page_file)
+{
+  fclose(page_file->file);
+  BLI_delete(page_file->filepath, false, false);
+  BLI_freelistN(&page_file->free_ranges);
+  MEM_freeN(page_file);
+}
+
+/* Find space for a page: the first released range it fits in, or the end of the file. */
+static int64_t page_file_allocate(PageFile *page_file, const size_t size)
+{
+  LISTBASE_FOREACH (PageFileRange *, range, &page_file->free_ranges) {
+    if (range->size >= size) {
+      const int64_t offset = range->offset;
+      range->offset += (int64_t)size;
+      range->size -= size;
+      if (range->size == 0) {
+        BLI_freelinkN(&page_file->free_ranges, range);
+      }
+      return offset;
+    }
+  }
+  const int64_t offset = page_file->size;
+  page_file->size += (int64_t)size;
+  return offset;
+}
+
+static void page_file_range_release(PageFile *page_file, const int64_t offset, const size_t size)
+{
+  PageFileRange *range_next = page_file->free_ranges.first;
+  while (range_next != NULL && range_next->offset < offset) {
+    range_next = range_next->next;
+  }
+  PageFileRange *range_prev = (range_next != NULL) ? range_next->prev :
+                                                     page_file->free_ranges.last;
+
+  PageFileRange *range;
+  if (range_prev != NULL && range_prev->offset + (int64_t)range_prev->size == offset) {
+    range = range_prev;
+    range->size += size;
+  }
+  else {
+    range = MEM_callocN(sizeof(PageFileRange), __func__);
+    range->offset = offset;
+    range->size = size;
+    BLI_insertlinkbefore(&page_file->free_ranges, range_next, range);
+  }
+  if (range_next != NULL && range->offset + (int64_t)range->size == range_next->offset) {
+    range->size += range_next->size;
+    BLI_freelinkN(&page_file->free_ranges, range_next);
+  }
+
+  /* Space at the end of the file is not kept as a range, the next page is written there. */
+  if (range->offset + (int64_t)range->size == page_file->size) {
+    page_file->size = range->offset;
+    BLI_freelinkN(&page_file->free_ranges, range);
+  }
+}
+
+bool BLI_page_file_write(PageFile *page_file,
+                         const void *data,
+                         const size_t size,
+                         PageFilePage *r_page)
+{
+  const size_t buffer_size = ZSTD_compressBound(size);
+  void *buffer = MEM_mallocN(buffer_size, __func__);
+  const size_t size_compressed = ZSTD_compress(
+      buffer, buffer_size, data, size, page_file->compression_level);
+  if (ZSTD_isError(size_compressed)) {
+    MEM_freeN(buffer);
+    return false;
+  }
+
+  const int64_t offset = page_file_allocate(page_file, size_compressed);
+  /* Flush to find out about a full disk right away. */
+  const bool success = BLI_fseek(page_file->file, offset, SEEK_SET) == 0 &&
+                       fwrite(buffer, 1, size_compressed, page_file->file) == size_compressed &&
+                       fflush(page_file->file) == 0;
+  MEM_freeN(buffer);
+  if (!success) {
+    page_file_range_release(page_file, offset, size_compressed);
+    return false;
+  }
+
+  r_page->offset = offset;
+  r_page->size_compressed = size_compressed;
+  r_page->size = size;
+  return true;
+}
+
+bool BLI_page_file_read(PageFile *page_file, const PageFilePage *page, void *r_data)
+{
+  void *buffer = MEM_mallocN(page->size_compressed, __func__);
+  bool success = BLI_fseek(page_file->file, page->offset, SEEK_SET) == 0 &&
+                 fread(buffer, 1, page->size_compressed, page_file->file) ==
+                     page->size_compressed;
+  if (success) {
+    const size_t size = ZSTD_decompress(r_data, page->size, buffer, page->size_compressed);
+    success = !ZSTD_isError(size) && size == page->size;
+  }
+  MEM_freeN(buffer);
+  return success;
+}
+
+void BLI_page_file_release(PageFile *page_file, const PageFilePage *page)
+{
+  page_file_range_release(page_file, page->offset, page->size_compressed);
+}
+
+int64_t BLI_page_file_size(const PageFile *page_file)
+{
+  return page_file->size;
+}
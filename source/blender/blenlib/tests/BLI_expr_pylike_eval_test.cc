@@ -111,6 +111,8 @@ TEST_PARSE_FAIL(Truncated7, "1 and")
 TEST_PARSE_FAIL(Truncated8, "1 or")
 TEST_PARSE_FAIL(Truncated9, "sqrt(1")
 TEST_PARSE_FAIL(Truncated10, "fmod(1,")
+TEST_PARSE_FAIL(Truncated11, "2 **")
+TEST_PARSE_FAIL(TripleStar, "2 *** 2")
 
 /* Constant expression with working constant folding */
 #define TEST_CONST(name, str, value) \
@@ -143,6 +145,9 @@ TEST_CONST(TenE, "1.e+1", 10.0)
 TEST_CONST(Half, ".5", 0.5)
 
 TEST_CONST(Pi, "pi", M_PI)
+TEST_CONST(E, "e", M_E)
+TEST_CONST(Tau, "tau", 2.0 * M_PI)
+TEST_CONST(Inf, "-inf < -1e300", TRUE_VAL)
 TEST_CONST(True, "True", TRUE_VAL)
 TEST_CONST(False, "False", FALSE_VAL)
 
@@ -181,6 +186,17 @@ TEST_CONST(Smoothstep4, "smoothstep(-10,10,20)", 1.0)
 TEST_CONST(Smoothstep5, "smoothstep(-10,10,-5)", 0.15625)
 TEST_EVAL(Smoothstep1, "smoothstep(-10,10,x)", 5, 0.84375)
 
+TEST_CONST(Hypot, "hypot(3, 4)", 5.0)
+TEST_CONST(CopySign, "copysign(2, -0.5)", -2.0)
+TEST_CONST(Log10, "log10(1000)", 3.0)
+TEST_CONST(Log2, "log2(8)", 3.0)
+TEST_CONST(Sinh, "sinh(0)", 0.0)
+TEST_CONST(Cosh, "cosh(0)", 1.0)
+TEST_CONST(Tanh, "tanh(0)", 0.0)
+TEST_EVAL(Float, "float(x)", 0.5, 0.5)
+TEST_EVAL(Bool1, "bool(x)", -2.0, TRUE_VAL)
+TEST_EVAL(Bool2, "bool(x)", 0.0, FALSE_VAL)
+
 TEST_RESULT(Min1, "min(3,1,2)", 1.0)
 TEST_RESULT(Max1, "max(3,1,2)", 3.0)
 TEST_RESULT(Min2, "min(1,2,3)", 1.0)
@@ -212,6 +228,26 @@ TEST_CONST(Arith4, "3 * (-2 + 1)", -3.0)
 
 TEST_EVAL(Arith1, "1 + -x * 3", 2, -5.0)
 
+TEST_CONST(Power1, "2 ** 3", 8.0)
+TEST_CONST(Power2, "-2 ** 2", -4.0)
+TEST_CONST(Power3, "2 ** -1", 0.5)
+TEST_CONST(Power4, "2 ** 3 ** 2", 512.0)
+TEST_CONST(Power5, "3 * 2 ** 2", 12.0)
+TEST_EVAL(Power1, "x ** 2", -3.0, 9.0)
+
+TEST_CONST(FloorDiv1, "7 // 2", 3.0)
+TEST_CONST(FloorDiv2, "-7 // 2", -4.0)
+TEST_CONST(FloorDiv3, "1 // 0.1", 9.0)
+TEST_CONST(FloorDiv4, "-1 // 0.1", -10.0)
+TEST_CONST(FloorDiv5, "7 // -2", -4.0)
+TEST_EVAL(FloorDiv1, "x // 0.5", 1.75, 3.0)
+
+TEST_CONST(Mod1, "7 % 3", 1.0)
+TEST_CONST(Mod2, "-7 % 3", 2.0)
+TEST_CONST(Mod3, "7 % -3", -2.0)
+TEST_CONST(Mod4, "6 % 3", 0.0)
+TEST_EVAL(Mod1, "x % 1", -0.25, 0.75)
+
 TEST_CONST(Eq1, "1 == 1.0", TRUE_VAL)
 TEST_CONST(Eq2, "1 == 2.0", FALSE_VAL)
 TEST_CONST(Eq3, "True == 1", TRUE_VAL)
@@ -329,6 +365,7 @@ TEST_ERROR(DivZero1, "0 / 0", 0.0, EXPR_PYLIKE_MATH_ERROR)
 TEST_ERROR(DivZero2, "1 / 0", 0.0, EXPR_PYLIKE_DIV_BY_ZERO)
 TEST_ERROR(DivZero3, "1 / x", 0.0, EXPR_PYLIKE_DIV_BY_ZERO)
 TEST_ERROR(DivZero4, "1 / x", 1.0, EXPR_PYLIKE_SUCCESS)
+TEST_ERROR(DivZero5, "1 // x", 0.0, EXPR_PYLIKE_DIV_BY_ZERO)
 
 TEST_ERROR(SqrtDomain1, "sqrt(-1)", 0.0, EXPR_PYLIKE_MATH_ERROR)
 TEST_ERROR(SqrtDomain2, "sqrt(x)", -1.0, EXPR_PYLIKE_MATH_ERROR)
@@ -361,3 +398,25 @@ TEST(expr_pylike, Error_ArgumentCount)
 
   BLI_expr_pylike_free(expr);
 }
+
+static void expr_pylike_parse_error_test(const char *str, eExprPyLike_ParseError error)
+{
+  const char *names[1] = {"x"};
+  ExprPyLike_Parsed *expr = BLI_expr_pylike_parse(str, names, ARRAY_SIZE(names));
+
+  EXPECT_EQ(BLI_expr_pylike_parse_error(expr), error);
+
+  BLI_expr_pylike_free(expr);
+}
+
+TEST(expr_pylike, ParseError)
+{
+  expr_pylike_parse_error_test("sqrt(x) + 1", EXPR_PYLIKE_PARSE_OK);
+  expr_pylike_parse_error_test("y + 1", EXPR_PYLIKE_PARSE_UNKNOWN_NAME);
+  expr_pylike_parse_error_test("sqrt(1 + math.x)", EXPR_PYLIKE_PARSE_UNKNOWN_NAME);
+  expr_pylike_parse_error_test("sqrt(x, 2)", EXPR_PYLIKE_PARSE_FUNCTION_ARGS);
+  expr_pylike_parse_error_test("lerp(x, 2)", EXPR_PYLIKE_PARSE_FUNCTION_ARGS);
+  expr_pylike_parse_error_test("x[0]", EXPR_PYLIKE_PARSE_SYNTAX);
+  expr_pylike_parse_error_test("(x + 1", EXPR_PYLIKE_PARSE_SYNTAX);
+  expr_pylike_parse_error_test("", EXPR_PYLIKE_PARSE_SYNTAX);
+}
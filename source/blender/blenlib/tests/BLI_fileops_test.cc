@@ -0,0 +1,81 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cstdio>
+
+#include "BLI_array.hh"
+#include "BLI_fileops.h"
+
+namespace blender::tests {
+
+/* Compressed arrays are written one after the other into the same file, like arrays of paged out
+ * sculpt undo steps. */
+TEST(fileops, ZstdAtPosRoundTrip)
+{
+  FILE *file = tmpfile();
+  ASSERT_NE(file, nullptr);
+
+  Array<float> array_a(1000);
+  Array<int> array_b(333);
+  for (const int i : array_a.index_range()) {
+    array_a[i] = i * 0.5f;
+  }
+  for (const int i : array_b.index_range()) {
+    array_b[i] = i * i;
+  }
+
+  const size_t offset_a = 0;
+  const size_t size_a = BLI_file_zstd_from_mem_at_pos(
+      array_a.data(), array_a.as_span().size_in_bytes(), file, offset_a, 1);
+  EXPECT_GT(size_a, 0u);
+  const size_t offset_b = offset_a + size_a;
+  const size_t size_b = BLI_file_zstd_from_mem_at_pos(
+      array_b.data(), array_b.as_span().size_in_bytes(), file, offset_b, 1);
+  EXPECT_GT(size_b, 0u);
+
+  /* Read in a different order than written. */
+  Array<int> result_b(array_b.size());
+  EXPECT_EQ(BLI_file_unzstd_to_mem_at_pos(
+                result_b.data(), result_b.as_span().size_in_bytes(), file, offset_b),
+            (size_t)result_b.as_span().size_in_bytes());
+  EXPECT_EQ(result_b.as_span(), array_b.as_span());
+
+  Array<float> result_a(array_a.size());
+  EXPECT_EQ(BLI_file_unzstd_to_mem_at_pos(
+                result_a.data(), result_a.as_span().size_in_bytes(), file, offset_a),
+            (size_t)result_a.as_span().size_in_bytes());
+  EXPECT_EQ(result_a.as_span(), array_a.as_span());
+
+  fclose(file);
+}
+
+/* A failed read has to be detectable by the returned size. */
+TEST(fileops, ZstdAtPosReadFailure)
+{
+  FILE *file = tmpfile();
+  ASSERT_NE(file, nullptr);
+
+  Array<int> array(1000, 7);
+  const size_t size = BLI_file_zstd_from_mem_at_pos(
+      array.data(), array.as_span().size_in_bytes(), file, 0, 1);
+  EXPECT_GT(size, 0u);
+
+  Array<int> result(array.size());
+  /* Reading past the end of the file. */
+  EXPECT_NE(BLI_file_unzstd_to_mem_at_pos(
+                result.data(), result.as_span().size_in_bytes(), file, size + 16),
+            (size_t)result.as_span().size_in_bytes());
+
+  /* Corrupted data. */
+  fseek(file, 0, SEEK_SET);
+  const char garbage[16] = "not compressed";
+  fwrite(garbage, 1, sizeof(garbage), file);
+  EXPECT_NE(BLI_file_unzstd_to_mem_at_pos(
+                result.data(), result.as_span().size_in_bytes(), file, 0),
+            (size_t)result.as_span().size_in_bytes());
+
+  fclose(file);
+}
+
+}  // namespace blender::tests
@@ -0,0 +1,151 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <cstdio>
+#include <string>
+
+#include "BLI_array.hh"
+#include "BLI_fileops.h"
+#include "BLI_page_file.h"
+
+namespace blender::tests {
+
+static std::string page_file_test_path()
+{
+  return ::testing::TempDir() + "BLI_page_file_test.cache";
+}
+
+/* Hashed values, which hardly compress. */
+static Array<int> page_file_test_array(const int size, const int seed)
+{
+  Array<int> array(size);
+  for (const int i : array.index_range()) {
+    array[i] = int(uint32_t(i + seed * size) * 2654435761u);
+  }
+  return array;
+}
+
+static PageFilePage page_file_test_write(PageFile *page_file, const Array<int> &array)
+{
+  PageFilePage page;
+  EXPECT_TRUE(
+      BLI_page_file_write(page_file, array.data(), array.as_span().size_in_bytes(), &page));
+  return page;
+}
+
+static void page_file_test_expect_read(PageFile *page_file,
+                                       const PageFilePage &page,
+                                       const Array<int> &array)
+{
+  ASSERT_EQ(page.size, (size_t)array.as_span().size_in_bytes());
+  Array<int> result(array.size());
+  EXPECT_TRUE(BLI_page_file_read(page_file, &page, result.data()));
+  EXPECT_EQ(result.as_span(), array.as_span());
+}
+
+TEST(page_file, RoundTrip)
+{
+  const std::string path = page_file_test_path();
+  PageFile *page_file = BLI_page_file_create(path.c_str(), 1);
+  ASSERT_NE(page_file, nullptr);
+
+  const Array<int> array_a = page_file_test_array(1000, 3);
+  const Array<int> array_b = page_file_test_array(333, 7);
+  const Array<int> array_c = page_file_test_array(1, 1);
+  const PageFilePage page_a = page_file_test_write(page_file, array_a);
+  const PageFilePage page_b = page_file_test_write(page_file, array_b);
+  const PageFilePage page_c = page_file_test_write(page_file, array_c);
+  EXPECT_EQ(page_b.offset, page_a.offset + (int64_t)page_a.size_compressed);
+  EXPECT_EQ(BLI_page_file_size(page_file), page_c.offset + (int64_t)page_c.size_compressed);
+
+  /* Read in a different order than written, and more than once. */
+  page_file_test_expect_read(page_file, page_c, array_c);
+  page_file_test_expect_read(page_file, page_b, array_b);
+  page_file_test_expect_read(page_file, page_a, array_a);
+  page_file_test_expect_read(page_file, page_b, array_b);
+
+  BLI_page_file_free(page_file);
+  EXPECT_FALSE(BLI_exists(path.c_str()));
+}
+
+TEST(page_file, ReuseReleasedSpace)
+{
+  PageFile *page_file = BLI_page_file_create(page_file_test_path().c_str(), 1);
+  ASSERT_NE(page_file, nullptr);
+
+  const Array<int> array_a = page_file_test_array(1000, 3);
+  const Array<int> array_b = page_file_test_array(1000, 5);
+  const Array<int> array_c = page_file_test_array(1000, 7);
+  const PageFilePage page_a = page_file_test_write(page_file, array_a);
+  const PageFilePage page_b = page_file_test_write(page_file, array_b);
+  const PageFilePage page_c = page_file_test_write(page_file, array_c);
+  const int64_t size = BLI_page_file_size(page_file);
+
+  /* The same data compresses to the same size, so it fits exactly. */
+  BLI_page_file_release(page_file, &page_b);
+  const PageFilePage page_d = page_file_test_write(page_file, array_b);
+  EXPECT_EQ(page_d.offset, page_b.offset);
+  EXPECT_EQ(BLI_page_file_size(page_file), size);
+  page_file_test_expect_read(page_file, page_a, array_a);
+  page_file_test_expect_read(page_file, page_c, array_c);
+  page_file_test_expect_read(page_file, page_d, array_b);
+
+  /* Released space at the end shrinks the file, also when it is merged with released space
+   * before it. */
+  BLI_page_file_release(page_file, &page_c);
+  EXPECT_EQ(BLI_page_file_size(page_file), page_c.offset);
+  BLI_page_file_release(page_file, &page_a);
+  EXPECT_EQ(BLI_page_file_size(page_file), page_c.offset);
+  BLI_page_file_release(page_file, &page_d);
+  EXPECT_EQ(BLI_page_file_size(page_file), 0);
+
+  /* Data which is too large for released space goes to the end. */
+  const PageFilePage page_e = page_file_test_write(page_file, array_a);
+  const PageFilePage page_f = page_file_test_write(page_file, array_b);
+  BLI_page_file_release(page_file, &page_e);
+  const PageFilePage page_g = page_file_test_write(page_file, page_file_test_array(100000, 11));
+  EXPECT_EQ(page_g.offset, page_f.offset + (int64_t)page_f.size_compressed);
+  page_file_test_expect_read(page_file, page_f, array_b);
+  page_file_test_expect_read(page_file, page_g, page_file_test_array(100000, 11));
+
+  BLI_page_file_free(page_file);
+}
+
+/* Data which can't be read back has to be detected. */
+TEST(page_file, ReadFailure)
+{
+  const std::string path = page_file_test_path();
+  PageFile *page_file = BLI_page_file_create(path.c_str(), 1);
+  ASSERT_NE(page_file, nullptr);
+
+  const Array<int> array = page_file_test_array(1000, 3);
+  Array<int> result(array.size());
+
+  /* Corrupted data, modified before the page file reads and buffers it. */
+  const PageFilePage page_corrupted = page_file_test_write(page_file, array);
+  FILE *file = BLI_fopen(path.c_str(), "r+b");
+  ASSERT_NE(file, nullptr);
+  const char garbage[16] = "not compressed";
+  fwrite(garbage, 1, sizeof(garbage), file);
+  fclose(file);
+  EXPECT_FALSE(BLI_page_file_read(page_file, &page_corrupted, result.data()));
+
+  const PageFilePage page = page_file_test_write(page_file, array);
+  page_file_test_expect_read(page_file, page, array);
+
+  /* Reading past the end of the file. */
+  PageFilePage page_past_end = page;
+  page_past_end.offset += 16;
+  EXPECT_FALSE(BLI_page_file_read(page_file, &page_past_end, result.data()));
+
+  /* Reading a page which is larger than the data. */
+  PageFilePage page_larger = page;
+  page_larger.size += sizeof(int);
+  Array<int> result_larger(array.size() + 1);
+  EXPECT_FALSE(BLI_page_file_read(page_file, &page_larger, result_larger.data()));
+
+  BLI_page_file_free(page_file);
+}
+
+}  // namespace blender::tests
@@ -62,6 +62,22 @@ void DEG_debug_stats_gnuplot(const struct Depsgraph *graph,
                              const char *label,
                              const char *output_filename);
 
+/* ************************************************ */
+/* Evaluation Trace */
+
+/* Record the timings of all evaluated operations of all dependency graphs, including the thread
+ * they were evaluated on and how long they waited for a thread. Evaluations are accumulated until
+ * the trace is cleared, so that a whole playback range can be recorded. */
+void DEG_debug_trace_start(void);
+void DEG_debug_trace_stop(void);
+bool DEG_debug_trace_is_active(void);
+void DEG_debug_trace_clear(void);
+
+/* Write the recorded evaluations in the Chrome trace event format, which can be opened in
+ * Perfetto or chrome://tracing, followed by timings of every operation over all evaluations.
+ * Returns false if the file could not be written. */
+bool DEG_debug_trace_write(const char *filepath);
+
 /* ************************************************ */
 
 /* Compare two dependency graphs. */
@@ -31,7 +31,9 @@
 #include "DNA_layer_types.h"
 #include "DNA_object_types.h"
 
+#include "BLI_array.hh"
 #include "BLI_stack.h"
+#include "BLI_task.hh"
 #include "BLI_utildefines.h"
 
 #include "BKE_action.h"
@@ -212,6 +214,33 @@ void deg_graph_build_flush_visibility(Depsgraph *graph)
   BLI_stack_free(stack);
 }
 
+/* Recalc flags the ID needs to be tagged with after the graph was built. */
+int id_node_recalc_flags_after_build(const IDNode *id_node)
+{
+  const ID *id_orig = id_node->id_orig;
+  int flag = 0;
+  /* Tag rebuild if special evaluation flags changed. */
+  if (id_node->eval_flags != id_node->previous_eval_flags) {
+    flag |= ID_RECALC_TRANSFORM | ID_RECALC_GEOMETRY;
+  }
+  /* Tag rebuild if the custom data mask changed. */
+  if (id_node->customdata_masks != id_node->previous_customdata_masks) {
+    flag |= ID_RECALC_GEOMETRY;
+  }
+  if (!deg_copy_on_write_is_expanded(id_node->id_cow)) {
+    flag |= ID_RECALC_COPY_ON_WRITE;
+    /* This means ID is being added to the dependency graph first
+     * time, which is similar to "ob-visible-change" */
+    if (GS(id_orig->name) == ID_OB) {
+      flag |= ID_RECALC_TRANSFORM | ID_RECALC_GEOMETRY;
+    }
+  }
+  /* Restore recalc flags from original ID, which could possibly contain recalc flags set by
+   * an operator and then were carried on by the undo system. */
+  flag |= id_orig->recalc;
+  return flag;
+}
+
 }  // namespace
 
 void deg_graph_build_finalize(Main *bmain, Depsgraph *graph)
@@ -221,32 +250,20 @@ void deg_graph_build_finalize(Main *bmain, Depsgraph *graph)
   deg_graph_remove_unused_noops(graph);
 
   /* Re-tag IDs for update if it was tagged before the relations
-   * update tag. */
-  for (IDNode *id_node : graph->id_nodes) {
-    ID *id_orig = id_node->id_orig;
-    id_node->finalize_build(graph);
-    int flag = 0;
-    /* Tag rebuild if special evaluation flags changed. */
-    if (id_node->eval_flags != id_node->previous_eval_flags) {
-      flag |= ID_RECALC_TRANSFORM | ID_RECALC_GEOMETRY;
-    }
-    /* Tag rebuild if the custom data mask changed. */
-    if (id_node->customdata_masks != id_node->previous_customdata_masks) {
-      flag |= ID_RECALC_GEOMETRY;
-    }
-    if (!deg_copy_on_write_is_expanded(id_node->id_cow)) {
-      flag |= ID_RECALC_COPY_ON_WRITE;
-      /* This means ID is being added to the dependency graph first
-       * time, which is similar to "ob-visible-change" */
-      if (GS(id_orig->name) == ID_OB) {
-        flag |= ID_RECALC_TRANSFORM | ID_RECALC_GEOMETRY;
-      }
+   * update tag. The flags only depend on the ID itself and are calculated in parallel, tagging
+   * happens afterwards in the order of the ID nodes. */
+  Array<int> id_flags(graph->id_nodes.size());
+  threading::parallel_for(graph->id_nodes.index_range(), 64, [&](const IndexRange range) {
+    for (const int i : range) {
+      IDNode *id_node = graph->id_nodes[i];
+      id_node->finalize_build(graph);
+      id_flags[i] = id_node_recalc_flags_after_build(id_node);
     }
-    /* Restore recalc flags from original ID, which could possibly contain recalc flags set by
-     * an operator and then were carried on by the undo system. */
-    flag |= id_orig->recalc;
-    if (flag != 0) {
-      graph_id_tag_update(bmain, graph, id_node->id_orig, flag, DEG_UPDATE_SOURCE_RELATIONS);
+  });
+  for (const int i : graph->id_nodes.index_range()) {
+    if (id_flags[i] != 0) {
+      graph_id_tag_update(
+          bmain, graph, graph->id_nodes[i]->id_orig, id_flags[i], DEG_UPDATE_SOURCE_RELATIONS);
     }
   }
 }
@@ -32,6 +32,7 @@
 
 #include "BLI_blenlib.h"
 #include "BLI_string.h"
+#include "BLI_task.hh"
 #include "BLI_utildefines.h"
 
 #include "DNA_action_types.h"
@@ -392,20 +393,14 @@ void DepsgraphNodeBuilder::begin_build()
 
 /* `id_cow_self` is the user of `id_pointer`, see also `LibraryIDLinkCallbackData` struct
  * definition. */
-int DepsgraphNodeBuilder::foreach_id_cow_detect_need_for_update_callback(ID *id_cow_self,
-                                                                         ID *id_pointer)
+bool DepsgraphNodeBuilder::foreach_id_cow_detect_need_for_update_callback(ID *id_pointer)
 {
   if (id_pointer->orig_id == nullptr) {
     /* `id_cow_self` uses a non-cow ID, if that ID has a COW copy in current depsgraph its owner
      * needs to be remapped, i.e. COW-flushed. */
     IDNode *id_node = find_id_node(id_pointer);
     if (id_node != nullptr && id_node->id_cow != nullptr) {
-      graph_id_tag_update(bmain_,
-                          graph_,
-                          id_cow_self->orig_id,
-                          ID_RECALC_COPY_ON_WRITE,
-                          DEG_UPDATE_SOURCE_RELATIONS);
-      return IDWALK_RET_STOP_ITER;
+      return true;
     }
   }
   else {
@@ -416,17 +411,17 @@ int DepsgraphNodeBuilder::foreach_id_cow_detect_need_for_update_callback(ID *id_
      * destruction of the builder itself). */
     IDNode *id_node = find_id_node(id_pointer->orig_id);
     if (id_node == nullptr) {
-      graph_id_tag_update(bmain_,
-                          graph_,
-                          id_cow_self->orig_id,
-                          ID_RECALC_COPY_ON_WRITE,
-                          DEG_UPDATE_SOURCE_RELATIONS);
-      return IDWALK_RET_STOP_ITER;
+      return true;
     }
   }
-  return IDWALK_RET_NOP;
+  return false;
 }
 
+struct DetectNeedForUpdateData {
+  DepsgraphNodeBuilder *builder;
+  bool need_update;
+};
+
 static int foreach_id_cow_detect_need_for_update_callback(LibraryIDLinkCallbackData *cb_data)
 {
   ID *id = *cb_data->id_pointer;
@@ -434,10 +429,12 @@ static int foreach_id_cow_detect_need_for_update_callback(LibraryIDLinkCallbackD
     return IDWALK_RET_NOP;
   }
 
-  DepsgraphNodeBuilder *builder = static_cast<DepsgraphNodeBuilder *>(cb_data->user_data);
-  ID *id_cow_self = cb_data->id_self;
-
-  return builder->foreach_id_cow_detect_need_for_update_callback(id_cow_self, id);
+  DetectNeedForUpdateData *data = static_cast<DetectNeedForUpdateData *>(cb_data->user_data);
+  if (data->builder->foreach_id_cow_detect_need_for_update_callback(id)) {
+    data->need_update = true;
+    return IDWALK_RET_STOP_ITER;
+  }
+  return IDWALK_RET_NOP;
 }
 
 /* Check for IDs that need to be flushed (COW-updated) because the depsgraph itself created or
@@ -452,46 +449,68 @@ static int foreach_id_cow_detect_need_for_update_callback(LibraryIDLinkCallbackD
  * NOTE: This mechanism may also 'fix' some missing update tagging from non-depsgraph code in
  * some cases. This is slightly unfortunate (as it may hide issues in other parts of Blender
  * code), but cannot really be avoided currently.
+ *
+ * NOTE: The check only reads the graph, so it runs for all IDs in parallel. The IDs are tagged
+ * afterwards in the order of the ID nodes.
  */
 void DepsgraphNodeBuilder::update_invalid_cow_pointers()
 {
-  for (const IDNode *id_node : graph_->id_nodes) {
-    if (id_node->previously_visible_components_mask == 0) {
-      /* Newly added node/ID, no need to check it. */
-      continue;
-    }
-    if (ELEM(id_node->id_cow, id_node->id_orig, nullptr)) {
-      /* Node/ID with no COW data, no need to check it. */
-      continue;
+  Array<bool> need_update(graph_->id_nodes.size(), false);
+  threading::parallel_for(graph_->id_nodes.index_range(), 64, [&](const IndexRange range) {
+    for (const int i : range) {
+      need_update[i] = id_cow_pointers_need_update(graph_->id_nodes[i]);
     }
-    if ((id_node->id_cow->recalc & ID_RECALC_COPY_ON_WRITE) != 0) {
-      /* Node/ID already tagged for COW flush, no need to check it. */
-      continue;
-    }
-    if ((id_node->id_cow->flag & LIB_EMBEDDED_DATA) != 0) {
-      /* For now, we assume embedded data are managed by their owner IDs and do not need to be
-       * checked here.
-       *
-       * NOTE: This exception somewhat weak, and ideally should not be needed. Currently however,
-       * embedded data are handled as full local (private) data of their owner IDs in part of
-       * Blender (like read/write code, including undo/redo), while depsgraph generally treat them
-       * as regular independent IDs. This leads to inconsistencies that can lead to bad level
-       * memory accesses.
-       *
-       * E.g. when undoing creation/deletion of a collection directly child of a scene's master
-       * collection, the scene itself is re-read in place, but its master collection becomes a
-       * completely new different pointer, and the existing COW of the old master collection in the
-       * matching deg node is therefore pointing to fully invalid (freed) memory. */
-      continue;
+  });
+  for (const int i : graph_->id_nodes.index_range()) {
+    if (need_update[i]) {
+      graph_id_tag_update(bmain_,
+                          graph_,
+                          graph_->id_nodes[i]->id_orig,
+                          ID_RECALC_COPY_ON_WRITE,
+                          DEG_UPDATE_SOURCE_RELATIONS);
     }
-    BKE_library_foreach_ID_link(nullptr,
-                                id_node->id_cow,
-                                deg::foreach_id_cow_detect_need_for_update_callback,
-                                this,
-                                IDWALK_IGNORE_EMBEDDED_ID | IDWALK_READONLY);
   }
 }
 
+bool DepsgraphNodeBuilder::id_cow_pointers_need_update(const IDNode *id_node)
+{
+  if (id_node->previously_visible_components_mask == 0) {
+    /* Newly added node/ID, no need to check it. */
+    return false;
+  }
+  if (ELEM(id_node->id_cow, id_node->id_orig, nullptr)) {
+    /* Node/ID with no COW data, no need to check it. */
+    return false;
+  }
+  if ((id_node->id_cow->recalc & ID_RECALC_COPY_ON_WRITE) != 0) {
+    /* Node/ID already tagged for COW flush, no need to check it. */
+    return false;
+  }
+  if ((id_node->id_cow->flag & LIB_EMBEDDED_DATA) != 0) {
+    /* For now, we assume embedded data are managed by their owner IDs and do not need to be
+     * checked here.
+     *
+     * NOTE: This exception somewhat weak, and ideally should not be needed. Currently however,
+     * embedded data are handled as full local (private) data of their owner IDs in part of
+     * Blender (like read/write code, including undo/redo), while depsgraph generally treat them
+     * as regular independent IDs. This leads to inconsistencies that can lead to bad level
+     * memory accesses.
+     *
+     * E.g. when undoing creation/deletion of a collection directly child of a scene's master
+     * collection, the scene itself is re-read in place, but its master collection becomes a
+     * completely new different pointer, and the existing COW of the old master collection in the
+     * matching deg node is therefore pointing to fully invalid (freed) memory. */
+    return false;
+  }
+  DetectNeedForUpdateData data = {this, false};
+  BKE_library_foreach_ID_link(nullptr,
+                              id_node->id_cow,
+                              deg::foreach_id_cow_detect_need_for_update_callback,
+                              &data,
+                              IDWALK_IGNORE_EMBEDDED_ID | IDWALK_READONLY);
+  return data.need_update;
+}
+
 void DepsgraphNodeBuilder::tag_previously_tagged_nodes()
 {
   for (const SavedEntryTag &entry_tag : saved_entry_tags_) {
@@ -102,7 +102,8 @@ class DepsgraphNodeBuilder : public DepsgraphBuilder {
   virtual void begin_build();
   virtual void end_build();
 
-  int foreach_id_cow_detect_need_for_update_callback(ID *id_cow_self, ID *id_pointer);
+  /* Returns true when the evaluated ID which uses `id_pointer` needs to be remapped. */
+  bool foreach_id_cow_detect_need_for_update_callback(ID *id_pointer);
 
   IDNode *add_id_node(ID *id);
   IDNode *find_id_node(ID *id);
@@ -281,6 +282,7 @@ class DepsgraphNodeBuilder : public DepsgraphBuilder {
 
   void tag_previously_tagged_nodes();
   void update_invalid_cow_pointers();
+  bool id_cow_pointers_need_update(const IDNode *id_node);
 
   /* State which demotes currently built entities. */
   Scene *scene_;
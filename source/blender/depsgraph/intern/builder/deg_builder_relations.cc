@@ -32,6 +32,7 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_blenlib.h"
+#include "BLI_task.hh"
 #include "BLI_utildefines.h"
 
 #include "DNA_action_types.h"
@@ -2866,8 +2867,16 @@ void DepsgraphRelationBuilder::build_vfont(VFont *vfont)
 
 void DepsgraphRelationBuilder::build_copy_on_write_relations()
 {
+  /* Relations between the copy-on-write operation and other operations of the same ID only
+   * modify nodes of that ID, so IDs are handled in parallel. Relations which involve other IDs
+   * are added afterwards in the order of the ID nodes, to keep the graph deterministic. */
+  threading::parallel_for(graph_->id_nodes.index_range(), 64, [&](const IndexRange range) {
+    for (const int i : range) {
+      build_copy_on_write_relations(graph_->id_nodes[i]);
+    }
+  });
   for (IDNode *id_node : graph_->id_nodes) {
-    build_copy_on_write_relations(id_node);
+    build_copy_on_write_data_relations(id_node);
   }
 }
 
@@ -2995,6 +3004,15 @@ void DepsgraphRelationBuilder::build_copy_on_write_relations(IDNode *id_node)
      * evaluation step needs geometry, it will have transitive dependency
      * to Mesh copy-on-write already. */
   }
+}
+
+void DepsgraphRelationBuilder::build_copy_on_write_data_relations(IDNode *id_node)
+{
+  ID *id_orig = id_node->id_orig;
+  if (!deg_copy_on_write_is_needed(GS(id_orig->name))) {
+    return;
+  }
+  OperationKey copy_on_write_key(id_orig, NodeType::COPY_ON_WRITE, OperationCode::COPY_ON_WRITE);
   /* TODO(sergey): This solves crash for now, but causes too many
    * updates potentially. */
   if (GS(id_orig->name) == ID_OB) {
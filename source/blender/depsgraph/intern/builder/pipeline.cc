@@ -42,18 +42,31 @@ AbstractBuilderPipeline::AbstractBuilderPipeline(::Depsgraph *graph)
 
 void AbstractBuilderPipeline::build()
 {
-  double start_time = 0.0;
-  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    start_time = PIL_check_seconds_timer();
+  const bool do_time = (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) != 0;
+  /* Points in time before and after every build step, to see which step takes the most time. */
+  double step_times[4] = {0.0};
+  if (do_time) {
+    step_times[0] = PIL_check_seconds_timer();
   }
 
   build_step_sanity_check();
   build_step_nodes();
+  if (do_time) {
+    step_times[1] = PIL_check_seconds_timer();
+  }
   build_step_relations();
+  if (do_time) {
+    step_times[2] = PIL_check_seconds_timer();
+  }
   build_step_finalize();
 
-  if (G.debug & (G_DEBUG_DEPSGRAPH_BUILD | G_DEBUG_DEPSGRAPH_TIME)) {
-    printf("Depsgraph built in %f seconds.\n", PIL_check_seconds_timer() - start_time);
+  if (do_time) {
+    step_times[3] = PIL_check_seconds_timer();
+    printf("Depsgraph built in %f seconds (nodes %f, relations %f, finalize %f).\n",
+           step_times[3] - step_times[0],
+           step_times[1] - step_times[0],
+           step_times[2] - step_times[1],
+           step_times[3] - step_times[2]);
   }
 }
 
@@ -0,0 +1,352 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "intern/debug/deg_debug_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+
+#include "BLI_fileops.h"
+#include "BLI_map.hh"
+#include "BLI_string.h"
+#include "BLI_utildefines.h"
+#include "BLI_vector.hh"
+
+#include "DEG_depsgraph_debug.h"
+
+#include "intern/depsgraph.h"
+#include "intern/depsgraph_type.h"
+#include "intern/node/deg_node_component.h"
+#include "intern/node/deg_node_operation.h"
+
+namespace blender::deg {
+namespace {
+
+struct TraceEvent {
+  string name;
+  const char *category;
+  double enqueue_time;
+  double start_time;
+  double end_time;
+  int thread_index;
+  bool on_critical_path;
+};
+
+struct TraceEvaluation {
+  int graph_index;
+  float frame;
+  double start_time;
+  double end_time;
+  Vector<TraceEvent> events;
+};
+
+/* Timings of all evaluations of one operation over the recorded frames. */
+struct TraceOperationStats {
+  int count = 0;
+  int critical_path_count = 0;
+  double total_time = 0.0;
+  double max_time = 0.0;
+  double wait_time = 0.0;
+};
+
+struct Trace {
+  std::mutex mutex;
+  /* Dependency graphs and threads are referred to by index, which become the process and thread
+   * ids of the written trace. */
+  Vector<const Depsgraph *> graphs;
+  Vector<string> graph_names;
+  Vector<std::thread::id> threads;
+  Vector<TraceEvaluation> evaluations;
+
+  int graph_index(const Depsgraph *graph)
+  {
+    const int index = graphs.first_index_of_try(graph);
+    if (index != -1) {
+      return index;
+    }
+    graphs.append(graph);
+    graph_names.append(graph->debug.name.empty() ? "Depsgraph" : graph->debug.name);
+    return graphs.size() - 1;
+  }
+
+  int thread_index(const std::thread::id thread_id)
+  {
+    const int index = threads.first_index_of_try(thread_id);
+    if (index != -1) {
+      return index;
+    }
+    threads.append(thread_id);
+    return threads.size() - 1;
+  }
+
+  void clear()
+  {
+    graphs.clear();
+    graph_names.clear();
+    threads.clear();
+    evaluations.clear();
+  }
+};
+
+std::atomic<bool> trace_is_active = false;
+
+Trace &get_trace()
+{
+  static Trace trace;
+  return trace;
+}
+
+/* Thread id 0 of every process shows the evaluations themselves, the evaluation threads follow. */
+int trace_tid(const int thread_index)
+{
+  return thread_index + 1;
+}
+
+double trace_microseconds(const double time, const double start_time)
+{
+  return (time - start_time) * 1e6;
+}
+
+void trace_fputs_json_string(FILE *fp, const char *str)
+{
+  fputc('"', fp);
+  for (const char *c = str; *c; c++) {
+    switch (*c) {
+      case '"':
+        fputs("\\\"", fp);
+        break;
+      case '\\':
+        fputs("\\\\", fp);
+        break;
+      case '\n':
+        fputs("\\n", fp);
+        break;
+      case '\t':
+        fputs("\\t", fp);
+        break;
+      default:
+        if ((unsigned char)*c < 0x20) {
+          fprintf(fp, "\\u%04x", (unsigned char)*c);
+        }
+        else {
+          fputc(*c, fp);
+        }
+        break;
+    }
+  }
+  fputc('"', fp);
+}
+
+void trace_write_metadata(FILE *fp, const char *name, int pid, int tid, const char *value)
+{
+  fprintf(fp,
+          "{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+          name,
+          pid,
+          tid);
+  trace_fputs_json_string(fp, value);
+  fputs("}}", fp);
+}
+
+void trace_write_events(FILE *fp, const Trace &trace)
+{
+  double trace_start_time = 0.0;
+  if (!trace.evaluations.is_empty()) {
+    trace_start_time = trace.evaluations.first().start_time;
+    for (const TraceEvaluation &evaluation : trace.evaluations) {
+      trace_start_time = std::min(trace_start_time, evaluation.start_time);
+    }
+  }
+
+  bool is_first = true;
+  auto separator = [&]() {
+    fputs(is_first ? "\n" : ",\n", fp);
+    is_first = false;
+  };
+
+  for (const int pid : trace.graphs.index_range()) {
+    separator();
+    trace_write_metadata(fp, "process_name", pid, 0, trace.graph_names[pid].c_str());
+    separator();
+    trace_write_metadata(fp, "thread_name", pid, 0, "Evaluation");
+    for (const int thread_index : trace.threads.index_range()) {
+      char thread_name[64];
+      BLI_snprintf(thread_name, sizeof(thread_name), "Thread %d", thread_index);
+      separator();
+      trace_write_metadata(fp, "thread_name", pid, trace_tid(thread_index), thread_name);
+    }
+  }
+
+  for (const TraceEvaluation &evaluation : trace.evaluations) {
+    separator();
+    fprintf(fp,
+            "{\"name\":\"Frame %g\",\"cat\":\"evaluation\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+            "\"pid\":%d,\"tid\":0,\"args\":{\"operations\":%d}}",
+            evaluation.frame,
+            trace_microseconds(evaluation.start_time, trace_start_time),
+            (evaluation.end_time - evaluation.start_time) * 1e6,
+            evaluation.graph_index,
+            (int)evaluation.events.size());
+    for (const TraceEvent &event : evaluation.events) {
+      separator();
+      fputs("{\"name\":", fp);
+      trace_fputs_json_string(fp, event.name.c_str());
+      fprintf(fp,
+              ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,"
+              "\"args\":{\"wait\":%.3f,\"critical_path\":%s,\"frame\":%g}}",
+              event.category,
+              trace_microseconds(event.start_time, trace_start_time),
+              (event.end_time - event.start_time) * 1e6,
+              evaluation.graph_index,
+              trace_tid(event.thread_index),
+              (event.start_time - event.enqueue_time) * 1e6,
+              event.on_critical_path ? "true" : "false",
+              evaluation.frame);
+    }
+  }
+  fputs("\n", fp);
+}
+
+/* Operations over all recorded evaluations, the slowest first. This is not part of the trace event
+ * format and is ignored by the trace viewers. */
+void trace_write_operation_stats(FILE *fp, const Trace &trace)
+{
+  Map<string, TraceOperationStats> stats_by_name;
+  for (const TraceEvaluation &evaluation : trace.evaluations) {
+    for (const TraceEvent &event : evaluation.events) {
+      TraceOperationStats &stats = stats_by_name.lookup_or_add_default(event.name);
+      const double time = event.end_time - event.start_time;
+      stats.count++;
+      stats.critical_path_count += event.on_critical_path;
+      stats.total_time += time;
+      stats.max_time = std::max(stats.max_time, time);
+      stats.wait_time += event.start_time - event.enqueue_time;
+    }
+  }
+
+  Vector<std::pair<const string *, const TraceOperationStats *>> sorted_stats;
+  for (const auto item : stats_by_name.items()) {
+    sorted_stats.append({&item.key, &item.value});
+  }
+  std::sort(sorted_stats.begin(), sorted_stats.end(), [](const auto &a, const auto &b) {
+    return a.second->total_time > b.second->total_time;
+  });
+
+  for (const int i : sorted_stats.index_range()) {
+    const TraceOperationStats &stats = *sorted_stats[i].second;
+    fputs(i == 0 ? "\n{\"name\":" : ",\n{\"name\":", fp);
+    trace_fputs_json_string(fp, sorted_stats[i].first->c_str());
+    fprintf(fp,
+            ",\"count\":%d,\"total_ms\":%.4f,\"average_ms\":%.4f,\"max_ms\":%.4f,"
+            "\"average_wait_ms\":%.4f,\"critical_path_count\":%d}",
+            stats.count,
+            stats.total_time * 1e3,
+            stats.total_time / stats.count * 1e3,
+            stats.max_time * 1e3,
+            stats.wait_time / stats.count * 1e3,
+            stats.critical_path_count);
+  }
+  fputs("\n", fp);
+}
+
+}  // namespace
+
+bool deg_debug_trace_is_active()
+{
+  return trace_is_active.load(std::memory_order_relaxed);
+}
+
+void deg_debug_trace_add_evaluation(const Depsgraph *graph,
+                                    const double start_time,
+                                    const double end_time)
+{
+  Trace &trace = get_trace();
+  std::lock_guard<std::mutex> lock(trace.mutex);
+
+  trace.evaluations.append_as();
+  TraceEvaluation &evaluation = trace.evaluations.last();
+  evaluation.graph_index = trace.graph_index(graph);
+  evaluation.frame = graph->frame;
+  evaluation.start_time = start_time;
+  evaluation.end_time = end_time;
+  for (const OperationNode *node : graph->operations) {
+    const OperationTraceTimes &times = node->trace;
+    if (times.end_time == 0.0) {
+      continue;
+    }
+    TraceEvent event;
+    event.name = node->full_identifier();
+    event.category = nodeTypeAsString(node->owner->type);
+    event.enqueue_time = times.enqueue_time;
+    event.start_time = times.start_time;
+    event.end_time = times.end_time;
+    event.thread_index = trace.thread_index(times.thread_id);
+    event.on_critical_path = times.on_critical_path;
+    evaluation.events.append(std::move(event));
+  }
+  std::sort(evaluation.events.begin(),
+            evaluation.events.end(),
+            [](const TraceEvent &a, const TraceEvent &b) { return a.start_time < b.start_time; });
+}
+
+}  // namespace blender::deg
+
+namespace deg = blender::deg;
+
+void DEG_debug_trace_start()
+{
+  deg::trace_is_active = true;
+}
+
+void DEG_debug_trace_stop()
+{
+  deg::trace_is_active = false;
+}
+
+bool DEG_debug_trace_is_active()
+{
+  return deg::deg_debug_trace_is_active();
+}
+
+void DEG_debug_trace_clear()
+{
+  deg::Trace &trace = deg::get_trace();
+  std::lock_guard<std::mutex> lock(trace.mutex);
+  trace.clear();
+}
+
+bool DEG_debug_trace_write(const char *filepath)
+{
+  FILE *fp = BLI_fopen(filepath, "w");
+  if (fp == nullptr) {
+    return false;
+  }
+  deg::Trace &trace = deg::get_trace();
+  std::lock_guard<std::mutex> lock(trace.mutex);
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", fp);
+  deg::trace_write_events(fp, trace);
+  fputs("],\"operationStats\":[", fp);
+  deg::trace_write_operation_stats(fp, trace);
+  fputs("]}\n", fp);
+  fclose(fp);
+  return true;
+}
@@ -0,0 +1,52 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ *
+ * Evaluation trace: timings of every evaluated operation, recorded while tracing is active and
+ * written in the Chrome trace event format (which is also read by Perfetto).
+ */
+
+#pragma once
+
+#include <thread>
+
+namespace blender {
+namespace deg {
+
+struct Depsgraph;
+
+/* Timings of the last evaluation of an operation, only recorded while tracing is active. */
+struct OperationTraceTimes {
+  /* Point in time when all dependencies of the operation were evaluated and it was scheduled. */
+  double enqueue_time = 0.0;
+  double start_time = 0.0;
+  /* Zero when the operation was not evaluated. */
+  double end_time = 0.0;
+  std::thread::id thread_id;
+  bool on_critical_path = false;
+};
+
+/* Check whether evaluations are to be recorded. Cheap enough to be called for every evaluation. */
+bool deg_debug_trace_is_active();
+
+/* Record all operations of the graph which were evaluated between the given points in time.
+ * Must be called after the critical path of the evaluation has been marked. */
+void deg_debug_trace_add_evaluation(const Depsgraph *graph, double start_time, double end_time);
+
+}  // namespace deg
+}  // namespace blender
@@ -49,6 +49,11 @@ template<int MaxSamples> class AveragedTimeSampler {
     }
   }
 
+  bool has_samples() const
+  {
+    return num_samples_ != 0;
+  }
+
   double get_averaged() const
   {
     double sum = 0.0;
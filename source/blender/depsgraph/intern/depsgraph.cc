@@ -47,6 +47,7 @@
 #include "intern/depsgraph_update.h"
 
 #include "intern/eval/deg_eval_copy_on_write.h"
+#include "intern/eval/deg_eval_transform_batch.h"
 
 #include "intern/node/deg_node.h"
 #include "intern/node/deg_node_component.h"
@@ -74,7 +75,8 @@ Depsgraph::Depsgraph(Main *bmain, Scene *scene, ViewLayer *view_layer, eEvaluati
       is_active(false),
       is_evaluating(false),
       is_render_pipeline_depsgraph(false),
-      use_editors_update(false)
+      use_editors_update(false),
+      transform_batch(nullptr)
 {
   BLI_spin_init(&lock);
   memset(id_type_updated, 0, sizeof(id_type_updated));
@@ -88,6 +90,7 @@ Depsgraph::~Depsgraph()
 {
   clear_id_nodes();
   delete time_source;
+  delete transform_batch;
   BLI_spin_end(&lock);
 }
 
@@ -247,6 +250,8 @@ void Depsgraph::clear_all_nodes()
   clear_id_nodes();
   delete time_source;
   time_source = nullptr;
+  delete transform_batch;
+  transform_batch = nullptr;
 }
 
 ID *Depsgraph::get_cow_id(const ID *id_orig) const
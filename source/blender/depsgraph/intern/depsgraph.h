@@ -55,6 +55,7 @@ struct Node;
 struct OperationNode;
 struct Relation;
 struct TimeSourceNode;
+struct TransformBatch;
 
 /* Dependency Graph object */
 struct Depsgraph {
@@ -175,6 +176,10 @@ struct Depsgraph {
    * created along with relations, for fast lookup during evaluation. */
   Map<const ID *, ListBase *> *physics_relations[DEG_PHYSICS_RELATIONS_NUM];
 
+  /* Objects whose transform is evaluated in a batch, created on the first evaluation after the
+   * relations were built. */
+  TransformBatch *transform_batch;
+
   MEM_CXX_CLASS_ALLOC_FUNCS("Depsgraph");
 };
 
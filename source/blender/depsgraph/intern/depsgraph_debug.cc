@@ -23,6 +23,7 @@
  * Implementation of tools for debugging the depsgraph
  */
 
+#include "BLI_set.hh"
 #include "BLI_utildefines.h"
 
 #include "DNA_scene_types.h"
@@ -40,6 +41,7 @@
 #include "intern/depsgraph_type.h"
 #include "intern/node/deg_node_component.h"
 #include "intern/node/deg_node_id.h"
+#include "intern/node/deg_node_operation.h"
 #include "intern/node/deg_node_time.h"
 
 namespace deg = blender::deg;
@@ -68,22 +70,75 @@ const char *DEG_debug_name_get(struct Depsgraph *depsgraph)
   return deg_graph->debug.name.c_str();
 }
 
+static deg::string debug_node_identifier(const deg::Node *node)
+{
+  if (node->type == deg::NodeType::OPERATION) {
+    const deg::OperationNode *operation_node = (const deg::OperationNode *)node;
+    return operation_node->full_identifier() + "[" + std::to_string(operation_node->name_tag) +
+           "]";
+  }
+  return node->identifier();
+}
+
+/* Identifiers of all operations and relations in the graph. Nodes are identified by their
+ * names, so that graphs which are built separately can be compared. */
+static blender::Set<deg::string> debug_graph_identifiers(const deg::Depsgraph *deg_graph)
+{
+  blender::Set<deg::string> identifiers;
+  auto add_relations = [&](const deg::Node *node) {
+    for (const deg::Relation *rel : node->outlinks) {
+      identifiers.add(debug_node_identifier(rel->from) + " -> " + debug_node_identifier(rel->to) +
+                      " (" + rel->name + ")");
+    }
+  };
+  for (const deg::OperationNode *node : deg_graph->operations) {
+    identifiers.add(debug_node_identifier(node));
+    add_relations(node);
+  }
+  if (deg_graph->time_source != nullptr) {
+    add_relations(deg_graph->time_source);
+  }
+  return identifiers;
+}
+
+/* Print up to a few identifiers which only exist in one of the graphs. */
+static int debug_print_missing_identifiers(const blender::Set<deg::string> &identifiers,
+                                           const blender::Set<deg::string> &other_identifiers,
+                                           const char *message)
+{
+  const int max_printed = 10;
+  int missing_num = 0;
+  for (const deg::string &identifier : identifiers) {
+    if (other_identifiers.contains(identifier)) {
+      continue;
+    }
+    if (missing_num < max_printed) {
+      fprintf(stderr, "%s: %s\n", message, identifier.c_str());
+    }
+    missing_num++;
+  }
+  if (missing_num > max_printed) {
+    fprintf(stderr, "%s: %d more...\n", message, missing_num - max_printed);
+  }
+  return missing_num;
+}
+
 bool DEG_debug_compare(const struct Depsgraph *graph1, const struct Depsgraph *graph2)
 {
   BLI_assert(graph1 != nullptr);
   BLI_assert(graph2 != nullptr);
   const deg::Depsgraph *deg_graph1 = reinterpret_cast<const deg::Depsgraph *>(graph1);
   const deg::Depsgraph *deg_graph2 = reinterpret_cast<const deg::Depsgraph *>(graph2);
-  if (deg_graph1->operations.size() != deg_graph2->operations.size()) {
-    return false;
-  }
-  /* TODO(sergey): Currently we only do real stupid check,
-   * which is fast but which isn't 100% reliable.
-   *
-   * Would be cool to make it more robust, but it's good enough
-   * for now. Also, proper graph check is actually NP-complex
-   * problem. */
-  return true;
+  /* Compare operations and relations by their names. This does not detect differences between
+   * nodes with the same name, but that is good enough to catch missing or outdated relations. */
+  const blender::Set<deg::string> identifiers1 = debug_graph_identifiers(deg_graph1);
+  const blender::Set<deg::string> identifiers2 = debug_graph_identifiers(deg_graph2);
+  int differences_num = 0;
+  differences_num += debug_print_missing_identifiers(
+      identifiers1, identifiers2, "Only in first graph");
+  differences_num += debug_print_missing_identifiers(
+      identifiers2, identifiers1, "Only in second graph");
+  return differences_num == 0;
 }
 
 bool DEG_debug_graph_relations_validate(Depsgraph *graph,
@@ -95,7 +150,7 @@ bool DEG_debug_graph_relations_validate(Depsgraph *graph,
   bool valid = true;
   DEG_graph_build_from_view_layer(temp_depsgraph);
   if (!DEG_debug_compare(temp_depsgraph, graph)) {
-    fprintf(stderr, "ERROR! Depsgraph wasn't tagged for update when it should have!\n");
+    fprintf(stderr, "ERROR! Depsgraph differs from a graph built from scratch!\n");
     BLI_assert_msg(0, "This should not happen!");
     valid = false;
   }
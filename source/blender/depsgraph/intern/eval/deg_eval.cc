@@ -25,18 +25,25 @@
 
 #include "intern/eval/deg_eval.h"
 
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
 #include "PIL_time.h"
 
 #include "BLI_compiler_attrs.h"
 #include "BLI_gsqueue.h"
 #include "BLI_task.h"
 #include "BLI_utildefines.h"
+#include "BLI_vector.hh"
 
+#include "BKE_fcurve_driver.h"
 #include "BKE_global.h"
 
 #include "DNA_node_types.h"
 #include "DNA_object_types.h"
 #include "DNA_scene_types.h"
+#include "DNA_userdef_types.h"
 
 #include "DEG_depsgraph.h"
 #include "DEG_depsgraph_query.h"
@@ -47,12 +54,14 @@
 
 #include "atomic_ops.h"
 
+#include "intern/debug/deg_debug_trace.h"
 #include "intern/depsgraph.h"
 #include "intern/depsgraph_relation.h"
 #include "intern/depsgraph_tag.h"
 #include "intern/eval/deg_eval_copy_on_write.h"
 #include "intern/eval/deg_eval_flush.h"
 #include "intern/eval/deg_eval_stats.h"
+#include "intern/eval/deg_eval_transform_batch.h"
 #include "intern/node/deg_node.h"
 #include "intern/node/deg_node_component.h"
 #include "intern/node/deg_node_id.h"
@@ -78,6 +87,8 @@ void schedule_node_to_pool(OperationNode *node, const int UNUSED(thread_id), Tas
   BLI_task_pool_push(pool, deg_task_run_func, node, false, nullptr);
 }
 
+void schedule_node_to_priority_queue(OperationNode *node, const int thread_id, TaskPool *pool);
+
 /* Denotes which part of dependency graph is being evaluated. */
 enum class EvaluationStage {
   /* Stage 1: Only  Copy-on-Write operations are to be evaluated, prior to anything else.
@@ -100,8 +111,22 @@ struct DepsgraphEvalState {
   bool do_stats;
   EvaluationStage stage;
   bool need_single_thread_pass;
+
+  /* Evaluate operations with the longest remaining critical path first. Operations which are
+   * ready for evaluation are put into a heap, and every task evaluates the top operation. */
+  bool do_priority;
+  std::mutex ready_operations_mutex;
+  Vector<OperationNode *> ready_operations;
+
+  /* Record enqueue, start and end times of operations, see #DEG_debug_trace_start. */
+  bool do_trace;
 };
 
+bool operation_has_lower_priority(const OperationNode *a, const OperationNode *b)
+{
+  return a->critical_path_time < b->critical_path_time;
+}
+
 void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_node)
 {
   ::Depsgraph *depsgraph = reinterpret_cast<::Depsgraph *>(state->graph);
@@ -109,10 +134,26 @@ void evaluate_node(const DepsgraphEvalState *state, OperationNode *operation_nod
   /* Sanity checks. */
   BLI_assert_msg(!operation_node->is_noop(), "NOOP nodes should not actually be scheduled");
   /* Perform operation. */
-  if (state->do_stats) {
+  if (state->do_trace) {
+    OperationTraceTimes &trace = operation_node->trace;
+    trace.thread_id = std::this_thread::get_id();
+    trace.start_time = PIL_check_seconds_timer();
+    operation_node->evaluate(depsgraph);
+    trace.end_time = PIL_check_seconds_timer();
+    const double eval_time = trace.end_time - trace.start_time;
+    operation_node->stats.current_time += eval_time;
+    if (state->do_priority) {
+      operation_node->eval_time_history.add_sample(eval_time);
+    }
+  }
+  else if (state->do_stats || state->do_priority) {
     const double start_time = PIL_check_seconds_timer();
     operation_node->evaluate(depsgraph);
-    operation_node->stats.current_time += PIL_check_seconds_timer() - start_time;
+    const double eval_time = PIL_check_seconds_timer() - start_time;
+    operation_node->stats.current_time += eval_time;
+    if (state->do_priority) {
+      operation_node->eval_time_history.add_sample(eval_time);
+    }
   }
   else {
     operation_node->evaluate(depsgraph);
@@ -132,7 +173,43 @@ void deg_task_run_func(TaskPool *pool, void *taskdata)
   schedule_children(state, operation_node, schedule_node_to_pool, pool);
 }
 
-bool check_operation_node_visible(OperationNode *op_node)
+void deg_task_run_priority_func(TaskPool *pool, void *UNUSED(taskdata))
+{
+  void *userdata_v = BLI_task_pool_user_data(pool);
+  DepsgraphEvalState *state = (DepsgraphEvalState *)userdata_v;
+
+  /* Every task is pushed together with an operation, but evaluates whichever ready operation has
+   * the highest priority at the moment the task runs. */
+  OperationNode *operation_node;
+  {
+    std::lock_guard lock(state->ready_operations_mutex);
+    BLI_assert(!state->ready_operations.is_empty());
+    std::pop_heap(state->ready_operations.begin(),
+                  state->ready_operations.end(),
+                  operation_has_lower_priority);
+    operation_node = state->ready_operations.pop_last();
+  }
+  evaluate_node(state, operation_node);
+
+  schedule_children(state, operation_node, schedule_node_to_priority_queue, pool);
+}
+
+void schedule_node_to_priority_queue(OperationNode *node,
+                                     const int UNUSED(thread_id),
+                                     TaskPool *pool)
+{
+  DepsgraphEvalState *state = (DepsgraphEvalState *)BLI_task_pool_user_data(pool);
+  {
+    std::lock_guard lock(state->ready_operations_mutex);
+    state->ready_operations.append(node);
+    std::push_heap(state->ready_operations.begin(),
+                   state->ready_operations.end(),
+                   operation_has_lower_priority);
+  }
+  BLI_task_pool_push(pool, deg_task_run_priority_func, nullptr, false, nullptr);
+}
+
+bool check_operation_node_visible(const OperationNode *op_node)
 {
   const ComponentNode *comp_node = op_node->owner;
   /* Special exception, copy on write component is to be always evaluated,
@@ -148,6 +225,7 @@ void calculate_pending_parents_for_node(OperationNode *node)
   /* Update counters, applies for both visible and invisible IDs. */
   node->num_links_pending = 0;
   node->scheduled = false;
+  node->batch_evaluated = false;
   /* Invisible IDs requires no pending operations. */
   if (!check_operation_node_visible(node)) {
     return;
@@ -182,15 +260,307 @@ void calculate_pending_parents(Depsgraph *graph)
   }
 }
 
+bool operation_needs_evaluation(const OperationNode *node)
+{
+  return (node->flag & DEPSOP_FLAG_NEEDS_UPDATE) && check_operation_node_visible(node);
+}
+
+/* Calculate for every operation which needs evaluation the time of the longest chain of
+ * operations starting at it, where cost_fn gives the time of a single operation. This visits the
+ * graph from the operations without evaluated children towards their parents, ignoring cyclic
+ * relations in the same way as the scheduling does.
+ *
+ * Returns the time of the longest chain in the graph, which is the lowest evaluation time that
+ * can be achieved with an unlimited number of threads. */
+template<typename CostFunction>
+double calculate_critical_path_times(Depsgraph *graph, const CostFunction &cost_fn)
+{
+  Vector<OperationNode *> ready_nodes;
+  for (OperationNode *node : graph->operations) {
+    node->critical_path_time = 0.0;
+    node->num_children_pending = 0;
+    if (!operation_needs_evaluation(node)) {
+      continue;
+    }
+    for (Relation *rel : node->outlinks) {
+      const OperationNode *child = (const OperationNode *)rel->to;
+      if ((rel->flag & RELATION_FLAG_CYCLIC) == 0 && operation_needs_evaluation(child)) {
+        node->num_children_pending++;
+      }
+    }
+    if (node->num_children_pending == 0) {
+      ready_nodes.append(node);
+    }
+  }
+
+  double max_time = 0.0;
+  while (!ready_nodes.is_empty()) {
+    OperationNode *node = ready_nodes.pop_last();
+    /* At this point the critical path time contains the longest path of all children. */
+    node->critical_path_time += node->is_noop() ? 0.0 : cost_fn(node);
+    max_time = std::max(max_time, node->critical_path_time);
+    for (Relation *rel : node->inlinks) {
+      if (rel->from->type != NodeType::OPERATION || (rel->flag & RELATION_FLAG_CYCLIC)) {
+        continue;
+      }
+      OperationNode *parent = (OperationNode *)rel->from;
+      if (!operation_needs_evaluation(parent)) {
+        continue;
+      }
+      parent->critical_path_time = std::max(parent->critical_path_time, node->critical_path_time);
+      BLI_assert(parent->num_children_pending > 0);
+      if (--parent->num_children_pending == 0) {
+        ready_nodes.append(parent);
+      }
+    }
+  }
+  return max_time;
+}
+
+/* Cost of operations which were not evaluated yet, so that longer chains of them still get a
+ * higher priority. */
+static constexpr double unknown_operation_cost = 1e-6;
+
 void initialize_execution(DepsgraphEvalState *state, Depsgraph *graph)
 {
-  const bool do_stats = state->do_stats;
+  const bool do_stats = state->do_stats || state->do_priority || state->do_trace;
   calculate_pending_parents(graph);
   /* Clear tags and other things which needs to be clear. */
   for (OperationNode *node : graph->operations) {
     if (do_stats) {
       node->stats.reset_current();
     }
+    if (state->do_trace) {
+      node->trace = OperationTraceTimes();
+    }
+  }
+  if (state->do_priority) {
+    calculate_critical_path_times(graph, [](const OperationNode *node) {
+      return node->eval_time_history.has_samples() ? node->eval_time_history.get_averaged() :
+                                                     unknown_operation_cost;
+    });
+  }
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Transform Batch
+ *
+ * See deg_eval_transform_batch.cc.
+ * \{ */
+
+template<typename ScheduleFunction>
+void transform_batch_evaluate_object(DepsgraphEvalState *state,
+                                     const TransformBatchObject &batch_object,
+                                     ScheduleFunction *schedule_function,
+                                     TaskPool *pool)
+{
+  for (OperationNode *operation : batch_object.operations) {
+    if (!operation->batch_evaluated || operation->is_noop()) {
+      continue;
+    }
+    if (state->do_trace) {
+      operation->trace.enqueue_time = PIL_check_seconds_timer();
+    }
+    evaluate_node(state, operation);
+  }
+  /* Children in the batch are skipped, they are evaluated by a later level or already were. */
+  for (OperationNode *operation : batch_object.operations) {
+    if (operation->batch_evaluated) {
+      schedule_children(state, operation, schedule_function, pool);
+    }
+  }
+}
+
+struct TransformBatchLevelData {
+  DepsgraphEvalState *state;
+  const Vector<TransformBatchObject *> *objects;
+  TaskPool *pool;
+};
+
+void transform_batch_evaluate_object_func(void *__restrict userdata,
+                                          const int i,
+                                          const TaskParallelTLS *__restrict UNUSED(tls))
+{
+  const TransformBatchLevelData *data = static_cast<const TransformBatchLevelData *>(userdata);
+  const TransformBatchObject &batch_object = *(*data->objects)[i];
+  if (!batch_object.is_evaluated) {
+    return;
+  }
+  if (data->state->do_priority) {
+    transform_batch_evaluate_object(
+        data->state, batch_object, schedule_node_to_priority_queue, data->pool);
+  }
+  else {
+    transform_batch_evaluate_object(data->state, batch_object, schedule_node_to_pool, data->pool);
+  }
+}
+
+void transform_batch_run_func(TaskPool *pool, void *taskdata)
+{
+  DepsgraphEvalState *state = (DepsgraphEvalState *)BLI_task_pool_user_data(pool);
+  const TransformBatch *batch = static_cast<const TransformBatch *>(taskdata);
+  const double start_time = state->do_stats ? PIL_check_seconds_timer() : 0.0;
+
+  TaskParallelSettings settings;
+  BLI_parallel_range_settings_defaults(&settings);
+  settings.min_iter_per_thread = 16;
+  for (const Vector<TransformBatchObject *> &level : batch->levels) {
+    TransformBatchLevelData data = {state, &level, pool};
+    BLI_task_parallel_range(
+        0, level.size(), &data, transform_batch_evaluate_object_func, &settings);
+  }
+
+  if (state->do_stats) {
+    int objects_num = 0;
+    for (const TransformBatchObject &batch_object : batch->objects) {
+      objects_num += batch_object.is_evaluated;
+    }
+    printf("Depsgraph transform batch: %d of %d objects in %d levels in %f seconds.\n",
+           objects_num,
+           int(batch->objects.size()),
+           int(batch->levels.size()),
+           PIL_check_seconds_timer() - start_time);
+  }
+}
+
+/** \} */
+
+/* Compare the evaluation time with the critical path time, calculated from the actual timings
+ * of the operations in this evaluation. */
+void report_critical_path_efficiency(Depsgraph *graph, const double eval_time)
+{
+  const double critical_path_time = calculate_critical_path_times(
+      graph, [](const OperationNode *node) { return node->stats.current_time; });
+  printf("Depsgraph critical path: %f seconds, evaluated in %f seconds (%.1f%% efficiency).\n",
+         critical_path_time,
+         eval_time,
+         eval_time > 0.0 ? critical_path_time / eval_time * 100.0 : 100.0);
+}
+
+/* Mark the longest chain of operations of this evaluation, using the actual timings. */
+void trace_mark_critical_path(Depsgraph *graph)
+{
+  calculate_critical_path_times(graph, [](const OperationNode *node) {
+    return node->trace.end_time - node->trace.start_time;
+  });
+  /* The chain starts at the operation with the longest remaining path, and continues with the
+   * child which has the longest remaining path. */
+  OperationNode *node = nullptr;
+  for (OperationNode *operation : graph->operations) {
+    if (operation_needs_evaluation(operation) &&
+        (node == nullptr || operation->critical_path_time > node->critical_path_time)) {
+      node = operation;
+    }
+  }
+  while (node != nullptr) {
+    node->trace.on_critical_path = true;
+    OperationNode *next_node = nullptr;
+    for (Relation *rel : node->outlinks) {
+      OperationNode *child = (OperationNode *)rel->to;
+      if ((rel->flag & RELATION_FLAG_CYCLIC) || !operation_needs_evaluation(child)) {
+        continue;
+      }
+      if (next_node == nullptr || child->critical_path_time > next_node->critical_path_time) {
+        next_node = child;
+      }
+    }
+    node = next_node;
+  }
+}
+
+/* Report how many scripted drivers needed Python, which serializes their evaluation. */
+void report_driver_expression_stats()
+{
+  DriverExpressionStats stats;
+  BKE_driver_expression_stats_get(&stats);
+  if (stats.python == 0) {
+    return;
+  }
+  printf("Depsgraph drivers: %llu simple expressions, %llu Python expressions "
+         "(unknown name: %llu, function arguments: %llu, syntax: %llu, evaluation error: %llu).\n",
+         (unsigned long long)stats.simple,
+         (unsigned long long)stats.python,
+         (unsigned long long)stats.python_unknown_name,
+         (unsigned long long)stats.python_function_args,
+         (unsigned long long)stats.python_syntax,
+         (unsigned long long)stats.python_eval_error);
+}
+
+/* Number of the most expensive bones and solvers reported for every armature. */
+static constexpr int pose_stats_report_num = 5;
+
+struct PoseTimeStat {
+  const char *name;
+  const char *type;
+  double time;
+};
+
+void report_pose_time_stats(const char *title, Vector<PoseTimeStat> &stats)
+{
+  std::sort(stats.begin(), stats.end(), [](const PoseTimeStat &a, const PoseTimeStat &b) {
+    return a.time > b.time;
+  });
+  printf("  %s:", title);
+  for (const int i : IndexRange(std::min<int64_t>(stats.size(), pose_stats_report_num))) {
+    printf(" %s'%s' %f", stats[i].type, stats[i].name, stats[i].time);
+  }
+  printf("\n");
+}
+
+/* Report the cost of the bones and of the IK solvers of every evaluated pose. Operation
+ * statistics are expected to be aggregated to the components already. */
+void report_pose_stats(Depsgraph *graph)
+{
+  for (IDNode *id_node : graph->id_nodes) {
+    if (GS(id_node->id_orig->name) != ID_OB) {
+      continue;
+    }
+    const Object *object = reinterpret_cast<const Object *>(id_node->id_cow);
+    if (object->type != OB_ARMATURE) {
+      continue;
+    }
+
+    Vector<PoseTimeStat> bone_stats;
+    Vector<PoseTimeStat> solver_stats;
+    double bones_time = 0.0;
+    double solvers_time = 0.0;
+    for (ComponentNode *comp_node : id_node->components.values()) {
+      if (comp_node->type == NodeType::BONE) {
+        if (comp_node->stats.current_time > 0.0) {
+          bone_stats.append({comp_node->name.c_str(), "", comp_node->stats.current_time});
+          bones_time += comp_node->stats.current_time;
+        }
+      }
+      else if (comp_node->type == NodeType::EVAL_POSE) {
+        for (OperationNode *op_node : comp_node->operations) {
+          if (ELEM(op_node->opcode,
+                   OperationCode::POSE_IK_SOLVER,
+                   OperationCode::POSE_SPLINE_IK_SOLVER) &&
+              op_node->stats.current_time > 0.0) {
+            const char *type = (op_node->opcode == OperationCode::POSE_IK_SOLVER) ? "IK " :
+                                                                                    "Spline IK ";
+            solver_stats.append({op_node->name.c_str(), type, op_node->stats.current_time});
+            solvers_time += op_node->stats.current_time;
+          }
+        }
+      }
+    }
+    if (bone_stats.is_empty() && solver_stats.is_empty()) {
+      continue;
+    }
+
+    printf("Depsgraph pose %s: %d bones in %f seconds, %d solvers in %f seconds.\n",
+           id_node->id_orig->name + 2,
+           int(bone_stats.size()),
+           bones_time,
+           int(solver_stats.size()),
+           solvers_time);
+    if (!bone_stats.is_empty()) {
+      report_pose_time_stats("slowest bones", bone_stats);
+    }
+    if (!solver_stats.is_empty()) {
+      report_pose_time_stats("slowest solvers", solver_stats);
+    }
   }
 }
 
@@ -269,11 +639,17 @@ void schedule_node(DepsgraphEvalState *state,
   /* Actually schedule the node. */
   bool is_scheduled = atomic_fetch_and_or_uint8((uint8_t *)&node->scheduled, (uint8_t) true);
   if (!is_scheduled) {
-    if (node->is_noop()) {
+    if (node->batch_evaluated) {
+      /* The transform batch task evaluates the node and schedules its children. */
+    }
+    else if (node->is_noop()) {
       /* skip NOOP node, schedule children right away */
       schedule_children(state, node, schedule_function, schedule_function_args...);
     }
     else {
+      if (state->do_trace) {
+        node->trace.enqueue_time = PIL_check_seconds_timer();
+      }
       /* children are scheduled once this task is completed */
       schedule_function(node, 0, schedule_function_args...);
     }
@@ -389,6 +765,13 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
   state.graph = graph;
   state.do_stats = graph->debug.do_time_debug();
   state.need_single_thread_pass = false;
+  state.do_priority = (U.depsgraph_flag & USER_DEPSGRAPH_PRIORITY_SCHEDULING) &&
+                      !(G.debug & G_DEBUG_DEPSGRAPH_NO_THREADS);
+  state.do_trace = deg_debug_trace_is_active();
+  const double start_time = (state.do_stats || state.do_trace) ? PIL_check_seconds_timer() : 0.0;
+  if (state.do_stats) {
+    BKE_driver_expression_stats_reset();
+  }
   /* Prepare all nodes for evaluation. */
   initialize_execution(&state, graph);
 
@@ -402,8 +785,26 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
 
   /* After that, process all other nodes. */
   state.stage = EvaluationStage::THREADED_EVALUATION;
+  /* The batch only saves task overhead, so it is not used without threads. This also gives a
+   * reference evaluation of the batched objects. */
+  bool use_transform_batch = false;
+  if ((G.debug & G_DEBUG_DEPSGRAPH_NO_THREADS) == 0) {
+    if (graph->transform_batch == nullptr) {
+      graph->transform_batch = transform_batch_build(graph);
+    }
+    use_transform_batch = transform_batch_prepare(graph->transform_batch);
+  }
   task_pool = deg_evaluate_task_pool_create(&state);
-  schedule_graph(&state, schedule_node_to_pool, task_pool);
+  if (use_transform_batch) {
+    BLI_task_pool_push(
+        task_pool, transform_batch_run_func, graph->transform_batch, false, nullptr);
+  }
+  if (state.do_priority) {
+    schedule_graph(&state, schedule_node_to_priority_queue, task_pool);
+  }
+  else {
+    schedule_graph(&state, schedule_node_to_pool, task_pool);
+  }
   BLI_task_pool_work_and_wait(task_pool);
   BLI_task_pool_free(task_pool);
 
@@ -412,11 +813,22 @@ void deg_evaluate_on_refresh(Depsgraph *graph)
     evaluate_graph_single_threaded(&state);
   }
 
+  if (state.do_stats) {
+    report_critical_path_efficiency(graph, PIL_check_seconds_timer() - start_time);
+  }
+  if (state.do_trace) {
+    const double end_time = PIL_check_seconds_timer();
+    trace_mark_critical_path(graph);
+    deg_debug_trace_add_evaluation(graph, start_time, end_time);
+  }
+
   /* Finalize statistics gathering. This is because we only gather single
    * operation timing here, without aggregating anything to avoid any extra
    * synchronization. */
   if (state.do_stats) {
     deg_eval_stats_aggregate(graph);
+    report_driver_expression_stats();
+    report_pose_stats(graph);
   }
   /* Clear any uncleared tags - just in case. */
   deg_graph_clear_tags(graph);
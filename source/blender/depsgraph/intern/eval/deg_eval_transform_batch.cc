@@ -0,0 +1,281 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ *
+ * Animated objects which only depend on themselves and on the transform of other such objects,
+ * like animated props parented to each other, are evaluated by a single task of the threaded
+ * evaluation: one parallel loop over the objects per dependency level instead of a task for every
+ * operation. The batched operations are skipped by the regular scheduling, the batch task
+ * schedules their children once an object has been evaluated.
+ */
+
+#include "intern/eval/deg_eval_transform_batch.h"
+
+#include <algorithm>
+
+#include "BLI_map.hh"
+#include "BLI_utildefines.h"
+
+#include "DNA_object_types.h"
+
+#include "intern/depsgraph.h"
+#include "intern/depsgraph_relation.h"
+#include "intern/node/deg_node.h"
+#include "intern/node/deg_node_component.h"
+#include "intern/node/deg_node_id.h"
+#include "intern/node/deg_node_operation.h"
+
+namespace blender::deg {
+
+namespace {
+
+/* Below this number of objects the tasks of the regular scheduling are cheap enough. */
+constexpr int transform_batch_min_objects = 64;
+
+struct TransformBatchBuilder {
+  TransformBatch *batch;
+  /* Index into the objects of the batch, or one of the values below. */
+  Map<const IDNode *, int> object_index_by_id;
+  static constexpr int rejected = -1;
+  static constexpr int in_progress = -2;
+};
+
+bool is_transform_batch_component(const ComponentNode *component)
+{
+  return ELEM(component->type, NodeType::ANIMATION, NodeType::PARAMETERS, NodeType::TRANSFORM);
+}
+
+bool is_transform_batch_candidate(const IDNode *id_node)
+{
+  if (GS(id_node->id_orig->name) != ID_OB) {
+    return false;
+  }
+  /* Meta-balls are evaluated in a single threaded pass. */
+  const Object *object = reinterpret_cast<const Object *>(id_node->id_cow);
+  if (object->type == OB_MBALL) {
+    return false;
+  }
+  const ComponentNode *transform = id_node->find_component(NodeType::TRANSFORM);
+  return transform != nullptr && transform->exit_operation != nullptr &&
+         transform->affects_directly_visible;
+}
+
+/* Parents which are never evaluated during the threaded evaluation: copy-on-write operations
+ * are evaluated in the previous stage, and invisible operations are not evaluated at all. */
+bool is_transform_batch_ignored_parent(const OperationNode *operation)
+{
+  const ComponentNode *component = operation->owner;
+  return component->type == NodeType::COPY_ON_WRITE || !component->affects_directly_visible;
+}
+
+/* Operations of other IDs which don't have to be evaluated before the batch. The animation of an
+ * action does nothing, but is tagged for update by the time source on every frame change. */
+bool is_transform_batch_satisfied_operation(const OperationNode *operation)
+{
+  const ComponentNode *component = operation->owner;
+  if (!operation->is_noop() || component->type != NodeType::ANIMATION ||
+      GS(component->owner->id_orig->name) != ID_AC) {
+    return false;
+  }
+  for (const Relation *rel : operation->inlinks) {
+    if (rel->from->type == NodeType::TIMESOURCE || (rel->flag & RELATION_FLAG_CYCLIC)) {
+      continue;
+    }
+    if (rel->from->type == NodeType::OPERATION &&
+        is_transform_batch_ignored_parent((const OperationNode *)rel->from)) {
+      continue;
+    }
+    return false;
+  }
+  return true;
+}
+
+/* Sort the operations of an object so that they are evaluated after the operations of the same
+ * object they depend on. Returns false when that is not possible. */
+bool transform_batch_sort_operations(Vector<OperationNode *> &operations)
+{
+  Vector<OperationNode *> sorted_operations;
+  Vector<int> num_links_pending(operations.size(), 0);
+  for (const int i : operations.index_range()) {
+    for (Relation *rel : operations[i]->inlinks) {
+      if (rel->from->type == NodeType::OPERATION && (rel->flag & RELATION_FLAG_CYCLIC) == 0 &&
+          operations.contains((OperationNode *)rel->from)) {
+        num_links_pending[i]++;
+      }
+    }
+    if (num_links_pending[i] == 0) {
+      sorted_operations.append(operations[i]);
+    }
+  }
+  for (int i = 0; i < sorted_operations.size(); i++) {
+    for (Relation *rel : sorted_operations[i]->outlinks) {
+      const int child_index = operations.first_index_of_try((OperationNode *)rel->to);
+      if (child_index != -1 && (rel->flag & RELATION_FLAG_CYCLIC) == 0 &&
+          --num_links_pending[child_index] == 0) {
+        sorted_operations.append(operations[child_index]);
+      }
+    }
+  }
+  if (sorted_operations.size() != operations.size()) {
+    return false;
+  }
+  operations = std::move(sorted_operations);
+  return true;
+}
+
+/* Add the object to the batch if all operations it waits for are part of the batch. Transform
+ * operations may depend on the transform of other objects in the batch, which are added first.
+ * Returns the index of the object in the batch, or #TransformBatchBuilder::rejected. */
+int transform_batch_add_object(TransformBatchBuilder &builder, const IDNode *id_node)
+{
+  const int *existing_index = builder.object_index_by_id.lookup_ptr(id_node);
+  if (existing_index != nullptr) {
+    return (*existing_index == TransformBatchBuilder::in_progress) ?
+               TransformBatchBuilder::rejected :
+               *existing_index;
+  }
+  if (!is_transform_batch_candidate(id_node)) {
+    builder.object_index_by_id.add_new(id_node, TransformBatchBuilder::rejected);
+    return TransformBatchBuilder::rejected;
+  }
+  builder.object_index_by_id.add_new(id_node, TransformBatchBuilder::in_progress);
+
+  TransformBatchObject batch_object;
+  batch_object.transform_exit_operation = id_node->find_component(NodeType::TRANSFORM)
+                                              ->exit_operation;
+  batch_object.level = 0;
+  batch_object.is_evaluated = false;
+  for (const ComponentNode *component : id_node->components.values()) {
+    if (is_transform_batch_component(component) && component->affects_directly_visible) {
+      batch_object.operations.extend(component->operations);
+    }
+  }
+
+  bool is_valid = true;
+  for (const OperationNode *operation : batch_object.operations) {
+    for (const Relation *rel : operation->inlinks) {
+      if (rel->from->type != NodeType::OPERATION || (rel->flag & RELATION_FLAG_CYCLIC)) {
+        continue;
+      }
+      const OperationNode *from = (const OperationNode *)rel->from;
+      if (is_transform_batch_ignored_parent(from) || is_transform_batch_satisfied_operation(from)) {
+        continue;
+      }
+      const IDNode *from_id_node = from->owner->owner;
+      if (from_id_node == id_node) {
+        is_valid &= is_transform_batch_component(from->owner);
+      }
+      else if (operation->owner->type == NodeType::TRANSFORM &&
+               from->owner->type == NodeType::TRANSFORM) {
+        const int from_index = transform_batch_add_object(builder, from_id_node);
+        if (from_index == TransformBatchBuilder::rejected) {
+          is_valid = false;
+        }
+        else {
+          batch_object.dependencies.append_non_duplicates(from_index);
+          batch_object.level = std::max(batch_object.level,
+                                        builder.batch->objects[from_index].level + 1);
+        }
+      }
+      else {
+        is_valid = false;
+      }
+      if (!is_valid) {
+        break;
+      }
+    }
+    if (!is_valid) {
+      break;
+    }
+  }
+  if (is_valid) {
+    is_valid = transform_batch_sort_operations(batch_object.operations);
+  }
+
+  int &index = builder.object_index_by_id.lookup(id_node);
+  if (!is_valid) {
+    index = TransformBatchBuilder::rejected;
+    return TransformBatchBuilder::rejected;
+  }
+  index = builder.batch->objects.append_and_get_index(std::move(batch_object));
+  return index;
+}
+
+}  // namespace
+
+TransformBatch *transform_batch_build(const Depsgraph *graph)
+{
+  TransformBatch *batch = new TransformBatch();
+  TransformBatchBuilder builder;
+  builder.batch = batch;
+  for (const IDNode *id_node : graph->id_nodes) {
+    transform_batch_add_object(builder, id_node);
+  }
+  if (batch->objects.size() < transform_batch_min_objects) {
+    batch->objects.clear();
+    return batch;
+  }
+
+  int levels_num = 0;
+  for (const TransformBatchObject &batch_object : batch->objects) {
+    levels_num = std::max(levels_num, batch_object.level + 1);
+  }
+  batch->levels.resize(levels_num);
+  for (TransformBatchObject &batch_object : batch->objects) {
+    batch->levels[batch_object.level].append(&batch_object);
+  }
+  return batch;
+}
+
+bool transform_batch_prepare(TransformBatch *batch)
+{
+  int objects_num = 0;
+  for (Vector<TransformBatchObject *> &level : batch->levels) {
+    for (TransformBatchObject *batch_object : level) {
+      batch_object->is_evaluated = (batch_object->transform_exit_operation->flag &
+                                    DEPSOP_FLAG_NEEDS_UPDATE) != 0;
+      /* The batch does not wait for the transform of objects it does not evaluate. Tags are
+       * flushed to the exit operation, so it tells whether any transform operation is tagged. */
+      for (const int index : batch_object->dependencies) {
+        const TransformBatchObject &dependency = batch->objects[index];
+        if (!dependency.is_evaluated &&
+            (dependency.transform_exit_operation->flag & DEPSOP_FLAG_NEEDS_UPDATE)) {
+          batch_object->is_evaluated = false;
+        }
+      }
+      objects_num += batch_object->is_evaluated;
+    }
+  }
+  if (objects_num < transform_batch_min_objects) {
+    return false;
+  }
+
+  for (const TransformBatchObject &batch_object : batch->objects) {
+    if (!batch_object.is_evaluated) {
+      continue;
+    }
+    for (OperationNode *operation : batch_object.operations) {
+      if (operation->flag & DEPSOP_FLAG_NEEDS_UPDATE) {
+        operation->batch_evaluated = true;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace blender::deg
@@ -0,0 +1,64 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ *
+ * Objects whose transform is evaluated by a single task of the threaded evaluation.
+ */
+
+#pragma once
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_vector.hh"
+
+namespace blender::deg {
+
+struct Depsgraph;
+struct OperationNode;
+
+struct TransformBatchObject {
+  /* Visible operations of the batch components of the object, in evaluation order. */
+  Vector<OperationNode *> operations;
+  /* The object is evaluated by the batch when its transform is tagged for update. */
+  OperationNode *transform_exit_operation;
+  /* Indices of the objects in the batch whose transform this object depends on. */
+  Vector<int> dependencies;
+  /* Objects are evaluated after all objects of a lower level, which they depend on. */
+  int level;
+  /* Set for every evaluation, see #transform_batch_prepare. */
+  bool is_evaluated;
+};
+
+/* Only depends on the relations and the visibility of the graph, which are both updated by
+ * rebuilding the graph, so the batch is built once and stored in #Depsgraph::transform_batch. */
+struct TransformBatch {
+  Vector<TransformBatchObject> objects;
+  /* Objects grouped by their level. */
+  Vector<Vector<TransformBatchObject *>> levels;
+
+  MEM_CXX_CLASS_ALLOC_FUNCS("TransformBatch");
+};
+
+/* Find the objects which can be evaluated in a batch. */
+TransformBatch *transform_batch_build(const Depsgraph *graph);
+
+/* Mark the tagged operations of the objects to evaluate in the batch, so that the regular
+ * scheduling skips them. Returns false when there are too few of them for a batch. */
+bool transform_batch_prepare(TransformBatch *batch);
+
+}  // namespace blender::deg
@@ -0,0 +1,266 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/** \file
+ * \ingroup depsgraph
+ */
+
+#include "testing/testing.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_listbase.h"
+#include "BLI_rand.hh"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+#include "BLI_vector.hh"
+
+#include "BKE_action.h"
+#include "BKE_anim_data.h"
+#include "BKE_appdir.h"
+#include "BKE_blender.h"
+#include "BKE_collection.h"
+#include "BKE_constraint.h"
+#include "BKE_fcurve.h"
+#include "BKE_global.h"
+#include "BKE_idtype.h"
+#include "BKE_image.h"
+#include "BKE_lib_id.h"
+#include "BKE_main.h"
+#include "BKE_modifier.h"
+#include "BKE_node.h"
+#include "BKE_object.h"
+#include "BKE_scene.h"
+
+#include "DEG_depsgraph.h"
+#include "DEG_depsgraph_build.h"
+#include "DEG_depsgraph_query.h"
+
+#include "DNA_anim_types.h"
+#include "DNA_constraint_types.h"
+#include "DNA_genfile.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "ED_keyframing.h"
+
+#include "IMB_imbuf.h"
+
+#include "RNA_define.h"
+
+#include "CLG_log.h"
+
+#include "intern/depsgraph.h"
+#include "intern/eval/deg_eval_transform_batch.h"
+
+namespace blender::deg::tests {
+
+class TransformBatchTest : public testing::Test {
+ protected:
+  Main *bmain_ = nullptr;
+  Scene *scene_ = nullptr;
+  Vector<Object *> objects_;
+  Vector<::Depsgraph *> depsgraphs_;
+
+  static void SetUpTestCase()
+  {
+    testing::Test::SetUpTestCase();
+
+    /* Same initialization as for loading a blend-file and evaluating its depsgraph. */
+    CLG_init();
+    BLI_threadapi_init();
+    DNA_sdna_current_init();
+    BKE_blender_globals_init();
+    BKE_idtype_init();
+    BKE_appdir_init();
+    IMB_init();
+    BKE_images_init();
+    BKE_modifier_init();
+    DEG_register_node_types();
+    RNA_init();
+    BKE_node_system_init();
+
+    G.background = true;
+  }
+
+  static void TearDownTestCase()
+  {
+    BKE_blender_free();
+    RNA_exit();
+    DEG_free_node_types();
+    DNA_sdna_current_free();
+    BLI_threadapi_exit();
+    BKE_blender_atexit();
+    BKE_appdir_exit();
+    CLG_exit();
+
+    testing::Test::TearDownTestCase();
+  }
+
+  void SetUp() override
+  {
+    bmain_ = BKE_main_new();
+    scene_ = BKE_scene_add(bmain_, "Scene");
+  }
+
+  void TearDown() override
+  {
+    for (::Depsgraph *depsgraph : depsgraphs_) {
+      DEG_graph_free(depsgraph);
+    }
+    BKE_main_free(bmain_);
+  }
+
+  /* Add an empty with keyframed location and rotation, the way animated props are set up. */
+  Object *add_animated_object(RandomNumberGenerator &rng)
+  {
+    char name[MAX_ID_NAME - 2];
+    BLI_snprintf(name, sizeof(name), "Prop%d", int(objects_.size()));
+    Object *object = BKE_object_add_only_object(bmain_, OB_EMPTY, name);
+    BKE_collection_object_add(bmain_, scene_->master_collection, object);
+
+    bAction *action = BKE_action_add(bmain_, name);
+    AnimData *adt = BKE_animdata_ensure_id(&object->id);
+    adt->action = action;
+    id_us_plus(&action->id);
+    for (const char *rna_path : {"location", "rotation_euler"}) {
+      for (const int axis : IndexRange(3)) {
+        FCurve *fcu = BKE_fcurve_create();
+        fcu->rna_path = BLI_strdup(rna_path);
+        fcu->array_index = axis;
+        for (const int key : IndexRange(4)) {
+          insert_vert_fcurve(fcu,
+                             1.0f + key * 10.0f,
+                             rng.get_float() * 4.0f - 2.0f,
+                             BEZT_KEYTYPE_KEYFRAME,
+                             INSERTKEY_NO_USERPREF);
+        }
+        BLI_addtail(&action->curves, fcu);
+      }
+    }
+    objects_.append(object);
+    return object;
+  }
+
+  void add_constraint(Object *object, const short type, Object *target)
+  {
+    bConstraint *con = BKE_constraint_add_for_object(object, nullptr, type);
+    switch (type) {
+      case CONSTRAINT_TYPE_LOCLIKE:
+        static_cast<bLocateLikeConstraint *>(con->data)->tar = target;
+        break;
+      case CONSTRAINT_TYPE_ROTLIKE:
+        static_cast<bRotateLikeConstraint *>(con->data)->tar = target;
+        break;
+    }
+  }
+
+  ::Depsgraph *evaluate(const float frame, const bool use_threads)
+  {
+    ViewLayer *view_layer = static_cast<ViewLayer *>(scene_->view_layers.first);
+    ::Depsgraph *depsgraph = DEG_graph_new(bmain_, scene_, view_layer, DAG_EVAL_VIEWPORT);
+    depsgraphs_.append(depsgraph);
+    DEG_graph_build_from_view_layer(depsgraph);
+    evaluate(depsgraph, frame, use_threads);
+    return depsgraph;
+  }
+
+  static void evaluate(::Depsgraph *depsgraph, const float frame, const bool use_threads)
+  {
+    const int debug_flags = G.debug;
+    SET_FLAG_FROM_TEST(G.debug, !use_threads, G_DEBUG_DEPSGRAPH_NO_THREADS);
+    DEG_evaluate_on_framechange(depsgraph, frame);
+    G.debug = debug_flags;
+  }
+
+  static int batch_evaluated_objects_num(::Depsgraph *depsgraph)
+  {
+    const TransformBatch *batch = reinterpret_cast<Depsgraph *>(depsgraph)->transform_batch;
+    if (batch == nullptr) {
+      return 0;
+    }
+    int objects_num = 0;
+    for (const TransformBatchObject &batch_object : batch->objects) {
+      objects_num += batch_object.is_evaluated;
+    }
+    return objects_num;
+  }
+
+  /* Batching must not change the result, not even in the last bit. */
+  void expect_same_world_matrices(::Depsgraph *depsgraph, ::Depsgraph *reference)
+  {
+    for (Object *object : objects_) {
+      const Object *object_eval = DEG_get_evaluated_object(depsgraph, object);
+      const Object *reference_eval = DEG_get_evaluated_object(reference, object);
+      for (const int i : IndexRange(4)) {
+        for (const int j : IndexRange(4)) {
+          EXPECT_EQ(object_eval->obmat[i][j], reference_eval->obmat[i][j])
+              << object->id.name + 2 << " obmat[" << i << "][" << j << "]";
+        }
+      }
+    }
+  }
+};
+
+TEST_F(TransformBatchTest, ParentedAndConstrainedProps)
+{
+  RandomNumberGenerator rng(0);
+  for (const int i : IndexRange(128)) {
+    Object *object = add_animated_object(rng);
+    /* Chains of four props, each parented to the previous one. */
+    if (i % 4 != 0) {
+      object->parent = objects_[i - 1];
+      object->partype = PAROBJECT;
+    }
+    /* Constraints targeting props of other chains. */
+    if (i % 8 == 5) {
+      add_constraint(object, CONSTRAINT_TYPE_LOCLIKE, objects_[i - 5]);
+    }
+    if (i % 8 == 6 && i >= 8) {
+      add_constraint(object, CONSTRAINT_TYPE_ROTLIKE, objects_[i - 7]);
+    }
+  }
+
+  ::Depsgraph *depsgraph = evaluate(1.0f, true);
+  ASSERT_NE(reinterpret_cast<Depsgraph *>(depsgraph)->transform_batch, nullptr);
+  EXPECT_EQ(batch_evaluated_objects_num(depsgraph), objects_.size());
+  expect_same_world_matrices(depsgraph, evaluate(1.0f, false));
+
+  /* Later frames reuse the batch built with the relations. */
+  for (const float frame : {7.5f, 23.25f, 40.0f}) {
+    evaluate(depsgraph, frame, true);
+    EXPECT_EQ(batch_evaluated_objects_num(depsgraph), objects_.size());
+    expect_same_world_matrices(depsgraph, evaluate(frame, false));
+  }
+}
+
+TEST_F(TransformBatchTest, TooFewProps)
+{
+  RandomNumberGenerator rng(0);
+  for (const int i : IndexRange(16)) {
+    Object *object = add_animated_object(rng);
+    if (i % 4 != 0) {
+      object->parent = objects_[i - 1];
+      object->partype = PAROBJECT;
+    }
+  }
+
+  ::Depsgraph *depsgraph = evaluate(3.0f, true);
+  EXPECT_EQ(batch_evaluated_objects_num(depsgraph), 0);
+  expect_same_world_matrices(depsgraph, evaluate(3.0f, false));
+}
+
+}  // namespace blender::deg::tests
@@ -209,7 +209,12 @@ const char *operationCodeAsString(OperationCode opcode)
   return "UNKNOWN";
 }
 
-OperationNode::OperationNode() : name_tag(-1), flag(0)
+OperationNode::OperationNode()
+    : batch_evaluated(false),
+      name_tag(-1),
+      flag(0),
+      critical_path_time(0.0),
+      num_children_pending(0)
 {
 }
 
@@ -25,6 +25,8 @@
 
 #include "intern/node/deg_node.h"
 
+#include "intern/debug/deg_debug_trace.h"
+#include "intern/debug/deg_time_average.h"
 #include "intern/depsgraph_type.h"
 
 struct Depsgraph;
@@ -264,6 +266,8 @@ struct OperationNode : public Node {
   /* How many inlinks are we still waiting on before we can be evaluated. */
   uint32_t num_links_pending;
   bool scheduled;
+  /* Operation is evaluated by the transform batch task instead of being scheduled on its own. */
+  bool batch_evaluated;
 
   /* Identifier for the operation being performed. */
   OperationCode opcode;
@@ -272,6 +276,17 @@ struct OperationNode : public Node {
   /* (OperationFlag) extra settings affecting evaluation. */
   int flag;
 
+  /* Evaluation times of the last evaluations, used by the priority scheduling. */
+  AveragedTimeSampler<4> eval_time_history;
+  /* Estimated time it takes to evaluate this operation and the longest chain of operations which
+   * depend on it. Operations with a longer remaining path are scheduled first. */
+  double critical_path_time;
+  /* Number of dependent operations whose critical path time is not calculated yet. */
+  uint32_t num_children_pending;
+
+  /* Timings of the last evaluation, see #DEG_debug_trace_start. */
+  OperationTraceTimes trace;
+
   DEG_DEPSNODE_DECLARE;
 };
 
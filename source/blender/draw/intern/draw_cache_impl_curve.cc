@@ -56,6 +56,7 @@
 using blender::Array;
 using blender::float3;
 using blender::IndexRange;
+using blender::MutableSpan;
 using blender::Span;
 
 /* See: edit_curve_point_vert.glsl for duplicate includes. */
@@ -571,17 +572,13 @@ static void curve_create_curves_pos(CurveRenderData *rdata, GPUVertBuf *vbo_curv
   GPU_vertbuf_data_alloc(vbo_curves_pos, vert_len);
 
   const CurveEval &curve_eval = *rdata->curve_eval;
-  Span<SplinePtr> splines = curve_eval.splines();
   Array<int> offsets = curve_eval.evaluated_point_offsets();
   BLI_assert(offsets.last() == vert_len);
 
-  for (const int i_spline : splines.index_range()) {
-    Span<float3> positions = splines[i_spline]->evaluated_positions();
-    for (const int i_point : positions.index_range()) {
-      GPU_vertbuf_attr_set(
-          vbo_curves_pos, attr_id.pos, offsets[i_spline] + i_point, positions[i_point]);
-    }
-  }
+  /* The format only contains the position, so the splines can be evaluated into the buffer. */
+  MutableSpan<float3> positions(static_cast<float3 *>(GPU_vertbuf_get_data(vbo_curves_pos)),
+                                vert_len);
+  curve_eval.evaluate_positions(offsets, positions);
 }
 
 static void curve_create_curves_lines(CurveRenderData *rdata, GPUIndexBuf *ibo_curve_lines)
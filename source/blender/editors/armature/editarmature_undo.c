@@ -179,7 +179,7 @@ static bool armature_undosys_step_encode(struct bContext *C, struct Main *bmain,
   return true;
 }
 
-static void armature_undosys_step_decode(struct bContext *C,
+static bool armature_undosys_step_decode(struct bContext *C,
                                          struct Main *bmain,
                                          UndoStep *us_p,
                                          const eUndoStepDir UNUSED(dir),
@@ -219,6 +219,7 @@ static void armature_undosys_step_decode(struct bContext *C,
   bmain->is_memfile_undo_flush_needed = true;
 
   WM_event_add_notifier(C, NC_GEOM | ND_DATA, NULL);
+  return true;
 }
 
 static void armature_undosys_step_free(UndoStep *us_p)
@@ -240,7 +240,7 @@ static bool curve_undosys_step_encode(struct bContext *C, struct Main *bmain, Un
   return true;
 }
 
-static void curve_undosys_step_decode(struct bContext *C,
+static bool curve_undosys_step_decode(struct bContext *C,
                                       struct Main *bmain,
                                       UndoStep *us_p,
                                       const eUndoStepDir UNUSED(dir),
@@ -280,6 +280,7 @@ static void curve_undosys_step_decode(struct bContext *C,
   bmain->is_memfile_undo_flush_needed = true;
 
   WM_event_add_notifier(C, NC_GEOM | ND_DATA, NULL);
+  return true;
 }
 
 static void curve_undosys_step_free(UndoStep *us_p)
@@ -364,7 +364,7 @@ static bool font_undosys_step_encode(struct bContext *C, struct Main *bmain, Und
   return true;
 }
 
-static void font_undosys_step_decode(struct bContext *C,
+static bool font_undosys_step_decode(struct bContext *C,
                                      struct Main *bmain,
                                      UndoStep *us_p,
                                      const eUndoStepDir UNUSED(dir),
@@ -389,6 +389,7 @@ static void font_undosys_step_decode(struct bContext *C,
   cu->editfont->needs_flush_to_id = 1;
   bmain->is_memfile_undo_flush_needed = true;
   WM_event_add_notifier(C, NC_GEOM | ND_DATA, NULL);
+  return true;
 }
 
 static void font_undosys_step_free(UndoStep *us_p)
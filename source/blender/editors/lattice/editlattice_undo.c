@@ -213,7 +213,7 @@ static bool lattice_undosys_step_encode(struct bContext *C, Main *bmain, UndoSte
   return true;
 }
 
-static void lattice_undosys_step_decode(struct bContext *C,
+static bool lattice_undosys_step_decode(struct bContext *C,
                                         struct Main *bmain,
                                         UndoStep *us_p,
                                         const eUndoStepDir UNUSED(dir),
@@ -253,6 +253,7 @@ static void lattice_undosys_step_decode(struct bContext *C,
   bmain->is_memfile_undo_flush_needed = true;
 
   WM_event_add_notifier(C, NC_GEOM | ND_DATA, NULL);
+  return true;
 }
 
 static void lattice_undosys_step_free(UndoStep *us_p)
@@ -846,7 +846,7 @@ static bool mesh_undosys_step_encode(struct bContext *C, struct Main *bmain, Und
   return true;
 }
 
-static void mesh_undosys_step_decode(struct bContext *C,
+static bool mesh_undosys_step_decode(struct bContext *C,
                                      struct Main *bmain,
                                      UndoStep *us_p,
                                      const eUndoStepDir UNUSED(dir),
@@ -890,6 +890,7 @@ static void mesh_undosys_step_decode(struct bContext *C,
   bmain->is_memfile_undo_flush_needed = true;
 
   WM_event_add_notifier(C, NC_GEOM | ND_DATA, NULL);
+  return true;
 }
 
 static void mesh_undosys_step_free(UndoStep *us_p)
@@ -247,7 +247,7 @@ static bool particle_undosys_step_encode(struct bContext *C,
   return true;
 }
 
-static void particle_undosys_step_decode(struct bContext *C,
+static bool particle_undosys_step_decode(struct bContext *C,
                                          struct Main *UNUSED(bmain),
                                          UndoStep *us_p,
                                          const eUndoStepDir UNUSED(dir),
@@ -267,7 +267,7 @@ static void particle_undosys_step_decode(struct bContext *C,
    * setup compared to most other modes which we can't ensure succeeds. */
   if (UNLIKELY(edit == NULL)) {
     BLI_assert(0);
-    return;
+    return false;
   }
 
   undoptcache_to_editcache(&us->data, edit);
@@ -281,6 +281,7 @@ static void particle_undosys_step_decode(struct bContext *C,
   ED_undo_object_set_active_or_warn(scene, CTX_data_view_layer(C), ob, us_p->name, &LOG);
 
   BLI_assert(particle_undosys_poll(C));
+  return true;
 }
 
 static void particle_undosys_step_free(UndoStep *us_p)
@@ -123,7 +123,7 @@ static bool paintcurve_undosys_step_encode(struct bContext *C,
   return true;
 }
 
-static void paintcurve_undosys_step_decode(struct bContext *UNUSED(C),
+static bool paintcurve_undosys_step_decode(struct bContext *UNUSED(C),
                                            struct Main *UNUSED(bmain),
                                            UndoStep *us_p,
                                            const eUndoStepDir UNUSED(dir),
@@ -131,6 +131,7 @@ static void paintcurve_undosys_step_decode(struct bContext *UNUSED(C),
 {
   PaintCurveUndoStep *us = (PaintCurveUndoStep *)us_p;
   undocurve_to_paintcurve(&us->data, us->pc_ref.ptr);
+  return true;
 }
 
 static void paintcurve_undosys_step_free(UndoStep *us_p)
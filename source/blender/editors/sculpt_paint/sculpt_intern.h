@@ -673,6 +673,9 @@ typedef struct SculptUndoNode {
   int *face_sets;
 
   size_t undo_size;
+
+  /* Arrays of the node which have been written to the undo cache file and freed. */
+  struct SculptUndoNodePage *page;
 } SculptUndoNode;
 
 /* Factor of brush to have rake point following behind
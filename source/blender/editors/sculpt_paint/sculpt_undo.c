@@ -23,12 +23,15 @@
  */
 
 #include <stddef.h>
+#include <stdio.h>
 
 #include "MEM_guardedalloc.h"
 
 #include "BLI_ghash.h"
 #include "BLI_listbase.h"
 #include "BLI_math.h"
+#include "BLI_page_file.h"
+#include "BLI_path_util.h"
 #include "BLI_string.h"
 #include "BLI_task.h"
 #include "BLI_threads.h"
@@ -40,6 +43,7 @@
 #include "DNA_scene_types.h"
 #include "DNA_screen_types.h"
 
+#include "BKE_appdir.h"
 #include "BKE_ccg.h"
 #include "BKE_context.h"
 #include "BKE_customdata.h"
@@ -107,7 +111,11 @@
  * does modifications on it.
  *
  * End of dynamic topology and symmetrize in this mode are handled in a special
- * manner as well. */
+ * manner as well.
+ *
+ * Arrays of steps which are far from the most recent one are paged out to a
+ * compressed cache file in the session temporary directory, and read back when
+ * the step is undone or redone. */
 
 typedef struct UndoSculpt {
   ListBase nodes;
@@ -116,6 +124,7 @@ typedef struct UndoSculpt {
 } UndoSculpt;
 
 static UndoSculpt *sculpt_undo_get_nodes(void);
+static void sculpt_undo_node_page_free(SculptUndoNode *unode);
 
 static void update_cb(PBVHNode *node, void *rebuild)
 {
@@ -898,6 +907,8 @@ static void sculpt_undo_free_list(ListBase *lb)
       MEM_freeN(unode->face_sets);
     }
 
+    sculpt_undo_node_page_free(unode);
+
     MEM_freeN(unode);
 
     unode = unode_next;
@@ -1426,6 +1437,179 @@ void SCULPT_undo_push_end_ex(const bool use_nested_undo)
   }
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Undo Paging
+ *
+ * Keeps the memory used by the undo stack bounded when sculpting very dense meshes: once the
+ * most recent steps use more than #SCULPT_UNDO_PAGING_RESIDENT_SIZE, arrays of older steps are
+ * compressed into a cache file and freed. They are read back before the step is applied.
+ * \{ */
+
+/* Memory used by the most recent steps, which are never paged out. */
+#define SCULPT_UNDO_PAGING_RESIDENT_SIZE ((size_t)512 * 1024 * 1024)
+
+/* Favor speed, coordinates don't compress that well anyway. */
+#define SCULPT_UNDO_PAGING_COMPRESSION_LEVEL 1
+
+#define SCULPT_UNDO_PAGE_ARRAYS_NUM 8
+
+typedef struct SculptUndoNodePage {
+  /* Zero size for arrays which were not paged out. */
+  PageFilePage arrays[SCULPT_UNDO_PAGE_ARRAYS_NUM];
+} SculptUndoNodePage;
+
+/* Created with the first paged out node, and deleted once no paged data is left. */
+static PageFile *sculpt_undo_page_file = NULL;
+static int sculpt_undo_pages_num = 0;
+
+static void sculpt_undo_node_page_arrays(SculptUndoNode *unode,
+                                         void **r_arrays[SCULPT_UNDO_PAGE_ARRAYS_NUM])
+{
+  r_arrays[0] = (void **)&unode->co;
+  r_arrays[1] = (void **)&unode->orig_co;
+  r_arrays[2] = (void **)&unode->no;
+  r_arrays[3] = (void **)&unode->col;
+  r_arrays[4] = (void **)&unode->mask;
+  r_arrays[5] = (void **)&unode->index;
+  r_arrays[6] = (void **)&unode->grids;
+  r_arrays[7] = (void **)&unode->face_sets;
+}
+
+static bool sculpt_undo_page_file_ensure(void)
+{
+  if (sculpt_undo_page_file == NULL) {
+    char filepath[FILE_MAX];
+    BLI_join_dirfile(filepath, sizeof(filepath), BKE_tempdir_session(), "sculpt_undo.cache");
+    sculpt_undo_page_file = BLI_page_file_create(filepath, SCULPT_UNDO_PAGING_COMPRESSION_LEVEL);
+  }
+  return sculpt_undo_page_file != NULL;
+}
+
+static void sculpt_undo_node_page_free(SculptUndoNode *unode)
+{
+  if (unode->page == NULL) {
+    return;
+  }
+  for (int i = 0; i < SCULPT_UNDO_PAGE_ARRAYS_NUM; i++) {
+    if (unode->page->arrays[i].size != 0) {
+      BLI_page_file_release(sculpt_undo_page_file, &unode->page->arrays[i]);
+    }
+  }
+  MEM_freeN(unode->page);
+  unode->page = NULL;
+
+  sculpt_undo_pages_num--;
+  if (sculpt_undo_pages_num == 0) {
+    BLI_page_file_free(sculpt_undo_page_file);
+    sculpt_undo_page_file = NULL;
+  }
+}
+
+static void sculpt_undo_node_page_out(SculptUndoNode *unode)
+{
+  if (unode->page != NULL || unode->bm_entry != NULL) {
+    return;
+  }
+
+  void **arrays[SCULPT_UNDO_PAGE_ARRAYS_NUM];
+  sculpt_undo_node_page_arrays(unode, arrays);
+
+  bool has_data = false;
+  for (int i = 0; i < SCULPT_UNDO_PAGE_ARRAYS_NUM; i++) {
+    has_data |= *arrays[i] != NULL && MEM_allocN_len(*arrays[i]) != 0;
+  }
+  if (!has_data || !sculpt_undo_page_file_ensure()) {
+    return;
+  }
+
+  SculptUndoNodePage page = {{{0}}};
+  for (int i = 0; i < SCULPT_UNDO_PAGE_ARRAYS_NUM; i++) {
+    if (*arrays[i] == NULL || MEM_allocN_len(*arrays[i]) == 0) {
+      continue;
+    }
+    if (!BLI_page_file_write(
+            sculpt_undo_page_file, *arrays[i], MEM_allocN_len(*arrays[i]), &page.arrays[i])) {
+      /* Out of disk space or similar, keep the node in memory. */
+      for (int j = 0; j < i; j++) {
+        if (page.arrays[j].size != 0) {
+          BLI_page_file_release(sculpt_undo_page_file, &page.arrays[j]);
+        }
+      }
+      if (sculpt_undo_pages_num == 0) {
+        BLI_page_file_free(sculpt_undo_page_file);
+        sculpt_undo_page_file = NULL;
+      }
+      return;
+    }
+  }
+
+  for (int i = 0; i < SCULPT_UNDO_PAGE_ARRAYS_NUM; i++) {
+    if (page.arrays[i].size != 0) {
+      MEM_freeN(*arrays[i]);
+      *arrays[i] = NULL;
+    }
+  }
+
+  unode->page = MEM_mallocN(sizeof(SculptUndoNodePage), __func__);
+  *unode->page = page;
+  sculpt_undo_pages_num++;
+}
+
+/* Read the arrays of the node back into memory. Returns false when the cache file could not be
+ * read, the node stays paged out then. */
+static bool sculpt_undo_node_page_in(SculptUndoNode *unode)
+{
+  SculptUndoNodePage *page = unode->page;
+  if (page == NULL) {
+    return true;
+  }
+
+  void **arrays[SCULPT_UNDO_PAGE_ARRAYS_NUM];
+  sculpt_undo_node_page_arrays(unode, arrays);
+
+  void *data[SCULPT_UNDO_PAGE_ARRAYS_NUM] = {NULL};
+  for (int i = 0; i < SCULPT_UNDO_PAGE_ARRAYS_NUM; i++) {
+    if (page->arrays[i].size == 0) {
+      continue;
+    }
+    data[i] = MEM_mallocN(page->arrays[i].size, "SculptUndoNode paged array");
+    if (!BLI_page_file_read(sculpt_undo_page_file, &page->arrays[i], data[i])) {
+      fprintf(stderr, "Failed to read sculpt undo data from the cache file\n");
+      for (int j = 0; j <= i; j++) {
+        MEM_SAFE_FREE(data[j]);
+      }
+      return false;
+    }
+  }
+
+  for (int i = 0; i < SCULPT_UNDO_PAGE_ARRAYS_NUM; i++) {
+    if (data[i] != NULL) {
+      *arrays[i] = data[i];
+    }
+  }
+  sculpt_undo_node_page_free(unode);
+  return true;
+}
+
+static bool sculpt_undo_list_page_in(ListBase *lb)
+{
+  LISTBASE_FOREACH (SculptUndoNode *, unode, lb) {
+    if (!sculpt_undo_node_page_in(unode)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void sculpt_undo_list_page_out(ListBase *lb)
+{
+  LISTBASE_FOREACH (SculptUndoNode *, unode, lb) {
+    sculpt_undo_node_page_out(unode);
+  }
+}
+
+/** \} */
+
 /* -------------------------------------------------------------------- */
 /** \name Implements ED Undo System
  * \{ */
@@ -1436,6 +1620,23 @@ typedef struct SculptUndoStep {
   UndoSculpt data;
 } SculptUndoStep;
 
+/* Page out steps preceding the given one, once the steps in between use more memory than
+ * #SCULPT_UNDO_PAGING_RESIDENT_SIZE. */
+static void sculpt_undosys_step_paging_update(SculptUndoStep *us_active)
+{
+  size_t resident_size = 0;
+  for (UndoStep *us_iter = &us_active->step; us_iter; us_iter = us_iter->prev) {
+    if (us_iter->type != BKE_UNDOSYS_TYPE_SCULPT) {
+      continue;
+    }
+    SculptUndoStep *us = (SculptUndoStep *)us_iter;
+    resident_size += us->data.undo_size;
+    if (us != us_active && resident_size > SCULPT_UNDO_PAGING_RESIDENT_SIZE) {
+      sculpt_undo_list_page_out(&us->data.nodes);
+    }
+  }
+}
+
 static void sculpt_undosys_step_encode_init(struct bContext *UNUSED(C), UndoStep *us_p)
 {
   SculptUndoStep *us = (SculptUndoStep *)us_p;
@@ -1462,28 +1663,40 @@ static bool sculpt_undosys_step_encode(struct bContext *UNUSED(C),
     bmain->is_memfile_undo_flush_needed = true;
   }
 
+  sculpt_undosys_step_paging_update(us);
+
   return true;
 }
 
-static void sculpt_undosys_step_decode_undo_impl(struct bContext *C,
+/* Returns false when the step could not be applied because its paged out data could not be
+ * read, the mesh is left unchanged then. */
+static bool sculpt_undosys_step_decode_undo_impl(struct bContext *C,
                                                  Depsgraph *depsgraph,
                                                  SculptUndoStep *us)
 {
   BLI_assert(us->step.is_applied == true);
+  if (!sculpt_undo_list_page_in(&us->data.nodes)) {
+    return false;
+  }
   sculpt_undo_restore_list(C, depsgraph, &us->data.nodes);
   us->step.is_applied = false;
+  return true;
 }
 
-static void sculpt_undosys_step_decode_redo_impl(struct bContext *C,
+static bool sculpt_undosys_step_decode_redo_impl(struct bContext *C,
                                                  Depsgraph *depsgraph,
                                                  SculptUndoStep *us)
 {
   BLI_assert(us->step.is_applied == false);
+  if (!sculpt_undo_list_page_in(&us->data.nodes)) {
+    return false;
+  }
   sculpt_undo_restore_list(C, depsgraph, &us->data.nodes);
   us->step.is_applied = true;
+  return true;
 }
 
-static void sculpt_undosys_step_decode_undo(struct bContext *C,
+static bool sculpt_undosys_step_decode_undo(struct bContext *C,
                                             Depsgraph *depsgraph,
                                             SculptUndoStep *us,
                                             const bool is_final)
@@ -1500,15 +1713,18 @@ static void sculpt_undosys_step_decode_undo(struct bContext *C,
 
   while ((us_iter != us) || (!is_final && us_iter == us)) {
     BLI_assert(us_iter->step.type == us->step.type); /* Previous loop ensures this. */
-    sculpt_undosys_step_decode_undo_impl(C, depsgraph, us_iter);
+    if (!sculpt_undosys_step_decode_undo_impl(C, depsgraph, us_iter)) {
+      return false;
+    }
     if (us_iter == us) {
       break;
     }
     us_iter = (SculptUndoStep *)us_iter->step.prev;
   }
+  return true;
 }
 
-static void sculpt_undosys_step_decode_redo(struct bContext *C,
+static bool sculpt_undosys_step_decode_redo(struct bContext *C,
                                             Depsgraph *depsgraph,
                                             SculptUndoStep *us)
 {
@@ -1520,15 +1736,18 @@ static void sculpt_undosys_step_decode_redo(struct bContext *C,
     us_iter = (SculptUndoStep *)us_iter->step.prev;
   }
   while (us_iter && (us_iter->step.is_applied == false)) {
-    sculpt_undosys_step_decode_redo_impl(C, depsgraph, us_iter);
+    if (!sculpt_undosys_step_decode_redo_impl(C, depsgraph, us_iter)) {
+      return false;
+    }
     if (us_iter == us) {
       break;
     }
     us_iter = (SculptUndoStep *)us_iter->step.next;
   }
+  return true;
 }
 
-static void sculpt_undosys_step_decode(
+static bool sculpt_undosys_step_decode(
     struct bContext *C, struct Main *bmain, UndoStep *us_p, const eUndoStepDir dir, bool is_final)
 {
   /* NOTE: behavior for undo/redo closely matches image undo. */
@@ -1567,17 +1786,23 @@ static void sculpt_undosys_step_decode(
     }
     else {
       BLI_assert(0);
-      return;
+      return false;
     }
   }
 
   SculptUndoStep *us = (SculptUndoStep *)us_p;
+  bool success = true;
   if (dir == STEP_UNDO) {
-    sculpt_undosys_step_decode_undo(C, depsgraph, us, is_final);
+    success = sculpt_undosys_step_decode_undo(C, depsgraph, us, is_final);
   }
   else if (dir == STEP_REDO) {
-    sculpt_undosys_step_decode_redo(C, depsgraph, us);
+    success = sculpt_undosys_step_decode_redo(C, depsgraph, us);
+  }
+  if (!success) {
+    /* The steps which could be applied stay applied, the mesh matches their state. */
+    WM_report(RPT_ERROR, "Failed to read sculpt undo data from the cache file");
   }
+  return success;
 }
 
 static void sculpt_undosys_step_free(UndoStep *us_p)
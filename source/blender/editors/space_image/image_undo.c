@@ -948,7 +948,7 @@ static void image_undosys_step_decode_redo(ImageUndoStep *us)
   }
 }
 
-static void image_undosys_step_decode(
+static bool image_undosys_step_decode(
     struct bContext *C, struct Main *bmain, UndoStep *us_p, const eUndoStepDir dir, bool is_final)
 {
   /* NOTE: behavior for undo/redo closely matches sculpt undo. */
@@ -968,6 +968,7 @@ static void image_undosys_step_decode(
 
   /* Refresh texture slots. */
   ED_editors_init_for_undo(bmain);
+  return true;
 }
 
 static void image_undosys_step_free(UndoStep *us_p)
@@ -14,6 +14,8 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include "BLI_math_rotation.h"
+
 #include "BKE_context.h"
 #include "BKE_editmesh.h"
 #include "BKE_lib_id.h"
@@ -441,6 +443,40 @@ std::unique_ptr<ColumnValues> InstancesDataSource::get_column_values(
         });
     return values;
   }
+  if (component_->has_compact_transforms()) {
+    if (STREQ(column_id.name, "Position")) {
+      Span<float3> positions = component_->instance_positions();
+      return column_values_from_function(
+          SPREADSHEET_VALUE_TYPE_FLOAT3,
+          column_id.name,
+          size,
+          [positions](int index, CellValue &r_cell_value) {
+            r_cell_value.value_float3 = positions[index];
+          });
+    }
+    if (STREQ(column_id.name, "Rotation")) {
+      Span<float4> rotations = component_->instance_rotations();
+      return column_values_from_function(
+          SPREADSHEET_VALUE_TYPE_FLOAT3,
+          column_id.name,
+          size,
+          [rotations](int index, CellValue &r_cell_value) {
+            float3 rotation;
+            quat_to_eul(rotation, rotations[index]);
+            r_cell_value.value_float3 = rotation;
+          });
+    }
+    if (STREQ(column_id.name, "Scale")) {
+      Span<float3> scales = component_->instance_scales();
+      return column_values_from_function(
+          SPREADSHEET_VALUE_TYPE_FLOAT3,
+          column_id.name,
+          size,
+          [scales](int index, CellValue &r_cell_value) {
+            r_cell_value.value_float3 = scales[index];
+          });
+    }
+  }
   Span<float4x4> transforms = component_->instance_transforms();
   if (STREQ(column_id.name, "Position")) {
     return column_values_from_function(
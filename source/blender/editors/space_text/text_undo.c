@@ -196,7 +196,7 @@ static bool text_undosys_step_encode(struct bContext *C,
   return true;
 }
 
-static void text_undosys_step_decode(struct bContext *C,
+static bool text_undosys_step_decode(struct bContext *C,
                                      struct Main *UNUSED(bmain),
                                      UndoStep *us_p,
                                      const eUndoStepDir dir,
@@ -225,6 +225,7 @@ static void text_undosys_step_decode(struct bContext *C,
   text_update_cursor_moved(C);
   text_drawcache_tag_update(st, 1);
   WM_event_add_notifier(C, NC_TEXT | NA_EDITED, text);
+  return true;
 }
 
 static void text_undosys_step_free(UndoStep *us_p)
@@ -170,7 +170,7 @@ static void memfile_undosys_unfinished_id_previews_restart(ID *id)
   }
 }
 
-static void memfile_undosys_step_decode(struct bContext *C,
+static bool memfile_undosys_step_decode(struct bContext *C,
                                         struct Main *bmain,
                                         UndoStep *us_p,
                                         const eUndoStepDir undo_direction,
@@ -307,6 +307,7 @@ static void memfile_undosys_step_decode(struct bContext *C,
   }
 
   WM_event_add_notifier(C, NC_SCENE | ND_LAYER_CONTENT, CTX_data_scene(C));
+  return true;
 }
 
 static void memfile_undosys_step_free(UndoStep *us_p)
@@ -157,6 +157,11 @@ class GField : public GFieldBase<std::shared_ptr<FieldNode>> {
       : GFieldBase<std::shared_ptr<FieldNode>>(std::move(node), node_output_index)
   {
   }
+
+  const std::shared_ptr<FieldNode> &node_ptr() const
+  {
+    return node_;
+  }
 };
 
 /**
@@ -210,6 +215,9 @@ class FieldOperation : public FieldNode {
   /** Inputs to the operation. */
   blender::Vector<GField> inputs_;
 
+  /** Computed once, because it depends on the hashes of the entire field tree below. */
+  uint64_t hash_;
+
  public:
   FieldOperation(std::shared_ptr<const MultiFunction> function, Vector<GField> inputs = {});
   FieldOperation(const MultiFunction &function, Vector<GField> inputs = {});
@@ -219,9 +227,17 @@ class FieldOperation : public FieldNode {
 
   const CPPType &output_cpp_type(int output_index) const override;
   void foreach_field_input(FunctionRef<void(const FieldInput &)> foreach_fn) const override;
+
+  /**
+   * Operations that use the same multi-function with equal inputs compute the same values. Those
+   * are deduplicated during evaluation and can share results in a #FieldCache.
+   */
+  uint64_t hash() const override;
+  bool is_equal_to(const FieldNode &other) const override;
 };
 
 class FieldContext;
+class FieldCache;
 
 /**
  * A #FieldNode that represents an input to the entire field-tree.
@@ -271,6 +287,17 @@ class FieldContext {
   virtual const GVArray *get_varray_for_input(const FieldInput &field_input,
                                               IndexMask mask,
                                               ResourceScope &scope) const;
+
+  /**
+   * Cache that stores the results of evaluations in this context, so that they can be reused by
+   * later evaluations. Null when results should not be reused.
+   */
+  virtual FieldCache *field_cache() const;
+  /**
+   * Results in the cache are only reused when this key is the same. It has to change whenever the
+   * data that fields are evaluated on changes.
+   */
+  virtual uint64_t field_cache_key() const;
 };
 
 /**
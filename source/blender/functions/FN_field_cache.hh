@@ -0,0 +1,147 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup fn
+ *
+ * A #FieldCache stores results of field evaluations, so that evaluating an equal field again in
+ * the same context does not have to compute it again. This is useful when the same expensive
+ * fields (e.g. normals) are evaluated on the same data by different users.
+ *
+ * Fields are compared with #FieldNode::hash and #FieldNode::is_equal_to. Every result is stored
+ * together with a key provided by the #FieldContext, which has to change whenever the data the
+ * field is evaluated on changes.
+ */
+
+#include <atomic>
+#include <mutex>
+
+#include "BLI_map.hh"
+
+#include "FN_field.hh"
+#include "FN_generic_array.hh"
+
+namespace blender::fn {
+
+struct FieldCacheStats {
+  int64_t hits = 0;
+  int64_t misses = 0;
+  int64_t stores = 0;
+  int64_t clears = 0;
+};
+
+class FieldCache : NonCopyable, NonMovable {
+ private:
+  /**
+   * Identifies the field of a result without owning it. Field nodes can own the data that owns
+   * the cache (e.g. a multi-function that references a geometry), which would be a reference cycle.
+   * Results of fields that have been freed can't be found anymore and are removed in #store.
+   */
+  struct Key {
+    std::weak_ptr<FieldNode> node;
+    int node_output_index;
+    uint64_t field_hash;
+    uint64_t context_key;
+
+    uint64_t hash() const
+    {
+      return get_default_hash_2(field_hash, context_key);
+    }
+  };
+
+  struct LookupKey {
+    const GField &field;
+    uint64_t field_hash;
+    uint64_t context_key;
+
+    operator Key() const
+    {
+      return {field.node_ptr(), field.node_output_index(), field_hash, context_key};
+    }
+
+    friend bool operator==(const LookupKey &a, const Key &b)
+    {
+      if (a.context_key != b.context_key || a.field_hash != b.field_hash ||
+          a.field.node_output_index() != b.node_output_index) {
+        return false;
+      }
+      const std::shared_ptr<const FieldNode> node = b.node.lock();
+      return node && *node == a.field.node();
+    }
+  };
+
+  struct KeyHash {
+    uint64_t operator()(const Key &key) const
+    {
+      return key.hash();
+    }
+
+    uint64_t operator()(const LookupKey &key) const
+    {
+      return get_default_hash_2(key.field_hash, key.context_key);
+    }
+  };
+
+  struct Result {
+    /** Contains a single element when all values are the same. */
+    GArray<> values;
+    bool is_single;
+    int64_t size;
+  };
+
+  std::mutex mutex_;
+  Map<Key,
+      std::shared_ptr<const Result>,
+      default_inline_buffer_capacity(sizeof(Key)),
+      DefaultProbingStrategy,
+      KeyHash>
+      results_;
+  int64_t memory_used_ = 0;
+
+  std::atomic<int64_t> hits_ = 0;
+  std::atomic<int64_t> misses_ = 0;
+  std::atomic<int64_t> stores_ = 0;
+  std::atomic<int64_t> clears_ = 0;
+
+  /** Remove results of fields that can't be looked up anymore. Expects the mutex to be locked. */
+  void remove_freed_fields();
+
+ public:
+  /**
+   * Get the result of an earlier evaluation of the field for the first #size indices, or null if
+   * there is none. The returned virtual array lives as long as #scope.
+   */
+  const GVArray *lookup(const GField &field,
+                        uint64_t context_key,
+                        int64_t size,
+                        ResourceScope &scope);
+
+  /** Store the result of an evaluation for all indices in the range of #varray. */
+  void store(const GField &field, uint64_t context_key, const GVArray &varray);
+
+  void clear();
+
+  /** Statistics of this cache, to check how effective caching is for specific data. */
+  FieldCacheStats stats() const;
+
+  /** Statistics of all caches, to check how effective caching is. */
+  static FieldCacheStats global_stats();
+  static void global_stats_reset();
+};
+
+}  // namespace blender::fn
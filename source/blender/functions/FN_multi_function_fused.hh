@@ -0,0 +1,73 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/** \file
+ * \ingroup fn
+ *
+ * A #FusedMultiFunction evaluates a tree of multi-functions as if it was a single function.
+ * Instead of calling every function for the entire mask before moving on to the next one, the
+ * mask is split into small chunks and the whole tree is evaluated for one chunk at a time. That
+ * way intermediate values only have to be stored for a single chunk, which keeps them in the CPU
+ * cache and makes memory usage independent of the size of the mask.
+ *
+ * Every function in the tree has a single output and only single inputs. The output of every
+ * function except the last one is used by exactly one other function in the tree.
+ */
+
+#include "FN_multi_function.hh"
+
+namespace blender::fn {
+
+class FusedMultiFunction : public MultiFunction {
+ public:
+  /** Where the value for an input parameter of a function in the tree comes from. */
+  struct InputSource {
+    /** Index of the function in the tree that computes the value, or -1 for values that are
+     * passed into the fused function. */
+    int node_index;
+    /** Index of the input of the fused function, used when #node_index is -1. */
+    int input_index;
+  };
+
+  struct FunctionNode {
+    const MultiFunction *fn;
+    /** Source for every input parameter of the function, in the order of the parameters. */
+    Vector<InputSource> inputs;
+  };
+
+ private:
+  /** Functions in the order they are evaluated in. The last one computes the output. */
+  Vector<FunctionNode> nodes_;
+  int64_t chunk_size_;
+  MFSignature signature_;
+
+ public:
+  FusedMultiFunction(Vector<FunctionNode> nodes);
+
+  /** Check whether the function can be part of a #FusedMultiFunction. */
+  static bool can_be_fused(const MultiFunction &fn);
+
+  void call(IndexMask mask, MFParams params, MFContext context) const override;
+
+  int64_t chunk_size() const
+  {
+    return chunk_size_;
+  }
+};
+
+}  // namespace blender::fn
@@ -28,12 +28,30 @@ class ParallelMultiFunction : public MultiFunction {
  private:
   const MultiFunction &fn_;
   const int64_t grain_size_;
+  /**
+   * When not zero, the wrapped function is never called for more indices at once. This keeps
+   * temporary buffers of functions like #MFProcedureExecutor small enough to stay in the CPU
+   * cache, because their size depends on the size of the mask.
+   */
+  const int64_t chunk_size_;
   bool threading_supported_;
 
  public:
-  ParallelMultiFunction(const MultiFunction &fn, const int64_t grain_size);
+  ParallelMultiFunction(const MultiFunction &fn,
+                        const int64_t grain_size,
+                        const int64_t chunk_size = 0);
 
   void call(IndexMask mask, MFParams params, MFContext context) const override;
+
+ private:
+  void call_chunked(IndexMask full_mask,
+                    IndexRange mask_slice,
+                    MFParams params,
+                    MFContext context) const;
+  void call_slice(IndexMask full_mask,
+                  IndexRange mask_slice,
+                  MFParams params,
+                  MFContext context) const;
 };
 
 }  // namespace blender::fn
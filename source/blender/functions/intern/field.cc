@@ -21,6 +21,8 @@
 #include "BLI_vector_set.hh"
 
 #include "FN_field.hh"
+#include "FN_field_cache.hh"
+#include "FN_multi_function_fused.hh"
 #include "FN_multi_function_parallel.hh"
 
 namespace blender::fn {
@@ -139,6 +141,64 @@ static Set<GFieldRef> find_varying_fields(const FieldTreeInfo &field_tree_info,
   return found_fields;
 }
 
+/**
+ * Operations with a single output that is used by only one other operation are evaluated as part
+ * of that operation when possible, so that their result doesn't have to be stored for all indices.
+ * See #FusedMultiFunction.
+ */
+static bool field_is_fused_into_user(const GFieldRef &field,
+                                     const FieldTreeInfo &field_tree_info,
+                                     Span<GFieldRef> output_fields)
+{
+  if (!field.node().is_operation()) {
+    return false;
+  }
+  const FieldOperation &operation = static_cast<const FieldOperation &>(field.node());
+  if (!FusedMultiFunction::can_be_fused(operation.multi_function())) {
+    return false;
+  }
+  if (output_fields.contains(field)) {
+    return false;
+  }
+  const Span<GFieldRef> users = field_tree_info.field_users.lookup(field);
+  if (users.size() != 1) {
+    return false;
+  }
+  const FieldOperation &user = static_cast<const FieldOperation &>(users[0].node());
+  return FusedMultiFunction::can_be_fused(user.multi_function());
+}
+
+/**
+ * Adds the function of the operation and of all operations fused into it to the nodes of a
+ * #FusedMultiFunction. Variables that are passed into the fused function are added to
+ * #r_input_variables.
+ * \return The index of the node that computes the output of the operation.
+ */
+static int add_fused_function_nodes(const FieldOperation &operation,
+                                    const Set<GFieldRef> &fused_fields,
+                                    const Map<GFieldRef, MFVariable *> &variable_by_field,
+                                    Vector<FusedMultiFunction::FunctionNode> &r_nodes,
+                                    VectorSet<MFVariable *> &r_input_variables)
+{
+  FusedMultiFunction::FunctionNode node;
+  node.fn = &operation.multi_function();
+  for (const GField &input_field : operation.inputs()) {
+    if (fused_fields.contains(input_field)) {
+      const FieldOperation &input_operation = static_cast<const FieldOperation &>(
+          input_field.node());
+      const int input_node_index = add_fused_function_nodes(
+          input_operation, fused_fields, variable_by_field, r_nodes, r_input_variables);
+      node.inputs.append({input_node_index, -1});
+    }
+    else {
+      MFVariable *variable = variable_by_field.lookup(input_field);
+      node.inputs.append({-1, (int)r_input_variables.index_of_or_add(variable)});
+    }
+  }
+  r_nodes.append(std::move(node));
+  return r_nodes.size() - 1;
+}
+
 /**
  * Builds the #procedure so that it computes the the fields.
  */
@@ -148,8 +208,10 @@ static void build_multi_function_procedure_for_fields(MFProcedure &procedure,
                                                       Span<GFieldRef> output_fields)
 {
   MFProcedureBuilder builder{procedure};
-  /* Every input, intermediate and output field corresponds to a variable in the procedure. */
+  /* Every input, intermediate and output field corresponds to a variable in the procedure, except
+   * for fields that are computed as part of a fused function. */
   Map<GFieldRef, MFVariable *> variable_by_field;
+  Set<GFieldRef> fused_fields;
 
   /* Start by adding the field inputs as parameters to the procedure. */
   for (const FieldInput &field_input : field_tree_info.deduplicated_field_inputs) {
@@ -172,7 +234,7 @@ static void build_multi_function_procedure_for_fields(MFProcedure &procedure,
     while (!fields_to_check.is_empty()) {
       FieldWithIndex &field_with_index = fields_to_check.peek();
       const GFieldRef &field = field_with_index.field;
-      if (variable_by_field.contains(field)) {
+      if (variable_by_field.contains(field) || fused_fields.contains(field)) {
         /* The field has been handled already. */
         fields_to_check.pop();
         continue;
@@ -189,20 +251,42 @@ static void build_multi_function_procedure_for_fields(MFProcedure &procedure,
         fields_to_check.push({operation_inputs[field_with_index.current_input_index]});
         field_with_index.current_input_index++;
       }
+      else if (field_is_fused_into_user(field, field_tree_info, output_fields)) {
+        /* The field is computed when its user is computed. */
+        fused_fields.add_new(field);
+      }
       else {
         /* All inputs variables are ready, now gather all variables that are used by the function
          * and call it. */
-        const MultiFunction &multi_function = operation.multi_function();
-        Vector<MFVariable *> variables(multi_function.param_amount());
+        const MultiFunction *multi_function = &operation.multi_function();
+        Vector<MFVariable *> input_variables;
+        const bool has_fused_inputs = std::any_of(
+            operation_inputs.begin(), operation_inputs.end(), [&](const GField &input_field) {
+              return fused_fields.contains(input_field);
+            });
+        if (has_fused_inputs) {
+          Vector<FusedMultiFunction::FunctionNode> nodes;
+          VectorSet<MFVariable *> fused_input_variables;
+          add_fused_function_nodes(
+              operation, fused_fields, variable_by_field, nodes, fused_input_variables);
+          multi_function = &scope.construct<FusedMultiFunction>(std::move(nodes));
+          input_variables.extend(fused_input_variables.as_span());
+        }
+        else {
+          for (const GField &input_field : operation_inputs) {
+            input_variables.append(variable_by_field.lookup(input_field));
+          }
+        }
+
+        Vector<MFVariable *> variables(multi_function->param_amount());
 
         int param_input_index = 0;
         int param_output_index = 0;
-        for (const int param_index : multi_function.param_indices()) {
-          const MFParamType param_type = multi_function.param_type(param_index);
+        for (const int param_index : multi_function->param_indices()) {
+          const MFParamType param_type = multi_function->param_type(param_index);
           const MFParamType::InterfaceType interface_type = param_type.interface_type();
           if (interface_type == MFParamType::Input) {
-            const GField &input_field = operation_inputs[param_input_index];
-            variables[param_index] = variable_by_field.lookup(input_field);
+            variables[param_index] = input_variables[param_input_index];
             param_input_index++;
           }
           else if (interface_type == MFParamType::Output) {
@@ -226,7 +310,7 @@ static void build_multi_function_procedure_for_fields(MFProcedure &procedure,
             BLI_assert_unreachable();
           }
         }
-        builder.add_call_with_all_variables(multi_function, variables);
+        builder.add_call_with_all_variables(*multi_function, variables);
       }
     }
   }
@@ -260,6 +344,24 @@ static void build_multi_function_procedure_for_fields(MFProcedure &procedure,
   BLI_assert(procedure.validate());
 }
 
+/**
+ * The procedure executor allocates buffers for all variables that are as large as the mask it is
+ * called with. Limit the number of indices that are processed at once, so that those buffers stay
+ * in the CPU cache and memory usage does not grow with the size of the geometry.
+ */
+static int64_t procedure_chunk_size(const MFProcedure &procedure)
+{
+  const int64_t cache_size = 256 * 1024;
+  int64_t bytes_per_index = 0;
+  for (const MFVariable *variable : procedure.variables()) {
+    const MFDataType data_type = variable->data_type();
+    if (data_type.is_single()) {
+      bytes_per_index += data_type.single_type().size();
+    }
+  }
+  return std::clamp<int64_t>(cache_size / std::max<int64_t>(bytes_per_index, 1), 1024, 8192);
+}
+
 /**
  * Evaluate fields in the given context. If possible, multiple fields should be evaluated together,
  * because that can be more efficient when they share common sub-fields.
@@ -347,9 +449,11 @@ Vector<const GVArray *> evaluate_fields(ResourceScope &scope,
     build_multi_function_procedure_for_fields(
         procedure, scope, field_tree_info, varying_fields_to_evaluate);
     MFProcedureExecutor procedure_executor{"Procedure", procedure};
-    /* Add multi threading capabilities to the field evaluation. */
+    /* Add multi threading capabilities to the field evaluation. The procedure is evaluated in
+     * chunks, so that temporary data of the executor stays small. */
     const int grain_size = 10000;
-    fn::ParallelMultiFunction parallel_procedure_executor{procedure_executor, grain_size};
+    fn::ParallelMultiFunction parallel_procedure_executor{
+        procedure_executor, grain_size, procedure_chunk_size(procedure)};
     /* Utility variable to make easy to switch the executor. */
     const MultiFunction &executor_fn = parallel_procedure_executor;
 
@@ -521,6 +625,16 @@ const GVArray *FieldContext::get_varray_for_input(const FieldInput &field_input,
   return field_input.get_varray_for_context(*this, mask, scope);
 }
 
+FieldCache *FieldContext::field_cache() const
+{
+  return nullptr;
+}
+
+uint64_t FieldContext::field_cache_key() const
+{
+  return 0;
+}
+
 IndexFieldInput::IndexFieldInput() : FieldInput(CPPType::get<int>(), "Index")
 {
   category_ = Category::Generated;
@@ -579,6 +693,28 @@ FieldOperation::FieldOperation(const MultiFunction &function, Vector<GField> inp
       function_(&function),
       inputs_(std::move(inputs))
 {
+  hash_ = get_default_hash(function_);
+  for (const GField &field : inputs_) {
+    hash_ = hash_ * 33 ^ field.hash();
+  }
+}
+
+uint64_t FieldOperation::hash() const
+{
+  return hash_;
+}
+
+bool FieldOperation::is_equal_to(const FieldNode &other) const
+{
+  if (this == &other) {
+    return true;
+  }
+  const FieldOperation *other_operation = dynamic_cast<const FieldOperation *>(&other);
+  if (other_operation == nullptr) {
+    return false;
+  }
+  return hash_ == other_operation->hash_ && function_ == other_operation->function_ &&
+         inputs_ == other_operation->inputs_;
 }
 
 void FieldOperation::foreach_field_input(FunctionRef<void(const FieldInput &)> foreach_fn) const
@@ -664,14 +800,131 @@ int FieldEvaluator::add(GField field)
   return field_index;
 }
 
+/**
+ * Results of fields that only read existing attributes are not cached, because they do not have
+ * to be computed. The same goes for inputs that are cheaper to compute than to copy from the
+ * cache, like the index.
+ */
+static bool field_result_is_cacheable(const GField &field)
+{
+  if (!field.node().depends_on_input()) {
+    return false;
+  }
+  if (field.node().is_input()) {
+    const FieldInput &field_input = static_cast<const FieldInput &>(field.node());
+    if (dynamic_cast<const IndexFieldInput *>(&field_input) != nullptr) {
+      return false;
+    }
+    switch (field_input.category()) {
+      case FieldInput::Category::NamedAttribute:
+      case FieldInput::Category::AnonymousAttribute:
+        return false;
+      case FieldInput::Category::Generated:
+      case FieldInput::Category::Unknown:
+        break;
+    }
+  }
+  return true;
+}
+
+/**
+ * Copy a result from the cache into a destination provided by the caller. Cached results are
+ * always spans or single values, so all indices are copied at once when the destination is a span.
+ */
+static void copy_cached_result(const GVArray &src, const IndexMask mask, GVMutableArray &dst)
+{
+  const CPPType &type = src.type();
+  if (!dst.is_span()) {
+    BUFFER_FOR_CPP_TYPE_VALUE(type, buffer);
+    for (const int64_t index : mask) {
+      src.get_to_uninitialized(index, buffer);
+      dst.set_by_relocate(index, buffer);
+    }
+    return;
+  }
+  void *dst_data = dst.get_internal_span().data();
+  if (src.is_single()) {
+    BUFFER_FOR_CPP_TYPE_VALUE(type, buffer);
+    src.get_internal_single_to_uninitialized(buffer);
+    type.fill_assign_indices(buffer, dst_data, mask);
+    type.destruct(buffer);
+  }
+  else {
+    type.copy_assign_indices(src.get_internal_span().data(), dst_data, mask);
+  }
+}
+
+/**
+ * Like #evaluate_fields, but fields that have been evaluated in the same context before are taken
+ * from the cache, and newly computed results are added to it.
+ */
+static Vector<const GVArray *> evaluate_fields_cached(ResourceScope &scope,
+                                                      Span<GField> fields_to_evaluate,
+                                                      const IndexMask mask,
+                                                      const FieldContext &context,
+                                                      FieldCache &cache,
+                                                      Span<GVMutableArray *> dst_varrays)
+{
+  const uint64_t context_key = context.field_cache_key();
+  const int64_t array_size = mask.min_array_size();
+  /* Results are only valid for the indices in the mask, so only store them when they are complete.
+   * Partial masks can still use complete results from the cache. */
+  const bool mask_is_complete = mask.is_range() && mask.as_range().start() == 0;
+
+  Vector<const GVArray *> r_varrays(fields_to_evaluate.size(), nullptr);
+  Vector<GFieldRef> fields_to_compute;
+  Vector<GVMutableArray *> dst_varrays_to_compute;
+  Vector<int> compute_indices;
+  for (const int i : fields_to_evaluate.index_range()) {
+    const GField &field = fields_to_evaluate[i];
+    GVMutableArray *dst_varray = dst_varrays[i];
+    if (field_result_is_cacheable(field)) {
+      if (const GVArray *cached_varray = cache.lookup(field, context_key, array_size, scope)) {
+        if (dst_varray == nullptr) {
+          r_varrays[i] = cached_varray;
+        }
+        else {
+          copy_cached_result(*cached_varray, mask, *dst_varray);
+          r_varrays[i] = dst_varray;
+        }
+        continue;
+      }
+    }
+    fields_to_compute.append(field);
+    dst_varrays_to_compute.append(dst_varray);
+    compute_indices.append(i);
+  }
+  if (fields_to_compute.is_empty()) {
+    return r_varrays;
+  }
+
+  Vector<const GVArray *> computed_varrays = evaluate_fields(
+      scope, fields_to_compute, mask, context, dst_varrays_to_compute);
+  for (const int i : computed_varrays.index_range()) {
+    const int field_index = compute_indices[i];
+    const GField &field = fields_to_evaluate[field_index];
+    r_varrays[field_index] = computed_varrays[i];
+    if (mask_is_complete && field_result_is_cacheable(field)) {
+      cache.store(field, context_key, *computed_varrays[i]);
+    }
+  }
+  return r_varrays;
+}
+
 void FieldEvaluator::evaluate()
 {
   BLI_assert_msg(!is_evaluated_, "Cannot evaluate fields twice.");
-  Array<GFieldRef> fields(fields_to_evaluate_.size());
-  for (const int i : fields_to_evaluate_.index_range()) {
-    fields[i] = fields_to_evaluate_[i];
+  if (FieldCache *cache = context_.field_cache()) {
+    evaluated_varrays_ = evaluate_fields_cached(
+        scope_, fields_to_evaluate_, mask_, context_, *cache, dst_varrays_);
+  }
+  else {
+    Array<GFieldRef> fields(fields_to_evaluate_.size());
+    for (const int i : fields_to_evaluate_.index_range()) {
+      fields[i] = fields_to_evaluate_[i];
+    }
+    evaluated_varrays_ = evaluate_fields(scope_, fields, mask_, context_, dst_varrays_);
   }
-  evaluated_varrays_ = evaluate_fields(scope_, fields, mask_, context_, dst_varrays_);
   BLI_assert(fields_to_evaluate_.size() == evaluated_varrays_.size());
   for (const int i : fields_to_evaluate_.index_range()) {
     OutputPointerInfo &info = output_pointer_infos_[i];
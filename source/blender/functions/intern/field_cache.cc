@@ -0,0 +1,155 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <atomic>
+
+#include "FN_field_cache.hh"
+
+namespace blender::fn {
+
+/* When a single cache grows larger than this, all of its results are freed. Results that are
+ * larger on their own are not stored at all. */
+static constexpr int64_t cache_memory_limit = 64 * 1024 * 1024;
+
+static std::atomic<int64_t> global_hits = 0;
+static std::atomic<int64_t> global_misses = 0;
+static std::atomic<int64_t> global_stores = 0;
+static std::atomic<int64_t> global_clears = 0;
+
+const GVArray *FieldCache::lookup(const GField &field,
+                                  const uint64_t context_key,
+                                  const int64_t size,
+                                  ResourceScope &scope)
+{
+  std::shared_ptr<const Result> result;
+  {
+    std::lock_guard lock{mutex_};
+    const std::shared_ptr<const Result> *result_ptr = results_.lookup_ptr_as(
+        LookupKey{field, field.hash(), context_key});
+    if (result_ptr != nullptr && (*result_ptr)->size >= size) {
+      result = *result_ptr;
+    }
+  }
+  if (!result) {
+    misses_++;
+    global_misses++;
+    return nullptr;
+  }
+  hits_++;
+  global_hits++;
+
+  /* The result may be removed from the cache while it is still used. */
+  const Result &result_ref = *scope.add_value(std::move(result));
+  const GSpan values = result_ref.values.as_span();
+  if (result_ref.is_single) {
+    return &scope.construct<GVArray_For_SingleValueRef>(values.type(), size, values.data());
+  }
+  return &scope.construct<GVArray_For_GSpan>(values.slice(0, size));
+}
+
+void FieldCache::store(const GField &field, const uint64_t context_key, const GVArray &varray)
+{
+  const CPPType &type = varray.type();
+  auto result = std::make_shared<Result>();
+  if (varray.is_single()) {
+    result->values = GArray<>(type, 1);
+    varray.get_internal_single(result->values.data());
+    result->is_single = true;
+  }
+  else {
+    result->values = GArray<>(type, varray.size());
+    varray.materialize(result->values.data());
+    result->is_single = false;
+  }
+  result->size = varray.size();
+  const int64_t result_size = type.size() * result->values.size();
+  if (result_size > cache_memory_limit) {
+    return;
+  }
+
+  std::lock_guard lock{mutex_};
+  this->remove_freed_fields();
+  if (memory_used_ + result_size > cache_memory_limit) {
+    results_.clear();
+    memory_used_ = 0;
+    clears_++;
+    global_clears++;
+  }
+  const LookupKey key{field, field.hash(), context_key};
+  if (const std::shared_ptr<const Result> *old_result = results_.lookup_ptr_as(key)) {
+    if ((*old_result)->size >= result->size) {
+      return;
+    }
+    memory_used_ -= type.size() * (*old_result)->values.size();
+  }
+  results_.add_overwrite_as(key, std::move(result));
+  memory_used_ += result_size;
+  stores_++;
+  global_stores++;
+}
+
+void FieldCache::remove_freed_fields()
+{
+  for (auto it = results_.items().begin(); it != results_.items().end(); ++it) {
+    const auto item = *it;
+    if (item.key.node.expired()) {
+      memory_used_ -= item.value->values.type().size() * item.value->values.size();
+      results_.remove(it);
+    }
+  }
+}
+
+void FieldCache::clear()
+{
+  std::lock_guard lock{mutex_};
+  if (results_.is_empty()) {
+    return;
+  }
+  results_.clear();
+  memory_used_ = 0;
+  clears_++;
+  global_clears++;
+}
+
+FieldCacheStats FieldCache::stats() const
+{
+  FieldCacheStats stats;
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.stores = stores_;
+  stats.clears = clears_;
+  return stats;
+}
+
+FieldCacheStats FieldCache::global_stats()
+{
+  FieldCacheStats stats;
+  stats.hits = global_hits;
+  stats.misses = global_misses;
+  stats.stores = global_stores;
+  stats.clears = global_clears;
+  return stats;
+}
+
+void FieldCache::global_stats_reset()
+{
+  global_hits = 0;
+  global_misses = 0;
+  global_stores = 0;
+  global_clears = 0;
+}
+
+}  // namespace blender::fn
@@ -0,0 +1,193 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <algorithm>
+
+#include "FN_multi_function_fused.hh"
+
+#include "BLI_array.hh"
+#include "BLI_linear_allocator.hh"
+
+namespace blender::fn {
+
+/* Intermediate values of one chunk should fit into the L1/L2 cache, together with the inputs and
+ * outputs of the functions that are processed at the same time. */
+static constexpr int64_t chunk_intermediate_memory = 64 * 1024;
+static constexpr int64_t min_chunk_size = 256;
+static constexpr int64_t max_chunk_size = 4096;
+
+static const CPPType &node_output_type(const MultiFunction &fn)
+{
+  for (const int param_index : fn.param_indices()) {
+    const MFParamType param_type = fn.param_type(param_index);
+    if (param_type.interface_type() == MFParamType::Output) {
+      return param_type.data_type().single_type();
+    }
+  }
+  BLI_assert_unreachable();
+  return CPPType::get<float>();
+}
+
+FusedMultiFunction::FusedMultiFunction(Vector<FunctionNode> nodes) : nodes_(std::move(nodes))
+{
+  BLI_assert(!nodes_.is_empty());
+
+  const MultiFunction &output_fn = *nodes_.last().fn;
+  MFSignatureBuilder signature{"Fused " + output_fn.name()};
+
+  /* Find the types of the values that are passed into the fused function. */
+  Vector<const CPPType *> input_types;
+  bool depends_on_context = false;
+  for (const FunctionNode &node : nodes_) {
+    BLI_assert(can_be_fused(*node.fn));
+    depends_on_context |= node.fn->depends_on_context();
+    int input_index = 0;
+    for (const int param_index : node.fn->param_indices()) {
+      const MFParamType param_type = node.fn->param_type(param_index);
+      if (param_type.interface_type() != MFParamType::Input) {
+        continue;
+      }
+      const InputSource &source = node.inputs[input_index++];
+      if (source.node_index == -1) {
+        if (source.input_index >= input_types.size()) {
+          input_types.resize(source.input_index + 1, nullptr);
+        }
+        input_types[source.input_index] = &param_type.data_type().single_type();
+      }
+      else {
+        BLI_assert(source.node_index < &node - nodes_.begin());
+      }
+    }
+  }
+
+  for (const CPPType *type : input_types) {
+    BLI_assert(type != nullptr);
+    signature.single_input("Input", *type);
+  }
+  signature.single_output("Output", node_output_type(output_fn));
+  if (depends_on_context) {
+    signature.depends_on_context();
+  }
+  signature_ = signature.build();
+  this->set_signature(&signature_);
+
+  int64_t intermediate_size = 0;
+  for (const FunctionNode &node : nodes_.as_span().drop_back(1)) {
+    intermediate_size += node_output_type(*node.fn).size();
+  }
+  chunk_size_ = intermediate_size == 0 ?
+                    max_chunk_size :
+                    std::clamp(chunk_intermediate_memory / intermediate_size,
+                               min_chunk_size,
+                               max_chunk_size);
+}
+
+bool FusedMultiFunction::can_be_fused(const MultiFunction &fn)
+{
+  int outputs_num = 0;
+  for (const int param_index : fn.param_indices()) {
+    const MFParamType param_type = fn.param_type(param_index);
+    switch (param_type.category()) {
+      case MFParamType::SingleInput:
+        break;
+      case MFParamType::SingleOutput:
+        outputs_num++;
+        break;
+      case MFParamType::SingleMutable:
+      case MFParamType::VectorInput:
+      case MFParamType::VectorMutable:
+      case MFParamType::VectorOutput:
+        return false;
+    }
+  }
+  return outputs_num == 1;
+}
+
+void FusedMultiFunction::call(IndexMask mask, MFParams params, MFContext context) const
+{
+  const int output_param_index = this->param_amount() - 1;
+  GMutableSpan output = params.uninitialized_single_output(output_param_index);
+
+  /* Buffers for the intermediate values of one chunk, reused for all chunks. */
+  LinearAllocator<> allocator;
+  Array<void *> buffers(nodes_.size() - 1);
+  for (const int node_index : buffers.index_range()) {
+    const CPPType &type = node_output_type(*nodes_[node_index].fn);
+    buffers[node_index] = allocator.allocate(type.size() * chunk_size_, type.alignment());
+  }
+
+  const Span<int64_t> indices = mask.indices();
+  Vector<int64_t> sub_mask_indices;
+  int64_t mask_start = 0;
+  while (mask_start < mask.size()) {
+    /* Every chunk covers at most #chunk_size_ consecutive indices, so that the buffers are large
+     * enough for sparse masks as well. */
+    const int64_t slice_start = indices[mask_start];
+    const int64_t mask_end = std::lower_bound(indices.begin() + mask_start,
+                                              indices.end(),
+                                              slice_start + chunk_size_) -
+                             indices.begin();
+    const IndexMask sub_mask = mask.slice_and_offset(IndexRange(mask_start, mask_end - mask_start),
+                                                     sub_mask_indices);
+    const IndexRange slice_range{slice_start, indices[mask_end - 1] - slice_start + 1};
+
+    for (const int node_index : nodes_.index_range()) {
+      const FunctionNode &node = nodes_[node_index];
+      const MultiFunction &fn = *node.fn;
+      MFParamsBuilder node_params{fn, sub_mask.min_array_size()};
+      ResourceScope &scope = node_params.resource_scope();
+
+      int input_index = 0;
+      for (const int param_index : fn.param_indices()) {
+        const MFParamType param_type = fn.param_type(param_index);
+        const CPPType &type = param_type.data_type().single_type();
+        if (param_type.interface_type() == MFParamType::Input) {
+          const InputSource &source = node.inputs[input_index++];
+          if (source.node_index == -1) {
+            const GVArray &varray = params.readonly_single_input(source.input_index);
+            const GVArray &sliced_varray = scope.construct<GVArray_Slice>(varray, slice_range);
+            node_params.add_readonly_single_input(sliced_varray);
+          }
+          else {
+            node_params.add_readonly_single_input(
+                GSpan(type, buffers[source.node_index], slice_range.size()));
+          }
+        }
+        else if (node_index == nodes_.index_range().last()) {
+          node_params.add_uninitialized_single_output(
+              output.slice(slice_range.start(), slice_range.size()));
+        }
+        else {
+          node_params.add_uninitialized_single_output(
+              GMutableSpan(type, buffers[node_index], slice_range.size()));
+        }
+      }
+
+      fn.call(sub_mask, node_params, context);
+    }
+
+    for (const int node_index : buffers.index_range()) {
+      const CPPType &type = node_output_type(*nodes_[node_index].fn);
+      if (!type.is_trivially_destructible()) {
+        type.destruct_indices(buffers[node_index], sub_mask);
+      }
+    }
+
+    mask_start = mask_end;
+  }
+}
+
+}  // namespace blender::fn
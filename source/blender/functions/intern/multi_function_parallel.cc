@@ -20,8 +20,10 @@
 
 namespace blender::fn {
 
-ParallelMultiFunction::ParallelMultiFunction(const MultiFunction &fn, const int64_t grain_size)
-    : fn_(fn), grain_size_(grain_size)
+ParallelMultiFunction::ParallelMultiFunction(const MultiFunction &fn,
+                                             const int64_t grain_size,
+                                             const int64_t chunk_size)
+    : fn_(fn), grain_size_(grain_size), chunk_size_(chunk_size)
 {
   this->set_signature(&fn.signature());
 
@@ -38,58 +40,92 @@ ParallelMultiFunction::ParallelMultiFunction(const MultiFunction &fn, const int6
 
 void ParallelMultiFunction::call(IndexMask full_mask, MFParams params, MFContext context) const
 {
-  if (full_mask.size() <= grain_size_ || !threading_supported_) {
+  if (!threading_supported_) {
     fn_.call(full_mask, params, context);
     return;
   }
-
-  threading::parallel_for(full_mask.index_range(), grain_size_, [&](const IndexRange mask_slice) {
-    Vector<int64_t> sub_mask_indices;
-    const IndexMask sub_mask = full_mask.slice_and_offset(mask_slice, sub_mask_indices);
-    if (sub_mask.is_empty()) {
+  if (full_mask.size() <= grain_size_) {
+    if (chunk_size_ == 0 || full_mask.size() <= chunk_size_) {
+      fn_.call(full_mask, params, context);
       return;
     }
-    const int64_t input_slice_start = full_mask[mask_slice.first()];
-    const int64_t input_slice_size = full_mask[mask_slice.last()] - input_slice_start + 1;
-    const IndexRange input_slice_range{input_slice_start, input_slice_size};
+    this->call_chunked(full_mask, full_mask.index_range(), params, context);
+    return;
+  }
 
-    MFParamsBuilder sub_params{fn_, sub_mask.min_array_size()};
-    ResourceScope &scope = sub_params.resource_scope();
+  threading::parallel_for(full_mask.index_range(), grain_size_, [&](const IndexRange mask_slice) {
+    this->call_chunked(full_mask, mask_slice, params, context);
+  });
+}
 
-    /* All parameters are sliced so that the wrapped multi-function does not have to take care of
-     * the index offset. */
-    for (const int param_index : fn_.param_indices()) {
-      const MFParamType param_type = fn_.param_type(param_index);
-      switch (param_type.category()) {
-        case MFParamType::SingleInput: {
-          const GVArray &varray = params.readonly_single_input(param_index);
-          const GVArray &sliced_varray = scope.construct<GVArray_Slice>(varray, input_slice_range);
-          sub_params.add_readonly_single_input(sliced_varray);
-          break;
-        }
-        case MFParamType::SingleMutable: {
-          const GMutableSpan span = params.single_mutable(param_index);
-          const GMutableSpan sliced_span = span.slice(input_slice_start, input_slice_size);
-          sub_params.add_single_mutable(sliced_span);
-          break;
-        }
-        case MFParamType::SingleOutput: {
-          const GMutableSpan span = params.uninitialized_single_output(param_index);
-          const GMutableSpan sliced_span = span.slice(input_slice_start, input_slice_size);
-          sub_params.add_uninitialized_single_output(sliced_span);
-          break;
-        }
-        case MFParamType::VectorInput:
-        case MFParamType::VectorMutable:
-        case MFParamType::VectorOutput: {
-          BLI_assert_unreachable();
-          break;
-        }
+void ParallelMultiFunction::call_chunked(const IndexMask full_mask,
+                                         const IndexRange mask_slice,
+                                         MFParams params,
+                                         MFContext context) const
+{
+  if (chunk_size_ == 0) {
+    this->call_slice(full_mask, mask_slice, params, context);
+    return;
+  }
+  /* Process the slice of the current task in chunks one after another, so that temporary data of
+   * the wrapped function is reused while it is still in cache. */
+  for (int64_t chunk_start = mask_slice.start(); chunk_start < mask_slice.one_after_last();
+       chunk_start += chunk_size_) {
+    const int64_t chunk_size = std::min(chunk_size_, mask_slice.one_after_last() - chunk_start);
+    this->call_slice(full_mask, IndexRange(chunk_start, chunk_size), params, context);
+  }
+}
+
+void ParallelMultiFunction::call_slice(const IndexMask full_mask,
+                                       const IndexRange mask_slice,
+                                       MFParams params,
+                                       MFContext context) const
+{
+  Vector<int64_t> sub_mask_indices;
+  const IndexMask sub_mask = full_mask.slice_and_offset(mask_slice, sub_mask_indices);
+  if (sub_mask.is_empty()) {
+    return;
+  }
+  const int64_t input_slice_start = full_mask[mask_slice.first()];
+  const int64_t input_slice_size = full_mask[mask_slice.last()] - input_slice_start + 1;
+  const IndexRange input_slice_range{input_slice_start, input_slice_size};
+
+  MFParamsBuilder sub_params{fn_, sub_mask.min_array_size()};
+  ResourceScope &scope = sub_params.resource_scope();
+
+  /* All parameters are sliced so that the wrapped multi-function does not have to take care of
+   * the index offset. */
+  for (const int param_index : fn_.param_indices()) {
+    const MFParamType param_type = fn_.param_type(param_index);
+    switch (param_type.category()) {
+      case MFParamType::SingleInput: {
+        const GVArray &varray = params.readonly_single_input(param_index);
+        const GVArray &sliced_varray = scope.construct<GVArray_Slice>(varray, input_slice_range);
+        sub_params.add_readonly_single_input(sliced_varray);
+        break;
+      }
+      case MFParamType::SingleMutable: {
+        const GMutableSpan span = params.single_mutable(param_index);
+        const GMutableSpan sliced_span = span.slice(input_slice_start, input_slice_size);
+        sub_params.add_single_mutable(sliced_span);
+        break;
+      }
+      case MFParamType::SingleOutput: {
+        const GMutableSpan span = params.uninitialized_single_output(param_index);
+        const GMutableSpan sliced_span = span.slice(input_slice_start, input_slice_size);
+        sub_params.add_uninitialized_single_output(sliced_span);
+        break;
+      }
+      case MFParamType::VectorInput:
+      case MFParamType::VectorMutable:
+      case MFParamType::VectorOutput: {
+        BLI_assert_unreachable();
+        break;
       }
     }
+  }
 
-    fn_.call(sub_mask, sub_params, context);
-  });
+  fn_.call(sub_mask, sub_params, context);
 }
 
 }  // namespace blender::fn
@@ -1,10 +1,14 @@
 /* Apache License, Version 2.0 */
 
+#include <atomic>
+
 #include "testing/testing.h"
 
 #include "FN_cpp_type.hh"
 #include "FN_field.hh"
+#include "FN_field_cache.hh"
 #include "FN_multi_function_builder.hh"
+#include "FN_multi_function_fused.hh"
 #include "FN_multi_function_test_common.hh"
 
 namespace blender::fn::tests {
@@ -291,4 +295,212 @@ TEST(field, IgnoredOutput)
   EXPECT_EQ(results->get(3), 5);
 }
 
+TEST(field, FusedFunctions)
+{
+  GField index_field{std::make_shared<IndexFieldInput>()};
+
+  GField double_field{std::make_shared<FieldOperation>(
+                          std::make_unique<CustomMF_SI_SO<int, int>>(
+                              "double", [](int a) { return a * 2; }),
+                          Vector<GField>{index_field}),
+                      0};
+  /* Use a type that is not trivially destructible for an intermediate value. */
+  GField string_field{std::make_shared<FieldOperation>(
+                          std::make_unique<CustomMF_SI_SO<int, std::string>>(
+                              "to_string", [](int a) { return std::to_string(a); }),
+                          Vector<GField>{double_field}),
+                      0};
+  GField length_field{std::make_shared<FieldOperation>(
+                          std::make_unique<CustomMF_SI_SI_SO<std::string, int, int>>(
+                              "length_add",
+                              [](const std::string &a, int b) { return (int)a.size() + b; }),
+                          Vector<GField>{string_field, index_field}),
+                      0};
+
+  /* Use a sparse mask that is larger than a chunk of the fused function. */
+  const int size = 20000;
+  Vector<int64_t> indices;
+  for (int i = 0; i < size; i += 3) {
+    indices.append(i);
+  }
+  const IndexMask mask{indices};
+
+  Array<int> result(size, -1);
+  FieldContext context;
+  FieldEvaluator evaluator{context, &mask};
+  evaluator.add_with_destination(length_field, result.as_mutable_span());
+  evaluator.evaluate();
+
+  for (const int i : IndexRange(size)) {
+    if (i % 3 == 0) {
+      EXPECT_EQ(result[i], (int)std::to_string(i * 2).size() + i);
+    }
+    else {
+      EXPECT_EQ(result[i], -1);
+    }
+  }
+}
+
+class CachedFieldContext : public FieldContext {
+ public:
+  mutable FieldCache cache;
+  uint64_t key = 0;
+
+  FieldCache *field_cache() const override
+  {
+    return &cache;
+  }
+
+  uint64_t field_cache_key() const override
+  {
+    return key;
+  }
+};
+
+TEST(field, CachedEvaluation)
+{
+  std::atomic<int> calls = 0;
+  CustomMF_SI_SO<int, int> fn{"add_one", [&](int a) {
+                                calls++;
+                                return a + 1;
+                              }};
+  GField index_field{std::make_shared<IndexFieldInput>()};
+  /* Equal operations that are created separately, like by two different nodes. */
+  GField field_1{std::make_shared<FieldOperation>(fn, Vector<GField>{index_field}), 0};
+  GField field_2{std::make_shared<FieldOperation>(fn, Vector<GField>{index_field}), 0};
+  EXPECT_EQ(field_1, field_2);
+
+  CachedFieldContext context;
+  FieldCache::global_stats_reset();
+  {
+    Array<int> result_1(10);
+    Array<int> result_2(10);
+    FieldEvaluator evaluator{context, 10};
+    evaluator.add_with_destination(field_1, result_1.as_mutable_span());
+    evaluator.add_with_destination(field_2, result_2.as_mutable_span());
+    evaluator.evaluate();
+    EXPECT_EQ(result_1[4], 5);
+    EXPECT_EQ(result_2[9], 10);
+    /* Both fields are computed only once. */
+    EXPECT_EQ(calls, 10);
+  }
+  {
+    const Array<int64_t> indices = {2, 7};
+    const IndexMask mask{indices};
+    Array<int> result(10, -1);
+    FieldEvaluator evaluator{context, &mask};
+    evaluator.add_with_destination(field_2, result.as_mutable_span());
+    evaluator.evaluate();
+    EXPECT_EQ(result[2], 3);
+    EXPECT_EQ(result[3], -1);
+    EXPECT_EQ(result[7], 8);
+    EXPECT_EQ(calls, 10);
+  }
+  context.key = 1;
+  {
+    FieldEvaluator evaluator{context, 10};
+    const VArray<int> *result;
+    evaluator.add(Field<int>(field_1), &result);
+    evaluator.evaluate();
+    EXPECT_EQ((*result)[0], 1);
+    EXPECT_EQ(calls, 20);
+  }
+
+  const FieldCacheStats stats = FieldCache::global_stats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.stores, 2);
+
+  const FieldCacheStats cache_stats = context.cache.stats();
+  EXPECT_EQ(cache_stats.hits, 1);
+  EXPECT_EQ(cache_stats.misses, 3);
+  EXPECT_EQ(cache_stats.stores, 2);
+}
+
+TEST(field, CacheDoesNotOwnFields)
+{
+  CustomMF_SI_SO<int, int> fn{"double", [](int a) { return a * 2; }};
+  /* The index input of the library, not the one of this test. */
+  GField index_field{std::make_shared<fn::IndexFieldInput>()};
+  GField field{std::make_shared<FieldOperation>(fn, Vector<GField>{index_field}), 0};
+  std::weak_ptr<FieldNode> node = field.node_ptr();
+
+  CachedFieldContext context;
+  FieldCache::global_stats_reset();
+  {
+    FieldEvaluator evaluator{context, 10};
+    evaluator.add(field);
+    evaluator.add(index_field);
+    evaluator.evaluate();
+  }
+  /* The index is cheaper to compute than to look up. */
+  EXPECT_EQ(FieldCache::global_stats().stores, 1);
+
+  /* Field nodes may own the data that owns the cache, so the cache must not keep them alive. */
+  field = {};
+  EXPECT_TRUE(node.expired());
+
+  {
+    GField new_field{std::make_shared<FieldOperation>(fn, Vector<GField>{index_field}), 0};
+    FieldEvaluator evaluator{context, 10};
+    evaluator.add(new_field);
+    evaluator.evaluate();
+    EXPECT_EQ(evaluator.get_evaluated<int>(0)[3], 6);
+  }
+  EXPECT_EQ(FieldCache::global_stats().hits, 0);
+}
+
+/**
+ * Set this to 1 and include `BLI_timeit.hh` to activate the benchmark. It compares evaluating a
+ * chain of functions with a #FusedMultiFunction to calling every function for the entire mask,
+ * like the procedure executor does. Both run on a single thread.
+ */
+#if 0
+TEST(field, FusedFunctionsBenchmark)
+{
+  const int size = 10000000;
+  const int chain_length = 8;
+
+  CustomMF_SI_SO<float, float> fn{"madd", [](float a) { return a * 1.0001f + 0.5f; }};
+
+  Array<float> input(size);
+  for (const int i : IndexRange(size)) {
+    input[i] = (float)i;
+  }
+
+  Vector<FusedMultiFunction::FunctionNode> nodes;
+  nodes.append({&fn, {{-1, 0}}});
+  for (int i = 1; i < chain_length; i++) {
+    nodes.append({&fn, {{i - 1, -1}}});
+  }
+  FusedMultiFunction fused_fn{std::move(nodes)};
+
+  Array<float> result(size);
+  {
+    SCOPED_TIMER("fused");
+    MFParamsBuilder params{fused_fn, size};
+    params.add_readonly_single_input(input.as_span());
+    params.add_uninitialized_single_output(result.as_mutable_span());
+    MFContextBuilder context;
+    fused_fn.call(IndexRange(size), params, context);
+  }
+
+  Array<float> result_unfused(size);
+  {
+    SCOPED_TIMER("unfused");
+    Array<float> buffer = input;
+    for (int i = 0; i < chain_length; i++) {
+      MFParamsBuilder params{fn, size};
+      params.add_readonly_single_input(buffer.as_span());
+      params.add_uninitialized_single_output(result_unfused.as_mutable_span());
+      MFContextBuilder context;
+      fn.call(IndexRange(size), params, context);
+      std::swap(buffer, result_unfused);
+    }
+    std::swap(buffer, result_unfused);
+  }
+
+  EXPECT_EQ(result[size - 1], result_unfused[size - 1]);
+}
+#endif /* Benchmark */
+
 }  // namespace blender::fn::tests
@@ -1,9 +1,12 @@
 /* Apache License, Version 2.0 */
 
+#include <atomic>
+
 #include "testing/testing.h"
 
 #include "FN_multi_function.hh"
 #include "FN_multi_function_builder.hh"
+#include "FN_multi_function_parallel.hh"
 #include "FN_multi_function_test_common.hh"
 
 namespace blender::fn::tests {
@@ -355,5 +358,67 @@ TEST(multi_function, IgnoredOutputs)
   }
 }
 
+class MaxMaskSizeFunction : public MultiFunction {
+ public:
+  mutable std::atomic<int64_t> max_mask_size = 0;
+
+  MaxMaskSizeFunction()
+  {
+    static MFSignature signature = create_signature();
+    this->set_signature(&signature);
+  }
+
+  static MFSignature create_signature()
+  {
+    MFSignatureBuilder signature("Max Mask Size");
+    signature.single_input<int>("Value");
+    signature.single_output<int>("Result");
+    return signature.build();
+  }
+
+  void call(IndexMask mask, MFParams params, MFContext UNUSED(context)) const override
+  {
+    const VArray<int> &values = params.readonly_single_input<int>(0, "Value");
+    MutableSpan<int> results = params.uninitialized_single_output<int>(1, "Result");
+    for (int64_t i : mask) {
+      results[i] = values[i] * 2;
+    }
+    int64_t prev_max = max_mask_size;
+    while (prev_max < mask.min_array_size() &&
+           !max_mask_size.compare_exchange_weak(prev_max, mask.min_array_size())) {
+    }
+  }
+};
+
+TEST(multi_function, ParallelChunked)
+{
+  MaxMaskSizeFunction fn;
+  const int64_t grain_size = 1000;
+  const int64_t chunk_size = 64;
+  ParallelMultiFunction parallel_fn{fn, grain_size, chunk_size};
+
+  const int64_t size = 10000;
+  Array<int> values(size);
+  for (const int64_t i : values.index_range()) {
+    values[i] = i;
+  }
+  Vector<int64_t> mask_indices;
+  for (int64_t i = 0; i < size; i += 3) {
+    mask_indices.append(i);
+  }
+  Array<int> results(size, -1);
+
+  MFParamsBuilder params(parallel_fn, size);
+  params.add_readonly_single_input(values.as_span());
+  params.add_uninitialized_single_output(results.as_mutable_span());
+  MFContextBuilder context;
+  parallel_fn.call(mask_indices.as_span(), params, context);
+
+  EXPECT_LE(fn.max_mask_size, chunk_size * 3);
+  for (const int64_t i : values.index_range()) {
+    EXPECT_EQ(results[i], i % 3 == 0 ? i * 2 : -1);
+  }
+}
+
 }  // namespace
 }  // namespace blender::fn::tests
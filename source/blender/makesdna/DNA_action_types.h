@@ -39,6 +39,7 @@ extern "C" {
 #endif
 
 struct Collection;
+struct CompiledAction;
 struct GHash;
 struct Object;
 struct SpaceLink;
@@ -196,6 +197,10 @@ typedef struct bPoseChannel_Runtime {
   /* B-Bone shape data: copy of the segment count for validation. */
   int bbone_segments;
 
+  /* Scratch data of #BKE_pose_where_is to find independent groups of channels. */
+  int solve_index;
+  int solve_group;
+
   /* Rest and posed matrices for segments. */
   struct Mat4 *bbone_rest_mats;
   struct Mat4 *bbone_pose_mats;
@@ -475,6 +480,8 @@ typedef struct bPose {
    * chanbase. Used for quick pose channel lookup from an index.
    */
   bPoseChannel **chan_array;
+  /** Deformation data of the evaluated pose, see #BKE_pose_skinning_palette_update. */
+  struct PoseSkinningPalette *skinning_palette;
 
   short flag;
   char _pad[2];
@@ -683,6 +690,9 @@ typedef struct bAction {
   char _pad[4];
 
   PreviewImage *preview;
+
+  /** Runtime data, only set on evaluated copies. */
+  struct CompiledAction *compiled;
 } bAction;
 
 /* Flags for the action */
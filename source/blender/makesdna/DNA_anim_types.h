@@ -1117,6 +1117,8 @@ typedef struct AnimData {
 
   /** Runtime data, for depsgraph evaluation. */
   FCurve **driver_array;
+  /** Runtime data, for depsgraph evaluation of the active action. */
+  struct CompiledActionState *compiled_action_state;
 
   /* settings for animation evaluation */
   /** User-defined settings. */
@@ -62,6 +62,11 @@ typedef struct CustomDataLayer {
    * automatically.
    */
   const struct AnonymousAttributeID *anonymous_id;
+  /**
+   * Run-time user count of #data when it is shared with layers of other #CustomData.
+   * Shared layers are flagged with #CD_FLAG_NOFREE and have to be duplicated before writing.
+   */
+  struct CustomDataSharingInfo *sharing_info;
 } CustomDataLayer;
 
 #define MAX_CUSTOMDATA_LAYER_NAME 64
@@ -2273,9 +2273,18 @@ typedef struct NodesModifierData {
   /* Contains logged information from the last evaluation. This can be used to help the user to
    * debug a node tree. */
   void *runtime_eval_log;
-  void *_pad1;
+  /* Outputs of nodes from previous evaluations, see #NODES_MODIFIER_USE_NODE_CACHE. */
+  void *runtime_node_cache;
+  int flag;
+  char _pad[4];
 } NodesModifierData;
 
+/** #NodesModifierData.flag */
+enum {
+  /* Reuse outputs of nodes whose inputs did not change since the last evaluation. */
+  NODES_MODIFIER_USE_NODE_CACHE = (1 << 0),
+};
+
 typedef struct MeshToVolumeModifierData {
   ModifierData modifier;
 
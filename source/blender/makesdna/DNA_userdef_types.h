@@ -729,7 +729,9 @@ typedef struct UserDef {
   /** #eUserpref_UI_Flag2. */
   char uiflag2;
   char gpu_flag;
-  char _pad8[6];
+  /** #eUserpref_Depsgraph_Flag. */
+  char depsgraph_flag;
+  char _pad8[5];
   /* Experimental flag for app-templates to make changes to behavior
    * which are outside the scope of typical preferences. */
   char app_flag;
@@ -1141,6 +1143,11 @@ typedef enum eUserpref_GPU_Flag {
   USER_GPU_FLAG_OVERLAY_SMOOTH_WIRE = (1 << 2),
 } eUserpref_GPU_Flag;
 
+/** #UserDef.depsgraph_flag */
+typedef enum eUserpref_Depsgraph_Flag {
+  USER_DEPSGRAPH_PRIORITY_SCHEDULING = (1 << 0),
+} eUserpref_Depsgraph_Flag;
+
 /** #UserDef.tablet_api */
 typedef enum eUserpref_TableAPI {
   USER_TABLET_AUTOMATIC = 0,
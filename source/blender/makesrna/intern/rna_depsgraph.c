@@ -254,6 +254,13 @@ static void rna_Depsgraph_debug_stats_gnuplot(Depsgraph *depsgraph,
   fclose(f);
 }
 
+static void rna_Depsgraph_debug_trace_write(ReportList *reports, const char *filename)
+{
+  if (!DEG_debug_trace_write(filename)) {
+    BKE_reportf(reports, RPT_ERROR, "Could not write depsgraph trace to '%s'", filename);
+  }
+}
+
 static void rna_Depsgraph_debug_tag_update(Depsgraph *depsgraph)
 {
   DEG_graph_tag_relations_update(depsgraph);
@@ -667,6 +674,31 @@ static void rna_def_depsgraph(BlenderRNA *brna)
                                   "File name where gnuplot script will save the result");
   RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
 
+  func = RNA_def_function(srna, "debug_trace_start", "DEG_debug_trace_start");
+  RNA_def_function_ui_description(
+      func,
+      "Start recording the timings of evaluated operations of all dependency graphs, "
+      "adding to the previously recorded evaluations");
+  RNA_def_function_flag(func, FUNC_NO_SELF);
+
+  func = RNA_def_function(srna, "debug_trace_stop", "DEG_debug_trace_stop");
+  RNA_def_function_ui_description(func, "Stop recording the timings of evaluated operations");
+  RNA_def_function_flag(func, FUNC_NO_SELF);
+
+  func = RNA_def_function(srna, "debug_trace_clear", "DEG_debug_trace_clear");
+  RNA_def_function_ui_description(func, "Remove all recorded evaluations");
+  RNA_def_function_flag(func, FUNC_NO_SELF);
+
+  func = RNA_def_function(srna, "debug_trace_write", "rna_Depsgraph_debug_trace_write");
+  RNA_def_function_ui_description(
+      func,
+      "Write the recorded evaluations in the Chrome trace format, "
+      "which can be opened in Perfetto or chrome://tracing");
+  RNA_def_function_flag(func, FUNC_NO_SELF | FUNC_USE_REPORTS);
+  parm = RNA_def_string_file_path(
+      func, "filename", NULL, FILE_MAX, "File Name", "Output path for the trace file");
+  RNA_def_parameter_flags(parm, 0, PARM_REQUIRED);
+
   func = RNA_def_function(srna, "debug_tag_update", "rna_Depsgraph_debug_tag_update");
 
   func = RNA_def_function(srna, "debug_stats", "rna_Depsgraph_debug_stats");
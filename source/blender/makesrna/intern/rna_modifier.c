@@ -6943,6 +6943,15 @@ static void rna_def_modifier_nodes(BlenderRNA *brna)
   RNA_def_property_flag(prop, PROP_EDITABLE);
   RNA_def_property_update(prop, 0, "rna_NodesModifier_node_group_update");
 
+  prop = RNA_def_property(srna, "use_node_cache", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "flag", NODES_MODIFIER_USE_NODE_CACHE);
+  RNA_def_property_ui_text(prop,
+                           "Cache Node Results",
+                           "Keep the results of nodes in memory and reuse them when their inputs "
+                           "did not change, e.g. when only time dependent parts of the node tree "
+                           "change. Not used while the node tree is shown in a node editor");
+  RNA_def_property_update(prop, 0, "rna_Modifier_update");
+
   RNA_define_lib_overridable(false);
 }
 
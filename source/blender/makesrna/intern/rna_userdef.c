@@ -5508,6 +5508,16 @@ static void rna_def_userdef_system(BlenderRNA *brna)
   RNA_def_property_ui_text(
       prop, "Scrollback", "Maximum number of lines to store for the console buffer");
 
+  /* Dependency graph. */
+
+  prop = RNA_def_property(srna, "use_depsgraph_priority_scheduling", PROP_BOOLEAN, PROP_NONE);
+  RNA_def_property_boolean_sdna(prop, NULL, "depsgraph_flag", USER_DEPSGRAPH_PRIORITY_SCHEDULING);
+  RNA_def_property_ui_text(prop,
+                           "Priority Scheduling",
+                           "Evaluate the operations on the longest chain of dependencies first, "
+                           "based on the timings of previous evaluations");
+  RNA_def_property_update(prop, 0, "rna_userdef_update");
+
   /* OpenGL */
 
   /* Viewport anti-aliasing */
@@ -119,6 +119,7 @@ using blender::fn::GPointer;
 using blender::nodes::FieldInferencingInterface;
 using blender::nodes::GeoNodeExecParams;
 using blender::nodes::InputSocketFieldType;
+using blender::modifiers::geometry_nodes::GeometryNodesCache;
 using blender::threading::EnumerableThreadSpecific;
 using namespace blender::fn::multi_function_types;
 using namespace blender::nodes::derived_node_tree_types;
@@ -856,6 +857,66 @@ static void clear_runtime_data(NodesModifierData *nmd)
   }
 }
 
+static void free_node_cache(NodesModifierData *nmd)
+{
+  if (nmd->runtime_node_cache != nullptr) {
+    delete static_cast<GeometryNodesCache *>(nmd->runtime_node_cache);
+    nmd->runtime_node_cache = nullptr;
+  }
+}
+
+/**
+ * The cache is stored on the original modifier, so that it survives copy-on-write updates. It is
+ * not used while logging, because then all intermediate values and node warnings are needed.
+ */
+static GeometryNodesCache *ensure_node_cache(NodesModifierData *nmd,
+                                             const ModifierEvalContext *ctx,
+                                             const bool is_logging)
+{
+  if (!DEG_is_active(ctx->depsgraph)) {
+    return nullptr;
+  }
+  NodesModifierData *nmd_orig = (NodesModifierData *)BKE_modifier_get_original(&nmd->modifier);
+  if (!(nmd->flag & NODES_MODIFIER_USE_NODE_CACHE)) {
+    free_node_cache(nmd_orig);
+    return nullptr;
+  }
+  if (is_logging) {
+    return nullptr;
+  }
+  if (nmd_orig->runtime_node_cache == nullptr) {
+    nmd_orig->runtime_node_cache = new GeometryNodesCache();
+  }
+  return static_cast<GeometryNodesCache *>(nmd_orig->runtime_node_cache);
+}
+
+/**
+ * The input geometry can only be identified when it is created from the object data alone, which
+ * is the case when no other modifier is evaluated before this one. Any update of the data, also
+ * one flushed from shape keys or other data it depends on, tags it for recalculation.
+ */
+static std::optional<uint64_t> input_geometry_version(GeometryNodesCache &cache,
+                                                      const NodesModifierData *nmd,
+                                                      const ModifierEvalContext *ctx)
+{
+  const Object *object = ctx->object;
+  LISTBASE_FOREACH (const ModifierData *, md, &object->modifiers) {
+    if (md == &nmd->modifier) {
+      break;
+    }
+    if (md->mode & eModifierMode_Realtime) {
+      return std::nullopt;
+    }
+  }
+  const ID *data_id = static_cast<const ID *>(object->data);
+  if (data_id == nullptr) {
+    return std::nullopt;
+  }
+  const ID *data_id_orig = DEG_get_original_id(const_cast<ID *>(data_id));
+  return cache.update_input_geometry_version(data_id_orig->session_uuid,
+                                             (data_id->recalc & ID_RECALC_ALL) != 0);
+}
+
 static void store_field_on_geometry_component(GeometryComponent &component,
                                               const StringRef attribute_name,
                                               AttributeDomain domain,
@@ -998,6 +1059,12 @@ static GeometrySet compute_geometry(const DerivedNodeTree &tree,
   eval_params.depsgraph = ctx->depsgraph;
   eval_params.self_object = ctx->object;
   eval_params.geo_logger = geo_logger.has_value() ? &*geo_logger : nullptr;
+  eval_params.print_timings = (G.debug & G_DEBUG_DEPSGRAPH_TIME) != 0;
+  eval_params.node_cache = ensure_node_cache(nmd, ctx, geo_logger.has_value());
+  if (eval_params.node_cache != nullptr) {
+    eval_params.input_geometry_version = input_geometry_version(
+        *eval_params.node_cache, nmd, ctx);
+  }
   blender::modifiers::geometry_nodes::evaluate_geometry_nodes(eval_params);
 
   GeometrySet output_geometry_set = eval_params.r_output_values[0].relocate_out<GeometrySet>();
@@ -1441,6 +1508,8 @@ static void panel_draw(const bContext *C, Panel *panel)
     }
   }
 
+  uiItemR(layout, ptr, "use_node_cache", 0, nullptr, ICON_NONE);
+
   /* Draw node warnings. */
   bool has_legacy_node = false;
   if (nmd->runtime_eval_log != nullptr) {
@@ -1519,6 +1588,7 @@ static void blendRead(BlendDataReader *reader, ModifierData *md)
   BLO_read_data_address(reader, &nmd->settings.properties);
   IDP_BlendDataRead(reader, &nmd->settings.properties);
   nmd->runtime_eval_log = nullptr;
+  nmd->runtime_node_cache = nullptr;
 }
 
 static void copyData(const ModifierData *md, ModifierData *target, const int flag)
@@ -1529,6 +1599,7 @@ static void copyData(const ModifierData *md, ModifierData *target, const int fla
   BKE_modifier_copydata_generic(md, target, flag);
 
   tnmd->runtime_eval_log = nullptr;
+  tnmd->runtime_node_cache = nullptr;
 
   if (nmd->settings.properties != nullptr) {
     tnmd->settings.properties = IDP_CopyProperty_ex(nmd->settings.properties, flag);
@@ -1544,6 +1615,7 @@ static void freeData(ModifierData *md)
   }
 
   clear_runtime_data(nmd);
+  free_node_cache(nmd);
 }
 
 static void requiredDataMask(Object *UNUSED(ob),
@@ -14,8 +14,18 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <iomanip>
+
 #include "MOD_nodes_evaluator.hh"
 
+#include "MEM_guardedalloc.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_pointcloud_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_node.h"
+
 #include "NOD_geometry_exec.hh"
 #include "NOD_socket_declarations.hh"
 #include "NOD_type_conversions.hh"
@@ -30,9 +40,11 @@
 #include "BLT_translation.h"
 
 #include "BLI_enumerable_thread_specific.hh"
+#include "BLI_hash_mm2a.h"
 #include "BLI_stack.hh"
 #include "BLI_task.h"
 #include "BLI_task.hh"
+#include "BLI_timeit.hh"
 #include "BLI_vector_set.hh"
 
 namespace blender::modifiers::geometry_nodes {
@@ -43,6 +55,9 @@ using fn::FieldCPPType;
 using fn::GField;
 using fn::GValueMap;
 using nodes::GeoNodeExecParams;
+using timeit::Clock;
+using timeit::Nanoseconds;
+using timeit::TimePoint;
 using namespace fn::multi_function_types;
 
 enum class ValueUsage : uint8_t {
@@ -165,7 +180,7 @@ struct OutputState {
   int potential_users = 0;
 };
 
-enum class NodeScheduleState {
+enum class NodeScheduleState : uint8_t {
   /**
    * Default state of every node.
    */
@@ -218,9 +233,17 @@ struct NodeState {
   /**
    * Becomes true when the node will never be executed again and its inputs are destructed.
    * Generally, a node has finished once all of its outputs with (potential) users have been
-   * computed.
+   * computed. Only changed while the node is locked, but can be read without locking because it
+   * never becomes false again.
    */
-  bool node_has_finished = false;
+  std::atomic<bool> node_has_finished = false;
+
+  /**
+   * Cheap nodes are not added to the task pool when they are scheduled. Instead they run on the
+   * thread that scheduled them, because the task overhead would be larger than the node itself.
+   * Does not change during evaluation.
+   */
+  bool is_cheap = false;
 
   /**
    * Counts the number of values that still have to be forwarded to this node until it should run
@@ -231,9 +254,47 @@ struct NodeState {
 
   /**
    * A node is always in one specific schedule state. This helps to ensure that the same node does
-   * not run twice at the same time accidentally.
+   * not run twice at the same time accidentally. Transitions are done atomically, so that this
+   * can be changed without locking the node in some cases.
    */
-  NodeScheduleState schedule_state = NodeScheduleState::NotScheduled;
+  std::atomic<NodeScheduleState> schedule_state = NodeScheduleState::NotScheduled;
+
+  /**
+   * Identifies the values of all outputs of the node for the node cache. It is computed from the
+   * node and everything its inputs depend on. Only valid when `is_cacheable` is true, which is not
+   * the case when the outputs depend on data that is not part of the signature. Does not change
+   * during evaluation.
+   */
+  NodeCacheSignature cache_signature;
+  bool is_cacheable = false;
+
+  /**
+   * True when the outputs of this node are looked up in and added to the node cache. Does not
+   * change during evaluation.
+   */
+  bool use_cache = false;
+  bool cache_lookup_done = false;
+
+  /**
+   * Outputs from a previous evaluation. When this is set, the values are forwarded instead of
+   * executing the node.
+   */
+  std::shared_ptr<const GeometryNodesCache::Entry> cached_entry;
+
+  /**
+   * Copies of the outputs computed by the node, which are added to the cache once the evaluation
+   * is done. Only accessed by the thread that runs the node.
+   */
+  std::shared_ptr<GeometryNodesCache::Entry> new_cache_entry;
+
+  /**
+   * Only collected when timings are printed. These are only accessed by the thread that runs the
+   * node, which is never more than one at the same time.
+   */
+  Nanoseconds execution_time{0};
+  Nanoseconds overhead_time{0};
+  int task_runs = 0;
+  int inline_runs = 0;
 };
 
 /**
@@ -381,6 +442,223 @@ static bool node_supports_laziness(const DNode node)
   return node->typeinfo()->geometry_node_execute_supports_laziness;
 }
 
+/* Outputs of nodes are not kept anymore once the cache of a single modifier uses more memory. */
+static constexpr int64_t node_cache_memory_limit = 512 * 1024 * 1024;
+
+std::shared_ptr<const GeometryNodesCache::Entry> GeometryNodesCache::lookup(
+    const NodeCacheSignature &signature, const StringRef node_path)
+{
+  std::lock_guard lock{mutex_};
+  std::shared_ptr<const Entry> entry = entries_.lookup_default(signature, {});
+  if (entry && entry->node_path != node_path) {
+    return {};
+  }
+  return entry;
+}
+
+bool GeometryNodesCache::add(const NodeCacheSignature &signature,
+                             std::shared_ptr<const Entry> entry)
+{
+  std::lock_guard lock{mutex_};
+  if (memory_used_ + entry->memory > node_cache_memory_limit) {
+    return false;
+  }
+  memory_used_ += entry->memory;
+  if (const std::shared_ptr<const Entry> *old_entry = entries_.lookup_ptr(signature)) {
+    memory_used_ -= (*old_entry)->memory;
+  }
+  entries_.add_overwrite(signature, std::move(entry));
+  return true;
+}
+
+void GeometryNodesCache::remove_unused(const Set<NodeCacheSignature> &used_signatures)
+{
+  std::lock_guard lock{mutex_};
+  Vector<NodeCacheSignature> signatures_to_remove;
+  for (auto &&item : entries_.items()) {
+    if (!used_signatures.contains(item.key)) {
+      signatures_to_remove.append(item.key);
+      memory_used_ -= item.value->memory;
+    }
+  }
+  for (const NodeCacheSignature &signature : signatures_to_remove) {
+    entries_.remove(signature);
+  }
+}
+
+uint64_t GeometryNodesCache::update_input_geometry_version(const uint32_t data_session_uuid,
+                                                           const bool data_changed)
+{
+  if (data_changed || data_session_uuid != input_data_session_uuid_) {
+    input_geometry_version_++;
+    input_data_session_uuid_ = data_session_uuid;
+  }
+  return input_geometry_version_;
+}
+
+/**
+ * Computes a #NodeCacheSignature of arbitrary data by combining four 32 bit hashes with different
+ * seeds. Signatures in the node cache are compared with nothing but the node path, so they have
+ * to be long enough to make collisions practically impossible.
+ */
+class SignatureBuilder {
+ private:
+  static constexpr int hashes_num = 4;
+  /* Large data is hashed in blocks, so that it is still in the CPU cache for every hash. */
+  static constexpr size_t block_size = 4096;
+  BLI_HashMurmur2A hashes_[hashes_num];
+
+ public:
+  SignatureBuilder()
+  {
+    const uint32_t seeds[hashes_num] = {0, 0x9e3779b9, 0x85ebca6b, 0xc2b2ae35};
+    for (const int i : IndexRange(hashes_num)) {
+      BLI_hash_mm2a_init(&hashes_[i], seeds[i]);
+    }
+  }
+
+  void add_data(const void *data, const size_t size)
+  {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t offset = 0; offset < size; offset += block_size) {
+      const size_t size_in_block = std::min(block_size, size - offset);
+      for (BLI_HashMurmur2A &hash : hashes_) {
+        BLI_hash_mm2a_add(&hash, bytes + offset, size_in_block);
+      }
+    }
+  }
+
+  template<typename T> void add(const T &value)
+  {
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>);
+    this->add_data(&value, sizeof(T));
+  }
+
+  void add(const NodeCacheSignature &signature)
+  {
+    this->add_data(signature.values, sizeof(signature.values));
+  }
+
+  void add_string(const StringRef str)
+  {
+    this->add(str.size());
+    this->add_data(str.data(), (size_t)str.size());
+  }
+
+  NodeCacheSignature build()
+  {
+    NodeCacheSignature signature;
+    signature.values[0] = ((uint64_t)BLI_hash_mm2a_end(&hashes_[0]) << 32) |
+                          BLI_hash_mm2a_end(&hashes_[1]);
+    signature.values[1] = ((uint64_t)BLI_hash_mm2a_end(&hashes_[2]) << 32) |
+                          BLI_hash_mm2a_end(&hashes_[3]);
+    return signature;
+  }
+};
+
+/** Names of the node and of the group nodes it is in, see #GeometryNodesCache::Entry. */
+static std::string node_cache_path(const DNode node)
+{
+  std::string path = node->name();
+  for (const DTreeContext *context = node.context(); !context->is_root();
+       context = context->parent_context()) {
+    path = std::string(context->parent_node()->name()) + "/" + path;
+  }
+  return path;
+}
+
+static int64_t custom_data_memory(const CustomData &custom_data, const int size)
+{
+  int64_t memory = 0;
+  for (const int i : IndexRange(custom_data.totlayer)) {
+    const CustomDataLayer &layer = custom_data.layers[i];
+    if (layer.data != nullptr) {
+      memory += (int64_t)CustomData_sizeof(layer.type) * size;
+    }
+  }
+  return memory;
+}
+
+/**
+ * Estimate how much memory is kept alive by a geometry. This does not have to be exact, it is
+ * only used to limit the size of the node cache.
+ */
+static int64_t estimate_geometry_memory(const GeometrySet &geometry_set)
+{
+  int64_t memory = sizeof(GeometrySet);
+  for (const GeometryComponent *component : geometry_set.get_components_for_read()) {
+    switch (component->type()) {
+      case GEO_COMPONENT_TYPE_MESH: {
+        if (const Mesh *mesh = static_cast<const MeshComponent *>(component)->get_for_read()) {
+          memory += custom_data_memory(mesh->vdata, mesh->totvert) +
+                    custom_data_memory(mesh->edata, mesh->totedge) +
+                    custom_data_memory(mesh->ldata, mesh->totloop) +
+                    custom_data_memory(mesh->pdata, mesh->totpoly);
+        }
+        break;
+      }
+      case GEO_COMPONENT_TYPE_POINT_CLOUD: {
+        if (const PointCloud *pointcloud =
+                static_cast<const PointCloudComponent *>(component)->get_for_read()) {
+          memory += custom_data_memory(pointcloud->pdata, pointcloud->totpoint);
+        }
+        break;
+      }
+      case GEO_COMPONENT_TYPE_INSTANCES: {
+        const InstancesComponent &instances = *static_cast<const InstancesComponent *>(component);
+        memory += (int64_t)instances.instances_amount() * (sizeof(float4x4) + 2 * sizeof(int));
+        break;
+      }
+      default: {
+        /* Assume positions and a few other attributes per point. */
+        memory += (int64_t)component->attribute_domain_size(ATTR_DOMAIN_POINT) * 64;
+        break;
+      }
+    }
+  }
+  return memory;
+}
+
+static int64_t estimate_value_memory(const GPointer value)
+{
+  if (value.type()->is<GeometrySet>()) {
+    return estimate_geometry_memory(*value.get<GeometrySet>());
+  }
+  return value.type()->size();
+}
+
+static bool socket_references_id_data(const SocketRef &socket)
+{
+  switch (socket.bsocket()->type) {
+    case SOCK_OBJECT:
+    case SOCK_COLLECTION:
+    case SOCK_TEXTURE:
+    case SOCK_IMAGE:
+      /* The referenced data can change without the node tree or its inputs changing. */
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+ * Hash the value of an unlinked input socket. Returns false when the value can't be used in a
+ * node signature.
+ */
+static bool add_socket_value_to_signature(SignatureBuilder &builder, const SocketRef &socket)
+{
+  if (socket_references_id_data(socket)) {
+    return false;
+  }
+  const void *default_value = socket.bsocket()->default_value;
+  if (default_value == nullptr) {
+    builder.add(0);
+    return true;
+  }
+  builder.add_data(default_value, MEM_allocN_len(default_value));
+  return true;
+}
+
 /** Implements the callbacks that might be called when a node is executed. */
 class NodeParamsProvider : public nodes::GeoNodeExecParamsProvider {
  private:
@@ -432,6 +710,23 @@ class GeometryNodesEvaluator {
    */
   TaskPool *task_pool_ = nullptr;
 
+  /**
+   * Cheap nodes that have been scheduled on a thread and will run on it next. A thread that is
+   * running cheap nodes already adds new ones to the queue instead of running them right away, so
+   * that long chains of cheap nodes don't result in a deep call stack.
+   */
+  struct InlineNodeQueue {
+    Vector<const NodeWithState *> nodes;
+    bool is_running = false;
+  };
+  threading::EnumerableThreadSpecific<InlineNodeQueue> inline_node_queues_;
+
+  /**
+   * All reachable nodes, sorted so that every node comes after the nodes it depends on. Only used
+   * when the node cache is enabled.
+   */
+  Vector<const NodeWithState *> nodes_in_dependency_order_;
+
   GeometryNodesEvaluationParams &params_;
   const blender::nodes::DataTypeConversions &conversions_;
 
@@ -450,6 +745,10 @@ class GeometryNodesEvaluator {
     task_pool_ = BLI_task_pool_create(this, TASK_PRIORITY_HIGH);
 
     this->create_states_for_reachable_nodes();
+    if (params_.node_cache != nullptr) {
+      /* Has to be done before the group inputs are forwarded, because they are hashed. */
+      this->compute_cache_signatures();
+    }
     this->forward_group_inputs();
     this->schedule_initial_nodes();
 
@@ -457,6 +756,14 @@ class GeometryNodesEvaluator {
     BLI_task_pool_work_and_wait(task_pool_);
     BLI_task_pool_free(task_pool_);
 
+    if (params_.node_cache != nullptr) {
+      this->update_node_cache();
+    }
+
+    if (params_.print_timings) {
+      this->print_node_timings();
+    }
+
     this->extract_group_outputs();
     this->destruct_node_states();
   }
@@ -518,6 +825,7 @@ class GeometryNodesEvaluator {
     /* Construct arrays of the correct size. */
     node_state.inputs = allocator.construct_array<InputState>(node->inputs().size());
     node_state.outputs = allocator.construct_array<OutputState>(node->outputs().size());
+    node_state.is_cheap = this->node_is_cheap(node);
 
     /* Initialize input states. */
     for (const int i : node->inputs().index_range()) {
@@ -585,6 +893,286 @@ class GeometryNodesEvaluator {
     }
   }
 
+  /**
+   * Nodes that don't have a geometry node execute callback only build fields or forward default
+   * values, which is much faster than pushing a task.
+   */
+  bool node_is_cheap(const DNode node) const
+  {
+    if (node->is_group_input_node() || node->is_group_output_node()) {
+      return true;
+    }
+    const bNode &bnode = *node->bnode();
+    return bnode.typeinfo->geometry_node_execute == nullptr;
+  }
+
+  /**
+   * Compute the cache signatures of all nodes. The nodes are processed in an order in which the
+   * signatures of all the nodes a node depends on are known already.
+   */
+  void compute_cache_signatures()
+  {
+    Map<DOutputSocket, NodeCacheSignature> group_input_signatures;
+    for (auto &&item : params_.input_values.items()) {
+      SignatureBuilder builder;
+      if (this->add_group_input_to_signature(builder, item.key, item.value)) {
+        group_input_signatures.add_new(item.key, builder.build());
+      }
+    }
+
+    Set<DNode> handled_nodes;
+    Stack<DNode> nodes_to_check;
+    for (const NodeWithState &item : node_states_) {
+      nodes_to_check.push(item.node);
+      while (!nodes_to_check.is_empty()) {
+        const DNode node = nodes_to_check.peek();
+        if (handled_nodes.contains(node)) {
+          nodes_to_check.pop();
+          continue;
+        }
+        bool origins_are_handled = true;
+        for (const InputSocketRef *input_ref : node->inputs()) {
+          const DInputSocket input{node.context(), input_ref};
+          input.foreach_origin_socket([&](const DSocket origin) {
+            if (origin->is_output() && !handled_nodes.contains(origin.node())) {
+              nodes_to_check.push(origin.node());
+              origins_are_handled = false;
+            }
+          });
+        }
+        if (!origins_are_handled) {
+          continue;
+        }
+        nodes_to_check.pop();
+        handled_nodes.add_new(node);
+        const NodeWithState &node_with_state = *node_states_.lookup_key_ptr_as(node);
+        this->compute_cache_signature(node, *node_with_state.state, group_input_signatures);
+        nodes_in_dependency_order_.append(&node_with_state);
+      }
+    }
+  }
+
+  void compute_cache_signature(const DNode node,
+                               NodeState &node_state,
+                               const Map<DOutputSocket, NodeCacheSignature> &group_input_signatures)
+  {
+    if (node->is_group_input_node() || node->is_group_output_node()) {
+      return;
+    }
+    const bNode &bnode = *node->bnode();
+    if (bnode.type == GEO_NODE_IS_VIEWPORT || bnode.id != nullptr) {
+      /* The outputs depend on data that is not part of the node tree. */
+      return;
+    }
+
+    SignatureBuilder builder;
+    builder.add_string(node->idname());
+    /* Different nodes never share cached outputs, even when they compute the same values.
+     * Otherwise they would share anonymous attributes as well. */
+    builder.add_string(node_cache_path(node));
+    builder.add(bnode.custom1);
+    builder.add(bnode.custom2);
+    builder.add(bnode.custom3);
+    builder.add(bnode.custom4);
+    if (bnode.storage != nullptr) {
+      builder.add_data(bnode.storage, MEM_allocN_len(bnode.storage));
+    }
+
+    for (const int i : node->inputs().index_range()) {
+      const InputState &input_state = node_state.inputs[i];
+      if (input_state.type == nullptr) {
+        continue;
+      }
+      const DInputSocket input = node.input(i);
+      if (socket_references_id_data(*input.socket_ref())) {
+        return;
+      }
+      builder.add(i);
+      bool has_origin = false;
+      bool is_cacheable = true;
+      input.foreach_origin_socket([&](const DSocket origin) {
+        has_origin = true;
+        if (origin->is_input()) {
+          is_cacheable &= add_socket_value_to_signature(builder, *origin.socket_ref());
+          return;
+        }
+        const DNode origin_node = origin.node();
+        if (origin_node->is_group_input_node()) {
+          const NodeCacheSignature *signature = group_input_signatures.lookup_ptr(
+              DOutputSocket(origin));
+          if (signature == nullptr) {
+            is_cacheable = false;
+            return;
+          }
+          builder.add(*signature);
+          return;
+        }
+        const NodeState &origin_state = this->get_node_state(origin_node);
+        if (!origin_state.is_cacheable) {
+          is_cacheable = false;
+          return;
+        }
+        builder.add(origin_state.cache_signature);
+        builder.add(origin->index());
+      });
+      if (!has_origin) {
+        /* The value of the socket itself is used. */
+        is_cacheable &= add_socket_value_to_signature(builder, *input.socket_ref());
+      }
+      if (!is_cacheable) {
+        return;
+      }
+    }
+
+    node_state.cache_signature = builder.build();
+    node_state.is_cacheable = true;
+
+    /* Only nodes that do actual work are cached. Cheap nodes are faster to execute again than to
+     * copy their outputs. Nodes that support laziness would have to be executed anyway to know
+     * which inputs they need. Nodes whose inputs are logged need their inputs. */
+    bool has_force_compute_input = false;
+    for (const InputState &input_state : node_state.inputs) {
+      has_force_compute_input |= input_state.force_compute;
+    }
+    node_state.use_cache = !node_state.is_cheap && !node_supports_laziness(node) &&
+                           !has_force_compute_input;
+  }
+
+  bool add_group_input_to_signature(SignatureBuilder &builder,
+                                    const DOutputSocket socket,
+                                    const GPointer value)
+  {
+    if (socket_references_id_data(*socket.socket_ref())) {
+      return false;
+    }
+    const CPPType &type = *value.type();
+    builder.add_string(type.name());
+    if (type.is<GeometrySet>()) {
+      /* Geometries passed into the modifier are a new copy in every evaluation. Instead of
+       * hashing all their data, they are identified by a version that changes whenever the data
+       * they are created from is tagged for an update. */
+      if (value.get<GeometrySet>()->is_empty()) {
+        return true;
+      }
+      if (!params_.input_geometry_version.has_value()) {
+        return false;
+      }
+      builder.add(*params_.input_geometry_version);
+      return true;
+    }
+    if (const FieldCPPType *field_cpp_type = dynamic_cast<const FieldCPPType *>(&type)) {
+      const GField &field = field_cpp_type->get_gfield(value.get());
+      if (field.node().depends_on_input()) {
+        const bke::AttributeFieldInput *attribute_input =
+            dynamic_cast<const bke::AttributeFieldInput *>(&field.node());
+        if (attribute_input == nullptr) {
+          return false;
+        }
+        builder.add_string(attribute_input->attribute_name());
+        return true;
+      }
+      const CPPType &value_type = field_cpp_type->field_type();
+      BUFFER_FOR_CPP_TYPE_VALUE(value_type, buffer);
+      fn::evaluate_constant_field(field, buffer);
+      const bool success = add_value_to_signature(builder, {value_type, buffer});
+      value_type.destruct(buffer);
+      return success;
+    }
+    return add_value_to_signature(builder, value);
+  }
+
+  static bool add_value_to_signature(SignatureBuilder &builder, const GPointer value)
+  {
+    const CPPType &type = *value.type();
+    if (type.is_trivially_destructible()) {
+      /* Use the bytes directly, because hashes of simple types are not unique enough. */
+      builder.add_data(value.get(), (size_t)type.size());
+      return true;
+    }
+    if (type.is_hashable()) {
+      builder.add(type.hash(value.get()));
+      return true;
+    }
+    return false;
+  }
+
+  static bool cache_entry_is_complete(const DNode node, const GeometryNodesCache::Entry &entry)
+  {
+    for (const int i : node->outputs().index_range()) {
+      const OutputSocketRef &socket_ref = node->output(i);
+      if (socket_ref.is_available() && get_socket_cpp_type(socket_ref) != nullptr) {
+        if (entry.outputs[i].is_empty()) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Add the outputs that have been computed in this evaluation to the cache and remove the outputs
+   * of nodes that have not been used. Outputs of a node are only added when the cached nodes it
+   * depends on have been cached as well. Otherwise, when one of those nodes is executed again
+   * while the outputs of nodes that depend on it are still cached, the anonymous attributes
+   * created by it would not match anymore.
+   */
+  void update_node_cache()
+  {
+    GeometryNodesCache &cache = *params_.node_cache;
+
+    Set<NodeCacheSignature> used_signatures;
+    for (const NodeWithState *item : nodes_in_dependency_order_) {
+      if (item->state->use_cache) {
+        used_signatures.add(item->state->cache_signature);
+      }
+    }
+    cache.remove_unused(used_signatures);
+
+    /* Nodes whose outputs only depend on cached outputs. */
+    Set<DNode> consistent_nodes;
+    for (const NodeWithState *item : nodes_in_dependency_order_) {
+      const DNode node = item->node;
+      NodeState &node_state = *item->state;
+      if (node->is_group_input_node()) {
+        consistent_nodes.add_new(node);
+        continue;
+      }
+      if (!node_state.is_cacheable) {
+        continue;
+      }
+      if (node_state.cached_entry) {
+        consistent_nodes.add_new(node);
+        continue;
+      }
+      bool inputs_are_consistent = true;
+      for (const int i : node->inputs().index_range()) {
+        const InputState &input_state = node_state.inputs[i];
+        if (input_state.type == nullptr || !input_state.was_ready_for_execution) {
+          continue;
+        }
+        node.input(i).foreach_origin_socket([&](const DSocket origin) {
+          if (origin->is_output() && !consistent_nodes.contains(origin.node())) {
+            inputs_are_consistent = false;
+          }
+        });
+      }
+      if (!inputs_are_consistent) {
+        continue;
+      }
+      if (!node_state.use_cache) {
+        consistent_nodes.add_new(node);
+        continue;
+      }
+      std::shared_ptr<GeometryNodesCache::Entry> entry = std::move(node_state.new_cache_entry);
+      if (!entry || !cache_entry_is_complete(node, *entry)) {
+        continue;
+      }
+      if (cache.add(node_state.cache_signature, std::move(entry))) {
+        consistent_nodes.add_new(node);
+      }
+    }
+  }
+
   void destruct_node_states()
   {
     threading::parallel_for(
@@ -672,28 +1260,37 @@ class GeometryNodesEvaluator {
 
   void schedule_node(LockedNode &locked_node)
   {
-    switch (locked_node.node_state.schedule_state) {
-      case NodeScheduleState::NotScheduled: {
-        /* The node will be scheduled once it is not locked anymore. We could schedule the node
-         * right here, but that would result in a deadlock if the task pool decides to run the task
-         * immediately (this only happens when Blender is started with a single thread). */
-        locked_node.node_state.schedule_state = NodeScheduleState::Scheduled;
-        locked_node.delayed_scheduled_nodes.append(locked_node.node);
-        break;
-      }
-      case NodeScheduleState::Scheduled: {
-        /* Scheduled already, nothing to do. */
-        break;
-      }
-      case NodeScheduleState::Running: {
-        /* Reschedule node while it is running.
-         * The node will reschedule itself when it is done. */
-        locked_node.node_state.schedule_state = NodeScheduleState::RunningAndRescheduled;
-        break;
-      }
-      case NodeScheduleState::RunningAndRescheduled: {
-        /* Scheduled already, nothing to do. */
-        break;
+    std::atomic<NodeScheduleState> &schedule_state = locked_node.node_state.schedule_state;
+    NodeScheduleState state = schedule_state.load();
+    while (true) {
+      switch (state) {
+        case NodeScheduleState::NotScheduled: {
+          /* The node will be scheduled once it is not locked anymore. We could schedule the node
+           * right here, but that would result in a deadlock if the task pool decides to run the
+           * task immediately (this only happens when Blender is started with a single thread). */
+          if (schedule_state.compare_exchange_weak(state, NodeScheduleState::Scheduled)) {
+            locked_node.delayed_scheduled_nodes.append(locked_node.node);
+            return;
+          }
+          break;
+        }
+        case NodeScheduleState::Scheduled: {
+          /* Scheduled already, nothing to do. */
+          return;
+        }
+        case NodeScheduleState::Running: {
+          /* Reschedule node while it is running.
+           * The node will reschedule itself when it is done. */
+          if (schedule_state.compare_exchange_weak(state,
+                                                   NodeScheduleState::RunningAndRescheduled)) {
+            return;
+          }
+          break;
+        }
+        case NodeScheduleState::RunningAndRescheduled: {
+          /* Scheduled already, nothing to do. */
+          return;
+        }
       }
     }
   }
@@ -704,7 +1301,13 @@ class GeometryNodesEvaluator {
     GeometryNodesEvaluator &evaluator = *(GeometryNodesEvaluator *)user_data;
     const NodeWithState *node_with_state = (const NodeWithState *)task_data;
 
-    evaluator.node_task_run(node_with_state->node, *node_with_state->state);
+    NodeState &node_state = *node_with_state->state;
+    if (evaluator.params_.print_timings) {
+      node_state.task_runs++;
+    }
+    evaluator.node_task_run(node_with_state->node, node_state);
+    /* Run the cheap nodes that have been scheduled by this node right away. */
+    evaluator.run_inline_nodes();
   }
 
   void node_task_run(const DNode node, NodeState &node_state)
@@ -715,15 +1318,62 @@ class GeometryNodesEvaluator {
       return;
     }
 
+    /* Finished nodes are scheduled quite often, e.g. when an output becomes unused. Since they
+     * never run again, there is no need to lock them. Other threads may still try to schedule the
+     * node while it is in the scheduled state, but those requests are ignored for finished nodes
+     * anyway. */
+    if (node_state.node_has_finished) {
+      node_state.schedule_state = NodeScheduleState::NotScheduled;
+      return;
+    }
+
+    const bool print_timings = params_.print_timings;
+    const TimePoint start_time = print_timings ? Clock::now() : TimePoint();
+    Nanoseconds execution_time{0};
+
     const bool do_execute_node = this->node_task_preprocessing(node, node_state);
 
     /* Only execute the node if all prerequisites are met. There has to be an output that is
      * required and all required inputs have to be provided already. */
     if (do_execute_node) {
-      this->execute_node(node, node_state);
+      if (print_timings) {
+        const TimePoint execute_start_time = Clock::now();
+        this->execute_node(node, node_state);
+        execution_time = Clock::now() - execute_start_time;
+      }
+      else {
+        this->execute_node(node, node_state);
+      }
     }
 
     this->node_task_postprocessing(node, node_state, do_execute_node);
+
+    if (print_timings) {
+      node_state.execution_time += execution_time;
+      node_state.overhead_time += Clock::now() - start_time - execution_time;
+    }
+  }
+
+  /**
+   * Run the cheap nodes that have been scheduled on this thread, unless this thread is running
+   * them already further up the call stack.
+   */
+  void run_inline_nodes()
+  {
+    InlineNodeQueue &queue = inline_node_queues_.local();
+    if (queue.is_running) {
+      return;
+    }
+    queue.is_running = true;
+    while (!queue.nodes.is_empty()) {
+      const NodeWithState *node_with_state = queue.nodes.pop_last();
+      NodeState &node_state = *node_with_state->state;
+      if (params_.print_timings) {
+        node_state.inline_runs++;
+      }
+      this->node_task_run(node_with_state->node, node_state);
+    }
+    queue.is_running = false;
   }
 
   bool node_task_preprocessing(const DNode node, NodeState &node_state)
@@ -741,6 +1391,11 @@ class GeometryNodesEvaluator {
       if (!this->prepare_node_outputs_for_execution(locked_node)) {
         return;
       }
+      if (node_state.use_cache && this->prepare_cached_node_for_execution(locked_node)) {
+        /* The outputs are taken from the cache, so the inputs are not needed. */
+        do_execute_node = true;
+        return;
+      }
       /* Initialize nodes that don't support laziness. This is done after at least one output is
        * required and before we check that all required inputs are provided. This reduces the
        * number of "round-trips" through the task pool by one for most nodes. */
@@ -820,6 +1475,40 @@ class GeometryNodesEvaluator {
     return execution_is_necessary;
   }
 
+  /**
+   * Returns true when the outputs of the node have been found in the cache. Otherwise all outputs
+   * are computed, so that they can be added to the cache after the evaluation.
+   */
+  bool prepare_cached_node_for_execution(LockedNode &locked_node)
+  {
+    const DNode node = locked_node.node;
+    NodeState &node_state = locked_node.node_state;
+    if (!node_state.cache_lookup_done) {
+      node_state.cache_lookup_done = true;
+      std::string node_path = node_cache_path(node);
+      std::shared_ptr<const GeometryNodesCache::Entry> entry = params_.node_cache->lookup(
+          node_state.cache_signature, node_path);
+      if (entry && cache_entry_is_complete(node, *entry)) {
+        node_state.cached_entry = std::move(entry);
+      }
+      else {
+        node_state.new_cache_entry = std::make_shared<GeometryNodesCache::Entry>();
+        node_state.new_cache_entry->outputs.reinitialize(node->outputs().size());
+        node_state.new_cache_entry->node_path = std::move(node_path);
+      }
+    }
+    if (node_state.cached_entry) {
+      return true;
+    }
+    for (const int i : node->outputs().index_range()) {
+      const OutputSocketRef &socket_ref = node->output(i);
+      if (socket_ref.is_available() && get_socket_cpp_type(socket_ref) != nullptr) {
+        node_state.outputs[i].output_usage_for_execution = ValueUsage::Required;
+      }
+    }
+    return false;
+  }
+
   void initialize_non_lazy_node(LockedNode &locked_node)
   {
     for (const int i : locked_node.node->inputs().index_range()) {
@@ -900,6 +1589,11 @@ class GeometryNodesEvaluator {
     }
     node_state.has_been_executed = true;
 
+    if (node_state.cached_entry) {
+      this->forward_cached_outputs(node, node_state);
+      return;
+    }
+
     /* Use the geometry node execute callback if it exists. */
     if (bnode.typeinfo->geometry_node_execute != nullptr) {
       this->execute_geometry_node(node, node_state);
@@ -985,6 +1679,27 @@ class GeometryNodesEvaluator {
     }
   }
 
+  void forward_cached_outputs(const DNode node, NodeState &node_state)
+  {
+    LinearAllocator<> &allocator = local_allocators_.local();
+    const GeometryNodesCache::Entry &entry = *node_state.cached_entry;
+    for (const int i : node->outputs().index_range()) {
+      OutputState &output_state = node_state.outputs[i];
+      if (output_state.output_usage_for_execution == ValueUsage::Unused) {
+        continue;
+      }
+      const GArray<> &cached_value = entry.outputs[i];
+      if (cached_value.is_empty()) {
+        continue;
+      }
+      const CPPType &type = cached_value.type();
+      void *buffer = allocator.allocate(type.size(), type.alignment());
+      type.copy_construct(cached_value.data(), buffer);
+      this->forward_output(node.output(i), {type, buffer});
+      output_state.has_been_computed = true;
+    }
+  }
+
   void execute_unknown_node(const DNode node, NodeState &node_state)
   {
     LinearAllocator<> &allocator = local_allocators_.local();
@@ -1010,9 +1725,9 @@ class GeometryNodesEvaluator {
   {
     this->with_locked_node(node, node_state, [&](LockedNode &locked_node) {
       const bool node_has_finished = this->finish_node_if_possible(locked_node);
-      const bool reschedule_requested = node_state.schedule_state ==
+      const bool reschedule_requested = node_state.schedule_state.exchange(
+                                            NodeScheduleState::NotScheduled) ==
                                         NodeScheduleState::RunningAndRescheduled;
-      node_state.schedule_state = NodeScheduleState::NotScheduled;
       if (reschedule_requested && !node_has_finished) {
         /* Either the node rescheduled itself or another node tried to schedule it while it ran. */
         this->schedule_node(locked_node);
@@ -1247,6 +1962,10 @@ class GeometryNodesEvaluator {
     /* Push the task to the pool while it is not locked to avoid a deadlock in case when the task
      * is executed immediately. */
     const NodeWithState *node_with_state = node_states_.lookup_key_ptr_as(node);
+    if (node_with_state->state->is_cheap) {
+      inline_node_queues_.local().nodes.append(node_with_state);
+      return;
+    }
     BLI_task_pool_push(
         task_pool_, run_node_from_task_pool, (void *)node_with_state, false, nullptr);
   }
@@ -1573,6 +2292,51 @@ class GeometryNodesEvaluator {
     for (const DNode &node : locked_node.delayed_scheduled_nodes) {
       this->add_node_to_task_pool(node);
     }
+    if (!locked_node.delayed_scheduled_nodes.is_empty()) {
+      this->run_inline_nodes();
+    }
+  }
+
+  void print_node_timings()
+  {
+    Vector<const NodeWithState *> nodes;
+    Nanoseconds total_execution_time{0};
+    Nanoseconds total_overhead_time{0};
+    int total_task_runs = 0;
+    int total_inline_runs = 0;
+    for (const NodeWithState &item : node_states_) {
+      const NodeState &node_state = *item.state;
+      total_execution_time += node_state.execution_time;
+      total_overhead_time += node_state.overhead_time;
+      total_task_runs += node_state.task_runs;
+      total_inline_runs += node_state.inline_runs;
+      if (node_state.task_runs + node_state.inline_runs > 0) {
+        nodes.append(&item);
+      }
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const NodeWithState *a, const NodeWithState *b) {
+      return a->state->execution_time > b->state->execution_time;
+    });
+
+    std::cout << "Geometry nodes evaluation of " << params_.modifier_->modifier.name << ": "
+              << node_states_.size() << " nodes, " << total_task_runs << " tasks, "
+              << total_inline_runs << " inline runs\n";
+    std::cout << "  Execution: ";
+    timeit::print_duration(total_execution_time);
+    std::cout << ", overhead: ";
+    timeit::print_duration(total_overhead_time);
+    std::cout << "\n";
+
+    const int max_nodes_to_print = 20;
+    for (const NodeWithState *item : nodes.as_span().take_front(max_nodes_to_print)) {
+      const NodeState &node_state = *item->state;
+      std::cout << "  " << std::setw(32) << std::left << item->node->name() << " runs: "
+                << node_state.task_runs << " + " << node_state.inline_runs << " inline, time: ";
+      timeit::print_duration(node_state.execution_time);
+      std::cout << ", overhead: ";
+      timeit::print_duration(node_state.overhead_time);
+      std::cout << "\n";
+    }
   }
 };
 
@@ -1687,6 +2451,12 @@ void NodeParamsProvider::set_output(StringRef identifier, GMutablePointer value)
 
   OutputState &output_state = node_state_.outputs[socket->index()];
   BLI_assert(!output_state.has_been_computed);
+  if (node_state_.new_cache_entry) {
+    /* Keep a copy for the cache, because the value might be modified by other nodes. */
+    GeometryNodesCache::Entry &entry = *node_state_.new_cache_entry;
+    entry.outputs[socket->index()] = GArray<>(fn::GSpan(*value.type(), value.get(), 1));
+    entry.memory += estimate_value_memory(value);
+  }
   evaluator_.forward_output(socket, value);
   output_state.has_been_computed = true;
 }
@@ -16,12 +16,18 @@
 
 #pragma once
 
+#include <mutex>
+#include <optional>
+
+#include "BLI_array.hh"
 #include "BLI_map.hh"
+#include "BLI_set.hh"
 
 #include "NOD_derived_node_tree.hh"
 #include "NOD_geometry_nodes_eval_log.hh"
 #include "NOD_multi_function.hh"
 
+#include "FN_generic_array.hh"
 #include "FN_generic_pointer.hh"
 
 #include "DNA_modifier_types.h"
@@ -33,9 +39,74 @@ namespace geo_log = blender::nodes::geometry_nodes_eval_log;
 namespace blender::modifiers::geometry_nodes {
 
 using namespace nodes::derived_node_tree_types;
+using fn::GArray;
 using fn::GMutablePointer;
 using fn::GPointer;
 
+/**
+ * Identifies the outputs of a node in the #GeometryNodesCache. It is a 128 bit hash of the node
+ * itself and of everything its inputs depend on, so that different inputs practically never result
+ * in the same signature.
+ */
+struct NodeCacheSignature {
+  uint64_t values[2] = {0, 0};
+
+  uint64_t hash() const
+  {
+    return values[0];
+  }
+
+  friend bool operator==(const NodeCacheSignature &a, const NodeCacheSignature &b)
+  {
+    return a.values[0] == b.values[0] && a.values[1] == b.values[1];
+  }
+};
+
+/**
+ * Keeps the outputs of nodes between evaluations of the same modifier, so that nodes whose inputs
+ * did not change since the last evaluation don't have to be executed again. Every node is
+ * identified by a signature that is computed from the node itself and from everything its inputs
+ * depend on. This makes the cache independent of how the node tree is evaluated.
+ */
+class GeometryNodesCache : NonCopyable, NonMovable {
+ public:
+  struct Entry {
+    /** Copies of all outputs of the node, indexed by socket index. Empty for unused sockets. */
+    Array<GArray<>> outputs;
+    /** Estimate of the memory that is kept alive by the outputs. */
+    int64_t memory = 0;
+    /**
+     * Names of the node and of the group nodes it is in. Compared on lookup, so that a signature
+     * collision can't return the outputs of a different node.
+     */
+    std::string node_path;
+  };
+
+ private:
+  std::mutex mutex_;
+  Map<NodeCacheSignature, std::shared_ptr<const Entry>> entries_;
+  int64_t memory_used_ = 0;
+  uint64_t input_geometry_version_ = 0;
+  /** Session UUID of the original data-block the input geometry was created from. */
+  uint32_t input_data_session_uuid_ = 0;
+
+ public:
+  /**
+   * The geometry passed into the modifier is a new copy in every evaluation, so it is identified
+   * by a version that changes whenever the data it is created from has been tagged for an update,
+   * or when it is created from a different data-block.
+   */
+  uint64_t update_input_geometry_version(uint32_t data_session_uuid, bool data_changed);
+
+  std::shared_ptr<const Entry> lookup(const NodeCacheSignature &signature, StringRef node_path);
+
+  /** Returns false when there is not enough memory left to keep the entry. */
+  bool add(const NodeCacheSignature &signature, std::shared_ptr<const Entry> entry);
+
+  /** Remove all entries that have not been used in the last evaluation. */
+  void remove_unused(const Set<NodeCacheSignature> &used_signatures);
+};
+
 struct GeometryNodesEvaluationParams {
   blender::LinearAllocator<> allocator;
 
@@ -52,6 +123,13 @@ struct GeometryNodesEvaluationParams {
   Depsgraph *depsgraph;
   Object *self_object;
   geo_log::GeoLogger *geo_logger;
+  /* Print how much time was spent in every node and how much scheduling overhead there was. */
+  bool print_timings = false;
+  /* Reuse outputs of nodes from previous evaluations when this is not null. */
+  GeometryNodesCache *node_cache = nullptr;
+  /* Identifies the geometry passed into the modifier in the node cache. Nodes depending on it are
+   * not cached when it is not set. */
+  std::optional<uint64_t> input_geometry_version;
 
   Vector<GMutablePointer> r_output_values;
 };
@@ -118,7 +118,9 @@ static void freeRuntimeData(void *runtime_data_v)
   }
   SubsurfRuntimeData *runtime_data = (SubsurfRuntimeData *)runtime_data_v;
   if (runtime_data->subdiv != NULL) {
-    BKE_subdiv_free(runtime_data->subdiv);
+    /* Keep the descriptor around for re-use, e.g. after undo or by another object with the same
+     * base mesh topology. */
+    BKE_subdiv_cache_release(runtime_data->subdiv);
   }
   MEM_freeN(runtime_data);
 }
@@ -181,7 +183,8 @@ static Subdiv *subdiv_descriptor_ensure(SubsurfModifierData *smd,
                                         const Mesh *mesh)
 {
   SubsurfRuntimeData *runtime_data = (SubsurfRuntimeData *)smd->modifier.runtime;
-  Subdiv *subdiv = BKE_subdiv_update_from_mesh(runtime_data->subdiv, subdiv_settings, mesh);
+  Subdiv *subdiv = BKE_subdiv_update_from_mesh_cached(
+      runtime_data->subdiv, subdiv_settings, mesh);
   runtime_data->subdiv = subdiv;
   return subdiv;
 }
@@ -280,6 +283,8 @@ static Mesh *modifyMesh(ModifierData *md, const ModifierEvalContext *ctx, Mesh *
     BKE_mesh_calc_normals_split(mesh);
     CustomData_clear_layer_flag(&mesh->ldata, CD_NORMAL, CD_FLAG_TEMPORARY);
   }
+  /* The descriptor is shared with other objects which have the same base mesh topology. */
+  BKE_subdiv_cache_eval_lock(subdiv);
   /* TODO(sergey): Decide whether we ever want to use CCG for subsurf,
    * maybe when it is a last modifier in the stack? */
   if (true) {
@@ -288,6 +293,7 @@ static Mesh *modifyMesh(ModifierData *md, const ModifierEvalContext *ctx, Mesh *
   else {
     result = subdiv_as_ccg(smd, ctx, mesh, subdiv);
   }
+  BKE_subdiv_cache_eval_unlock(subdiv);
 
   if (use_clnors) {
     float(*lnors)[3] = CustomData_get_layer(&result->ldata, CD_NORMAL);
@@ -330,7 +336,9 @@ static void deformMatrices(ModifierData *md,
     /* Happens on bad topology, but also on empty input mesh. */
     return;
   }
+  BKE_subdiv_cache_eval_lock(subdiv);
   BKE_subdiv_deform_coarse_vertices(subdiv, mesh, vertex_cos, num_verts);
+  BKE_subdiv_cache_eval_unlock(subdiv);
   if (subdiv != runtime_data->subdiv) {
     BKE_subdiv_free(subdiv);
   }
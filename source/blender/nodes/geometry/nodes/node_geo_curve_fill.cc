@@ -63,15 +63,16 @@ static blender::meshintersect::CDT_result<double> do_cdt(const CurveEval &curve,
   input.vert.reinitialize(offsets.last());
   input.face.reinitialize(splines.size());
 
+  Array<float3> positions(offsets.last());
+  curve.evaluate_positions(offsets, positions);
+  for (const int i : positions.index_range()) {
+    input.vert[i] = double2(positions[i].x, positions[i].y);
+  }
+
   for (const int i_spline : splines.index_range()) {
     const SplinePtr &spline = splines[i_spline];
     const int vert_offset = offsets[i_spline];
 
-    Span<float3> positions = spline->evaluated_positions();
-    for (const int i : positions.index_range()) {
-      input.vert[vert_offset + i] = double2(positions[i].x, positions[i].y);
-    }
-
     input.face[i_spline].resize(spline->evaluated_edges_size());
     MutableSpan<int> face_verts = input.face[i_spline];
     for (const int i : IndexRange(spline->evaluated_edges_size())) {
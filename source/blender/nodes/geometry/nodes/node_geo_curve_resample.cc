@@ -175,6 +175,7 @@ static std::unique_ptr<CurveEval> resample_curve(const CurveComponent *component
   const int domain_size = component->attribute_domain_size(ATTR_DOMAIN_CURVE);
 
   Span<SplinePtr> input_splines = input_curve->splines();
+  input_curve->ensure_evaluated_positions();
 
   std::unique_ptr<CurveEval> output_curve = std::make_unique<CurveEval>();
   output_curve->resize(input_splines.size());
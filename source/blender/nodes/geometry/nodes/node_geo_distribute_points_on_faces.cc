@@ -14,7 +14,6 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
-#include "BLI_kdtree.h"
 #include "BLI_noise.hh"
 #include "BLI_rand.hh"
 #include "BLI_task.hh"
@@ -95,6 +94,14 @@ static float3 normal_to_euler_rotation(const float3 normal)
   return rotation;
 }
 
+/**
+ * The points are generated in two passes, so that every triangle can be processed in parallel
+ * while the result stays the same for any number of threads. The first pass computes the number
+ * of points on every triangle from its area. The accumulated counts are the offsets of the points
+ * of every triangle in the result, so that the second pass can write the points of every triangle
+ * directly to their final place. The random numbers of a triangle only depend on the seed and the
+ * triangle index.
+ */
 static void sample_mesh_surface(const Mesh &mesh,
                                 const float base_density,
                                 const Span<float> density_factors,
@@ -106,60 +113,211 @@ static void sample_mesh_surface(const Mesh &mesh,
   const Span<MLoopTri> looptris{BKE_mesh_runtime_looptri_ensure(&mesh),
                                 BKE_mesh_runtime_looptri_len(&mesh)};
 
+  Array<int> offsets(looptris.size() + 1);
+  threading::parallel_for(looptris.index_range(), 1024, [&](IndexRange range) {
+    for (const int looptri_index : range) {
+      const MLoopTri &looptri = looptris[looptri_index];
+      const int v0_loop = looptri.tri[0];
+      const int v1_loop = looptri.tri[1];
+      const int v2_loop = looptri.tri[2];
+      const float3 v0_pos = float3(mesh.mvert[mesh.mloop[v0_loop].v].co);
+      const float3 v1_pos = float3(mesh.mvert[mesh.mloop[v1_loop].v].co);
+      const float3 v2_pos = float3(mesh.mvert[mesh.mloop[v2_loop].v].co);
+
+      float looptri_density_factor = 1.0f;
+      if (!density_factors.is_empty()) {
+        const float v0_density_factor = std::max(0.0f, density_factors[v0_loop]);
+        const float v1_density_factor = std::max(0.0f, density_factors[v1_loop]);
+        const float v2_density_factor = std::max(0.0f, density_factors[v2_loop]);
+        looptri_density_factor = (v0_density_factor + v1_density_factor + v2_density_factor) /
+                                 3.0f;
+      }
+      const float area = area_tri_v3(v0_pos, v1_pos, v2_pos);
+
+      const int looptri_seed = noise::hash(looptri_index, seed);
+      RandomNumberGenerator looptri_rng(looptri_seed);
+
+      const float points_amount_fl = area * base_density * looptri_density_factor;
+      const float add_point_probability = fractf(points_amount_fl);
+      const bool add_point = add_point_probability > looptri_rng.get_float();
+      offsets[looptri_index] = (int)points_amount_fl + (int)add_point;
+    }
+  });
+
+  int total_points = 0;
   for (const int looptri_index : looptris.index_range()) {
-    const MLoopTri &looptri = looptris[looptri_index];
-    const int v0_loop = looptri.tri[0];
-    const int v1_loop = looptri.tri[1];
-    const int v2_loop = looptri.tri[2];
-    const int v0_index = mesh.mloop[v0_loop].v;
-    const int v1_index = mesh.mloop[v1_loop].v;
-    const int v2_index = mesh.mloop[v2_loop].v;
-    const float3 v0_pos = float3(mesh.mvert[v0_index].co);
-    const float3 v1_pos = float3(mesh.mvert[v1_index].co);
-    const float3 v2_pos = float3(mesh.mvert[v2_index].co);
-
-    float looptri_density_factor = 1.0f;
-    if (!density_factors.is_empty()) {
-      const float v0_density_factor = std::max(0.0f, density_factors[v0_loop]);
-      const float v1_density_factor = std::max(0.0f, density_factors[v1_loop]);
-      const float v2_density_factor = std::max(0.0f, density_factors[v2_loop]);
-      looptri_density_factor = (v0_density_factor + v1_density_factor + v2_density_factor) / 3.0f;
+    const int point_amount = offsets[looptri_index];
+    offsets[looptri_index] = total_points;
+    total_points += point_amount;
+  }
+  offsets.last() = total_points;
+
+  r_positions.resize(total_points);
+  r_bary_coords.resize(total_points);
+  r_looptri_indices.resize(total_points);
+
+  threading::parallel_for(looptris.index_range(), 1024, [&](IndexRange range) {
+    for (const int looptri_index : range) {
+      const IndexRange points_range{offsets[looptri_index],
+                                    offsets[looptri_index + 1] - offsets[looptri_index]};
+      if (points_range.size() == 0) {
+        continue;
+      }
+      const MLoopTri &looptri = looptris[looptri_index];
+      const float3 v0_pos = float3(mesh.mvert[mesh.mloop[looptri.tri[0]].v].co);
+      const float3 v1_pos = float3(mesh.mvert[mesh.mloop[looptri.tri[1]].v].co);
+      const float3 v2_pos = float3(mesh.mvert[mesh.mloop[looptri.tri[2]].v].co);
+
+      const int looptri_seed = noise::hash(looptri_index, seed);
+      RandomNumberGenerator looptri_rng(looptri_seed);
+      /* Skip the random number that was used to compute the number of points. */
+      looptri_rng.get_float();
+
+      for (const int i : points_range) {
+        const float3 bary_coord = looptri_rng.get_barycentric_coordinates();
+        interp_v3_v3v3v3(r_positions[i], v0_pos, v1_pos, v2_pos, bary_coord);
+        r_bary_coords[i] = bary_coord;
+        r_looptri_indices[i] = looptri_index;
+      }
     }
-    const float area = area_tri_v3(v0_pos, v1_pos, v2_pos);
-
-    const int looptri_seed = noise::hash(looptri_index, seed);
-    RandomNumberGenerator looptri_rng(looptri_seed);
-
-    const float points_amount_fl = area * base_density * looptri_density_factor;
-    const float add_point_probability = fractf(points_amount_fl);
-    const bool add_point = add_point_probability > looptri_rng.get_float();
-    const int point_amount = (int)points_amount_fl + (int)add_point;
-
-    for (int i = 0; i < point_amount; i++) {
-      const float3 bary_coord = looptri_rng.get_barycentric_coordinates();
-      float3 point_pos;
-      interp_v3_v3v3v3(point_pos, v0_pos, v1_pos, v2_pos, bary_coord);
-      r_positions.append(point_pos);
-      r_bary_coords.append(bary_coord);
-      r_looptri_indices.append(looptri_index);
+  });
+}
+
+/**
+ * A uniform grid with cells as large as the minimum distance, so that all points that are closer
+ * than that are in the same or in neighboring cells. The cells are hashed into a fixed number of
+ * buckets, which avoids allocating memory for the empty parts of the bounding box.
+ */
+struct GridCell {
+  int x, y, z;
+};
+
+struct PointGrid {
+  float cell_size_inv;
+  uint32_t bucket_mask;
+  /** The points of a bucket are `point_indices[bucket_offsets[i]:bucket_offsets[i + 1]]`. */
+  Array<int> bucket_offsets;
+  Array<int> point_indices;
+};
+
+static GridCell point_grid_cell(const PointGrid &grid, const float3 &position)
+{
+  /* Clamping keeps neighboring points in neighboring cells and avoids integer overflow. */
+  const float limit = 1e9f;
+  return {(int)floorf(std::clamp(position.x * grid.cell_size_inv, -limit, limit)),
+          (int)floorf(std::clamp(position.y * grid.cell_size_inv, -limit, limit)),
+          (int)floorf(std::clamp(position.z * grid.cell_size_inv, -limit, limit))};
+}
+
+static uint32_t point_grid_bucket(const PointGrid &grid, const GridCell &cell)
+{
+  return noise::hash(cell.x, cell.y, cell.z) & grid.bucket_mask;
+}
+
+BLI_NOINLINE static PointGrid build_point_grid(Span<float3> positions, const float cell_size)
+{
+  PointGrid grid;
+  grid.cell_size_inv = 1.0f / cell_size;
+  const int buckets_amount = power_of_2_max_i(std::max<int>(positions.size(), 1));
+  grid.bucket_mask = buckets_amount - 1;
+
+  Array<uint32_t> point_buckets(positions.size());
+  threading::parallel_for(positions.index_range(), 4096, [&](IndexRange range) {
+    for (const int i : range) {
+      point_buckets[i] = point_grid_bucket(grid, point_grid_cell(grid, positions[i]));
     }
+  });
+
+  /* Counting sort keeps the points of every bucket in index order. */
+  grid.bucket_offsets.reinitialize(buckets_amount + 1);
+  grid.bucket_offsets.fill(0);
+  for (const uint32_t bucket : point_buckets) {
+    grid.bucket_offsets[bucket + 1]++;
   }
+  for (const int i : IndexRange(buckets_amount)) {
+    grid.bucket_offsets[i + 1] += grid.bucket_offsets[i];
+  }
+  Array<int> bucket_fill(grid.bucket_offsets.as_span().drop_back(1));
+  grid.point_indices.reinitialize(positions.size());
+  for (const int i : positions.index_range()) {
+    grid.point_indices[bucket_fill[point_buckets[i]]++] = i;
+  }
+  return grid;
 }
 
-BLI_NOINLINE static KDTree_3d *build_kdtree(Span<float3> positions)
+/**
+ * Call the function for all points in the cells around the position. Points may be passed to the
+ * function more than once, when different cells are hashed to the same bucket.
+ */
+template<typename Fn>
+static void point_grid_foreach_neighbor(const PointGrid &grid,
+                                        const float3 &position,
+                                        const Fn &fn)
 {
-  KDTree_3d *kdtree = BLI_kdtree_3d_new(positions.size());
-
-  int i_point = 0;
-  for (const float3 position : positions) {
-    BLI_kdtree_3d_insert(kdtree, i_point, position);
-    i_point++;
+  const GridCell cell = point_grid_cell(grid, position);
+  for (int z = cell.z - 1; z <= cell.z + 1; z++) {
+    for (int y = cell.y - 1; y <= cell.y + 1; y++) {
+      for (int x = cell.x - 1; x <= cell.x + 1; x++) {
+        const uint32_t bucket = point_grid_bucket(grid, {x, y, z});
+        for (const int i : IndexRange(grid.bucket_offsets[bucket],
+                                      grid.bucket_offsets[bucket + 1] -
+                                          grid.bucket_offsets[bucket])) {
+          if (!fn(grid.point_indices[i])) {
+            return;
+          }
+        }
+      }
+    }
   }
+}
+
+enum class EliminationState : uint8_t {
+  Undecided,
+  Kept,
+  Eliminated,
+};
 
-  BLI_kdtree_3d_balance(kdtree);
-  return kdtree;
+/**
+ * A point is kept when no other point with a lower index that is kept is closer than the minimum
+ * distance. The result is undecided as long as such a close point is undecided itself.
+ */
+static EliminationState decide_point_elimination(const PointGrid &grid,
+                                                 Span<float3> positions,
+                                                 Span<EliminationState> states,
+                                                 const float minimum_distance_sq,
+                                                 const int point_index)
+{
+  const float3 position = positions[point_index];
+  EliminationState result = EliminationState::Kept;
+  point_grid_foreach_neighbor(grid, position, [&](const int other_index) {
+    if (other_index >= point_index) {
+      return true;
+    }
+    if (float3::distance_squared(position, positions[other_index]) > minimum_distance_sq) {
+      return true;
+    }
+    switch (states[other_index]) {
+      case EliminationState::Kept:
+        result = EliminationState::Eliminated;
+        return false;
+      case EliminationState::Undecided:
+        result = EliminationState::Undecided;
+        return true;
+      case EliminationState::Eliminated:
+        return true;
+    }
+    return true;
+  });
+  return result;
 }
 
+/**
+ * Gives the same result as processing the points in index order and eliminating all points that
+ * are close to every point that has not been eliminated yet. Instead of processing the points
+ * one by one, all points that can already be decided are decided in parallel in every round.
+ * Since the decisions only depend on the point order, the result does not depend on the number
+ * of threads.
+ */
 BLI_NOINLINE static void update_elimination_mask_for_close_points(
     Span<float3> positions, const float minimum_distance, MutableSpan<bool> elimination_mask)
 {
@@ -167,33 +325,61 @@ BLI_NOINLINE static void update_elimination_mask_for_close_points(
     return;
   }
 
-  KDTree_3d *kdtree = build_kdtree(positions);
+  const PointGrid grid = build_point_grid(positions, minimum_distance);
+  const float minimum_distance_sq = minimum_distance * minimum_distance;
 
+  Array<EliminationState> states(positions.size());
+  Vector<int> undecided_points;
   for (const int i : positions.index_range()) {
     if (elimination_mask[i]) {
-      continue;
+      states[i] = EliminationState::Eliminated;
     }
+    else {
+      states[i] = EliminationState::Undecided;
+      undecided_points.append(i);
+    }
+  }
 
-    struct CallbackData {
-      int index;
-      MutableSpan<bool> elimination_mask;
-    } callback_data = {i, elimination_mask};
-
-    BLI_kdtree_3d_range_search_cb(
-        kdtree,
-        positions[i],
-        minimum_distance,
-        [](void *user_data, int index, const float *UNUSED(co), float UNUSED(dist_sq)) {
-          CallbackData &callback_data = *static_cast<CallbackData *>(user_data);
-          if (index != callback_data.index) {
-            callback_data.elimination_mask[index] = true;
-          }
-          return true;
-        },
-        &callback_data);
+  Array<EliminationState> decisions;
+  while (!undecided_points.is_empty()) {
+    decisions.reinitialize(undecided_points.size());
+    threading::parallel_for(undecided_points.index_range(), 1024, [&](IndexRange range) {
+      for (const int i : range) {
+        decisions[i] = decide_point_elimination(
+            grid, positions, states, minimum_distance_sq, undecided_points[i]);
+      }
+    });
+
+    int still_undecided_amount = 0;
+    for (const int i : undecided_points.index_range()) {
+      const int point_index = undecided_points[i];
+      if (decisions[i] == EliminationState::Undecided) {
+        undecided_points[still_undecided_amount++] = point_index;
+      }
+      else {
+        states[point_index] = decisions[i];
+      }
+    }
+    const int decided_amount = undecided_points.size() - still_undecided_amount;
+    undecided_points.resize(still_undecided_amount);
+
+    /* The points can depend on each other in long chains, e.g. for points along a line. Then only
+     * few points are decided in every round, and deciding the remaining points in order is
+     * faster. All points with a lower index are decided at the time a point is processed. */
+    if (decided_amount * 8 < still_undecided_amount) {
+      for (const int point_index : undecided_points) {
+        states[point_index] = decide_point_elimination(
+            grid, positions, states, minimum_distance_sq, point_index);
+      }
+      break;
+    }
   }
 
-  BLI_kdtree_3d_free(kdtree);
+  threading::parallel_for(positions.index_range(), 4096, [&](IndexRange range) {
+    for (const int i : range) {
+      elimination_mask[i] = states[i] == EliminationState::Eliminated;
+    }
+  });
 }
 
 BLI_NOINLINE static void update_elimination_mask_based_on_density_factors(
@@ -205,32 +391,40 @@ BLI_NOINLINE static void update_elimination_mask_based_on_density_factors(
 {
   const Span<MLoopTri> looptris{BKE_mesh_runtime_looptri_ensure(&mesh),
                                 BKE_mesh_runtime_looptri_len(&mesh)};
-  for (const int i : bary_coords.index_range()) {
-    if (elimination_mask[i]) {
-      continue;
-    }
+  threading::parallel_for(bary_coords.index_range(), 2048, [&](IndexRange range) {
+    for (const int i : range) {
+      if (elimination_mask[i]) {
+        continue;
+      }
 
-    const MLoopTri &looptri = looptris[looptri_indices[i]];
-    const float3 bary_coord = bary_coords[i];
+      const MLoopTri &looptri = looptris[looptri_indices[i]];
+      const float3 bary_coord = bary_coords[i];
 
-    const int v0_loop = looptri.tri[0];
-    const int v1_loop = looptri.tri[1];
-    const int v2_loop = looptri.tri[2];
+      const int v0_loop = looptri.tri[0];
+      const int v1_loop = looptri.tri[1];
+      const int v2_loop = looptri.tri[2];
 
-    const float v0_density_factor = std::max(0.0f, density_factors[v0_loop]);
-    const float v1_density_factor = std::max(0.0f, density_factors[v1_loop]);
-    const float v2_density_factor = std::max(0.0f, density_factors[v2_loop]);
+      const float v0_density_factor = std::max(0.0f, density_factors[v0_loop]);
+      const float v1_density_factor = std::max(0.0f, density_factors[v1_loop]);
+      const float v2_density_factor = std::max(0.0f, density_factors[v2_loop]);
 
-    const float probablity = v0_density_factor * bary_coord.x + v1_density_factor * bary_coord.y +
-                             v2_density_factor * bary_coord.z;
+      const float probablity = v0_density_factor * bary_coord.x +
+                               v1_density_factor * bary_coord.y +
+                               v2_density_factor * bary_coord.z;
 
-    const float hash = noise::hash_float_to_float(bary_coord);
-    if (hash > probablity) {
-      elimination_mask[i] = true;
+      const float hash = noise::hash_float_to_float(bary_coord);
+      if (hash > probablity) {
+        elimination_mask[i] = true;
+      }
     }
-  }
+  });
 }
 
+/**
+ * Remove the eliminated points. The last remaining points are moved into the freed slots, so the
+ * order of the remaining points changes. This is the order the baseline produced, which existing
+ * files with a fixed seed depend on.
+ */
 BLI_NOINLINE static void eliminate_points_based_on_mask(const Span<bool> elimination_mask,
                                                         Vector<float3> &positions,
                                                         Vector<float3> &bary_coords,
@@ -252,35 +446,40 @@ BLI_NOINLINE static void interpolate_attribute(const Mesh &mesh,
                                                const GVArray &source_data,
                                                GMutableSpan output_data)
 {
-  switch (source_domain) {
-    case ATTR_DOMAIN_POINT: {
-      bke::mesh_surface_sample::sample_point_attribute(mesh,
-                                                       looptri_indices,
-                                                       bary_coords,
-                                                       source_data,
-                                                       IndexMask(output_data.size()),
-                                                       output_data);
-      break;
-    }
-    case ATTR_DOMAIN_CORNER: {
-      bke::mesh_surface_sample::sample_corner_attribute(mesh,
-                                                        looptri_indices,
-                                                        bary_coords,
-                                                        source_data,
-                                                        IndexMask(output_data.size()),
-                                                        output_data);
-      break;
-    }
-    case ATTR_DOMAIN_FACE: {
-      bke::mesh_surface_sample::sample_face_attribute(
-          mesh, looptri_indices, source_data, IndexMask(output_data.size()), output_data);
-      break;
-    }
-    default: {
-      /* Not supported currently. */
-      return;
-    }
+  if (!ELEM(source_domain, ATTR_DOMAIN_POINT, ATTR_DOMAIN_CORNER, ATTR_DOMAIN_FACE)) {
+    /* Not supported currently. */
+    return;
   }
+  /* Read the source values from a span to avoid virtual calls for every point. */
+  GVArray_GSpan source_span{source_data};
+  const fn::GVArray_For_GSpan source_varray{source_span};
+
+  /* Interpolate the points in batches, so that every thread writes a separate part of the
+   * output. */
+  threading::parallel_for(IndexRange(output_data.size()), 4096, [&](IndexRange range) {
+    const IndexMask mask{range};
+    switch (source_domain) {
+      case ATTR_DOMAIN_POINT: {
+        bke::mesh_surface_sample::sample_point_attribute(
+            mesh, looptri_indices, bary_coords, source_varray, mask, output_data);
+        break;
+      }
+      case ATTR_DOMAIN_CORNER: {
+        bke::mesh_surface_sample::sample_corner_attribute(
+            mesh, looptri_indices, bary_coords, source_varray, mask, output_data);
+        break;
+      }
+      case ATTR_DOMAIN_FACE: {
+        bke::mesh_surface_sample::sample_face_attribute(
+            mesh, looptri_indices, source_varray, mask, output_data);
+        break;
+      }
+      default: {
+        BLI_assert_unreachable();
+        break;
+      }
+    }
+  });
 }
 
 BLI_NOINLINE static void propagate_existing_attributes(
@@ -357,31 +556,33 @@ BLI_NOINLINE static void compute_attribute_outputs(const MeshComponent &mesh_com
   const Span<MLoopTri> looptris{BKE_mesh_runtime_looptri_ensure(&mesh),
                                 BKE_mesh_runtime_looptri_len(&mesh)};
 
-  for (const int i : bary_coords.index_range()) {
-    const int looptri_index = looptri_indices[i];
-    const MLoopTri &looptri = looptris[looptri_index];
-    const float3 &bary_coord = bary_coords[i];
-
-    const int v0_index = mesh.mloop[looptri.tri[0]].v;
-    const int v1_index = mesh.mloop[looptri.tri[1]].v;
-    const int v2_index = mesh.mloop[looptri.tri[2]].v;
-    const float3 v0_pos = float3(mesh.mvert[v0_index].co);
-    const float3 v1_pos = float3(mesh.mvert[v1_index].co);
-    const float3 v2_pos = float3(mesh.mvert[v2_index].co);
-
-    ids[i] = noise::hash(noise::hash_float(bary_coord), looptri_index);
-
-    float3 normal;
-    if (!normals.is_empty() || !rotations.is_empty()) {
-      normal_tri_v3(normal, v0_pos, v1_pos, v2_pos);
-    }
-    if (!normals.is_empty()) {
-      normals[i] = normal;
-    }
-    if (!rotations.is_empty()) {
-      rotations[i] = normal_to_euler_rotation(normal);
+  threading::parallel_for(bary_coords.index_range(), 2048, [&](IndexRange range) {
+    for (const int i : range) {
+      const int looptri_index = looptri_indices[i];
+      const MLoopTri &looptri = looptris[looptri_index];
+      const float3 &bary_coord = bary_coords[i];
+
+      const int v0_index = mesh.mloop[looptri.tri[0]].v;
+      const int v1_index = mesh.mloop[looptri.tri[1]].v;
+      const int v2_index = mesh.mloop[looptri.tri[2]].v;
+      const float3 v0_pos = float3(mesh.mvert[v0_index].co);
+      const float3 v1_pos = float3(mesh.mvert[v1_index].co);
+      const float3 v2_pos = float3(mesh.mvert[v2_index].co);
+
+      ids[i] = noise::hash(noise::hash_float(bary_coord), looptri_index);
+
+      float3 normal;
+      if (!normals.is_empty() || !rotations.is_empty()) {
+        normal_tri_v3(normal, v0_pos, v1_pos, v2_pos);
+      }
+      if (!normals.is_empty()) {
+        normals[i] = normal;
+      }
+      if (!rotations.is_empty()) {
+        rotations[i] = normal_to_euler_rotation(normal);
+      }
     }
-  }
+  });
 
   id_attribute.save();
 
@@ -68,17 +68,6 @@ static void add_instances_from_component(InstancesComponent &dst_component,
   selection_evaluator.evaluate();
   const IndexMask selection = selection_evaluator.get_evaluated_as_mask(0);
 
-  /* The initial size of the component might be non-zero when this function is called for multiple
-   * component types. */
-  const int start_len = dst_component.instances_amount();
-  const int select_len = selection.index_range().size();
-  dst_component.resize(start_len + select_len);
-
-  MutableSpan<int> dst_handles = dst_component.instance_reference_handles().slice(start_len,
-                                                                                  select_len);
-  MutableSpan<float4x4> dst_transforms = dst_component.instance_transforms().slice(start_len,
-                                                                                   select_len);
-
   FieldEvaluator field_evaluator{field_context, domain_size};
   const VArray<bool> *pick_instance = nullptr;
   const VArray<int> *indices = nullptr;
@@ -96,12 +85,49 @@ static void add_instances_from_component(InstancesComponent &dst_component,
       "position", domain, {0, 0, 0});
 
   const InstancesComponent *src_instances = instance.get_component_for_read<InstancesComponent>();
+  const bool may_pick_instances = src_instances != nullptr &&
+                                  (!pick_instance->is_single() ||
+                                   pick_instance->get_internal_single());
+
+  /* Store the transforms as position, rotation and scale when possible. That isn't possible when
+   * they are combined with the transforms of picked instances, which may result in shear. */
+  const int start_len = dst_component.instances_amount();
+  if (may_pick_instances) {
+    dst_component.ensure_matrix_transforms();
+  }
+  else if (start_len == 0) {
+    dst_component.use_compact_transforms();
+  }
+  const bool use_compact_transforms = dst_component.has_compact_transforms();
+
+  /* The initial size of the component might be non-zero when this function is called for multiple
+   * component types. */
+  const int select_len = selection.index_range().size();
+  dst_component.resize(start_len + select_len);
+
+  MutableSpan<int> dst_handles = dst_component.instance_reference_handles().slice(start_len,
+                                                                                  select_len);
+  MutableSpan<float4x4> dst_transforms;
+  MutableSpan<float3> dst_positions;
+  MutableSpan<float4> dst_rotations;
+  MutableSpan<float3> dst_scales;
+  if (use_compact_transforms) {
+    dst_positions = dst_component.instance_positions().slice(start_len, select_len);
+    dst_rotations = dst_component.instance_rotations().slice(start_len, select_len);
+    dst_scales = dst_component.instance_scales().slice(start_len, select_len);
+  }
+  else {
+    dst_transforms = dst_component.instance_transforms().slice(start_len, select_len);
+  }
 
   /* Maps handles from the source instances to handles on the new instance. */
   Array<int> handle_mapping;
+  /* Transforms of the source instances, retrieved once because they may be computed from the
+   * compact storage. */
+  Span<float4x4> src_transforms;
   /* Only fill #handle_mapping when it may be used below. */
-  if (src_instances != nullptr &&
-      (!pick_instance->is_single() || pick_instance->get_internal_single())) {
+  if (may_pick_instances) {
+    src_transforms = src_instances->instance_transforms();
     Span<InstanceReference> src_references = src_instances->references();
     handle_mapping.reinitialize(src_references.size());
     for (const int src_instance_handle : src_references.index_range()) {
@@ -119,6 +145,16 @@ static void add_instances_from_component(InstancesComponent &dst_component,
     for (const int range_i : selection_range) {
       const int64_t i = selection[range_i];
 
+      if (use_compact_transforms) {
+        /* No instances are picked in this case, so only the transforms have to be set. */
+        dst_positions[range_i] = positions[i];
+        eul_to_quat(dst_rotations[range_i], rotations->get(i));
+        dst_scales[range_i] = scales->get(i);
+        dst_handles[range_i] = pick_instance->get(i) ? empty_reference_handle :
+                                                       full_instance_handle;
+        continue;
+      }
+
       /* Compute base transform for every instances. */
       float4x4 &dst_transform = dst_transforms[range_i];
       dst_transform = float4x4::from_loc_eul_scale(
@@ -141,8 +177,7 @@ static void add_instances_from_component(InstancesComponent &dst_component,
             dst_handle = handle_mapping[src_handle];
 
             /* Take transforms of the source instance into account. */
-            mul_m4_m4_post(dst_transform.values,
-                           src_instances->instance_transforms()[index].values);
+            mul_m4_m4_post(dst_transform.values, src_transforms[index].values);
           }
         }
       }
@@ -257,8 +257,14 @@ static void join_components(Span<const InstancesComponent *> src_components, Geo
   InstancesComponent &dst_component = result.get_component_for_write<InstancesComponent>();
 
   int tot_instances = 0;
+  bool all_compact = true;
   for (const InstancesComponent *src_component : src_components) {
     tot_instances += src_component->instances_amount();
+    all_compact &= src_component->has_compact_transforms();
+  }
+  /* Only keep the compact transforms when they don't have to be converted from matrices. */
+  if (all_compact && dst_component.instances_amount() == 0) {
+    dst_component.use_compact_transforms();
   }
   dst_component.reserve(tot_instances);
 
@@ -269,9 +275,20 @@ static void join_components(Span<const InstancesComponent *> src_components, Geo
       handle_map[src_handle] = dst_component.add_reference(src_references[src_handle]);
     }
 
-    Span<float4x4> src_transforms = src_component->instance_transforms();
     Span<int> src_reference_handles = src_component->instance_reference_handles();
 
+    if (src_component->has_compact_transforms()) {
+      Span<float3> src_positions = src_component->instance_positions();
+      Span<float4> src_rotations = src_component->instance_rotations();
+      Span<float3> src_scales = src_component->instance_scales();
+      for (const int i : src_reference_handles.index_range()) {
+        const int dst_handle = handle_map[src_reference_handles[i]];
+        dst_component.add_instance(dst_handle, src_positions[i], src_rotations[i], src_scales[i]);
+      }
+      continue;
+    }
+
+    Span<float4x4> src_transforms = src_component->instance_transforms();
     for (const int i : src_transforms.index_range()) {
       const int src_handle = src_reference_handles[i];
       const int dst_handle = handle_map[src_handle];
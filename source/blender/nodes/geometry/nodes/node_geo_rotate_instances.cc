@@ -30,6 +30,62 @@ static void geo_node_rotate_instances_declare(NodeDeclarationBuilder &b)
   b.add_output<decl::Geometry>(N_("Instances"));
 };
 
+/**
+ * Same as the matrix version below, but changes the quaternion of every instance directly. In
+ * local space, rotating around the axes of the instance is the same as applying the euler
+ * rotation before the existing rotation.
+ */
+static void rotate_compact_instances(InstancesComponent &instances_component,
+                                     const IndexMask selection,
+                                     const VArray<float3> &rotations,
+                                     const VArray<float3> &pivots,
+                                     const VArray<bool> &local_spaces)
+{
+  MutableSpan<float3> positions = instances_component.instance_positions();
+  MutableSpan<float4> instance_rotations = instances_component.instance_rotations();
+  Span<float3> scales = instances_component.instance_scales();
+
+  threading::parallel_for(selection.index_range(), 512, [&](IndexRange range) {
+    for (const int i_selection : range) {
+      const int i = selection[i_selection];
+      float3 euler = rotations[i];
+      float4 &instance_rotation = instance_rotations[i];
+
+      float4 rotation;
+      float3 used_pivot;
+      if (local_spaces[i]) {
+        /* A negative scale flips the axes of the instance, inverting the rotation around them. */
+        const float3 scale = scales[i];
+        euler.x = scale.x < 0.0f ? -euler.x : euler.x;
+        euler.y = scale.y < 0.0f ? -euler.y : euler.y;
+        euler.z = scale.z < 0.0f ? -euler.z : euler.z;
+
+        float4 local_rotation;
+        eul_to_quat(local_rotation, euler);
+        /* Build the same rotation in world space. */
+        float4 inverse_rotation;
+        invert_qt_qt_normalized(inverse_rotation, instance_rotation);
+        mul_qt_qtqt(rotation, instance_rotation, local_rotation);
+        mul_qt_qtqt(rotation, rotation, inverse_rotation);
+
+        /* Transform the passed in pivot into the local space of the instance. */
+        used_pivot = pivots[i] * scale;
+        mul_qt_v3(instance_rotation, used_pivot);
+        used_pivot += positions[i];
+      }
+      else {
+        used_pivot = pivots[i];
+        eul_to_quat(rotation, euler);
+      }
+
+      float3 offset = positions[i] - used_pivot;
+      mul_qt_v3(rotation, offset);
+      positions[i] = used_pivot + offset;
+      mul_qt_qtqt(instance_rotation, rotation, instance_rotation);
+    }
+  });
+}
+
 static void rotate_instances(GeoNodeExecParams &params, InstancesComponent &instances_component)
 {
   GeometryComponentFieldContext field_context{instances_component, ATTR_DOMAIN_POINT};
@@ -49,6 +105,11 @@ static void rotate_instances(GeoNodeExecParams &params, InstancesComponent &inst
   const VArray<float3> &pivots = transforms_evaluator.get_evaluated<float3>(1);
   const VArray<bool> &local_spaces = transforms_evaluator.get_evaluated<bool>(2);
 
+  if (instances_component.has_compact_transforms()) {
+    rotate_compact_instances(instances_component, selection, rotations, pivots, local_spaces);
+    return;
+  }
+
   MutableSpan<float4x4> instance_transforms = instances_component.instance_transforms();
 
   threading::parallel_for(selection.index_range(), 512, [&](IndexRange range) {
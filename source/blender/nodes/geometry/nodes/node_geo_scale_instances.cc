@@ -33,6 +33,54 @@ static void geo_node_scale_instances_declare(NodeDeclarationBuilder &b)
   b.add_output<decl::Geometry>(N_("Instances"));
 };
 
+static bool is_uniform(const float3 &scale)
+{
+  return scale.x == scale.y && scale.y == scale.z;
+}
+
+/**
+ * Scale the instances without building matrices. Scaling in local space only changes the scale
+ * and position of an instance. Scaling a rotated instance non-uniformly in world space results in
+ * shear though, which can only be stored in matrices, so false is returned for that case.
+ */
+static bool scale_compact_instances(InstancesComponent &instances_component,
+                                    const IndexMask selection,
+                                    const VArray<float3> &scales,
+                                    const VArray<float3> &pivots,
+                                    const VArray<bool> &local_spaces)
+{
+  for (const int i : selection) {
+    if (!local_spaces[i] && !is_uniform(scales[i])) {
+      return false;
+    }
+  }
+
+  MutableSpan<float3> positions = instances_component.instance_positions();
+  Span<float4> rotations = instances_component.instance_rotations();
+  MutableSpan<float3> instance_scales = instances_component.instance_scales();
+
+  threading::parallel_for(selection.index_range(), 512, [&](IndexRange range) {
+    for (const int i_selection : range) {
+      const int i = selection[i_selection];
+      const float3 pivot = pivots[i];
+      const float3 scale = scales[i];
+
+      if (local_spaces[i]) {
+        /* Keep the pivot at the same place in the local space of the instance. */
+        float3 offset = (pivot - pivot * scale) * instance_scales[i];
+        mul_qt_v3(rotations[i], offset);
+        positions[i] += offset;
+        instance_scales[i] *= scale;
+      }
+      else {
+        positions[i] = pivot + (positions[i] - pivot) * scale.x;
+        instance_scales[i] *= scale.x;
+      }
+    }
+  });
+  return true;
+}
+
 static void scale_instances(GeoNodeExecParams &params, InstancesComponent &instances_component)
 {
   GeometryComponentFieldContext field_context{instances_component, ATTR_DOMAIN_POINT};
@@ -51,6 +99,12 @@ static void scale_instances(GeoNodeExecParams &params, InstancesComponent &insta
   const VArray<float3> &pivots = transforms_evaluator.get_evaluated<float3>(1);
   const VArray<bool> &local_spaces = transforms_evaluator.get_evaluated<bool>(2);
 
+  if (instances_component.has_compact_transforms()) {
+    if (scale_compact_instances(instances_component, selection, scales, pivots, local_spaces)) {
+      return;
+    }
+  }
+
   MutableSpan<float4x4> instance_transforms = instances_component.instance_transforms();
 
   threading::parallel_for(selection.index_range(), 512, [&](IndexRange range) {
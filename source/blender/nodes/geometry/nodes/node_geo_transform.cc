@@ -99,14 +99,49 @@ static void transform_pointcloud(PointCloud &pointcloud, const float4x4 &transfo
 
 static void translate_instances(InstancesComponent &instances, const float3 translation)
 {
+  if (instances.has_compact_transforms()) {
+    for (float3 &position : instances.instance_positions()) {
+      position += translation;
+    }
+    return;
+  }
   MutableSpan<float4x4> transforms = instances.instance_transforms();
   for (float4x4 &transform : transforms) {
     add_v3_v3(transform.ptr()[3], translation);
   }
 }
 
+/**
+ * Transforms with shear or a non-uniform scale can't be applied to compact instance transforms
+ * without introducing shear, so the instances are converted to matrices in that case.
+ */
+static bool transform_compact_instances(InstancesComponent &instances, const float4x4 &transform)
+{
+  if (!is_uniform_scaled_m4(transform.values)) {
+    return false;
+  }
+  float3 translation;
+  float4 rotation;
+  float3 scale;
+  mat4_decompose(translation, rotation, scale, transform.values);
+
+  for (float3 &position : instances.instance_positions()) {
+    position = transform * position;
+  }
+  for (float4 &instance_rotation : instances.instance_rotations()) {
+    mul_qt_qtqt(instance_rotation, rotation, instance_rotation);
+  }
+  for (float3 &instance_scale : instances.instance_scales()) {
+    instance_scale *= scale.x;
+  }
+  return true;
+}
+
 static void transform_instances(InstancesComponent &instances, const float4x4 &transform)
 {
+  if (instances.has_compact_transforms() && transform_compact_instances(instances, transform)) {
+    return;
+  }
   MutableSpan<float4x4> instance_transforms = instances.instance_transforms();
   for (float4x4 &instance_transform : instance_transforms) {
     instance_transform = transform * instance_transform;
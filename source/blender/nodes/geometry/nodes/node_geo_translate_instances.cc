@@ -45,6 +45,26 @@ static void translate_instances(GeoNodeExecParams &params, InstancesComponent &i
   const VArray<float3> &translations = transforms_evaluator.get_evaluated<float3>(0);
   const VArray<bool> &local_spaces = transforms_evaluator.get_evaluated<bool>(1);
 
+  if (instances_component.has_compact_transforms()) {
+    MutableSpan<float3> positions = instances_component.instance_positions();
+    Span<float4> rotations = instances_component.instance_rotations();
+    Span<float3> scales = instances_component.instance_scales();
+    threading::parallel_for(selection.index_range(), 1024, [&](IndexRange range) {
+      for (const int i_selection : range) {
+        const int i = selection[i_selection];
+        if (local_spaces[i]) {
+          float3 translation = translations[i] * scales[i];
+          mul_qt_v3(rotations[i], translation);
+          positions[i] += translation;
+        }
+        else {
+          positions[i] += translations[i];
+        }
+      }
+    });
+    return;
+  }
+
   MutableSpan<float4x4> instance_transforms = instances_component.instance_transforms();
 
   threading::parallel_for(selection.index_range(), 1024, [&](IndexRange range) {
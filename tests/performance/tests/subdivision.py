@@ -0,0 +1,53 @@
+# Apache License, Version 2.0
+
+import api
+
+
+def _run(args):
+    import bpy
+    import time
+
+    bpy.ops.object.select_all(action='SELECT')
+    bpy.ops.object.delete()
+    bpy.ops.mesh.primitive_monkey_add()
+    ob = bpy.context.active_object
+    modifier = ob.modifiers.new("Subdivision", 'SUBSURF')
+    modifier.levels = args['levels']
+
+    depsgraph = bpy.context.evaluated_depsgraph_get()
+
+    start_time = time.time()
+    elapsed_time = 0.0
+    num_evaluations = 0
+
+    while elapsed_time < 10.0:
+        ob.update_tag()
+        depsgraph.update()
+
+        num_evaluations += 1
+        elapsed_time = time.time() - start_time
+
+    time_per_evaluation = elapsed_time / num_evaluations
+
+    result = {'time': time_per_evaluation}
+    return result
+
+
+class SubdivisionTest(api.Test):
+    def __init__(self, levels):
+        self.levels = levels
+
+    def name(self):
+        return f"subdivision_level_{self.levels}"
+
+    def category(self):
+        return "subdivision"
+
+    def run(self, env, device_id):
+        args = {'levels': self.levels}
+        result, _ = env.run_in_blender(_run, args)
+        return result
+
+
+def generate(env):
+    return [SubdivisionTest(levels) for levels in range(1, 5)]